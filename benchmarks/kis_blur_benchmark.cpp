@@ -38,6 +38,10 @@
 #include <kis_iterator_ng.h>
 #include <KisGlobalResourcesInterface.h>
 
+#include <kis_convolution_painter.h>
+#include <kis_convolution_kernel.h>
+#include <kis_gaussian_kernel.h>
+
 void KisBlurBenchmark::initTestCase()
 {
     m_colorSpace = KoColorSpaceRegistry::instance()->rgb8();    
@@ -88,6 +92,44 @@ void KisBlurBenchmark::benchmarkFilter()
     }
 }
 
+void KisBlurBenchmark::benchmarkGaussian_data()
+{
+    QTest::addColumn<qreal>("radius");
+    QTest::addColumn<bool>("recursive");
+
+    for (qreal radius = 5; radius <= 80; radius *= 4) {
+        QTest::newRow(QString("recursive %1").arg(radius).toLatin1()) << radius << true;
+
+        if (KisConvolutionPainter::supportsFFTW()) {
+            QTest::newRow(QString("fftw %1").arg(radius).toLatin1()) << radius << false;
+        }
+    }
+}
+
+void KisBlurBenchmark::benchmarkGaussian()
+{
+    QFETCH(qreal, radius);
+    QFETCH(bool, recursive);
 
+    const QRect rc(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+    KisPaintDeviceSP dev = new KisPaintDevice(m_colorSpace);
+
+    KisConvolutionKernelSP kernel;
+    if (!recursive) {
+        kernel = KisGaussianKernel::createUniform2DKernel(radius, radius);
+    }
+
+    const qreal sigma = KisGaussianKernel::sigmaFromRadius(radius);
+
+    QBENCHMARK {
+        KisConvolutionPainter painter(dev, KisConvolutionPainter::FFTW);
+
+        if (recursive) {
+            painter.applyGaussian(m_device, rc.topLeft(), rc.topLeft(), rc.size(), sigma, sigma);
+        } else {
+            painter.applyMatrix(kernel, m_device, rc.topLeft(), rc.topLeft(), rc.size());
+        }
+    }
+}
 
 QTEST_MAIN(KisBlurBenchmark)
@@ -48,6 +48,8 @@
 #include <KoColorSpaceTraits.h>
 #include <KoCompositeOpAlphaDarken.h>
 #include <KoCompositeOpOver.h>
+#include <KoCompositeOpGeneric.h>
+#include <KoCompositeOpRegistry.h>
 #include <KoOptimizedCompositeOpFactory.h>
 #include <KoAlphaDarkenParamsWrapper.h>
 
@@ -127,6 +129,27 @@ struct RandomGenerator<quint8>
     boost::mt11213b m_rnd;
 };
 
+template <>
+struct RandomGenerator<quint16>
+{
+    RandomGenerator(int seed)
+        : m_smallint(0,65535),
+          m_rnd(seed)
+    {
+    }
+
+    quint16 operator() () {
+        return m_smallint(m_rnd);
+    }
+
+    quint16 unit() {
+        return KoColorSpaceMathsTraits<quint16>::unitValue;
+    }
+
+    boost::uniform_smallint<int> m_smallint;
+    boost::mt11213b m_rnd;
+};
+
 template <>
 struct RandomGenerator<float>
 {
@@ -255,6 +278,8 @@ QVector<Tile> generateTiles(int size,
 
         if (pixelSize == 4) {
             generateDataLine<quint8>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+        } else if (pixelSize == 8) {
+            generateDataLine<quint16>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else if (pixelSize == 16) {
             generateDataLine<float>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else {
@@ -322,7 +347,7 @@ bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec) {
     return true;
 }
 
-bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2)
+bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2, float floatPrecision = 2e-7)
 {
     Q_ASSERT(op1->colorSpace()->pixelSize() == op2->colorSpace()->pixelSize());
     const quint32 pixelSize = op1->colorSpace()->pixelSize();
@@ -330,8 +355,8 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, ALPHA_RANDOM, op1->colorSpace()->pixelSize());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -354,8 +379,12 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     if (pixelSize == 4) {
         compareResult = compareTwoOpsPixels<quint8>(tiles, 10);
     }
+    else if (pixelSize == 8) {
+        // the same relative precision as for the 8-bit ops
+        compareResult = compareTwoOpsPixels<quint16>(tiles, 10 * 257);
+    }
     else if (pixelSize == 16) {
-        compareResult = compareTwoOpsPixels<float>(tiles, 2e-7);
+        compareResult = compareTwoOpsPixels<float>(tiles, floatPrecision);
     }
     else {
         qFatal("Pixel size %i is not implemented", pixelSize);
@@ -409,11 +438,12 @@ void benchmarkCompositeOp(const KoCompositeOp *op,
     QVector<Tile> tiles =
         generateTiles(numTiles, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange, op->colorSpace()->pixelSize());
 
-    const int tileOffset = 4 * (processRect.y() * rowStride + processRect.x());
+    const quint32 pixelSize = op->colorSpace()->pixelSize();
+    const int tileOffset = pixelSize * (processRect.y() * rowStride + processRect.x());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -464,6 +494,84 @@ void benchmarkCompositeOp(const KoCompositeOp *op, const QString &postfix)
     benchmarkCompositeOp(op, false, 1.0, 1.0, 0, 0, ALPHA_UNIT, ALPHA_UNIT);
 }
 
+/**
+ * Legacy versions of the separable blending modes that have
+ * an optimized implementation in KoOptimizedCompositeOpFactory
+ */
+template<class Traits>
+QVector<KoCompositeOp*> createLegacyGenericOps(const KoColorSpace *cs)
+{
+    typedef typename Traits::channels_type Arg;
+
+    QVector<KoCompositeOp*> ops;
+    ops << new KoCompositeOpGenericSC<Traits, &cfMultiply<Arg>>(cs, COMPOSITE_MULT, "Multiply", KoCompositeOp::categoryArithmetic());
+    ops << new KoCompositeOpGenericSC<Traits, &cfScreen<Arg>>(cs, COMPOSITE_SCREEN, "Screen", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfOverlay<Arg>>(cs, COMPOSITE_OVERLAY, "Overlay", KoCompositeOp::categoryMix());
+    ops << new KoCompositeOpGenericSC<Traits, &cfAddition<Arg>>(cs, COMPOSITE_ADD, "Addition", KoCompositeOp::categoryArithmetic());
+    ops << new KoCompositeOpGenericSC<Traits, &cfSubtract<Arg>>(cs, COMPOSITE_SUBTRACT, "Subtract", KoCompositeOp::categoryArithmetic());
+    ops << new KoCompositeOpGenericSC<Traits, &cfDarkenOnly<Arg>>(cs, COMPOSITE_DARKEN, "Darken", KoCompositeOp::categoryDark());
+    ops << new KoCompositeOpGenericSC<Traits, &cfLightenOnly<Arg>>(cs, COMPOSITE_LIGHTEN, "Lighten", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfDifference<Arg>>(cs, COMPOSITE_DIFF, "Difference", KoCompositeOp::categoryNegative());
+    return ops;
+}
+
+KoCompositeOp* createOptimizedGenericOp(const KoCompositeOp *legacyOp)
+{
+    const KoColorSpace *cs = legacyOp->colorSpace();
+
+    switch (cs->pixelSize()) {
+    case 4:
+        return KoOptimizedCompositeOpFactory::createGenericOp32(cs, legacyOp->id(), legacyOp->description(), legacyOp->category());
+    case 8:
+        return KoOptimizedCompositeOpFactory::createGenericOp64(cs, legacyOp->id(), legacyOp->description(), legacyOp->category());
+    case 16:
+        return KoOptimizedCompositeOpFactory::createGenericOp128(cs, legacyOp->id(), legacyOp->description(), legacyOp->category());
+    }
+
+    qFatal("Pixel size %i is not implemented", cs->pixelSize());
+    return 0;
+}
+
+template<class Traits>
+void compareGenericOps(const KoColorSpace *cs, bool haveMask)
+{
+    QVector<KoCompositeOp*> legacyOps = createLegacyGenericOps<Traits>(cs);
+
+    Q_FOREACH (KoCompositeOp *opExp, legacyOps) {
+        KoCompositeOp *opAct = createOptimizedGenericOp(opExp);
+        QVERIFY(opAct);
+
+        // the legacy float ops use double precision for intermediate values
+        const bool result = compareTwoOps(haveMask, opAct, opExp, 1e-5);
+        if (!result) {
+            qDebug() << "Failed op:" << opExp->id();
+        }
+        QVERIFY(result);
+
+        delete opAct;
+    }
+
+    qDeleteAll(legacyOps);
+}
+
+template<class Traits>
+void benchmarkGenericOps(const KoColorSpace *cs, bool optimized)
+{
+    QVector<KoCompositeOp*> legacyOps = createLegacyGenericOps<Traits>(cs);
+
+    Q_FOREACH (KoCompositeOp *legacyOp, legacyOps) {
+        KoCompositeOp *op = optimized ? createOptimizedGenericOp(legacyOp) : legacyOp;
+        qDebug() << "Testing Composite Op:" << op->id() << "(" << (optimized ? "Optimized" : "Legacy") << ")";
+        benchmarkCompositeOp(op, true, 0.5, 0.3, 0, 0, ALPHA_RANDOM, ALPHA_RANDOM);
+
+        if (optimized) {
+            delete op;
+        }
+    }
+
+    qDeleteAll(legacyOps);
+}
+
 #ifdef HAVE_VC
 
 template<class Compositor>
@@ -710,6 +818,30 @@ void KisCompositionBenchmark::compareRgbF32OverOps()
     delete opAct;
 }
 
+void KisCompositionBenchmark::compareGenericOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    ::compareGenericOps<KoBgrU8Traits>(cs, true);
+}
+
+void KisCompositionBenchmark::compareGenericOpsNoMask()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    ::compareGenericOps<KoBgrU8Traits>(cs, false);
+}
+
+void KisCompositionBenchmark::compareRgb16GenericOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    ::compareGenericOps<KoBgrU16Traits>(cs, true);
+}
+
+void KisCompositionBenchmark::compareRgbF32GenericOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F32", "");
+    ::compareGenericOps<KoRgbF32Traits>(cs, true);
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenLegacy()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
@@ -774,6 +906,42 @@ void KisCompositionBenchmark::testRgbF32CompositeOverOptimized()
     delete op;
 }
 
+void KisCompositionBenchmark::testRgb8CompositeGenericLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    benchmarkGenericOps<KoBgrU8Traits>(cs, false);
+}
+
+void KisCompositionBenchmark::testRgb8CompositeGenericOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    benchmarkGenericOps<KoBgrU8Traits>(cs, true);
+}
+
+void KisCompositionBenchmark::testRgb16CompositeGenericLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    benchmarkGenericOps<KoBgrU16Traits>(cs, false);
+}
+
+void KisCompositionBenchmark::testRgb16CompositeGenericOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    benchmarkGenericOps<KoBgrU16Traits>(cs, true);
+}
+
+void KisCompositionBenchmark::testRgbF32CompositeGenericLegacy()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F32", "");
+    benchmarkGenericOps<KoRgbF32Traits>(cs, false);
+}
+
+void KisCompositionBenchmark::testRgbF32CompositeGenericOptimized()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F32", "");
+    benchmarkGenericOps<KoRgbF32Traits>(cs, true);
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenReal_Aligned()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
@@ -45,6 +45,10 @@ private Q_SLOTS:
     void compareOverOps();
     void compareOverOpsNoMask();
     void compareRgbF32OverOps();
+    void compareGenericOps();
+    void compareGenericOpsNoMask();
+    void compareRgb16GenericOps();
+    void compareRgbF32GenericOps();
 
     void testRgb8CompositeAlphaDarkenLegacy();
     void testRgb8CompositeAlphaDarkenOptimized();
@@ -58,6 +62,15 @@ private Q_SLOTS:
     void testRgbF32CompositeOverLegacy();
     void testRgbF32CompositeOverOptimized();
 
+    void testRgb8CompositeGenericLegacy();
+    void testRgb8CompositeGenericOptimized();
+
+    void testRgb16CompositeGenericLegacy();
+    void testRgb16CompositeGenericOptimized();
+
+    void testRgbF32CompositeGenericLegacy();
+    void testRgbF32CompositeGenericOptimized();
+
     void testRgb8CompositeAlphaDarkenReal_Aligned();
     void testRgb8CompositeOverReal_Aligned();
 
@@ -33,6 +33,12 @@
 #include "kis_floodfill_benchmark.h"
 
 #include <kis_fill_painter.h>
+#include <kis_pixel_selection.h>
+#include <floodfill/kis_scanline_fill.h>
+
+// a 10K comics page
+#define LARGE_IMAGE_WIDTH 6600
+#define LARGE_IMAGE_HEIGHT 10200
 
 void KisFloodFillBenchmark::initTestCase()
 {
@@ -64,6 +70,21 @@ void KisFloodFillBenchmark::initTestCase()
         painter.paintEllipse(x+ 10, y+ 10, tilew, tileh);
     }
 
+    // a white page with black blobs scattered over it, the flood
+    // fill goes around them through the whole page
+    m_largeDevice = new KisPaintDevice(m_colorSpace);
+    m_largeDevice->fill(QRect(0, 0, LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT),
+                        KoColor(Qt::white, m_colorSpace));
+
+    KisPainter largePainter(m_largeDevice);
+    largePainter.setFillStyle(KisPainter::FillStyleForegroundColor);
+    largePainter.setPaintColor(KoColor(Qt::black, m_colorSpace));
+
+    for (int i = 0; i < 2000; i++) {
+        x = rand() % LARGE_IMAGE_WIDTH;
+        y = rand() % LARGE_IMAGE_HEIGHT;
+        largePainter.paintEllipse(x + 10, y + 10, tilew, tileh);
+    }
 
 }
 
@@ -103,6 +124,56 @@ void KisFloodFillBenchmark::benchmarkFlood()
     //out.save("fill_output.png");
 }
 
+inline void runLargeCanvasFill(KisPaintDeviceSP device, bool useParallelFill)
+{
+    const QRect imageRect(0, 0, LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT);
+    const KoColor fillColor(Qt::blue, device->colorSpace());
+
+    QBENCHMARK_ONCE
+    {
+        KisPaintDeviceSP dev = new KisPaintDevice(*device);
+
+        KisScanlineFill gc(dev, QPoint(1, 1), imageRect);
+        gc.setThreshold(15);
+        gc.setUseParallelFill(useParallelFill);
+        gc.fillColor(fillColor);
+    }
+}
+
+inline void runLargeCanvasFillSelection(KisPaintDeviceSP device, bool useParallelFill)
+{
+    const QRect imageRect(0, 0, LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT);
+
+    QBENCHMARK_ONCE
+    {
+        KisPixelSelectionSP pixelSelection = new KisPixelSelection();
+
+        KisScanlineFill gc(device, QPoint(1, 1), imageRect);
+        gc.setThreshold(15);
+        gc.setUseParallelFill(useParallelFill);
+        gc.fillSelection(pixelSelection);
+    }
+}
+
+void KisFloodFillBenchmark::benchmarkFloodLargeCanvas()
+{
+    runLargeCanvasFill(m_largeDevice, true);
+}
+
+void KisFloodFillBenchmark::benchmarkFloodLargeCanvasSequential()
+{
+    runLargeCanvasFill(m_largeDevice, false);
+}
+
+void KisFloodFillBenchmark::benchmarkFloodSelectionLargeCanvas()
+{
+    runLargeCanvasFillSelection(m_largeDevice, true);
+}
+
+void KisFloodFillBenchmark::benchmarkFloodSelectionLargeCanvasSequential()
+{
+    runLargeCanvasFillSelection(m_largeDevice, false);
+}
 
 void KisFloodFillBenchmark::cleanupTestCase()
 {
@@ -34,6 +34,7 @@ private:
     const KoColorSpace * m_colorSpace;
     KoColor m_color;
     KisPaintDeviceSP m_device;        
+    KisPaintDeviceSP m_largeDevice;
     int m_startX;
     int m_startY;
     
@@ -42,6 +43,11 @@ private Q_SLOTS:
     void cleanupTestCase();
     
     void benchmarkFlood();
+
+    void benchmarkFloodLargeCanvas();
+    void benchmarkFloodLargeCanvasSequential();
+    void benchmarkFloodSelectionLargeCanvas();
+    void benchmarkFloodSelectionLargeCanvasSequential();
     
     
     
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_inpaint_benchmark.h"
+
+#include <QTest>
+#include <functional>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+
+#include "testutil.h"
+
+class KoUpdater;
+
+// defined in plugins/tools/tool_smart_patch/kis_inpaint.cpp
+QRect patchImage(KisPaintDeviceSP imageDev, KisPaintDeviceSP maskDev, int radius, int accuracy,
+                 KoUpdater *progressUpdater, std::function<bool ()> cancelRequested);
+
+void KisInpaintBenchmark::initTestCase()
+{
+    QImage image(TestUtil::fetchDataFileLazy("hakonepa.png"));
+
+    m_device = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    m_device->convertFromQImage(image, 0);
+}
+
+void KisInpaintBenchmark::benchmarkPatch(const QRect &maskRect)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
+
+    KisPaintDeviceSP mask = new KisPaintDevice(cs);
+
+    KisPainter painter(mask);
+    painter.setFillStyle(KisPainter::FillStyleForegroundColor);
+    painter.setPaintColor(KoColor(Qt::black, cs));
+    painter.paintEllipse(maskRect);
+
+    // use the default radius and accuracy of the tool
+    QBENCHMARK_ONCE {
+        KisPaintDeviceSP dev = new KisPaintDevice(*m_device);
+        patchImage(dev, mask, 4, 50, 0, std::function<bool ()>());
+    }
+}
+
+void KisInpaintBenchmark::benchmarkSmallPatch()
+{
+    benchmarkPatch(QRect(300, 200, 24, 24));
+}
+
+void KisInpaintBenchmark::benchmarkMediumPatch()
+{
+    benchmarkPatch(QRect(260, 170, 80, 60));
+}
+
+void KisInpaintBenchmark::benchmarkLargePatch()
+{
+    benchmarkPatch(QRect(200, 130, 200, 140));
+}
+
+QTEST_MAIN(KisInpaintBenchmark)
@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_kra_save_benchmark.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_config.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_sequential_iterator.h>
+
+#define IMAGE_WIDTH 2048
+#define IMAGE_HEIGHT 2048
+#define NUM_LAYERS 50
+
+namespace {
+
+/**
+ * Every layer has a plain background and a noisy patch, so the
+ * document has both the well-compressible and the poorly-compressible
+ * data, like real paintings do
+ */
+void fillLayer(KisPaintDeviceSP dev, int index)
+{
+    const QRect rc(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+    dev->fill(rc, KoColor(QColor(index * 5, 255 - index * 5, 128), dev->colorSpace()));
+
+    const QRect noiseRect(index * 16, index * 16, IMAGE_WIDTH / 2, IMAGE_HEIGHT / 2);
+    const int pixelSize = dev->pixelSize();
+
+    quint32 seed = 0x12345678 + index;
+
+    KisSequentialIterator it(dev, noiseRect);
+    while (it.nextPixel()) {
+        quint8 *ptr = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            seed = seed * 1103515245 + 12345;
+            ptr[i] = seed >> 24;
+        }
+    }
+}
+
+}
+
+void KisKraSaveBenchmark::initTestCase()
+{
+}
+
+void KisKraSaveBenchmark::cleanupTestCase()
+{
+}
+
+void KisKraSaveBenchmark::benchmarkSave_data()
+{
+    QTest::addColumn<bool>("compressKra");
+
+    QTest::addRow("uncompressed") << false;
+    QTest::addRow("compressed") << true;
+}
+
+/**
+ * Saves a synthetic 50-layer document, which is bound by the
+ * serialization and compression of the layers' pixel data
+ */
+void KisKraSaveBenchmark::benchmarkSave()
+{
+    QFETCH(bool, compressKra);
+
+    const bool oldCompressKra = KisConfig(true).compressKra();
+    KisConfig(false).setCompressKra(compressKra);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, IMAGE_WIDTH, IMAGE_HEIGHT, cs, "save benchmark");
+
+    for (int i = 0; i < NUM_LAYERS; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+        fillLayer(layer->paintDevice(), i);
+        image->addNode(layer, image->root());
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setCurrentImage(image);
+
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("save_benchmark.kra");
+
+    QBENCHMARK_ONCE {
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), "application/x-krita"));
+    }
+
+    KisConfig(false).setCompressKra(oldCompressKra);
+}
+
+QTEST_MAIN(KisKraSaveBenchmark)
@@ -0,0 +1,193 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_particle_rasterizer_benchmark.h"
+
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <kis_random_accessor_ng.h>
+#include <KisParticleRasterizer.h>
+
+#include <random>
+
+const int NUM_PARTICLES = 100000;
+const int NUM_LINES = 200;
+const int AREA_SIZE = 500;
+const qreal LINE_WIDTH = 3.0;
+
+void KisParticleRasterizerBenchmark::initTestCase()
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<qreal> distribution(0.0, AREA_SIZE);
+
+    m_particles.resize(NUM_PARTICLES);
+    for (int i = 0; i < NUM_PARTICLES; i++) {
+        m_particles[i] = QPointF(distribution(generator), distribution(generator));
+    }
+}
+
+namespace {
+
+enum AccessorMode {
+    Overwrite,
+    Accumulate,
+    Composite
+};
+
+void accessorSplat(KisRandomAccessorSP it, const KoColorSpace *cs, const KoCompositeOp *op,
+                   int x, int y, const KoColor &color, quint8 opacity, AccessorMode mode)
+{
+    it->moveTo(x, y);
+
+    switch (mode) {
+    case Overwrite:
+        memcpy(it->rawData(), color.data(), cs->pixelSize());
+        cs->setOpacity(it->rawData(), opacity, 1);
+        break;
+    case Accumulate: {
+        const quint8 newOpacity = quint8(qMin(opacity + cs->opacityU8(it->rawData()), int(OPACITY_OPAQUE_U8)));
+        memcpy(it->rawData(), color.data(), cs->pixelSize());
+        cs->setOpacity(it->rawData(), newOpacity, 1);
+        break;
+    }
+    case Composite:
+        op->composite(it->rawData(), cs->pixelSize(), color.data(), cs->pixelSize(), 0, 0, 1, 1, opacity);
+        break;
+    }
+}
+
+void benchmarkAccessor(const QVector<QPointF> &particles, AccessorMode mode)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoCompositeOp *op = cs->compositeOp(COMPOSITE_OVER);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    KoColor color(Qt::red, cs);
+
+    QBENCHMARK {
+        dev->clear();
+        KisRandomAccessorSP it = dev->createRandomAccessorNG();
+
+        Q_FOREACH (const QPointF &pt, particles) {
+            const int ipx = qFloor(pt.x());
+            const int ipy = qFloor(pt.y());
+            const qreal fx = pt.x() - ipx;
+            const qreal fy = pt.y() - ipy;
+
+            accessorSplat(it, cs, op, ipx,     ipy,     color, qRound((1.0 - fx) * (1.0 - fy) * 255), mode);
+            accessorSplat(it, cs, op, ipx + 1, ipy,     color, qRound(fx * (1.0 - fy) * 255), mode);
+            accessorSplat(it, cs, op, ipx,     ipy + 1, color, qRound((1.0 - fx) * fy * 255), mode);
+            accessorSplat(it, cs, op, ipx + 1, ipy + 1, color, qRound(fx * fy * 255), mode);
+        }
+    }
+}
+
+void benchmarkRasterizer(const QVector<QPointF> &particles, KisParticleRasterizer::Mode mode)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    KoColor color(Qt::red, cs);
+
+    KisParticleRasterizer rasterizer(cs, mode, cs->compositeOp(COMPOSITE_OVER));
+
+    QBENCHMARK {
+        dev->clear();
+
+        Q_FOREACH (const QPointF &pt, particles) {
+            rasterizer.addParticle(pt, color, OPACITY_OPAQUE_U8);
+        }
+
+        rasterizer.rasterize(dev);
+    }
+}
+
+}
+
+void KisParticleRasterizerBenchmark::benchmarkAccessorOverwrite()
+{
+    benchmarkAccessor(m_particles, Overwrite);
+}
+
+void KisParticleRasterizerBenchmark::benchmarkRasterizerOverwrite()
+{
+    benchmarkRasterizer(m_particles, KisParticleRasterizer::Overwrite);
+}
+
+void KisParticleRasterizerBenchmark::benchmarkAccessorAccumulate()
+{
+    benchmarkAccessor(m_particles, Accumulate);
+}
+
+void KisParticleRasterizerBenchmark::benchmarkRasterizerAccumulate()
+{
+    benchmarkRasterizer(m_particles, KisParticleRasterizer::AccumulateOpacity);
+}
+
+void KisParticleRasterizerBenchmark::benchmarkAccessorComposite()
+{
+    benchmarkAccessor(m_particles, Composite);
+}
+
+void KisParticleRasterizerBenchmark::benchmarkRasterizerComposite()
+{
+    benchmarkRasterizer(m_particles, KisParticleRasterizer::Composite);
+}
+
+void KisParticleRasterizerBenchmark::benchmarkPainterLines()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    KisPainter gc(dev);
+    gc.setPaintColor(KoColor(Qt::red, cs));
+
+    QBENCHMARK {
+        dev->clear();
+
+        for (int i = 0; i < NUM_LINES; i++) {
+            gc.drawLine(m_particles[2 * i], m_particles[2 * i + 1], LINE_WIDTH, true);
+        }
+    }
+}
+
+void KisParticleRasterizerBenchmark::benchmarkRasterizerLines()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    KoColor color(Qt::red, cs);
+
+    KisParticleRasterizer rasterizer(cs, KisParticleRasterizer::Composite, cs->compositeOp(COMPOSITE_OVER));
+
+    QBENCHMARK {
+        dev->clear();
+
+        for (int i = 0; i < NUM_LINES; i++) {
+            rasterizer.addLine(m_particles[2 * i], m_particles[2 * i + 1], LINE_WIDTH, true, color, OPACITY_OPAQUE_U8);
+        }
+
+        rasterizer.rasterize(dev);
+    }
+}
+
+QTEST_MAIN(KisParticleRasterizerBenchmark)
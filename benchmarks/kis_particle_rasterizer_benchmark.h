@@ -0,0 +1,53 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_PARTICLE_RASTERIZER_BENCHMARK_H
+#define KIS_PARTICLE_RASTERIZER_BENCHMARK_H
+
+#include <QtTest>
+#include <QVector>
+#include <QPointF>
+
+class KisParticleRasterizerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    QVector<QPointF> m_particles;
+
+private Q_SLOTS:
+    void initTestCase();
+
+    // spray: wu particles overwrite the pixels
+    void benchmarkAccessorOverwrite();
+    void benchmarkRasterizerOverwrite();
+
+    // particle, hairy: wu particles accumulate opacity
+    void benchmarkAccessorAccumulate();
+    void benchmarkRasterizerAccumulate();
+
+    // hairy with compositing enabled
+    void benchmarkAccessorComposite();
+    void benchmarkRasterizerComposite();
+
+    // sketch: thick antialiased lines
+    void benchmarkPainterLines();
+    void benchmarkRasterizerLines();
+};
+
+#endif
@@ -16,6 +16,7 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 #include <QTest>
+#include <QThread>
 
 #include "kis_projection_benchmark.h"
 #include "kis_benchmark_values.h"
@@ -58,5 +59,41 @@ void KisProjectionBenchmark::benchmarkLoading()
     }
 }
 
+void KisProjectionBenchmark::benchmarkProjectionScaling_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    const int idealThreadCount = QThread::idealThreadCount();
+
+    for (int numThreads = 1; numThreads < idealThreadCount; numThreads *= 2) {
+        QTest::addRow("%d threads", numThreads) << numThreads;
+    }
+
+    QTest::addRow("%d threads", idealThreadCount) << idealThreadCount;
+}
+
+/**
+ * Recalculates the projection of the whole image using the update
+ * scheduler with different number of threads, so the results show
+ * how the updater context scales with the number of cores.
+ */
+void KisProjectionBenchmark::benchmarkProjectionScaling()
+{
+    QFETCH(int, numThreads);
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->loadNativeFormat(QString(FILES_DATA_DIR) + '/' + "load_test.kra");
+
+    KisImageSP image = doc->image();
+    image->setWorkingThreadsLimit(numThreads);
+    QCOMPARE(image->workingThreadsLimit(), numThreads);
+
+    QBENCHMARK {
+        image->refreshGraphAsync();
+        image->waitForDone();
+    }
+
+    delete doc;
+}
 
 QTEST_MAIN(KisProjectionBenchmark)
@@ -32,6 +32,9 @@ private Q_SLOTS:
 
     void benchmarkProjection();
     void benchmarkLoading();
+
+    void benchmarkProjectionScaling_data();
+    void benchmarkProjectionScaling();
 };
 
 #endif
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_psd_benchmark.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <KisImportExportManager.h>
+#include <KisImportExportErrorCode.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_sequential_iterator.h>
+
+#define IMAGE_WIDTH 4096
+#define IMAGE_HEIGHT 4096
+#define NUM_LAYERS 10
+
+namespace {
+
+const QByteArray PSDMimetype = "image/vnd.adobe.photoshop";
+
+/**
+ * A plain background compresses into long RLE runs and a noisy
+ * patch into literal runs, so both code paths of the codec are used
+ */
+void fillLayer(KisPaintDeviceSP dev, int index)
+{
+    const QRect rc(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+    dev->fill(rc, KoColor(QColor(index * 20, 255 - index * 20, 128), dev->colorSpace()));
+
+    const QRect noiseRect(index * 64, index * 64, IMAGE_WIDTH / 2, IMAGE_HEIGHT / 2);
+    const int pixelSize = dev->pixelSize();
+
+    quint32 seed = 0x12345678 + index;
+
+    KisSequentialIterator it(dev, noiseRect);
+    while (it.nextPixel()) {
+        quint8 *ptr = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            seed = seed * 1103515245 + 12345;
+            ptr[i] = seed >> 24;
+        }
+    }
+}
+
+KisDocument* createDocument(const QString &depth)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth, "");
+    KisImageSP image = new KisImage(0, IMAGE_WIDTH, IMAGE_HEIGHT, cs, "psd benchmark");
+
+    for (int i = 0; i < NUM_LAYERS; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+        fillLayer(layer->paintDevice(), i);
+        image->addNode(layer, image->root());
+    }
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+    doc->setCurrentImage(image);
+    doc->setFileBatchMode(true);
+
+    return doc;
+}
+
+void addDepthColumn()
+{
+    QTest::addColumn<QString>("depth");
+
+    QTest::addRow("rgb8") << Integer8BitsColorDepthID.id();
+    QTest::addRow("rgb16") << Integer16BitsColorDepthID.id();
+}
+
+}
+
+void KisPsdBenchmark::benchmarkSave_data()
+{
+    addDepthColumn();
+}
+
+/**
+ * Saves a synthetic multilayer document, which is dominated
+ * by RLE encoding of the channels
+ */
+void KisPsdBenchmark::benchmarkSave()
+{
+    QFETCH(QString, depth);
+
+    QScopedPointer<KisDocument> doc(createDocument(depth));
+
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("psd_benchmark.psd");
+
+    QBENCHMARK_ONCE {
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), PSDMimetype));
+    }
+}
+
+void KisPsdBenchmark::benchmarkLoad_data()
+{
+    addDepthColumn();
+}
+
+/**
+ * Loads back the document saved the same way as in benchmarkSave(),
+ * which is dominated by RLE decoding of the channels
+ */
+void KisPsdBenchmark::benchmarkLoad()
+{
+    QFETCH(QString, depth);
+
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("psd_benchmark.psd");
+
+    QRect bounds;
+
+    {
+        QScopedPointer<KisDocument> doc(createDocument(depth));
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), PSDMimetype));
+        bounds = doc->image()->bounds();
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setFileBatchMode(true);
+    KisImportExportManager manager(doc.data());
+
+    QBENCHMARK_ONCE {
+        KisImportExportErrorCode status = manager.importDocument(fileName, QString());
+        QVERIFY(status.isOk());
+    }
+
+    QVERIFY(doc->image());
+    QCOMPARE(doc->image()->bounds(), bounds);
+}
+
+QTEST_MAIN(KisPsdBenchmark)
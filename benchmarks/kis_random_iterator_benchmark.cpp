@@ -234,5 +234,61 @@ void KisRandomIteratorBenchmark::benchmarkTwoIteratorsNoMemCpy()
     }
 }
 
+void KisRandomIteratorBenchmark::benchmarkHugeSparseRandomAccessImpl(bool constAccess)
+{
+    // the tiles are spread over (2^30 x 2^30) pixels area
+    const int numTiles = 4096;
+    const int coordinateRange = 1 << 24;
+    const int tileSize = 64;
+
+    srand(123456);
+
+    // RAND_MAX may be as small as 0x7FFF, so combine two numbers
+    auto randomTileCoordinate = [] () {
+        return ((rand() & 0xFFF) << 12 | (rand() & 0xFFF)) - coordinateRange / 2;
+    };
+
+    QVector<QPoint> tiles;
+    for (int i = 0; i < numTiles; i++) {
+        tiles << QPoint(randomTileCoordinate() * tileSize,
+                        randomTileCoordinate() * tileSize);
+    }
+
+    KisPaintDevice dev(m_colorSpace);
+    Q_FOREACH (const QPoint &pt, tiles) {
+        dev.fill(pt.x(), pt.y(), tileSize, tileSize, m_color->data());
+    }
+
+    KisRandomAccessorSP it = dev.createRandomAccessorNG();
+    KisRandomConstAccessorSP constIt = dev.createRandomConstAccessorNG();
+
+    QBENCHMARK{
+        for (int i = 0; i < TEST_IMAGE_HEIGHT; i++){
+            for (int j = 0; j < TEST_IMAGE_WIDTH / 16; j++) {
+                const QPoint &pt = tiles[rand() % numTiles];
+                const int x = pt.x() + rand() % tileSize;
+                const int y = pt.y() + rand() % tileSize;
+
+                if (constAccess) {
+                    constIt->moveTo(x, y);
+                    memcpy(m_color->data(), constIt->oldRawData(), m_colorSpace->pixelSize());
+                } else {
+                    it->moveTo(x, y);
+                    memcpy(it->rawData(), m_color->data(), m_colorSpace->pixelSize());
+                }
+            }
+        }
+    }
+}
+
+void KisRandomIteratorBenchmark::benchmarkHugeSparseRandomAccess()
+{
+    benchmarkHugeSparseRandomAccessImpl(false);
+}
+
+void KisRandomIteratorBenchmark::benchmarkHugeSparseRandomAccessConst()
+{
+    benchmarkHugeSparseRandomAccessImpl(true);
+}
 
 QTEST_MAIN(KisRandomIteratorBenchmark)
@@ -34,6 +34,9 @@ private:
     const KoColorSpace * m_colorSpace;
     KisPaintDevice * m_device;        
     KoColor * m_color;
+
+    void benchmarkHugeSparseRandomAccessImpl(bool constAccess);
+
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
@@ -58,6 +61,10 @@ private Q_SLOTS:
     void benchmarkNoMemCpy();
     void benchmarkConstNoMemCpy();
     void benchmarkTwoIteratorsNoMemCpy();
+
+    // random access to a few tiles scattered over a huge area
+    void benchmarkHugeSparseRandomAccess();
+    void benchmarkHugeSparseRandomAccessConst();
 };
 
 #endif
@@ -51,6 +51,11 @@ inline double drand48()
 #include <brushengine/kis_paintop_registry.h>
 
 #include <KisGlobalResourcesInterface.h>
+#include <KisRunnableStrokeJobData.h>
+#include <brushengine/kis_paintop.h>
+
+#include <QElapsedTimer>
+#include <QtConcurrent>
 
 //#define SAVE_OUTPUT
 
@@ -359,6 +364,18 @@ void KisStrokeBenchmark::colorsmudgeRL()
     benchmarkStroke(presetFileName);
 }
 
+void KisStrokeBenchmark::colorsmudge500px()
+{
+    QString presetFileName = "colorsmudge.kpp";
+    benchmarkDabs(presetFileName, 500);
+}
+
+void KisStrokeBenchmark::colorsmudge1000px()
+{
+    QString presetFileName = "colorsmudge.kpp";
+    benchmarkDabs(presetFileName, 1000);
+}
+
 
 void KisStrokeBenchmark::roundMarker()
 {
@@ -452,6 +469,7 @@ inline void KisStrokeBenchmark::benchmarkLine(QString presetFileName)
 
     QBENCHMARK{
         m_painter->paintLine(pi1, pi2, &currentDistance);
+        flushAsyncronousUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -503,6 +521,7 @@ QBENCHMARK{
         }
         m_painter->paintLine(prev, first, &currentDistance);
     }
+    flushAsyncronousUpdates();
 }
 
 #ifdef SAVE_OUTPUT
@@ -533,6 +552,7 @@ void KisStrokeBenchmark::benchmarkRandomLines(QString presetFileName)
             KisPaintInformation pi2(m_endPoints[i], 1.0);
             m_painter->paintLine(pi1, pi2, &currentDistance);
         }
+        flushAsyncronousUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -564,6 +584,7 @@ void KisStrokeBenchmark::benchmarkRectangle(QString presetFileName)
             path.addRect(rect);
             m_painter->paintPainterPath(path);
         }
+        flushAsyncronousUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -588,6 +609,7 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
         KisDistanceInformation currentDistance;
         m_painter->paintBezierCurve(m_pi1, m_c1, m_c1, m_pi2, &currentDistance);
         m_painter->paintBezierCurve(m_pi2, m_c2, m_c2, m_pi3, &currentDistance);
+        flushAsyncronousUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -596,6 +618,87 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
 #endif
 }
 
+void KisStrokeBenchmark::flushAsyncronousUpdates()
+{
+    /**
+     * Executes the update jobs of the paintop the same way the strokes
+     * queue does: sequential jobs act as barriers, the concurrent jobs
+     * in between are run in parallel.
+     */
+    bool needsMoreUpdates = true;
+
+    while (needsMoreUpdates) {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        needsMoreUpdates = m_painter->paintOp()->doAsyncronousUpdate(jobs).second;
+
+        QVector<KisRunnableStrokeJobData*> concurrentJobs;
+
+        auto runConcurrentJobs = [&concurrentJobs] () {
+            QtConcurrent::blockingMap(concurrentJobs,
+                                      [] (KisRunnableStrokeJobData *job) {
+                                          job->run();
+                                      });
+            concurrentJobs.clear();
+        };
+
+        Q_FOREACH (KisRunnableStrokeJobData *job, jobs) {
+            if (job->sequentiality() == KisStrokeJobData::CONCURRENT) {
+                concurrentJobs.append(job);
+            } else {
+                runConcurrentJobs();
+                job->run();
+            }
+        }
+        runConcurrentJobs();
+
+        qDeleteAll(jobs);
+    }
+}
+
+void KisStrokeBenchmark::benchmarkDabs(QString presetFileName, qreal size)
+{
+    KisPaintOpPresetSP preset(new KisPaintOpPreset(m_dataPath + presetFileName));
+    bool loadedOk = preset->load(KisGlobalResourcesInterface::instance());
+    if (!loadedOk){
+        dbgKrita << "The preset was not loaded correctly. Done.";
+        return;
+    } else {
+        dbgKrita << "preset : " << presetFileName;
+    }
+
+    preset->settings()->setPaintOpSize(size);
+    m_painter->setPaintOpPreset(preset, m_layer, m_image);
+
+    const int numDabs = 100;
+    const QPointF startPoint(0.10 * TEST_IMAGE_WIDTH, 0.5 * TEST_IMAGE_HEIGHT);
+    const QPointF endPoint(0.90 * TEST_IMAGE_WIDTH, 0.5 * TEST_IMAGE_HEIGHT);
+
+    QElapsedTimer timer;
+    qint64 totalTime = 0;
+    int totalDabs = 0;
+
+    QBENCHMARK{
+        timer.start();
+
+        KisDistanceInformation currentDistance;
+        for (int i = 0; i < numDabs; i++) {
+            const QPointF pos = startPoint + (endPoint - startPoint) * qreal(i) / numDabs;
+            m_painter->paintAt(KisPaintInformation(pos, 1.0), &currentDistance);
+        }
+        flushAsyncronousUpdates();
+
+        totalTime += timer.nsecsElapsed();
+        totalDabs += numDabs;
+    }
+
+    qDebug() << presetFileName << "size" << size << "dabs per second:"
+             << qreal(totalDabs) / (qreal(totalTime) / 1e9);
+
+#ifdef SAVE_OUTPUT
+    m_layer->paintDevice()->convertToQImage(0).save(m_outputPath + presetFileName + "_dabs" + OUTPUT_FORMAT);
+#endif
+}
+
 static const int COUNT = 1000000;
 void KisStrokeBenchmark::benchmarkRand48()
 {
@@ -68,6 +68,9 @@ private:
         inline void benchmarkLine(QString presetFileName);
         inline void benchmarkCircle(QString presetFileName);
         inline void benchmarkRectangle(QString presetFileName);
+        inline void benchmarkDabs(QString presetFileName, qreal size);
+
+        void flushAsyncronousUpdates();
 
 private Q_SLOTS:
     void initTestCase();
@@ -127,6 +130,10 @@ private Q_SLOTS:
     void colorsmudge();
     void colorsmudgeRL();
 
+    // large dabs, rendered asynchronously
+    void colorsmudge500px();
+    void colorsmudge1000px();
+
     void roundMarker();
     void roundMarkerRandomLines();
     void roundMarkerRectangle();
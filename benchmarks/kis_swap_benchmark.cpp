@@ -0,0 +1,183 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_swap_benchmark.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+
+#include "kis_image_config.h"
+#include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "tiles3/swap/kis_memory_window.h"
+#include "tiles3/swap/kis_swap_file.h"
+
+/**
+ * 256 MiB of swap split into chunks of the size of a typical
+ * compressed RGBA8 tile
+ */
+#define CHUNK_SIZE (8 * 1024)
+#define NUM_CHUNKS (32 * 1024)
+#define NUM_READS (64 * 1024)
+
+#define TILES_SIZE 64
+
+namespace {
+
+QVector<int> randomIndexes(int numIndexes, int range)
+{
+    QVector<int> indexes;
+    indexes.reserve(numIndexes);
+
+    qsrand(12345);
+    for (int i = 0; i < numIndexes; i++) {
+        indexes << qrand() % range;
+    }
+
+    return indexes;
+}
+
+}
+
+void KisSwapBenchmark::benchmarkBackendRandomReads_data()
+{
+    QTest::addColumn<bool>("useSwapFile");
+    QTest::addColumn<int>("numThreads");
+
+    Q_FOREACH (int numThreads, QVector<int>({1, 4, 8})) {
+        QTest::addRow("window-%d", numThreads) << false << numThreads;
+        QTest::addRow("file-%d", numThreads) << true << numThreads;
+    }
+}
+
+void KisSwapBenchmark::benchmarkBackendRandomReads()
+{
+    QFETCH(bool, useSwapFile);
+    QFETCH(int, numThreads);
+
+    QTemporaryDir swapDir;
+    KisMemoryWindow window(swapDir.path());
+    KisSwapFile file(swapDir.path());
+
+    /**
+     * The window is not thread-safe, so it is guarded with a mutex,
+     * the same way KisSwappedDataStore used to do
+     */
+    QMutex windowLock;
+
+    QByteArray buffer(CHUNK_SIZE, 0);
+    for (int i = 0; i < NUM_CHUNKS; i++) {
+        buffer.fill(char(i));
+        const KisChunkData chunk(quint64(i) * CHUNK_SIZE, CHUNK_SIZE);
+
+        if (useSwapFile) {
+            QVERIFY(file.writeChunk(chunk, (quint8*)buffer.data()));
+        } else {
+            memcpy(window.getWriteChunkPtr(chunk), buffer.data(), CHUNK_SIZE);
+        }
+    }
+
+    const QVector<int> indexes = randomIndexes(NUM_READS, NUM_CHUNKS);
+
+    std::function<void (int)> readChunk =
+        [&] (int index) {
+            QByteArray readBuffer(CHUNK_SIZE, 0);
+            const KisChunkData chunk(quint64(index) * CHUNK_SIZE, CHUNK_SIZE);
+
+            if (useSwapFile) {
+                file.readChunk(chunk, (quint8*)readBuffer.data());
+            } else {
+                QMutexLocker l(&windowLock);
+                memcpy(readBuffer.data(), window.getReadChunkPtr(chunk), CHUNK_SIZE);
+            }
+        };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK_ONCE {
+        QtConcurrent::map(&pool, indexes, readChunk).waitForFinished();
+    }
+}
+
+void KisSwapBenchmark::benchmarkConcurrentSwapIn_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    QTest::addRow("1") << 1;
+    QTest::addRow("4") << 4;
+    QTest::addRow("8") << 8;
+}
+
+void KisSwapBenchmark::benchmarkConcurrentSwapIn()
+{
+    QFETCH(int, numThreads);
+
+    KisImageConfig config(false);
+    const qreal oldHardLimit = config.memoryHardLimitPercent();
+    const qreal oldSoftLimit = config.memorySoftLimitPercent();
+
+    /**
+     * Don't let the swapper push the tiles back while we are
+     * loading them
+     */
+    config.setMemoryHardLimitPercent(100.0);
+    config.setMemorySoftLimitPercent(100.0);
+    KisTileDataStore::instance()->testingRereadConfig();
+
+    const qint32 pixelSize = 4;
+    quint8 defaultPixel[pixelSize] = {0, 0, 0, 0};
+    KisTiledDataManager dm(pixelSize, defaultPixel);
+
+    for (int row = 0; row < TILES_SIZE; row++) {
+        for (int col = 0; col < TILES_SIZE; col++) {
+            KisTileSP tile = dm.getTile(col, row, true);
+            tile->lockForWrite();
+            quint8 *data = tile->tileData()->data();
+            for (int i = 0; i < KisTileData::WIDTH * KisTileData::HEIGHT * pixelSize; i++) {
+                data[i] = quint8(i + row * col);
+            }
+            tile->unlockForWrite();
+        }
+    }
+
+    KisTileDataStore::instance()->debugSwapAll();
+
+    const QVector<int> indexes = randomIndexes(TILES_SIZE * TILES_SIZE, TILES_SIZE * TILES_SIZE);
+
+    std::function<void (int)> loadTile =
+        [&dm] (int index) {
+            KisTileSP tile = dm.getTile(index % TILES_SIZE, index / TILES_SIZE, false);
+            tile->lockForRead();
+            tile->unlockForRead();
+        };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK_ONCE {
+        QtConcurrent::map(&pool, indexes, loadTile).waitForFinished();
+    }
+
+    config.setMemoryHardLimitPercent(oldHardLimit);
+    config.setMemorySoftLimitPercent(oldSoftLimit);
+    KisTileDataStore::instance()->testingRereadConfig();
+}
+
+QTEST_MAIN(KisSwapBenchmark)
@@ -0,0 +1,43 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_SWAP_BENCHMARK_H
+#define __KIS_SWAP_BENCHMARK_H
+
+#include <QtTest>
+
+/**
+ * Measures random-access reads from the swap performed by several
+ * threads at once, which is the typical load when the updater
+ * threads walk over a swapped-out image. The first benchmark
+ * compares the raw backends (the old sliding KisMemoryWindow and
+ * KisSwapFile), the second one loads the tiles through the whole
+ * KisTileDataStore machinery.
+ */
+class KisSwapBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchmarkBackendRandomReads_data();
+    void benchmarkBackendRandomReads();
+
+    void benchmarkConcurrentSwapIn_data();
+    void benchmarkConcurrentSwapIn();
+};
+
+#endif /* __KIS_SWAP_BENCHMARK_H */
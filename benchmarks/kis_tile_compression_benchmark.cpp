@@ -0,0 +1,199 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_compression_benchmark.h"
+
+#include <QTest>
+#include <testutil.h>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColor.h>
+
+#include "kis_paint_device.h"
+#include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/swap/kis_tile_compressor_2.h"
+
+/**
+ * The source image is tiled over the canvas, so that we get
+ * a reasonable number of tiles with a real-life content
+ */
+#define CANVAS_SIZE 2048
+
+namespace {
+
+const KoColorSpace* colorSpaceForDepth(const QString &depthId)
+{
+    return KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depthId, 0);
+}
+
+KisPaintDeviceSP createRealLayer(const KoColorSpace *cs)
+{
+    QImage image(TestUtil::fetchDataFileLazy("hakonepa.png"));
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    if (!image.isNull()) {
+        for (int y = 0; y < CANVAS_SIZE; y += image.height()) {
+            for (int x = 0; x < CANVAS_SIZE; x += image.width()) {
+                dev->convertFromQImage(image, 0, x, y);
+            }
+        }
+    }
+
+    dev->convertTo(cs);
+    return dev;
+}
+
+QVector<KisTileSP> fetchTiles(KisPaintDeviceSP dev)
+{
+    QVector<KisTileSP> tiles;
+
+    KisTiledDataManager *dm = dev->dataManager().data();
+    const QRect rc = dev->exactBounds();
+
+    // the canvas is located in the positive quadrant only
+    const int firstCol = rc.left() / KisTileData::WIDTH;
+    const int lastCol = rc.right() / KisTileData::WIDTH;
+    const int firstRow = rc.top() / KisTileData::HEIGHT;
+    const int lastRow = rc.bottom() / KisTileData::HEIGHT;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            tiles << dm->getTile(col, row, false);
+        }
+    }
+
+    return tiles;
+}
+
+void addCodecRows()
+{
+    QTest::addColumn<int>("compressionType");
+    QTest::addColumn<QString>("depthId");
+
+    const QList<KisTileCompressor2::CompressionType> codecs =
+        {KisTileCompressor2::LzfCompression,
+         KisTileCompressor2::Lz4Compression,
+         KisTileCompressor2::ZstdCompression};
+
+    const QStringList depths =
+        {Integer8BitsColorDepthID.id(),
+         Integer16BitsColorDepthID.id(),
+         Float32BitsColorDepthID.id()};
+
+    Q_FOREACH (KisTileCompressor2::CompressionType codec, codecs) {
+        if (!KisTileCompressor2::isCompressionSupported(codec)) continue;
+
+        Q_FOREACH (const QString &depth, depths) {
+            const QString name =
+                QString("%1-%2").arg(KisTileCompressor2::compressionName(codec)).arg(depth);
+
+            QTest::newRow(name.toLatin1()) << int(codec) << depth;
+        }
+    }
+}
+
+}
+
+void KisTileCompressionBenchmark::benchmarkCompression_data()
+{
+    addCodecRows();
+}
+
+void KisTileCompressionBenchmark::benchmarkCompression()
+{
+    QFETCH(int, compressionType);
+    QFETCH(QString, depthId);
+
+    KisPaintDeviceSP dev = createRealLayer(colorSpaceForDepth(depthId));
+    QVector<KisTileSP> tiles = fetchTiles(dev);
+    QVERIFY(!tiles.isEmpty());
+
+    KisTileCompressor2 compressor(KisTileCompressor2::CompressionType(compressionType));
+
+    const qint32 bufferSize = compressor.tileDataBufferSize(tiles.first()->tileData());
+    QByteArray buffer(bufferSize, 0);
+
+    qint64 rawBytes = 0;
+    qint64 compressedBytes = 0;
+
+    Q_FOREACH (KisTileSP tile, tiles) {
+        qint32 bytesWritten = 0;
+        compressor.compressTileData(tile->tileData(), (quint8*)buffer.data(), bufferSize, bytesWritten);
+        rawBytes += bufferSize - 1;
+        compressedBytes += bytesWritten;
+    }
+
+    qDebug() << "Compression ratio:" << qreal(rawBytes) / compressedBytes
+             << "tiles:" << tiles.size();
+
+    QBENCHMARK {
+        Q_FOREACH (KisTileSP tile, tiles) {
+            qint32 bytesWritten = 0;
+            compressor.compressTileData(tile->tileData(), (quint8*)buffer.data(), bufferSize, bytesWritten);
+        }
+    }
+}
+
+void KisTileCompressionBenchmark::benchmarkDecompression_data()
+{
+    addCodecRows();
+}
+
+void KisTileCompressionBenchmark::benchmarkDecompression()
+{
+    QFETCH(int, compressionType);
+    QFETCH(QString, depthId);
+
+    KisPaintDeviceSP dev = createRealLayer(colorSpaceForDepth(depthId));
+    QVector<KisTileSP> tiles = fetchTiles(dev);
+    QVERIFY(!tiles.isEmpty());
+
+    KisTileCompressor2 compressor(KisTileCompressor2::CompressionType(compressionType));
+
+    const qint32 bufferSize = compressor.tileDataBufferSize(tiles.first()->tileData());
+
+    QVector<QByteArray> compressedTiles;
+    Q_FOREACH (KisTileSP tile, tiles) {
+        QByteArray buffer(bufferSize, 0);
+        qint32 bytesWritten = 0;
+        compressor.compressTileData(tile->tileData(), (quint8*)buffer.data(), bufferSize, bytesWritten);
+        buffer.resize(bytesWritten);
+        compressedTiles << buffer;
+    }
+
+    /**
+     * We decompress into a separate device to avoid
+     * copy-on-write of the tiles of the source one
+     */
+    KisPaintDeviceSP dstDev = new KisPaintDevice(dev->colorSpace());
+    dstDev->fill(dev->exactBounds(), KoColor(Qt::white, dev->colorSpace()));
+    QVector<KisTileSP> dstTiles = fetchTiles(dstDev);
+    QCOMPARE(dstTiles.size(), tiles.size());
+
+    QBENCHMARK {
+        for (int i = 0; i < dstTiles.size(); i++) {
+            QByteArray &buffer = compressedTiles[i];
+            compressor.decompressTileData((quint8*)buffer.data(), buffer.size(), dstTiles[i]->tileData());
+        }
+    }
+}
+
+QTEST_MAIN(KisTileCompressionBenchmark)
@@ -0,0 +1,36 @@
+# - Try to find the Zstandard compression library
+# Once done this will define
+#
+#  ZSTD_FOUND - system has zstd
+#  ZSTD_INCLUDE_DIRS - the zstd include directories
+#  ZSTD_LIBRARIES - the libraries needed to use zstd
+# Redistribution and use is allowed according to the terms of the BSD license.
+# For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+#
+
+include(LibFindMacros)
+libfind_pkg_check_modules(ZSTD_PKGCONF libzstd)
+
+find_path(ZSTD_INCLUDE_DIR
+    NAMES zstd.h
+    HINTS ${ZSTD_PKGCONF_INCLUDE_DIRS} ${ZSTD_PKGCONF_INCLUDEDIR}
+)
+
+find_library(ZSTD_LIBRARY
+    NAMES zstd libzstd zstd_static
+    HINTS ${ZSTD_PKGCONF_LIBRARY_DIRS} ${ZSTD_PKGCONF_LIBDIR}
+    DOC "Libraries to link against for Zstandard Support"
+)
+
+set(ZSTD_PROCESS_LIBS ZSTD_LIBRARY)
+set(ZSTD_PROCESS_INCLUDES ZSTD_INCLUDE_DIR)
+libfind_process(ZSTD)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Zstd
+    FOUND_VAR
+        ZSTD_FOUND
+    REQUIRED_VARS
+        ZSTD_INCLUDE_DIR
+        ZSTD_LIBRARY
+)
@@ -0,0 +1,7 @@
+/* config-tile-compression.h.  Generated by cmake from config-tile-compression.h.cmake */
+
+/* Define if you have LZ4, used as a fast codec for the tiles swap */
+#cmakedefine HAVE_LZ4 1
+
+/* Define if you have Zstandard, used as a dense codec for the tiles in .kra */
+#cmakedefine HAVE_ZSTD 1
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisEuclideanDistanceTransform.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+#include "kis_assert.h"
+
+
+KisEuclideanDistanceTransform::KisEuclideanDistanceTransform(int width, int height, qreal xWeight, qreal yWeight)
+    : m_width(width),
+      m_height(height),
+      m_xWeight(xWeight),
+      m_yWeight(yWeight)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(m_xWeight > 0.0 && m_yWeight > 0.0);
+}
+
+bool KisEuclideanDistanceTransform::compute(const quint8 *features)
+{
+    m_nearestRow.resize(m_width * m_height);
+    if (m_nearestRow.isEmpty()) return false;
+
+    QVector<Chunk> columnChunks = splitIntoChunks(m_width, columnsPerChunk);
+
+    QtConcurrent::blockingMap(columnChunks,
+        [this, features] (const Chunk &chunk) {
+            processColumns(features, chunk);
+        });
+
+    /**
+     * Every column having a feature has its nearest row defined
+     * for all the pixels, so checking the first row is enough
+     */
+    const qint32 *firstRow = m_nearestRow.constData();
+    return std::any_of(firstRow, firstRow + m_width,
+                       [] (qint32 row) { return row >= 0; });
+}
+
+void KisEuclideanDistanceTransform::processRows(RowFunctor func) const
+{
+    QVector<Chunk> rowChunks = splitIntoChunks(m_height, rowsPerChunk);
+
+    QtConcurrent::blockingMap(rowChunks,
+        [this, func] (const Chunk &chunk) {
+            processRowsChunk(func, chunk);
+        });
+}
+
+QVector<KisEuclideanDistanceTransform::Chunk>
+KisEuclideanDistanceTransform::splitIntoChunks(int size, int chunkSize)
+{
+    QVector<Chunk> chunks;
+
+    for (int i = 0; i < size; i += chunkSize) {
+        Chunk chunk;
+        chunk.start = i;
+        chunk.size = qMin(chunkSize, size - i);
+        chunks.append(chunk);
+    }
+
+    return chunks;
+}
+
+void KisEuclideanDistanceTransform::processColumns(const quint8 *features, const Chunk &chunk)
+{
+    const int x0 = chunk.start;
+    qint32 *nearestRow = m_nearestRow.data();
+
+    /**
+     * The columns of the strip are processed together, row by row,
+     * so that both passes walk the memory linearly
+     */
+    QVector<qint32> lastFeature(chunk.size, -1);
+    qint32 *last = lastFeature.data();
+
+    // top-down pass: the nearest feature above the pixel
+    for (int y = 0; y < m_height; y++) {
+        const quint8 *srcPtr = features + y * m_width + x0;
+        qint32 *dstPtr = nearestRow + y * m_width + x0;
+
+        for (int i = 0; i < chunk.size; i++) {
+            if (srcPtr[i]) {
+                last[i] = y;
+            }
+            dstPtr[i] = last[i];
+        }
+    }
+
+    std::fill(last, last + chunk.size, -1);
+
+    // bottom-up pass: the nearest feature below the pixel, if it is closer
+    for (int y = m_height - 1; y >= 0; y--) {
+        const quint8 *srcPtr = features + y * m_width + x0;
+        qint32 *dstPtr = nearestRow + y * m_width + x0;
+
+        for (int i = 0; i < chunk.size; i++) {
+            if (srcPtr[i]) {
+                last[i] = y;
+            }
+
+            if (last[i] >= 0 && (dstPtr[i] < 0 || last[i] - y < y - dstPtr[i])) {
+                dstPtr[i] = last[i];
+            }
+        }
+    }
+}
+
+void KisEuclideanDistanceTransform::processRowsChunk(RowFunctor func, const Chunk &chunk) const
+{
+    const qreal infinity = std::numeric_limits<qreal>::infinity();
+
+    QVector<qint32> nearestX(m_width);
+    QVector<qint32> nearestY(m_width);
+
+    // the lower envelope of the parabolas: their columns and boundaries
+    QVector<qint32> envelope(m_width);
+    QVector<qreal> boundaries(m_width + 1);
+    QVector<qreal> columnDistance(m_width);
+
+    qint32 *v = envelope.data();
+    qreal *z = boundaries.data();
+    qreal *g = columnDistance.data();
+
+    auto intersection = [this, g] (int p, int q) {
+        return ((g[q] + m_xWeight * q * q) - (g[p] + m_xWeight * p * p)) /
+                (2.0 * m_xWeight * (q - p));
+    };
+
+    for (int y = chunk.start; y < chunk.start + chunk.size; y++) {
+        const qint32 *rowNearest = m_nearestRow.constData() + y * m_width;
+
+        int k = -1;
+
+        for (int q = 0; q < m_width; q++) {
+            if (rowNearest[q] < 0) continue;
+
+            const qreal dy = rowNearest[q] - y;
+            g[q] = m_yWeight * dy * dy;
+
+            if (k < 0) {
+                k = 0;
+                v[0] = q;
+                z[0] = -infinity;
+                z[1] = infinity;
+                continue;
+            }
+
+            qreal s = intersection(v[k], q);
+            while (s <= z[k]) {
+                k--;
+                s = intersection(v[k], q);
+            }
+
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = infinity;
+        }
+
+        KIS_SAFE_ASSERT_RECOVER_RETURN(k >= 0);
+
+        k = 0;
+        for (int x = 0; x < m_width; x++) {
+            while (z[k + 1] < x) {
+                k++;
+            }
+
+            nearestX[x] = v[k];
+            nearestY[x] = rowNearest[v[k]];
+        }
+
+        func(y, nearestX.constData(), nearestY.constData());
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISEUCLIDEANDISTANCETRANSFORM_H
+#define KISEUCLIDEANDISTANCETRANSFORM_H
+
+#include <QVector>
+#include <functional>
+
+#include "kritaimage_export.h"
+
+/**
+ * Exact Euclidean distance transform of a binary grid
+ * (Felzenszwalb & Huttenlocher, Meijster et al.)
+ *
+ * The transform is separable: the first pass finds the nearest
+ * feature in every column, the second one builds the lower envelope
+ * of the column distances in every row. Both passes are linear in
+ * the number of pixels, so the cost does not depend on how far the
+ * features are, and both passes are split into independent strips
+ * of columns and bunches of rows processed in parallel.
+ *
+ * Instead of plain distances the transform reports the nearest
+ * feature of every pixel, so the users can measure the distance in
+ * whatever way they need.
+ *
+ * The distance is measured as:
+ *
+ *     d^2 = xWeight * dx^2 + yWeight * dy^2
+ *
+ * which lets the transform work with elliptic neighbourhoods.
+ */
+class KRITAIMAGE_EXPORT KisEuclideanDistanceTransform
+{
+public:
+    KisEuclideanDistanceTransform(int width, int height, qreal xWeight = 1.0, qreal yWeight = 1.0);
+
+    /**
+     * Finds the nearest feature for every pixel of the grid.
+     * \p features is a width x height array in row-major order,
+     * non-zero values mark the features.
+     *
+     * \return false if the grid has no features at all
+     */
+    bool compute(const quint8 *features);
+
+    /**
+     * The functor is called for every row of the grid. \p nearestX
+     * and \p nearestY contain the coordinates of the nearest feature
+     * for every pixel of row \p y.
+     *
+     * The rows are processed in parallel, so the functor must be
+     * safe to call from several threads for different rows.
+     */
+    typedef std::function<void (int y, const qint32 *nearestX, const qint32 *nearestY)> RowFunctor;
+
+    /**
+     * Calls \p func for every row of the grid. Must be called only
+     * after compute() has found any features.
+     */
+    void processRows(RowFunctor func) const;
+
+    inline qreal distanceSquared(int x, int y, int featureX, int featureY) const {
+        const qreal dx = featureX - x;
+        const qreal dy = featureY - y;
+        return m_xWeight * dx * dx + m_yWeight * dy * dy;
+    }
+
+    /**
+     * The row of the nearest feature in column \p x for the pixel
+     * (x, y), -1 if the column has no features at all. Must be
+     * called only after compute() has found any features.
+     */
+    inline qint32 nearestRowInColumn(int x, int y) const {
+        return m_nearestRow[y * m_width + x];
+    }
+
+    int width() const {
+        return m_width;
+    }
+
+    int height() const {
+        return m_height;
+    }
+
+private:
+    struct Chunk {
+        int start;
+        int size;
+    };
+
+    static QVector<Chunk> splitIntoChunks(int size, int chunkSize);
+
+    void processColumns(const quint8 *features, const Chunk &chunk);
+    void processRowsChunk(RowFunctor func, const Chunk &chunk) const;
+
+private:
+    static const int columnsPerChunk = 64;
+    static const int rowsPerChunk = 64;
+
+    int m_width;
+    int m_height;
+    qreal m_xWeight;
+    qreal m_yWeight;
+
+    /**
+     * The row of the nearest feature in the same column,
+     * -1 if the column has no features at all
+     */
+    QVector<qint32> m_nearestRow;
+};
+
+#endif // KISEUCLIDEANDISTANCETRANSFORM_H
@@ -0,0 +1,501 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisParallelFill.h"
+
+#include <QVector>
+#include <QtConcurrent>
+
+#include "kis_assert.h"
+
+
+namespace {
+
+const int tileSize = 64;
+const quint16 noLabel = 0xFFFF;
+
+enum TileState {
+    Unvisited,
+    Queued,
+    Labelled
+};
+
+/**
+ * A run of the pixels of the same row having the same label
+ */
+struct Span
+{
+    quint16 offset; // index of the first pixel in the tile
+    quint16 length;
+    quint16 label;
+};
+
+/**
+ * The per-pixel opacity and labels of a tile exist only while the tile
+ * is being labelled. Then the tile keeps only what the merges and the
+ * final pass need: the labels of the border pixels, the runs of the
+ * labelled pixels, and their opacity, unless it is the same for all of
+ * them (which is always the case for the fills without softness).
+ */
+struct Tile
+{
+    QRect rect;
+    TileState state = Unvisited;
+
+    QVector<quint16> borderLabels[4]; // in the order of neighbours[]
+    QVector<Span> spans;
+    QVector<quint8> spanOpacity; // empty if uniform
+    quint8 uniformOpacity = 0;
+
+    int numLabels = 0;
+    int labelsBase = 0;
+};
+
+struct Neighbour
+{
+    int dx;
+    int dy;
+};
+
+const Neighbour neighbours[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+inline int sideIndex(const Neighbour &side)
+{
+    return side.dx ? (side.dx < 0 ? 0 : 1) : (side.dy < 0 ? 2 : 3);
+}
+
+inline int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+template <typename T>
+inline T findRoot(T *parent, T label)
+{
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+/**
+ * Splits the fillable pixels of the tile into 4-connected components
+ * with the classic two-pass algorithm. The components get compact
+ * labels in the order of their first pixel.
+ */
+void labelTile(Tile *tile, const KisParallelFill::OpacityFunction &calculateOpacity)
+{
+    const int width = tile->rect.width();
+    const int height = tile->rect.height();
+
+    QVector<quint8> opacityBuffer(width * height);
+    calculateOpacity(tile->rect, opacityBuffer.data());
+
+    QVector<quint16> labelsBuffer(width * height);
+
+    const quint8 *opacity = opacityBuffer.constData();
+    quint16 *labels = labelsBuffer.data();
+
+    QVector<quint16> parent;
+    parent.reserve(width * height / 2 + 1);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int index = y * width + x;
+
+            if (!opacity[index]) {
+                labels[index] = noLabel;
+                continue;
+            }
+
+            const quint16 left = x > 0 ? labels[index - 1] : noLabel;
+            const quint16 top = y > 0 ? labels[index - width] : noLabel;
+
+            if (left == noLabel && top == noLabel) {
+                labels[index] = parent.size();
+                parent.append(parent.size());
+            } else if (top == noLabel) {
+                labels[index] = left;
+            } else if (left == noLabel) {
+                labels[index] = top;
+            } else {
+                labels[index] = left;
+
+                const quint16 leftRoot = findRoot(parent.data(), left);
+                const quint16 topRoot = findRoot(parent.data(), top);
+
+                if (leftRoot != topRoot) {
+                    parent[qMax(leftRoot, topRoot)] = qMin(leftRoot, topRoot);
+                }
+            }
+        }
+    }
+
+    /**
+     * The roots are always smaller than the labels pointing to them,
+     * so a single pass is enough to compact the labels
+     */
+    QVector<quint16> compact(parent.size());
+    int numLabels = 0;
+
+    for (int i = 0; i < parent.size(); i++) {
+        const quint16 root = findRoot(parent.data(), quint16(i));
+        compact[i] = root == i ? numLabels++ : compact[root];
+    }
+
+    for (int i = 0; i < width * height; i++) {
+        if (labels[i] != noLabel) {
+            labels[i] = compact[labels[i]];
+        }
+    }
+
+    tile->numLabels = numLabels;
+
+    // keep the compact form of the tile only
+
+    for (const Neighbour &side : neighbours) {
+        const int length = side.dx ? height : width;
+        const int start =
+            side.dx > 0 ? width - 1 :
+            side.dy > 0 ? (height - 1) * width : 0;
+        const int step = side.dx ? width : 1;
+
+        QVector<quint16> &border = tile->borderLabels[sideIndex(side)];
+        border.resize(length);
+
+        for (int i = 0; i < length; i++) {
+            border[i] = labels[start + i * step];
+        }
+    }
+
+    bool opacityIsUniform = true;
+    int numLabelledPixels = 0;
+
+    for (int y = 0; y < height; y++) {
+        int x = 0;
+
+        while (x < width) {
+            const int index = y * width + x;
+            const quint16 label = labels[index];
+
+            int length = 1;
+            while (x + length < width && labels[index + length] == label) {
+                length++;
+            }
+
+            if (label != noLabel) {
+                Span span;
+                span.offset = index;
+                span.length = length;
+                span.label = label;
+                tile->spans.append(span);
+
+                if (!numLabelledPixels) {
+                    tile->uniformOpacity = opacity[index];
+                }
+
+                for (int i = index; opacityIsUniform && i < index + length; i++) {
+                    opacityIsUniform = opacity[i] == tile->uniformOpacity;
+                }
+
+                numLabelledPixels += length;
+            }
+
+            x += length;
+        }
+    }
+
+    if (!opacityIsUniform) {
+        tile->spanOpacity.reserve(numLabelledPixels);
+
+        Q_FOREACH (const Span &span, tile->spans) {
+            for (int i = span.offset; i < span.offset + span.length; i++) {
+                tile->spanOpacity.append(opacity[i]);
+            }
+        }
+    }
+
+    tile->spans.squeeze();
+}
+
+}
+
+struct Q_DECL_HIDDEN KisParallelFill::Private
+{
+    QPoint startPoint;
+    QRect boundingRect;
+
+    QRect tileGrid;
+    QVector<Tile> tiles;
+    QVector<int> parent;
+
+    inline int tileIndex(int column, int row) const {
+        return (row - tileGrid.top()) * tileGrid.width() + column - tileGrid.left();
+    }
+
+    inline int find(int label) {
+        return findRoot(parent.data(), label);
+    }
+
+    inline void unite(int first, int second) {
+        const int firstRoot = find(first);
+        const int secondRoot = find(second);
+
+        if (firstRoot != secondRoot) {
+            parent[qMax(firstRoot, secondRoot)] = qMin(firstRoot, secondRoot);
+        }
+    }
+
+    QVector<int> borderLabels(const Tile &tile, const Neighbour &side) const;
+    void mergeTiles(int first, int second, const Neighbour &side);
+    bool borderHasRoot(int index, const Neighbour &side, int root);
+    QVector<int> neighbourTiles(int index, QVector<Neighbour> *sides) const;
+};
+
+QVector<int> KisParallelFill::Private::borderLabels(const Tile &tile, const Neighbour &side) const
+{
+    const QVector<quint16> &border = tile.borderLabels[sideIndex(side)];
+
+    QVector<int> result(border.size());
+
+    for (int i = 0; i < border.size(); i++) {
+        const quint16 label = border[i];
+        result[i] = label != noLabel ? tile.labelsBase + label : -1;
+    }
+
+    return result;
+}
+
+void KisParallelFill::Private::mergeTiles(int first, int second, const Neighbour &side)
+{
+    const Neighbour oppositeSide = {-side.dx, -side.dy};
+
+    const QVector<int> firstLabels = borderLabels(tiles[first], side);
+    const QVector<int> secondLabels = borderLabels(tiles[second], oppositeSide);
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(firstLabels.size() == secondLabels.size());
+
+    for (int i = 0; i < firstLabels.size(); i++) {
+        if (firstLabels[i] >= 0 && secondLabels[i] >= 0) {
+            unite(firstLabels[i], secondLabels[i]);
+        }
+    }
+}
+
+bool KisParallelFill::Private::borderHasRoot(int index, const Neighbour &side, int root)
+{
+    Q_FOREACH (int label, borderLabels(tiles[index], side)) {
+        if (label >= 0 && find(label) == root) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QVector<int> KisParallelFill::Private::neighbourTiles(int index, QVector<Neighbour> *sides) const
+{
+    const int column = tileGrid.left() + index % tileGrid.width();
+    const int row = tileGrid.top() + index / tileGrid.width();
+
+    QVector<int> result;
+
+    for (const Neighbour &side : neighbours) {
+        if (!tileGrid.contains(column + side.dx, row + side.dy)) continue;
+
+        result.append(tileIndex(column + side.dx, row + side.dy));
+        sides->append(side);
+    }
+
+    return result;
+}
+
+KisParallelFill::KisParallelFill(const QPoint &startPoint, const QRect &boundingRect)
+    : m_d(new Private)
+{
+    m_d->startPoint = startPoint;
+    m_d->boundingRect = boundingRect;
+}
+
+KisParallelFill::~KisParallelFill()
+{
+}
+
+void KisParallelFill::run(OpacityFunction calculateOpacity, FillFunction fill)
+{
+    if (!m_d->boundingRect.contains(m_d->startPoint)) return;
+
+    m_d->tileGrid = QRect(QPoint(floorDiv(m_d->boundingRect.left(), tileSize),
+                                 floorDiv(m_d->boundingRect.top(), tileSize)),
+                          QPoint(floorDiv(m_d->boundingRect.right(), tileSize),
+                                 floorDiv(m_d->boundingRect.bottom(), tileSize)));
+
+    m_d->tiles.resize(m_d->tileGrid.width() * m_d->tileGrid.height());
+
+    for (int row = m_d->tileGrid.top(); row <= m_d->tileGrid.bottom(); row++) {
+        for (int column = m_d->tileGrid.left(); column <= m_d->tileGrid.right(); column++) {
+            const QRect rc(column * tileSize, row * tileSize, tileSize, tileSize);
+            m_d->tiles[m_d->tileIndex(column, row)].rect = rc & m_d->boundingRect;
+        }
+    }
+
+    const int startTile = m_d->tileIndex(floorDiv(m_d->startPoint.x(), tileSize),
+                                         floorDiv(m_d->startPoint.y(), tileSize));
+
+    QVector<int> wave;
+    wave.append(startTile);
+    m_d->tiles[startTile].state = Queued;
+
+    QVector<int> labelledTiles;
+    QVector<int> boundaryTiles;
+    int startLabel = -1;
+    int startRoot = -1;
+
+    auto labelFunc = [this, &calculateOpacity] (int index) {
+        labelTile(&m_d->tiles[index], calculateOpacity);
+    };
+
+    while (!wave.isEmpty()) {
+        if (wave.size() == 1) {
+            labelFunc(wave.first());
+        } else {
+            QtConcurrent::blockingMap(wave, labelFunc);
+        }
+
+        Q_FOREACH (int index, wave) {
+            Tile &tile = m_d->tiles[index];
+            tile.labelsBase = m_d->parent.size();
+            tile.state = Labelled;
+
+            for (int i = 0; i < tile.numLabels; i++) {
+                m_d->parent.append(tile.labelsBase + i);
+            }
+        }
+
+        Q_FOREACH (int index, wave) {
+            QVector<Neighbour> sides;
+            const QVector<int> neighbourIndexes = m_d->neighbourTiles(index, &sides);
+
+            for (int i = 0; i < neighbourIndexes.size(); i++) {
+                if (m_d->tiles[neighbourIndexes[i]].state == Labelled) {
+                    m_d->mergeTiles(index, neighbourIndexes[i], sides[i]);
+                }
+            }
+
+            labelledTiles.append(index);
+            boundaryTiles.append(index);
+        }
+
+        if (startLabel < 0) {
+            const Tile &tile = m_d->tiles[startTile];
+            const QPoint pt = m_d->startPoint - tile.rect.topLeft();
+            const int startIndex = pt.y() * tile.rect.width() + pt.x();
+
+            Q_FOREACH (const Span &span, tile.spans) {
+                if (span.offset <= startIndex && startIndex < span.offset + span.length) {
+                    startLabel = tile.labelsBase + span.label;
+                    break;
+                }
+            }
+
+            if (startLabel < 0) return;
+        }
+
+        startRoot = m_d->find(startLabel);
+
+        /**
+         * The tiles adjacent to the filled region join the next wave. The
+         * merges done in this wave could have connected any component of
+         * the boundary tiles to the filled region, so all of them are
+         * checked again.
+         */
+        wave.clear();
+        QVector<int> newBoundaryTiles;
+
+        Q_FOREACH (int index, boundaryTiles) {
+            QVector<Neighbour> sides;
+            const QVector<int> neighbourIndexes = m_d->neighbourTiles(index, &sides);
+            bool hasUnvisitedNeighbours = false;
+
+            for (int i = 0; i < neighbourIndexes.size(); i++) {
+                Tile &neighbour = m_d->tiles[neighbourIndexes[i]];
+                if (neighbour.state != Unvisited) continue;
+
+                if (m_d->borderHasRoot(index, sides[i], startRoot)) {
+                    neighbour.state = Queued;
+                    wave.append(neighbourIndexes[i]);
+                } else {
+                    hasUnvisitedNeighbours = true;
+                }
+            }
+
+            if (hasUnvisitedNeighbours) {
+                newBoundaryTiles.append(index);
+            }
+        }
+
+        boundaryTiles.swap(newBoundaryTiles);
+    }
+
+    // flatten the union-find so that the final pass can read it concurrently
+    for (int i = 0; i < m_d->parent.size(); i++) {
+        m_d->parent[i] = m_d->find(i);
+    }
+
+    const QVector<int> &roots = m_d->parent;
+
+    auto fillFunc = [this, &roots, startRoot, &fill] (int index) {
+        Tile &tile = m_d->tiles[index];
+
+        QVector<quint8> opacity;
+        const bool opacityIsUniform = tile.spanOpacity.isEmpty();
+        int spanOpacityOffset = 0;
+
+        Q_FOREACH (const Span &span, tile.spans) {
+            if (roots[tile.labelsBase + span.label] == startRoot) {
+                if (opacity.isEmpty()) {
+                    opacity.fill(0, tile.rect.width() * tile.rect.height());
+                }
+
+                quint8 *dst = opacity.data() + span.offset;
+
+                if (opacityIsUniform) {
+                    memset(dst, tile.uniformOpacity, span.length);
+                } else {
+                    memcpy(dst, tile.spanOpacity.constData() + spanOpacityOffset, span.length);
+                }
+            }
+
+            spanOpacityOffset += span.length;
+        }
+
+        if (!opacity.isEmpty()) {
+            fill(tile.rect, opacity.constData());
+        }
+
+        tile.spans.clear();
+        tile.spanOpacity.clear();
+    };
+
+    if (labelledTiles.size() == 1) {
+        fillFunc(labelledTiles.first());
+    } else {
+        QtConcurrent::blockingMap(labelledTiles, fillFunc);
+    }
+}
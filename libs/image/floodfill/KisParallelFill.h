@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISPARALLELFILL_H
+#define KISPARALLELFILL_H
+
+#include <QScopedPointer>
+#include <QPoint>
+#include <QRect>
+
+#include <functional>
+
+/**
+ * Tile-parallel flood fill engine used by KisScanlineFill
+ *
+ * The fill area is split into 64x64 tiles. Every tile is labelled
+ * independently: its pixels with non-zero opacity are grouped into
+ * 4-connected components. Then the labels of the neighbouring tiles
+ * are merged with union-find along the tile borders.
+ *
+ * The tiles are labelled in waves starting from the one containing
+ * the start point. A tile is added to the next wave only when the
+ * region connected to the start point reaches its border, so a fill
+ * of a small area doesn't have to label the whole bounding rect. All
+ * the tiles of a wave are labelled concurrently, and the final pass
+ * writing the result is concurrent as well.
+ *
+ * The per-pixel opacity and labels of a tile are dropped as soon as
+ * the tile is labelled. Until the final pass the tile keeps only the
+ * labels of its border pixels, the runs of its labelled pixels and,
+ * for the fills with softness, the opacity of these pixels.
+ */
+class KisParallelFill
+{
+public:
+    /**
+     * Calculates the fill opacity of every pixel of \p rc and writes
+     * it into \p opacity (row-major, rc.width() * rc.height() values).
+     * Zero opacity means the pixel is not fillable.
+     *
+     * Called concurrently for different rects.
+     */
+    typedef std::function<void(const QRect &rc, quint8 *opacity)> OpacityFunction;
+
+    /**
+     * Fills \p rc using the \p opacity map, in which all the pixels
+     * not belonging to the filled region are zeroed.
+     *
+     * Called concurrently for different rects.
+     */
+    typedef std::function<void(const QRect &rc, const quint8 *opacity)> FillFunction;
+
+public:
+    KisParallelFill(const QPoint &startPoint, const QRect &boundingRect);
+    ~KisParallelFill();
+
+    void run(OpacityFunction calculateOpacity, FillFunction fill);
+
+private:
+    Q_DISABLE_COPY(KisParallelFill)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISPARALLELFILL_H
@@ -29,6 +29,7 @@
 #include "kis_pixel_selection.h"
 #include "kis_random_accessor_ng.h"
 #include "kis_fill_sanity_checks.h"
+#include "KisParallelFill.h"
 
 
 template <class BaseClass>
@@ -344,6 +345,103 @@ private:
 };
 
 
+/**
+ * A filler for the policies used by the parallel engine: it only
+ * calculates the opacity, the pixels are written by the fill functions
+ * below.
+ */
+template <class BaseClass>
+class CalculateOpacityOnly : public BaseClass
+{
+public:
+    typedef KisRandomConstAccessorSP SourceAccessorType;
+
+    SourceAccessorType createSourceDeviceAccessor(KisPaintDeviceSP device) {
+        Q_UNUSED(device);
+        return SourceAccessorType();
+    }
+};
+
+template <bool useSmoothSelection, class DifferencePolicy>
+KisParallelFill::OpacityFunction createOpacityFunctionImpl(KisPaintDeviceSP device, const KoColor &srcPixel, int threshold)
+{
+    return [device, srcPixel, threshold] (const QRect &rc, quint8 *opacity) {
+        SelectionPolicy<useSmoothSelection, DifferencePolicy, CalculateOpacityOnly>
+            policy(device, srcPixel, threshold);
+
+        const int pixelSize = device->pixelSize();
+        const int numPixels = rc.width() * rc.height();
+
+        QVector<quint8> data(numPixels * pixelSize);
+        device->readBytes(data.data(), rc);
+
+        quint8 *pixelPtr = data.data();
+
+        for (int i = 0; i < numPixels; i++) {
+            opacity[i] = policy.calculateOpacity(pixelPtr);
+            pixelPtr += pixelSize;
+        }
+    };
+}
+
+template <bool useSmoothSelection,
+          template <typename> class OptimizedDifferencePolicy,
+          class SlowDifferencePolicy>
+KisParallelFill::OpacityFunction createOpacityFunction(KisPaintDeviceSP device, const KoColor &srcPixel, int threshold)
+{
+    switch (device->pixelSize()) {
+    case 1:
+        return createOpacityFunctionImpl<useSmoothSelection, OptimizedDifferencePolicy<quint8>>(device, srcPixel, threshold);
+    case 2:
+        return createOpacityFunctionImpl<useSmoothSelection, OptimizedDifferencePolicy<quint16>>(device, srcPixel, threshold);
+    case 4:
+        return createOpacityFunctionImpl<useSmoothSelection, OptimizedDifferencePolicy<quint32>>(device, srcPixel, threshold);
+    case 8:
+        return createOpacityFunctionImpl<useSmoothSelection, OptimizedDifferencePolicy<quint64>>(device, srcPixel, threshold);
+    default:
+        return createOpacityFunctionImpl<useSmoothSelection, SlowDifferencePolicy>(device, srcPixel, threshold);
+    }
+}
+
+KisParallelFill::FillFunction createFillWithColorFunction(KisPaintDeviceSP device, const KoColor &fillColor)
+{
+    return [device, fillColor] (const QRect &rc, const quint8 *opacity) {
+        const int pixelSize = device->pixelSize();
+        const int numPixels = rc.width() * rc.height();
+
+        KIS_SAFE_ASSERT_RECOVER_RETURN(fillColor.colorSpace()->pixelSize() == quint32(pixelSize));
+
+        QVector<quint8> data(numPixels * pixelSize);
+        device->readBytes(data.data(), rc);
+
+        for (int i = 0; i < numPixels; i++) {
+            if (opacity[i] == MAX_SELECTED) {
+                memcpy(data.data() + i * pixelSize, fillColor.data(), pixelSize);
+            }
+        }
+
+        device->writeBytes(data.constData(), rc);
+    };
+}
+
+KisParallelFill::FillFunction createCopyToSelectionFunction(KisPaintDeviceSP pixelSelection)
+{
+    return [pixelSelection] (const QRect &rc, const quint8 *opacity) {
+        const int numPixels = rc.width() * rc.height();
+
+        QVector<quint8> data(numPixels);
+        pixelSelection->readBytes(data.data(), rc);
+
+        for (int i = 0; i < numPixels; i++) {
+            if (opacity[i]) {
+                data[i] = opacity[i];
+            }
+        }
+
+        pixelSelection->writeBytes(data.constData(), rc);
+    };
+}
+
 
 struct Q_DECL_HIDDEN KisScanlineFill::Private
 {
@@ -351,6 +449,7 @@ struct Q_DECL_HIDDEN KisScanlineFill::Private
     QPoint startPoint;
     QRect boundingRect;
     int threshold;
+    bool useParallelFill;
 
     int rowIncrement;
     KisFillIntervalMap backwardMap;
@@ -379,6 +478,7 @@ KisScanlineFill::KisScanlineFill(KisPaintDeviceSP device, const QPoint &startPoi
     m_d->rowIncrement = 1;
 
     m_d->threshold = 0;
+    m_d->useParallelFill = true;
 }
 
 KisScanlineFill::~KisScanlineFill()
@@ -390,6 +490,11 @@ void KisScanlineFill::setThreshold(int threshold)
     m_d->threshold = threshold;
 }
 
+void KisScanlineFill::setUseParallelFill(bool value)
+{
+    m_d->useParallelFill = value;
+}
+
 template <class T>
 void KisScanlineFill::extendedPass(KisFillInterval *currentInterval, int srcRow, bool extendRight, T &pixelPolicy)
 {
@@ -553,6 +658,13 @@ void KisScanlineFill::fillColor(const KoColor &originalFillColor)
     KoColor fillColor(originalFillColor);
     fillColor.convertTo(m_d->device->colorSpace());
 
+    if (m_d->useParallelFill) {
+        KisParallelFill fill(m_d->startPoint, m_d->boundingRect);
+        fill.run(createOpacityFunction<false, DifferencePolicyOptimized, DifferencePolicySlow>(m_d->device, srcColor, m_d->threshold),
+                 createFillWithColorFunction(m_d->device, fillColor));
+        return;
+    }
+
     const int pixelSize = m_d->device->pixelSize();
 
     if (pixelSize == 1) {
@@ -589,6 +701,13 @@ void KisScanlineFill::fillColor(const KoColor &originalFillColor, KisPaintDevice
     KoColor fillColor(originalFillColor);
     fillColor.convertTo(m_d->device->colorSpace());
 
+    if (m_d->useParallelFill) {
+        KisParallelFill fill(m_d->startPoint, m_d->boundingRect);
+        fill.run(createOpacityFunction<false, DifferencePolicyOptimized, DifferencePolicySlow>(m_d->device, srcColor, m_d->threshold),
+                 createFillWithColorFunction(externalDevice, fillColor));
+        return;
+    }
+
     const int pixelSize = m_d->device->pixelSize();
 
     if (pixelSize == 1) {
@@ -628,6 +747,13 @@ void KisScanlineFill::fillSelection(KisPixelSelectionSP pixelSelection)
 {
     KoColor srcColor(m_d->device->pixel(m_d->startPoint));
 
+    if (m_d->useParallelFill) {
+        KisParallelFill fill(m_d->startPoint, m_d->boundingRect);
+        fill.run(createOpacityFunction<true, DifferencePolicyOptimized, DifferencePolicySlow>(m_d->device, srcColor, m_d->threshold),
+                 createCopyToSelectionFunction(pixelSelection));
+        return;
+    }
+
     const int pixelSize = m_d->device->pixelSize();
 
     if (pixelSize == 1) {
@@ -663,6 +789,13 @@ void KisScanlineFill::clearNonZeroComponent()
     const int pixelSize = m_d->device->pixelSize();
     KoColor srcColor(Qt::transparent, m_d->device->colorSpace());
 
+    if (m_d->useParallelFill) {
+        KisParallelFill fill(m_d->startPoint, m_d->boundingRect);
+        fill.run(createOpacityFunction<false, IsNonNullPolicyOptimized, IsNonNullPolicySlow>(m_d->device, srcColor, m_d->threshold),
+                 createFillWithColorFunction(m_d->device, srcColor));
+        return;
+    }
+
     if (pixelSize == 1) {
         SelectionPolicy<false, IsNonNullPolicyOptimized<quint8>, FillWithColor>
             policy(m_d->device, srcColor, m_d->threshold);
@@ -698,6 +831,44 @@ void KisScanlineFill::fillContiguousGroup(KisPaintDeviceSP groupMapDevice, qint3
 
     const quint8 referenceValue = *m_d->device->pixel(m_d->startPoint).data();
 
+    if (m_d->useParallelFill) {
+        KisPaintDeviceSP scribbleDevice = m_d->device;
+        const int threshold = m_d->threshold;
+
+        KisParallelFill fill(m_d->startPoint, m_d->boundingRect);
+        fill.run(
+            [scribbleDevice, referenceValue, threshold] (const QRect &rc, quint8 *opacity) {
+                scribbleDevice->readBytes(opacity, rc);
+
+                for (int i = 0; i < rc.width() * rc.height(); i++) {
+                    const int diff = qAbs(int(opacity[i]) - referenceValue);
+                    opacity[i] = diff <= threshold ? MAX_SELECTED : MIN_SELECTED;
+                }
+            },
+            [scribbleDevice, groupMapDevice, groupIndex] (const QRect &rc, const quint8 *opacity) {
+                const int numPixels = rc.width() * rc.height();
+
+                QVector<quint8> scribble(numPixels);
+                QVector<qint32> groupMap(numPixels);
+
+                scribbleDevice->readBytes(scribble.data(), rc);
+                groupMapDevice->readBytes(reinterpret_cast<quint8*>(groupMap.data()), rc);
+
+                for (int i = 0; i < numPixels; i++) {
+                    if (!opacity[i]) continue;
+
+                    // erase the scribble and write group index into the map
+                    scribble[i] = 0;
+                    KIS_SAFE_ASSERT_RECOVER_NOOP(groupMap[i] == 0);
+                    groupMap[i] = groupIndex;
+                }
+
+                scribbleDevice->writeBytes(scribble.constData(), rc);
+                groupMapDevice->writeBytes(reinterpret_cast<const quint8*>(groupMap.constData()), rc);
+            });
+        return;
+    }
+
     GroupSplitPolicy policy(m_d->device, groupMapDevice, groupIndex, referenceValue, m_d->threshold);
     runImpl(policy);
 }
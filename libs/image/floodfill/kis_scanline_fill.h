@@ -74,6 +74,13 @@ public:
      */
     void setThreshold(int threshold);
 
+    /**
+     * Use the tile-parallel engine (KisParallelFill) instead of the
+     * sequential scanline algorithm. The results are the same, the
+     * parallel engine is used by default.
+     */
+    void setUseParallelFill(bool value);
+
 private:
     friend class KisScanlineFillTest;
     Q_DISABLE_COPY(KisScanlineFill)
@@ -75,9 +75,9 @@ struct Q_DECL_HIDDEN KisCageTransformWorker::Private
     QVector<QPointF> calculateTransformedPoints();
 
     inline QVector<int> calculateMappedIndexes(int col, int row,
-                                               int *numExistingPoints);
+                                               int *numExistingPoints) const;
 
-    int tryGetValidIndex(const QPoint &cellPt);
+    int tryGetValidIndex(const QPoint &cellPt) const;
 
     struct MapIndexesOp;
 };
@@ -220,7 +220,7 @@ QVector<QPointF> KisCageTransformWorker::Private::calculateTransformedPoints()
 
 inline QVector<int> KisCageTransformWorker::Private::
 calculateMappedIndexes(int col, int row,
-                       int *numExistingPoints)
+                       int *numExistingPoints) const
 {
     *numExistingPoints = 0;
     QVector<int> cellIndexes =
@@ -237,7 +237,7 @@ calculateMappedIndexes(int col, int row,
 
 
 int KisCageTransformWorker::Private::
-tryGetValidIndex(const QPoint &cellPt)
+tryGetValidIndex(const QPoint &cellPt) const
 {
     int index = -1;
     if (cellPt.x() >= 0 &&
@@ -271,7 +271,7 @@ struct KisCageTransformWorker::Private::MapIndexesOp {
     }
 
     inline QPointF getSrcPointForce(const QPoint &cellPt) const {
-        return m_d->allSrcPoints[GridIterationTools::pointToIndex(cellPt, m_d->gridSize)];
+        return m_d->allSrcPoints.at(GridIterationTools::pointToIndex(cellPt, m_d->gridSize));
     }
 
     inline const QPolygonF srcCropPolygon() const {
@@ -369,7 +369,7 @@ void KisCageTransformWorker::run()
 
     GridIterationTools::PaintDevicePolygonOp polygonOp(srcDev, tempDevice);
     Private::MapIndexesOp indexesOp(m_d.data());
-    GridIterationTools::iterateThroughGrid
+    GridIterationTools::iterateThroughGridInPatches
         <GridIterationTools::IncompletePolygonPolicy>(polygonOp, indexesOp,
                                                       m_d->gridSize,
                                                       m_d->validPoints,
@@ -57,6 +57,8 @@
 #include "kis_convolution_worker_fft.h"
 #endif
 
+#include "kis_convolution_worker_recursive_gaussian.h"
+
 
 bool KisConvolutionPainter::useFFTImplementation(const KisConvolutionKernelSP kernel) const
 {
@@ -147,13 +149,7 @@ void KisConvolutionPainter::applyMatrix(const KisConvolutionKernelSP kernel, con
     // Determine whether we convolve border pixels, or not.
     switch (borderOp) {
     case BORDER_REPEAT: {
-        const QRect boundsRect = src->defaultBounds()->bounds();
-        const QRect requestedRect = QRect(srcPos, areaSize);
-        QRect dataRect = requestedRect | boundsRect;
-
-        KIS_SAFE_ASSERT_RECOVER(boundsRect != KisDefaultBounds().bounds()) {
-            dataRect = requestedRect | src->exactBounds();
-        }
+        const QRect dataRect = repeatDataRect(src, QRect(srcPos, areaSize));
 
         /**
          * FIXME: Implementation can return empty destination device
@@ -183,6 +179,45 @@ void KisConvolutionPainter::applyMatrix(const KisConvolutionKernelSP kernel, con
     }
 }
 
+void KisConvolutionPainter::applyGaussian(const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
+                                          qreal xSigma, qreal ySigma,
+                                          KisConvolutionBorderOp borderOp)
+{
+    // see a comment in applyMatrix()
+    if (src->defaultBounds()->wrapAroundMode()) {
+        borderOp = BORDER_IGNORE;
+    }
+
+    switch (borderOp) {
+    case BORDER_REPEAT: {
+        const QRect dataRect = repeatDataRect(src, QRect(srcPos, areaSize));
+
+        if (dataRect.isValid()) {
+            KisConvolutionWorkerRecursiveGaussian<RepeatIteratorFactory> worker(this, progressUpdater());
+            worker.execute(src, srcPos, dstPos, areaSize, xSigma, ySigma, dataRect);
+        }
+        break;
+    }
+    case BORDER_IGNORE:
+    default: {
+        KisConvolutionWorkerRecursiveGaussian<StandardIteratorFactory> worker(this, progressUpdater());
+        worker.execute(src, srcPos, dstPos, areaSize, xSigma, ySigma, QRect());
+    }
+    }
+}
+
+QRect KisConvolutionPainter::repeatDataRect(const KisPaintDeviceSP src, const QRect &requestedRect)
+{
+    const QRect boundsRect = src->defaultBounds()->bounds();
+    QRect dataRect = requestedRect | boundsRect;
+
+    KIS_SAFE_ASSERT_RECOVER(boundsRect != KisDefaultBounds().bounds()) {
+        dataRect = requestedRect | src->exactBounds();
+    }
+
+    return dataRect;
+}
+
 bool KisConvolutionPainter::needsTransaction(const KisConvolutionKernelSP kernel) const
 {
     return !useFFTImplementation(kernel);
@@ -76,6 +76,20 @@ public:
     void applyMatrix(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
                      KisConvolutionBorderOp borderOp = BORDER_REPEAT);
 
+    /**
+     * Blur the area of \p src with a Gaussian of the given standard
+     * deviations. The blur is done with a recursive filter, so its cost
+     * doesn't depend on the deviations. A deviation equal to zero skips
+     * the corresponding pass.
+     *
+     * The whole source area is cached before writing, so, unlike
+     * applyMatrix(), \p src may safely coincide with the destination
+     * device without a transaction.
+     */
+    void applyGaussian(const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
+                       qreal xSigma, qreal ySigma,
+                       KisConvolutionBorderOp borderOp = BORDER_REPEAT);
+
     /**
      * The caller should ask if the painter needs an explicit transaction iff
      * the source and destination devices coincide. Otherwise, the transaction is
@@ -98,6 +112,8 @@ private:
 
      bool useFFTImplementation(const KisConvolutionKernelSP kernel) const;
 
+     static QRect repeatDataRect(const KisPaintDeviceSP src, const QRect &requestedRect);
+
 private:
     TestingEnginePreference m_enginePreference;
 };
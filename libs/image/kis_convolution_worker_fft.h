@@ -29,9 +29,13 @@
 
 #include <QMutex>
 #include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QSharedPointer>
 #include <QTextStream>
 #include <QFile>
 #include <QDir>
+#include <QtConcurrent>
 
 #include <fftw3.h>
 
@@ -39,13 +43,105 @@ template<class _IteratorFactory_> class KisConvolutionWorkerFFT;
 class KisConvolutionWorkerFFTLock
 {
 private:
+    /**
+     * FFTW planner is not thread-safe, so every creation and
+     * destruction of a plan must be guarded by this mutex. Execution
+     * of the existing plans is thread-safe.
+     */
     static QMutex fftwMutex;
     template<class _IteratorFactory_> friend class KisConvolutionWorkerFFT;
+    friend class KisConvolutionWorkerFFTPlanCache;
 };
 
 QMutex KisConvolutionWorkerFFTLock::fftwMutex;
 
 
+/**
+ * Keeps the in-place real-to-complex and complex-to-real plans for the
+ * recently used transform sizes. The plans are executed with the
+ * new-array execute functions (fftw_execute_dft_r2c() and
+ * fftw_execute_dft_c2r()), so one plan can be used by any number of
+ * threads at the same time, as long as the arrays are allocated with
+ * fftw_malloc() and have the same size.
+ */
+class KisConvolutionWorkerFFTPlanCache
+{
+public:
+    struct Plans {
+        fftw_plan forward;
+        fftw_plan backward;
+    };
+    typedef QSharedPointer<Plans> PlansSP;
+
+    static KisConvolutionWorkerFFTPlanCache* instance() {
+        static KisConvolutionWorkerFFTPlanCache cache;
+        return &cache;
+    }
+
+    /**
+     * Returns the plans for a fftHeight x fftWidth transform. If there
+     * are no such plans yet, they are created for \p array. The planning
+     * is done in FFTW_ESTIMATE mode, so the array is not overwritten.
+     */
+    PlansSP plans(quint32 fftHeight, quint32 fftWidth, fftw_complex *array) {
+        const Key key(fftHeight, fftWidth);
+
+        // the evicted plans are destroyed after the mutex is released
+        QList<PlansSP> evictedPlans;
+        PlansSP result;
+
+        {
+            QMutexLocker l(&KisConvolutionWorkerFFTLock::fftwMutex);
+
+            if (!m_wisdomImported) {
+                fftw_import_system_wisdom();
+                m_wisdomImported = true;
+            }
+
+            result = m_plans.value(key);
+
+            if (result) {
+                m_usageOrder.removeOne(key);
+            } else {
+                result = PlansSP(new Plans, &KisConvolutionWorkerFFTPlanCache::destroyPlans);
+                result->forward = fftw_plan_dft_r2c_2d(fftHeight, fftWidth, (double*)array, array, FFTW_ESTIMATE);
+                result->backward = fftw_plan_dft_c2r_2d(fftHeight, fftWidth, array, (double*)array, FFTW_ESTIMATE);
+                m_plans.insert(key, result);
+
+                while (m_usageOrder.size() >= maxCachedPlans) {
+                    evictedPlans << m_plans.take(m_usageOrder.takeFirst());
+                }
+            }
+
+            m_usageOrder.append(key);
+        }
+
+        return result;
+    }
+
+private:
+    typedef QPair<quint32, quint32> Key;
+    static const int maxCachedPlans = 16;
+
+    KisConvolutionWorkerFFTPlanCache()
+        : m_wisdomImported(false)
+    {
+    }
+
+    static void destroyPlans(Plans *plans) {
+        QMutexLocker l(&KisConvolutionWorkerFFTLock::fftwMutex);
+        fftw_destroy_plan(plans->forward);
+        fftw_destroy_plan(plans->backward);
+        delete plans;
+    }
+
+private:
+    QHash<Key, PlansSP> m_plans;
+    QList<Key> m_usageOrder;
+    bool m_wisdomImported;
+};
+
+
 template<class _IteratorFactory_>
 class KisConvolutionWorkerFFT : public KisConvolutionWorker<_IteratorFactory_>
 {
@@ -129,35 +225,24 @@ public:
         const float progressPerFFT = (100 - 30) / (double)(convChannelList.count() * 2 + 1);
 
         // perform FFT
-        fftw_plan fftwPlanForward, fftwPlanBackward;
+        KisConvolutionWorkerFFTPlanCache::PlansSP plans =
+            KisConvolutionWorkerFFTPlanCache::instance()->plans(m_fftHeight, m_fftWidth, m_kernelFFT);
 
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftwPlanForward = fftw_plan_dft_r2c_2d(m_fftHeight, m_fftWidth, (double*)m_kernelFFT, m_kernelFFT, FFTW_ESTIMATE);
-        fftwPlanBackward = fftw_plan_dft_c2r_2d(m_fftHeight, m_fftWidth, m_kernelFFT, (double*)m_kernelFFT, FFTW_ESTIMATE);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
-
-        fftw_execute(fftwPlanForward);
+        fftw_execute_dft_r2c(plans->forward, (double*)m_kernelFFT, m_kernelFFT);
         addToProgress(progressPerFFT);
         if (isInterrupted()) return;
 
-        for (auto k = m_channelFFT.begin(); k != m_channelFFT.end(); ++k)
-        {
-            fftw_execute_dft_r2c(fftwPlanForward, (double*)(*k), *k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
-
-            fftMultiply(*k, m_kernelFFT);
-
-            fftw_execute_dft_c2r(fftwPlanBackward, *k, (double*)*k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
-        }
-
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftw_destroy_plan(fftwPlanForward);
-        fftw_destroy_plan(fftwPlanBackward);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
+        // the channels are independent, so they share the plans and are
+        // transformed in parallel
+        QtConcurrent::blockingMap(m_channelFFT,
+            [this, plans] (fftw_complex *channel) {
+                fftw_execute_dft_r2c(plans->forward, (double*)channel, channel);
+                fftMultiply(channel, m_kernelFFT);
+                fftw_execute_dft_c2r(plans->backward, channel, (double*)channel);
+            });
 
+        addToProgress(progressPerFFT * 2 * m_channelFFT.size());
+        if (isInterrupted()) return;
 
         writeResultToDevice(QRect(dstPos.x(), dstPos.y(), areaSize.width(), areaSize.height()),
                             cacheRowStride, halfKernelWidth, halfKernelHeight,
@@ -0,0 +1,450 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_CONVOLUTION_WORKER_RECURSIVE_GAUSSIAN_H
+#define KIS_CONVOLUTION_WORKER_RECURSIVE_GAUSSIAN_H
+
+#include <KoChannelInfo.h>
+#include <KoColorSpace.h>
+#include <KoUpdater.h>
+
+#include "kis_convolution_worker.h"
+#include "kis_math_toolbox.h"
+#include "kis_selection.h"
+
+#include <QVector>
+#include <QtMath>
+#include <QtConcurrent>
+
+#include <cmath>
+#include <limits>
+
+
+/**
+ * Applies a Gaussian blur with a recursive (IIR) filter, as described
+ * by Young and van Vliet in "Recursive implementation of the Gaussian
+ * filter" (1995).
+ *
+ * Every axis is filtered with a third-order causal pass followed by
+ * an anticausal one, so the cost per pixel does not depend on sigma.
+ * The image is cached in a planar-per-pixel float buffer: horizontal
+ * passes are run for bunches of rows in parallel, and vertical passes
+ * for strips of columns, processing all the columns of a strip in one
+ * contiguous (and easily vectorizable) loop.
+ *
+ * Outside the processed rect the signal is assumed to continue with
+ * its edge value, which is exactly what BORDER_REPEAT expects. For
+ * other cases the cache is extended by marginFromSigma() pixels, which
+ * is where the influence of the remaining pixels becomes negligible.
+ */
+template <class _IteratorFactory_>
+class KisConvolutionWorkerRecursiveGaussian
+{
+public:
+    KisConvolutionWorkerRecursiveGaussian(KisPainter *painter, KoUpdater *progress)
+        : m_painter(painter),
+          m_progress(progress),
+          m_numChannels(0),
+          m_cacheData(0),
+          m_cacheWidth(0),
+          m_cacheHeight(0),
+          m_alphaCachePos(-1),
+          m_alphaRealPos(-1)
+    {
+    }
+
+    static int marginFromSigma(qreal sigma) {
+        return sigma > 0.0 ? qCeil(4.0 * sigma) : 0;
+    }
+
+    void execute(const KisPaintDeviceSP src,
+                 QPoint srcPos, QPoint dstPos, QSize areaSize,
+                 qreal xSigma, qreal ySigma,
+                 const QRect &dataRect)
+    {
+        // Make the area we cover as small as possible
+        if (m_painter->selection()) {
+            QRect r = m_painter->selection()->selectedRect().intersected(QRect(srcPos, areaSize));
+            dstPos += r.topLeft() - srcPos;
+            srcPos = r.topLeft();
+            areaSize = r.size();
+        }
+
+        if (areaSize.isEmpty()) return;
+
+        initChannels(src);
+        if (!m_numChannels) return;
+
+        const int xMargin = marginFromSigma(xSigma);
+        const int yMargin = marginFromSigma(ySigma);
+
+        const QRect cacheRect(srcPos.x() - xMargin, srcPos.y() - yMargin,
+                              areaSize.width() + 2 * xMargin,
+                              areaSize.height() + 2 * yMargin);
+
+        m_cacheWidth = cacheRect.width();
+        m_cacheHeight = cacheRect.height();
+        m_cache.resize(m_cacheWidth * m_cacheHeight * m_numChannels);
+        m_cacheData = m_cache.data();
+
+        setProgress(0);
+
+        QVector<Chunk> rowChunks = splitIntoChunks(m_cacheHeight, rowsPerChunk);
+
+        QtConcurrent::blockingMap(rowChunks,
+            [this, src, cacheRect, dataRect] (const Chunk &chunk) {
+                readRows(src, cacheRect, dataRect, chunk);
+            });
+
+        setProgress(25);
+        if (isInterrupted()) return;
+
+        if (xSigma > 0.0) {
+            const Coefficients c = calculateCoefficients(xSigma);
+
+            QtConcurrent::blockingMap(rowChunks,
+                [this, c] (const Chunk &chunk) {
+                    for (int y = chunk.start; y < chunk.start + chunk.size; y++) {
+                        filterRow(y, c);
+                    }
+                });
+        }
+
+        setProgress(50);
+        if (isInterrupted()) return;
+
+        if (ySigma > 0.0) {
+            const Coefficients c = calculateCoefficients(ySigma);
+
+            QVector<Chunk> columnChunks = splitIntoChunks(m_cacheWidth, columnsPerChunk);
+
+            QtConcurrent::blockingMap(columnChunks,
+                [this, c] (const Chunk &chunk) {
+                    filterColumns(chunk, c);
+                });
+        }
+
+        setProgress(75);
+        if (isInterrupted()) return;
+
+        const QRect dstRect(dstPos, areaSize);
+        const QPoint cacheOffset(xMargin, yMargin);
+        QVector<Chunk> dstRowChunks = splitIntoChunks(areaSize.height(), rowsPerChunk);
+
+        QtConcurrent::blockingMap(dstRowChunks,
+            [this, dstRect, cacheOffset, dataRect] (const Chunk &chunk) {
+                writeRows(dstRect, cacheOffset, dataRect, chunk);
+            });
+
+        m_cache.clear();
+        setProgress(100);
+    }
+
+private:
+    static const int rowsPerChunk = 64;
+    static const int columnsPerChunk = 64;
+
+    struct Chunk {
+        int start;
+        int size;
+    };
+
+    /**
+     * The coefficients of the filter in the form
+     * w[n] = b * x[n] + a1 * w[n-1] + a2 * w[n-2] + a3 * w[n-3],
+     * where b = 1 - a1 - a2 - a3, so a constant signal stays unchanged
+     */
+    struct Coefficients {
+        float b;
+        float a1;
+        float a2;
+        float a3;
+    };
+
+    static Coefficients calculateCoefficients(qreal sigma) {
+        // the approximation is valid for sigma >= 0.5 only
+        sigma = qMax(sigma, qreal(0.5));
+
+        const qreal q = sigma >= 2.5 ?
+            0.98711 * sigma - 0.96330 :
+            3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+
+        const qreal q2 = q * q;
+        const qreal q3 = q2 * q;
+
+        const qreal b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+        const qreal b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+        const qreal b2 = -(1.4281 * q2 + 1.26661 * q3);
+        const qreal b3 = 0.422205 * q3;
+
+        Coefficients c;
+        c.a1 = b1 / b0;
+        c.a2 = b2 / b0;
+        c.a3 = b3 / b0;
+        c.b = 1.0 - (b1 + b2 + b3) / b0;
+
+        return c;
+    }
+
+    static QVector<Chunk> splitIntoChunks(int size, int chunkSize) {
+        QVector<Chunk> chunks;
+
+        for (int start = 0; start < size; start += chunkSize) {
+            Chunk chunk;
+            chunk.start = start;
+            chunk.size = qMin(chunkSize, size - start);
+            chunks.append(chunk);
+        }
+
+        return chunks;
+    }
+
+    void initChannels(const KisPaintDeviceSP src) {
+        QBitArray channelFlags = m_painter->channelFlags();
+        if (channelFlags.isEmpty()) {
+            channelFlags = QBitArray(src->colorSpace()->channelCount(), true);
+        }
+
+        const QList<KoChannelInfo*> channels = src->colorSpace()->channels();
+
+        m_convChannelList.clear();
+        for (int i = 0; i < channels.size(); i++) {
+            if (channelFlags.testBit(i)) {
+                m_convChannelList.append(channels[i]);
+            }
+        }
+
+        m_numChannels = m_convChannelList.size();
+
+        KisMathToolbox mathToolbox;
+
+        m_minClamp.resize(m_numChannels);
+        m_maxClamp.resize(m_numChannels);
+        m_toDoubleFuncPtr.resize(m_numChannels);
+        m_fromDoubleFuncPtr.resize(m_numChannels);
+
+        for (int i = 0; i < m_numChannels; i++) {
+            m_minClamp[i] = mathToolbox.minChannelValue(m_convChannelList[i]);
+            m_maxClamp[i] = mathToolbox.maxChannelValue(m_convChannelList[i]);
+
+            if (m_convChannelList[i]->channelType() == KoChannelInfo::ALPHA) {
+                m_alphaCachePos = i;
+                m_alphaRealPos = m_convChannelList[i]->pos();
+            }
+        }
+
+        bool result = mathToolbox.getToDoubleChannelPtr(m_convChannelList, m_toDoubleFuncPtr);
+        result &= mathToolbox.getFromDoubleChannelPtr(m_convChannelList, m_fromDoubleFuncPtr);
+
+        KIS_ASSERT(result);
+    }
+
+    inline float* cacheRow(int y) {
+        return m_cacheData + y * m_cacheWidth * m_numChannels;
+    }
+
+    void readRows(const KisPaintDeviceSP src, const QRect &cacheRect, const QRect &dataRect, const Chunk &chunk) {
+        typename _IteratorFactory_::HLineConstIterator hitSrc =
+            _IteratorFactory_::createHLineConstIterator(src,
+                                                        cacheRect.x(), cacheRect.y() + chunk.start,
+                                                        cacheRect.width(),
+                                                        dataRect);
+
+        for (int y = chunk.start; y < chunk.start + chunk.size; y++) {
+            float *dstPtr = cacheRow(y);
+
+            for (int x = 0; x < m_cacheWidth; x++) {
+                const quint8 *data = hitSrc->oldRawData();
+
+                // the color channels are blurred premultiplied by alpha
+                const qreal alphaValue = m_alphaRealPos >= 0 ?
+                    m_toDoubleFuncPtr[m_alphaCachePos](data, m_alphaRealPos) : 1.0;
+
+                for (int k = 0; k < m_numChannels; k++) {
+                    dstPtr[k] = k != m_alphaCachePos ?
+                        m_toDoubleFuncPtr[k](data, m_convChannelList[k]->pos()) * alphaValue :
+                        alphaValue;
+                }
+
+                dstPtr += m_numChannels;
+                hitSrc->nextPixel();
+            }
+
+            hitSrc->nextRow();
+        }
+    }
+
+    /**
+     * Runs the causal and anticausal passes along the row \p y. The
+     * values outside the row are taken equal to the edge ones, which is
+     * the steady state of the filter, so the indices are just clamped.
+     */
+    void filterRow(int y, const Coefficients &c) {
+        float *row = cacheRow(y);
+        const int n = m_numChannels;
+        const int lastX = m_cacheWidth - 1;
+
+        for (int x = 0; x <= lastX; x++) {
+            float *p = row + x * n;
+            const float *p1 = row + qMax(x - 1, 0) * n;
+            const float *p2 = row + qMax(x - 2, 0) * n;
+            const float *p3 = row + qMax(x - 3, 0) * n;
+
+            for (int k = 0; k < n; k++) {
+                p[k] = c.b * p[k] + c.a1 * p1[k] + c.a2 * p2[k] + c.a3 * p3[k];
+            }
+        }
+
+        for (int x = lastX; x >= 0; x--) {
+            float *p = row + x * n;
+            const float *p1 = row + qMin(x + 1, lastX) * n;
+            const float *p2 = row + qMin(x + 2, lastX) * n;
+            const float *p3 = row + qMin(x + 3, lastX) * n;
+
+            for (int k = 0; k < n; k++) {
+                p[k] = c.b * p[k] + c.a1 * p1[k] + c.a2 * p2[k] + c.a3 * p3[k];
+            }
+        }
+    }
+
+    /**
+     * Same as filterRow(), but for all the columns of the chunk at once,
+     * so the inner loop runs over a contiguous span of the row
+     */
+    void filterColumns(const Chunk &chunk, const Coefficients &c) {
+        const int offset = chunk.start * m_numChannels;
+        const int length = chunk.size * m_numChannels;
+        const int lastY = m_cacheHeight - 1;
+
+        for (int y = 0; y <= lastY; y++) {
+            float *p = cacheRow(y) + offset;
+            const float *p1 = cacheRow(qMax(y - 1, 0)) + offset;
+            const float *p2 = cacheRow(qMax(y - 2, 0)) + offset;
+            const float *p3 = cacheRow(qMax(y - 3, 0)) + offset;
+
+            for (int i = 0; i < length; i++) {
+                p[i] = c.b * p[i] + c.a1 * p1[i] + c.a2 * p2[i] + c.a3 * p3[i];
+            }
+        }
+
+        for (int y = lastY; y >= 0; y--) {
+            float *p = cacheRow(y) + offset;
+            const float *p1 = cacheRow(qMin(y + 1, lastY)) + offset;
+            const float *p2 = cacheRow(qMin(y + 2, lastY)) + offset;
+            const float *p3 = cacheRow(qMin(y + 3, lastY)) + offset;
+
+            for (int i = 0; i < length; i++) {
+                p[i] = c.b * p[i] + c.a1 * p1[i] + c.a2 * p2[i] + c.a3 * p3[i];
+            }
+        }
+    }
+
+    inline qreal writeChannel(quint8 *dstPtr, int k, qreal value) {
+        // the comparisons are written so that NaN is clamped to the lower bound
+        if (value > m_maxClamp[k]) {
+            value = m_maxClamp[k];
+        } else if (!(value >= m_minClamp[k])) {
+            value = m_minClamp[k];
+        }
+
+        m_fromDoubleFuncPtr[k](dstPtr, m_convChannelList[k]->pos(), value);
+        return value;
+    }
+
+    void writeRows(const QRect &dstRect, const QPoint &cacheOffset, const QRect &dataRect, const Chunk &chunk) {
+        typename _IteratorFactory_::HLineIterator hitDst =
+            _IteratorFactory_::createHLineIterator(m_painter->device(),
+                                                   dstRect.x(), dstRect.y() + chunk.start,
+                                                   dstRect.width(),
+                                                   dataRect);
+
+        for (int y = chunk.start; y < chunk.start + chunk.size; y++) {
+            const float *srcPtr = cacheRow(y + cacheOffset.y()) + cacheOffset.x() * m_numChannels;
+
+            for (int x = 0; x < dstRect.width(); x++) {
+                quint8 *dstPtr = hitDst->rawData();
+
+                if (m_alphaCachePos >= 0) {
+                    const qreal alphaValue = writeChannel(dstPtr, m_alphaCachePos, srcPtr[m_alphaCachePos]);
+
+                    if (alphaValue > std::numeric_limits<qreal>::epsilon()) {
+                        const qreal alphaValueInv = 1.0 / alphaValue;
+
+                        for (int k = 0; k < m_numChannels; k++) {
+                            if (k != m_alphaCachePos) {
+                                writeChannel(dstPtr, k, srcPtr[k] * alphaValueInv);
+                            }
+                        }
+                    } else {
+                        for (int k = 0; k < m_numChannels; k++) {
+                            if (k != m_alphaCachePos) {
+                                m_fromDoubleFuncPtr[k](dstPtr, m_convChannelList[k]->pos(), 0.0);
+                            }
+                        }
+                    }
+                } else {
+                    for (int k = 0; k < m_numChannels; k++) {
+                        writeChannel(dstPtr, k, srcPtr[k]);
+                    }
+                }
+
+                srcPtr += m_numChannels;
+                hitDst->nextPixel();
+            }
+
+            hitDst->nextRow();
+        }
+    }
+
+    void setProgress(int progress) {
+        if (m_progress) {
+            m_progress->setProgress(progress);
+        }
+    }
+
+    bool isInterrupted() {
+        if (m_progress && m_progress->interrupted()) {
+            m_cache.clear();
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    KisPainter *m_painter;
+    KoUpdater *m_progress;
+
+    QList<KoChannelInfo*> m_convChannelList;
+    int m_numChannels;
+
+    QVector<qreal> m_minClamp;
+    QVector<qreal> m_maxClamp;
+    QVector<PtrToDouble> m_toDoubleFuncPtr;
+    QVector<PtrFromDouble> m_fromDoubleFuncPtr;
+
+    QVector<float> m_cache;
+    float *m_cacheData;
+    int m_cacheWidth;
+    int m_cacheHeight;
+
+    int m_alphaCachePos;
+    int m_alphaRealPos;
+};
+
+#endif // KIS_CONVOLUTION_WORKER_RECURSIVE_GAUSSIAN_H
@@ -125,8 +125,8 @@ public:
         return ACTUAL_DATAMGR::write(writer);
     }
 
-    inline bool read(QIODevice *io) {
-        return ACTUAL_DATAMGR::read(io);
+    inline bool read(QIODevice *io, bool lazyDecoding = false) {
+        return ACTUAL_DATAMGR::read(io, lazyDecoding);
     }
 
     inline void purge(const QRect& area) {
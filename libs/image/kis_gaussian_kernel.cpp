@@ -24,6 +24,11 @@
 #include <kis_transaction.h>
 #include <QRect>
 
+/**
+ * Starting from this radius KisGaussianKernel::applyGaussian() switches
+ * to the recursive implementation (sigma = 3.0, kernel size = 19)
+ */
+static const qreal minRecursiveGaussianRadius = 9.0;
 
 qreal KisGaussianKernel::sigmaFromRadius(qreal radius)
 {
@@ -121,8 +126,23 @@ void KisGaussianKernel::applyGaussian(KisPaintDeviceSP device,
 {
     QPoint srcTopLeft = rect.topLeft();
 
+    /**
+     * Large kernels are applied with a recursive filter, which cost
+     * doesn't depend on the radius. For small ones the direct
+     * convolution is still faster and more precise.
+     */
+    if (qMax(xRadius, yRadius) >= minRecursiveGaussianRadius) {
+        // the source is cached before writing, so no transaction is needed
+        KisConvolutionPainter painter(device);
+        painter.setChannelFlags(channelFlags);
+        painter.setProgress(progressUpdater);
+
+        painter.applyGaussian(device, srcTopLeft, srcTopLeft, rect.size(),
+                              xRadius > 0.0 ? sigmaFromRadius(xRadius) : 0.0,
+                              yRadius > 0.0 ? sigmaFromRadius(yRadius) : 0.0,
+                              borderOp);
 
-    if (KisConvolutionPainter::supportsFFTW()) {
+    } else if (KisConvolutionPainter::supportsFFTW()) {
         KisConvolutionPainter painter(device, KisConvolutionPainter::FFTW);
         painter.setChannelFlags(channelFlags);
         painter.setProgress(progressUpdater);
@@ -23,12 +23,14 @@
 #include <algorithm>
 
 #include <QImage>
+#include <QtConcurrent>
 
 #include "kis_algebra_2d.h"
 #include "kis_four_point_interpolator_forward.h"
 #include "kis_four_point_interpolator_backward.h"
 #include "kis_iterator_ng.h"
 #include "kis_random_sub_accessor.h"
+#include "krita_utils.h"
 
 //#define DEBUG_PAINTING_POLYGONS
 
@@ -179,12 +181,23 @@ struct PaintDevicePolygonOp
     PaintDevicePolygonOp(KisPaintDeviceSP srcDev, KisPaintDeviceSP dstDev)
         : m_srcDev(srcDev), m_dstDev(dstDev) {}
 
+    /**
+     * Limits the area the op writes to. Used when the polygons are
+     * painted in parallel, patch by patch.
+     */
+    void setDstClipRect(const QRect &rc) {
+        m_dstClipRect = rc;
+    }
+
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon) {
         this->operator() (srcPolygon, dstPolygon, dstPolygon);
     }
 
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
         QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        if (!m_dstClipRect.isEmpty()) {
+            boundRect &= m_dstClipRect;
+        }
         if (boundRect.isEmpty()) return;
 
         KisSequentialIterator dstIt(m_dstDev, boundRect);
@@ -227,6 +240,7 @@ struct PaintDevicePolygonOp
 
     KisPaintDeviceSP m_srcDev;
     KisPaintDeviceSP m_dstDev;
+    QRect m_dstClipRect;
 };
 
 struct QImagePolygonOp
@@ -336,13 +350,11 @@ inline int pointToIndex(const QPoint &cellPt, const QSize &gridSize)
 namespace Private {
     inline QPoint pointPolygonIndexToColRow(QPoint baseColRow, int index)
     {
-        static QVector<QPoint> pointOffsets;
-        if (pointOffsets.isEmpty()) {
-            pointOffsets << QPoint(0,0);
-            pointOffsets << QPoint(1,0);
-            pointOffsets << QPoint(1,1);
-            pointOffsets << QPoint(0,1);
-        }
+        // the cells may be processed by several threads at once, so
+        // the table must not be initialized lazily
+        static const QPoint pointOffsets[] = {
+            QPoint(0,0), QPoint(1,0), QPoint(1,1), QPoint(0,1)
+        };
 
         return baseColRow + pointOffsets[index];
     }
@@ -551,6 +563,44 @@ inline void adjustAlignedPolygon(QPolygonF &polygon)
     polygon[3] += p3;
 }
 
+template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
+          class PolygonOp,
+          class IndexesOp>
+void processGridCell(int col, int row,
+                     PolygonOp &polygonOp,
+                     IndexesOp &indexesOp,
+                     const QVector<QPointF> &originalPoints,
+                     const QVector<QPointF> &transformedPoints)
+{
+    int numExistingPoints = 0;
+
+    QVector<int> polygonPoints = indexesOp.calculateMappedIndexes(col, row, &numExistingPoints);
+
+    if (!IncompletePolygonPolicy<PolygonOp, IndexesOp>::
+         tryProcessPolygon(col, row,
+                           numExistingPoints,
+                           polygonOp,
+                           indexesOp,
+                           polygonPoints,
+                           originalPoints,
+                           transformedPoints)) {
+
+        QPolygonF srcPolygon;
+        QPolygonF dstPolygon;
+
+        for (int i = 0; i < 4; i++) {
+            const int index = polygonPoints[i];
+            srcPolygon << originalPoints[index];
+            dstPolygon << transformedPoints[index];
+        }
+
+        adjustAlignedPolygon(srcPolygon);
+        adjustAlignedPolygon(dstPolygon);
+
+        polygonOp(srcPolygon, dstPolygon);
+    }
+}
+
 template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
           class PolygonOp,
           class IndexesOp>
@@ -560,39 +610,306 @@ void iterateThroughGrid(PolygonOp &polygonOp,
                         const QVector<QPointF> &originalPoints,
                         const QVector<QPointF> &transformedPoints)
 {
-    QVector<int> polygonPoints(4);
-
     for (int row = 0; row < gridSize.height() - 1; row++) {
         for (int col = 0; col < gridSize.width() - 1; col++) {
-            int numExistingPoints = 0;
-
-            polygonPoints = indexesOp.calculateMappedIndexes(col, row, &numExistingPoints);
-
-            if (!IncompletePolygonPolicy<PolygonOp, IndexesOp>::
-                 tryProcessPolygon(col, row,
-                                   numExistingPoints,
-                                   polygonOp,
-                                   indexesOp,
-                                   polygonPoints,
-                                   originalPoints,
-                                   transformedPoints)) {
-
-                QPolygonF srcPolygon;
-                QPolygonF dstPolygon;
-
-                for (int i = 0; i < 4; i++) {
-                    const int index = polygonPoints[i];
-                    srcPolygon << originalPoints[index];
-                    dstPolygon << transformedPoints[index];
-                }
+            processGridCell<IncompletePolygonPolicy>(col, row,
+                                                     polygonOp, indexesOp,
+                                                     originalPoints,
+                                                     transformedPoints);
+        }
+    }
+}
+
+/*************************************************************/
+/*      Parallel processing of the grid                      */
+/*************************************************************/
+
+/**
+ * A polygon op that paints nothing, but only records the rect
+ * PaintDevicePolygonOp would write into
+ */
+struct PolygonBoundsOp
+{
+    void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon) {
+        this->operator() (srcPolygon, dstPolygon, dstPolygon);
+    }
+
+    void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
+        Q_UNUSED(srcPolygon);
+        Q_UNUSED(dstPolygon);
+
+        bounds = clipDstPolygon.boundingRect().toAlignedRect();
+    }
+
+    QRect bounds;
+};
+
+/**
+ * Processes \p numCells cells of a grid in parallel with the result
+ * being exactly the same as if they were processed sequentially.
+ *
+ * The destination area is split into tile-aligned patches and every
+ * patch is painted by a separate job. The job replays, in the original
+ * order, all the cells overlapping its patch with a copy of \p polygonOp
+ * clipped to the patch. That is, a cell lying on the border of the
+ * patches is painted by all the jobs it overlaps, each of them writing
+ * only its own part of the cell. Overlapping (folded) cells are painted
+ * in the original order, and no two jobs ever write into the same tile.
+ *
+ * \p cellOp is called as cellOp(cellIndex, op), where op is either a
+ * PolygonBoundsOp or a clipped copy of \p polygonOp, and must be safe
+ * to call from several threads at once.
+ */
+template <class PolygonOp, class CellOp>
+void processCellsInPatches(const PolygonOp &polygonOp, const CellOp &cellOp, int numCells)
+{
+    using KisAlgebra2D::divideFloor;
+
+    if (numCells <= 0) return;
+
+    const int cellsPerJob = 4096;
+
+    QVector<int> jobStarts;
+    for (int i = 0; i < numCells; i += cellsPerJob) {
+        jobStarts << i;
+    }
+
+    QVector<QRect> cellBounds(numCells);
+    QRect *cellBoundsPtr = cellBounds.data();
+
+    QtConcurrent::blockingMap(jobStarts,
+        [cellBoundsPtr, numCells, cellsPerJob, &cellOp] (int start) {
+            const int end = qMin(start + cellsPerJob, numCells);
+
+            for (int i = start; i < end; i++) {
+                PolygonBoundsOp boundsOp;
+                cellOp(i, boundsOp);
+                cellBoundsPtr[i] = boundsOp.bounds;
+            }
+        });
+
+    QRect totalBounds;
+    for (int i = 0; i < numCells; i++) {
+        totalBounds |= cellBounds[i];
+    }
+    if (totalBounds.isEmpty()) return;
+
+    struct Patch {
+        QRect rect;
+        QVector<int> cells;
+    };
+
+    const QSize patchSize = KritaUtils::optimalPatchSize();
+    const int firstPatchCol = divideFloor(totalBounds.left(), patchSize.width());
+    const int firstPatchRow = divideFloor(totalBounds.top(), patchSize.height());
+    const int numPatchCols = divideFloor(totalBounds.right(), patchSize.width()) - firstPatchCol + 1;
+    const int numPatchRows = divideFloor(totalBounds.bottom(), patchSize.height()) - firstPatchRow + 1;
+
+    QVector<Patch> patches(numPatchCols * numPatchRows);
+
+    for (int row = 0; row < numPatchRows; row++) {
+        for (int col = 0; col < numPatchCols; col++) {
+            patches[row * numPatchCols + col].rect =
+                QRect(QPoint((firstPatchCol + col) * patchSize.width(),
+                             (firstPatchRow + row) * patchSize.height()),
+                      patchSize);
+        }
+    }
+
+    for (int i = 0; i < numCells; i++) {
+        const QRect &rc = cellBounds[i];
+        if (rc.isEmpty()) continue;
+
+        const int left = divideFloor(rc.left(), patchSize.width()) - firstPatchCol;
+        const int top = divideFloor(rc.top(), patchSize.height()) - firstPatchRow;
+        const int right = divideFloor(rc.right(), patchSize.width()) - firstPatchCol;
+        const int bottom = divideFloor(rc.bottom(), patchSize.height()) - firstPatchRow;
+
+        for (int row = top; row <= bottom; row++) {
+            for (int col = left; col <= right; col++) {
+                patches[row * numPatchCols + col].cells.append(i);
+            }
+        }
+    }
 
-                adjustAlignedPolygon(srcPolygon);
-                adjustAlignedPolygon(dstPolygon);
+    QtConcurrent::blockingMap(patches,
+        [&polygonOp, &cellOp] (const Patch &patch) {
+            if (patch.cells.isEmpty()) return;
 
-                polygonOp(srcPolygon, dstPolygon);
+            PolygonOp clippedOp(polygonOp);
+            clippedOp.setDstClipRect(patch.rect);
+
+            Q_FOREACH (int cell, patch.cells) {
+                cellOp(cell, clippedOp);
             }
+        });
+}
+
+namespace Private {
+
+    template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
+              class IndexesOp>
+    struct GridCellOp
+    {
+        GridCellOp(IndexesOp &_indexesOp,
+                   const QSize &_gridSize,
+                   const QVector<QPointF> &_originalPoints,
+                   const QVector<QPointF> &_transformedPoints)
+            : indexesOp(_indexesOp),
+              gridSize(_gridSize),
+              originalPoints(_originalPoints),
+              transformedPoints(_transformedPoints)
+        {
         }
+
+        template <class PolygonOp>
+        void operator() (int cellIndex, PolygonOp &polygonOp) const {
+            const int numCellCols = gridSize.width() - 1;
+
+            processGridCell<IncompletePolygonPolicy>(cellIndex % numCellCols,
+                                                     cellIndex / numCellCols,
+                                                     polygonOp, indexesOp,
+                                                     originalPoints,
+                                                     transformedPoints);
+        }
+
+        IndexesOp &indexesOp;
+        const QSize &gridSize;
+        const QVector<QPointF> &originalPoints;
+        const QVector<QPointF> &transformedPoints;
+    };
+
+    struct ForwardGridCellOp
+    {
+        ForwardGridCellOp(const QVector<int> &_cols,
+                          const QVector<int> &_rows,
+                          const QVector<QPointF> &_dstPoints)
+            : cols(_cols),
+              rows(_rows),
+              dstPoints(_dstPoints)
+        {
+        }
+
+        template <class PolygonOp>
+        void operator() (int cellIndex, PolygonOp &polygonOp) const {
+            const int numCols = cols.size();
+            const int colIndex = cellIndex % (numCols - 1) + 1;
+            const int rowIndex = cellIndex / (numCols - 1) + 1;
+
+            const int prevCol = cols.at(colIndex - 1);
+            const int col = cols.at(colIndex);
+            const int prevRow = rows.at(rowIndex - 1);
+            const int row = rows.at(rowIndex);
+
+            // the same polygons as CellOp generates
+            QPolygonF srcPolygon;
+
+            srcPolygon << QPointF(prevCol, prevRow);
+            srcPolygon << QPointF(col, prevRow);
+            srcPolygon << QPointF(col, row);
+            srcPolygon << QPointF(prevCol, row);
+
+            const int prevLine = (rowIndex - 1) * numCols;
+            const int currLine = rowIndex * numCols;
+
+            QPolygonF dstPolygon;
+
+            dstPolygon << dstPoints.at(prevLine + colIndex - 1);
+            dstPolygon << dstPoints.at(prevLine + colIndex);
+            dstPolygon << dstPoints.at(currLine + colIndex);
+            dstPolygon << dstPoints.at(currLine + colIndex - 1);
+
+            polygonOp(srcPolygon, dstPolygon);
+        }
+
+        const QVector<int> &cols;
+        const QVector<int> &rows;
+        const QVector<QPointF> &dstPoints;
+    };
+
+    /**
+     * Returns the positions of the grid lines processGrid() visits
+     * while iterating from \p start to \p end
+     */
+    inline QVector<int> calcGridLines(int start, int end, const int pixelPrecision)
+    {
+        const int alignmentMask = ~(pixelPrecision - 1);
+
+        QVector<int> lines;
+
+        for (int pos = start; pos <= end;) {
+            lines << pos;
+            pos += pixelPrecision;
+
+            if (pos > end && pos <= end + pixelPrecision - 1) {
+                pos = end;
+            } else {
+                pos &= alignmentMask;
+            }
+        }
+
+        return lines;
+    }
+}
+
+/**
+ * A parallel version of iterateThroughGrid(). See processCellsInPatches()
+ * for the requirements to the ops.
+ */
+template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
+          class PolygonOp,
+          class IndexesOp>
+void iterateThroughGridInPatches(const PolygonOp &polygonOp,
+                                 IndexesOp &indexesOp,
+                                 const QSize &gridSize,
+                                 const QVector<QPointF> &originalPoints,
+                                 const QVector<QPointF> &transformedPoints)
+{
+    if (gridSize.width() < 2 || gridSize.height() < 2) return;
+
+    Private::GridCellOp<IncompletePolygonPolicy, IndexesOp>
+        cellOp(indexesOp, gridSize, originalPoints, transformedPoints);
+
+    processCellsInPatches(polygonOp, cellOp,
+                          (gridSize.width() - 1) * (gridSize.height() - 1));
+}
+
+/**
+ * A parallel version of processGrid(). The grid points are transformed
+ * by several threads at once, so \p transformOp must be reentrant.
+ */
+template <class PolygonOp, class ForwardTransform>
+void processGridInPatches(const PolygonOp &polygonOp, const ForwardTransform &transformOp,
+                          const QRect &srcBounds, const int pixelPrecision)
+{
+    if (srcBounds.isEmpty()) return;
+
+    const QVector<int> cols = Private::calcGridLines(srcBounds.left(), srcBounds.right(), pixelPrecision);
+    const QVector<int> rows = Private::calcGridLines(srcBounds.top(), srcBounds.bottom(), pixelPrecision);
+
+    if (cols.size() < 2 || rows.size() < 2) return;
+
+    QVector<QPointF> dstPoints(cols.size() * rows.size());
+    QPointF *dstPointsPtr = dstPoints.data();
+
+    QVector<int> rowIndexes;
+    for (int i = 0; i < rows.size(); i++) {
+        rowIndexes << i;
     }
+
+    QtConcurrent::blockingMap(rowIndexes,
+        [dstPointsPtr, &cols, &rows, &transformOp] (int rowIndex) {
+            QPointF *dstLine = dstPointsPtr + rowIndex * cols.size();
+            const int row = rows.at(rowIndex);
+
+            for (int i = 0; i < cols.size(); i++) {
+                dstLine[i] = transformOp(QPointF(cols.at(i), row));
+            }
+        });
+
+    Private::ForwardGridCellOp cellOp(cols, rows, dstPoints);
+    processCellsInPatches(polygonOp, cellOp,
+                          (cols.size() - 1) * (rows.size() - 1));
 }
 
 }
@@ -174,6 +174,28 @@ void KisImageConfig::setSwapWindowSize(int value)
     m_config.writeEntry("swapWindowSize", value);
 }
 
+QString KisImageConfig::swapCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapCompression", "LZ4") : "LZ4";
+}
+
+void KisImageConfig::setSwapCompression(const QString &value)
+{
+    m_config.writeEntry("swapCompression", value);
+}
+
+QString KisImageConfig::tilesSaveCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("tilesSaveCompression", "LZF") : "LZF";
+}
+
+void KisImageConfig::setTilesSaveCompression(const QString &value)
+{
+    m_config.writeEntry("tilesSaveCompression", value);
+}
+
 int KisImageConfig::tilesHardLimit() const
 {
     qreal hp = qreal(memoryHardLimitPercent()) / 100.0;
@@ -230,6 +252,16 @@ void KisImageConfig::setMemoryPoolLimitPercent(qreal value)
     m_config.writeEntry("memoryPoolLimitPercent", value);
 }
 
+bool KisImageConfig::enableTileDeduplication(bool requestDefault) const
+{
+    return !requestDefault ? m_config.readEntry("enableTileDeduplication", true) : true;
+}
+
+void KisImageConfig::setEnableTileDeduplication(bool value)
+{
+    m_config.writeEntry("enableTileDeduplication", value);
+}
+
 QString KisImageConfig::safelyGetWritableTempLocation(const QString &suffix, const QString &configKey, bool requestDefault) const
 {
 #ifdef Q_OS_MACOS
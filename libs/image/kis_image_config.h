@@ -58,6 +58,20 @@ public:
     int swapWindowSize() const;
     void setSwapWindowSize(int value);
 
+    /**
+     * Codec used for compressing tiles in the swap file: "LZF", "LZ4"
+     * or "ZSTD". Unsupported codecs silently fall back to LZF.
+     */
+    QString swapCompression(bool requestDefault = false) const;
+    void setSwapCompression(const QString &value);
+
+    /**
+     * Codec used for compressing tiles saved into .kra files. Please
+     * note that older versions of Krita can read LZF tiles only.
+     */
+    QString tilesSaveCompression(bool requestDefault = false) const;
+    void setTilesSaveCompression(const QString &value);
+
     int tilesHardLimit() const; // MiB
     int tilesSoftLimit() const; // MiB
     int poolLimit() const; // MiB
@@ -69,6 +83,13 @@ public:
     void setMemorySoftLimitPercent(qreal value);
     void setMemoryPoolLimitPercent(qreal value);
 
+    /**
+     * Let the pooler thread merge the tile datas with identical
+     * content when the user is idle
+     */
+    bool enableTileDeduplication(bool requestDefault = false) const;
+    void setEnableTileDeduplication(bool value);
+
     static int totalRAM(); // MiB
 
     /**
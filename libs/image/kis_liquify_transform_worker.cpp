@@ -433,10 +433,10 @@ void KisLiquifyTransformWorker::run(KisPaintDeviceSP device)
 
     PaintDevicePolygonOp polygonOp(srcDev, device);
     Private::MapIndexesOp indexesOp(m_d.data());
-    iterateThroughGrid<AlwaysCompletePolygonPolicy>(polygonOp, indexesOp,
-                                                    m_d->gridSize,
-                                                    m_d->originalPoints,
-                                                    m_d->transformedPoints);
+    iterateThroughGridInPatches<AlwaysCompletePolygonPolicy>(polygonOp, indexesOp,
+                                                             m_d->gridSize,
+                                                             m_d->originalPoints,
+                                                             m_d->transformedPoints);
 }
 
 QRect KisLiquifyTransformWorker::approxChangeRect(const QRect &rc)
@@ -154,8 +154,13 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
     stats.realMemorySize = tileStats.realMemorySize;
     stats.historicalMemorySize = tileStats.historicalMemorySize;
     stats.poolSize = tileStats.poolSize;
+    stats.allocatorPoolSize = tileStats.allocatorPoolSize;
+    stats.deduplicatedSize = tileStats.deduplicatedSize;
 
     stats.swapSize = tileStats.swapSize;
+    stats.swapFileSize = tileStats.swapFileSize;
+    stats.swapCompactionSavedSize = tileStats.swapCompactionSavedSize;
+    stats.swapCompactionProgress = tileStats.swapCompactionProgress;
 
     KisImageConfig cfg(true);
 
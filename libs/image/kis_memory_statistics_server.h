@@ -43,8 +43,13 @@ public:
               realMemorySize(0),
               historicalMemorySize(0),
               poolSize(0),
+              allocatorPoolSize(0),
+              deduplicatedSize(0),
 
               swapSize(0),
+              swapFileSize(0),
+              swapCompactionSavedSize(0),
+              swapCompactionProgress(100),
 
               totalMemoryLimit(0),
               tilesHardLimit(0),
@@ -62,8 +67,13 @@ public:
         qint64 realMemorySize;
         qint64 historicalMemorySize;
         qint64 poolSize;
+        qint64 allocatorPoolSize;
+        qint64 deduplicatedSize;
 
         qint64 swapSize;
+        qint64 swapFileSize;
+        qint64 swapCompactionSavedSize;
+        int swapCompactionProgress;
 
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
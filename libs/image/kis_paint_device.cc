@@ -370,18 +370,21 @@ public:
         return m_frames.keys();
     }
 
-    bool readFrame(QIODevice *stream, int frameId)
+    bool readFrame(QIODevice *stream, int frameId, bool lazyDecoding)
     {
         bool retval = false;
-        DataSP data = m_frames[frameId];
-        retval = data->dataManager()->read(stream);
+        // the frames may be read from several threads at once
+        DataSP data = m_frames.value(frameId);
+        KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(data, false);
+        retval = data->dataManager()->read(stream, lazyDecoding);
         data->cache()->invalidate();
         return retval;
     }
 
     bool writeFrame(KisPaintDeviceWriter &store, int frameId)
     {
-        DataSP data = m_frames[frameId];
+        // the frames may be written from several threads at once
+        DataSP data = m_frames.value(frameId);
         return data->dataManager()->write(store);
     }
 
@@ -632,12 +635,12 @@ struct KisPaintDevice::Private::StrategyPolicy {
 
     KisHLineConstIteratorSP createConstIterator(const QRect &rect)
     {
-        return m_strategy->createHLineConstIteratorNG(m_dataManager, rect.x(), rect.y(), rect.width(), m_offsetX, m_offsetY);
+        return m_strategy->createHLineConstIteratorNG(m_dataManager, rect.x(), rect.y(), rect.width(), rect.height(), m_offsetX, m_offsetY);
     }
 
     KisHLineIteratorSP createIterator(const QRect &rect)
     {
-        return m_strategy->createHLineIteratorNG(m_dataManager, rect.x(), rect.y(), rect.width(), m_offsetX, m_offsetY);
+        return m_strategy->createHLineIteratorNG(m_dataManager, rect.x(), rect.y(), rect.width(), rect.height(), m_offsetX, m_offsetY);
     }
 
     int pixelSize() const
@@ -1515,11 +1518,11 @@ bool KisPaintDevice::write(KisPaintDeviceWriter &store)
     return m_d->dataManager()->write(store);
 }
 
-bool KisPaintDevice::read(QIODevice *stream)
+bool KisPaintDevice::read(QIODevice *stream, bool lazyDecoding)
 {
     bool retval;
 
-    retval = m_d->dataManager()->read(stream);
+    retval = m_d->dataManager()->read(stream, lazyDecoding);
     m_d->cache()->invalidate();
 
     return retval;
@@ -1770,26 +1773,26 @@ QImage KisPaintDevice::createThumbnail(qint32 w, qint32 h, qreal oversample, KoC
     return m_d->cache()->createThumbnail(size.width(), size.height(), oversample, renderingIntent, conversionFlags);
 }
 
-KisHLineIteratorSP KisPaintDevice::createHLineIteratorNG(qint32 x, qint32 y, qint32 w)
+KisHLineIteratorSP KisPaintDevice::createHLineIteratorNG(qint32 x, qint32 y, qint32 w, qint32 h)
 {
     m_d->cache()->invalidate();
-    return m_d->currentStrategy()->createHLineIteratorNG(m_d->dataManager().data(), x, y, w, m_d->x(), m_d->y());
+    return m_d->currentStrategy()->createHLineIteratorNG(m_d->dataManager().data(), x, y, w, h, m_d->x(), m_d->y());
 }
 
-KisHLineConstIteratorSP KisPaintDevice::createHLineConstIteratorNG(qint32 x, qint32 y, qint32 w) const
+KisHLineConstIteratorSP KisPaintDevice::createHLineConstIteratorNG(qint32 x, qint32 y, qint32 w, qint32 h) const
 {
-    return m_d->currentStrategy()->createHLineConstIteratorNG(m_d->dataManager().data(), x, y, w, m_d->x(), m_d->y());
+    return m_d->currentStrategy()->createHLineConstIteratorNG(m_d->dataManager().data(), x, y, w, h, m_d->x(), m_d->y());
 }
 
-KisVLineIteratorSP KisPaintDevice::createVLineIteratorNG(qint32 x, qint32 y, qint32 w)
+KisVLineIteratorSP KisPaintDevice::createVLineIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w)
 {
     m_d->cache()->invalidate();
-    return m_d->currentStrategy()->createVLineIteratorNG(x, y, w);
+    return m_d->currentStrategy()->createVLineIteratorNG(x, y, h, w);
 }
 
-KisVLineConstIteratorSP KisPaintDevice::createVLineConstIteratorNG(qint32 x, qint32 y, qint32 w) const
+KisVLineConstIteratorSP KisPaintDevice::createVLineConstIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w) const
 {
-    return m_d->currentStrategy()->createVLineConstIteratorNG(x, y, w);
+    return m_d->currentStrategy()->createVLineConstIteratorNG(x, y, h, w);
 }
 
 KisRepeatHLineConstIteratorSP KisPaintDevice::createRepeatHLineConstIterator(qint32 x, qint32 y, qint32 w, const QRect& _dataWidth) const
@@ -1966,6 +1969,11 @@ void KisPaintDevice::writePlanarBytes(QVector<quint8*> planes, qint32 x, qint32
     m_d->currentStrategy()->writePlanarBytes(planes, x, y, w, h);
 }
 
+bool KisPaintDevice::isRectUniform(const QRect &rect, quint8 *pixel) const
+{
+    return m_d->currentStrategy()->isRectUniform(rect, pixel);
+}
+
 
 quint32 KisPaintDevice::pixelSize() const
 {
@@ -2182,12 +2190,12 @@ bool KisPaintDeviceFramesInterface::writeFrame(KisPaintDeviceWriter &store, int
     return q->m_d->writeFrame(store, frameId);
 }
 
-bool KisPaintDeviceFramesInterface::readFrame(QIODevice *stream, int frameId)
+bool KisPaintDeviceFramesInterface::readFrame(QIODevice *stream, int frameId, bool lazyDecoding)
 {
     KIS_ASSERT_RECOVER(frameId >= 0) {
         return false;
     }
-    return q->m_d->readFrame(stream, frameId);
+    return q->m_d->readFrame(stream, frameId, lazyDecoding);
 }
 
 int KisPaintDeviceFramesInterface::currentFrameId() const
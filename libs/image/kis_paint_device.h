@@ -132,8 +132,11 @@ public:
 
     /**
      * Fill this paint device with the pixels from the specified file store.
+     *
+     * If \p lazyDecoding is true, the tiles are kept compressed in memory
+     * and are decompressed only when accessed for the first time.
      */
-    bool read(QIODevice *stream);
+    bool read(QIODevice *stream, bool lazyDecoding = false);
 
 public:
 
@@ -481,6 +484,15 @@ public:
      */
     void writePlanarBytes(QVector<quint8*> planes, qint32 x, qint32 y, qint32 w, qint32 h);
 
+    /**
+     * Checks whether all the pixels inside \p rect have the same
+     * value and, if so, writes it into \p pixel. The check is
+     * based on the uniformity flags cached per tile, so it is
+     * cheap, but it may return false for a rect that is actually
+     * uniform, e.g. when the rect covers only a part of a tile.
+     */
+    bool isRectUniform(const QRect &rect, quint8 *pixel) const;
+
     /**
      * Converts the paint device to a different colorspace
      */
@@ -786,11 +798,18 @@ public:
 
 public:
 
-    KisHLineIteratorSP createHLineIteratorNG(qint32 x, qint32 y, qint32 w);
-    KisHLineConstIteratorSP createHLineConstIteratorNG(qint32 x, qint32 y, qint32 w) const;
+    /**
+     * The optional \p h of the horizontal iterators (and \p w of the
+     * vertical ones) is the size of the area the caller is going to
+     * walk through with nextRow() (nextColumn()). It doesn't limit
+     * the iteration, the iterator only uses it to decide which swapped
+     * tiles are worth loading in advance. Pass it when it is known.
+     */
+    KisHLineIteratorSP createHLineIteratorNG(qint32 x, qint32 y, qint32 w, qint32 h = 1);
+    KisHLineConstIteratorSP createHLineConstIteratorNG(qint32 x, qint32 y, qint32 w, qint32 h = 1) const;
 
-    KisVLineIteratorSP createVLineIteratorNG(qint32 x, qint32 y, qint32 h);
-    KisVLineConstIteratorSP createVLineConstIteratorNG(qint32 x, qint32 y, qint32 h) const;
+    KisVLineIteratorSP createVLineIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w = 1);
+    KisVLineConstIteratorSP createVLineConstIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w = 1) const;
 
     KisRandomAccessorSP createRandomAccessorNG();
     KisRandomConstAccessorSP createRandomConstAccessorNG() const;
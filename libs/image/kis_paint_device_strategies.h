@@ -88,22 +88,22 @@ public:
     }
 
 
-    virtual KisHLineIteratorSP createHLineIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY) {
-        return new KisHLineIterator2(dataManager, x, y, w, offsetX, offsetY, true, m_d->cacheInvalidator());
+    virtual KisHLineIteratorSP createHLineIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 h, qint32 offsetX, qint32 offsetY) {
+        return new KisHLineIterator2(dataManager, x, y, w, offsetX, offsetY, true, m_d->cacheInvalidator(), h);
     }
 
-    virtual KisHLineConstIteratorSP createHLineConstIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY) const {
-        return new KisHLineIterator2(dataManager, x, y, w, offsetX, offsetY, false, m_d->cacheInvalidator());
+    virtual KisHLineConstIteratorSP createHLineConstIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 h, qint32 offsetX, qint32 offsetY) const {
+        return new KisHLineIterator2(dataManager, x, y, w, offsetX, offsetY, false, m_d->cacheInvalidator(), h);
     }
 
 
-    virtual KisVLineIteratorSP createVLineIteratorNG(qint32 x, qint32 y, qint32 w) {
+    virtual KisVLineIteratorSP createVLineIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w) {
         m_d->cache()->invalidate();
-        return new KisVLineIterator2(m_d->dataManager().data(), x, y, w, m_d->x(), m_d->y(), true, m_d->cacheInvalidator());
+        return new KisVLineIterator2(m_d->dataManager().data(), x, y, h, m_d->x(), m_d->y(), true, m_d->cacheInvalidator(), w);
     }
 
-    virtual KisVLineConstIteratorSP createVLineConstIteratorNG(qint32 x, qint32 y, qint32 w) const {
-        return new KisVLineIterator2(m_d->dataManager().data(), x, y, w, m_d->x(), m_d->y(), false, m_d->cacheInvalidator());
+    virtual KisVLineConstIteratorSP createVLineConstIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w) const {
+        return new KisVLineIterator2(m_d->dataManager().data(), x, y, h, m_d->x(), m_d->y(), false, m_d->cacheInvalidator(), w);
     }
 
     virtual KisRandomAccessorSP createRandomAccessorNG() {
@@ -159,6 +159,10 @@ public:
         m_d->dataManager()->writePlanarBytes(planes, m_device->channelSizes(), x, y, w, h);
         m_d->cache()->invalidate();
     }
+
+    virtual bool isRectUniform(const QRect &rect, quint8 *pixel) const {
+        return m_d->dataManager()->isRectUniform(rect.translated(-m_d->x(), -m_d->y()), pixel);
+    }
 protected:
     virtual void readBytesImpl(quint8 *data, const QRect &rect, int dataRowStride) const {
         m_d->dataManager()->readBytes(data,
@@ -289,36 +293,36 @@ public:
         }
     }
 
-    KisHLineIteratorSP createHLineIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY) override {
+    KisHLineIteratorSP createHLineIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 h, qint32 offsetX, qint32 offsetY) override {
         KisWrappedRect splitRect(QRect(x, y, w, m_wrapRect.height()), m_wrapRect);
         if (!splitRect.isSplit()) {
-            return KisPaintDeviceStrategy::createHLineIteratorNG(dataManager, x, y, w, offsetX, offsetY);
+            return KisPaintDeviceStrategy::createHLineIteratorNG(dataManager, x, y, w, h, offsetX, offsetY);
         }
         return new KisWrappedHLineIterator(dataManager, splitRect, offsetX, offsetY, true, m_d->cacheInvalidator());
     }
 
-    KisHLineConstIteratorSP createHLineConstIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY) const override {
+    KisHLineConstIteratorSP createHLineConstIteratorNG(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 h, qint32 offsetX, qint32 offsetY) const override {
         KisWrappedRect splitRect(QRect(x, y, w, m_wrapRect.height()), m_wrapRect);
         if (!splitRect.isSplit()) {
-            return KisPaintDeviceStrategy::createHLineConstIteratorNG(dataManager, x, y, w, offsetX, offsetY);
+            return KisPaintDeviceStrategy::createHLineConstIteratorNG(dataManager, x, y, w, h, offsetX, offsetY);
         }
         return new KisWrappedHLineIterator(dataManager, splitRect, offsetX, offsetY, false, m_d->cacheInvalidator());
     }
 
-    KisVLineIteratorSP createVLineIteratorNG(qint32 x, qint32 y, qint32 h) override {
+    KisVLineIteratorSP createVLineIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w) override {
         m_d->cache()->invalidate();
 
         KisWrappedRect splitRect(QRect(x, y, m_wrapRect.width(), h), m_wrapRect);
         if (!splitRect.isSplit()) {
-            return KisPaintDeviceStrategy::createVLineIteratorNG(x, y, h);
+            return KisPaintDeviceStrategy::createVLineIteratorNG(x, y, h, w);
         }
         return new KisWrappedVLineIterator(m_d->dataManager().data(), splitRect, m_d->x(), m_d->y(), true, m_d->cacheInvalidator());
     }
 
-    KisVLineConstIteratorSP createVLineConstIteratorNG(qint32 x, qint32 y, qint32 h) const override {
+    KisVLineConstIteratorSP createVLineConstIteratorNG(qint32 x, qint32 y, qint32 h, qint32 w) const override {
         KisWrappedRect splitRect(QRect(x, y, m_wrapRect.width(), h), m_wrapRect);
         if (!splitRect.isSplit()) {
-            return KisPaintDeviceStrategy::createVLineConstIteratorNG(x, y, h);
+            return KisPaintDeviceStrategy::createVLineConstIteratorNG(x, y, h, w);
         }
         return new KisWrappedVLineIterator(m_d->dataManager().data(), splitRect, m_d->x(), m_d->y(), false, m_d->cacheInvalidator());
     }
@@ -357,6 +361,13 @@ public:
         fastBitBltOldData(src, rect);
     }
 
+    bool isRectUniform(const QRect &rect, quint8 *pixel) const override {
+        // the rect may be split, so just fall back to the generic path
+        Q_UNUSED(rect);
+        Q_UNUSED(pixel);
+        return false;
+    }
+
     void readBytes(quint8 *data, const QRect &rect) const override {
         KisWrappedRect splitRect(rect, m_wrapRect);
 
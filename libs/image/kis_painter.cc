@@ -492,6 +492,124 @@ inline bool KisPainter::Private::tryReduceSourceRect(const KisPaintDevice *srcDe
     return false;
 }
 
+namespace {
+
+bool isChunkUniform(const quint8 *data, qint32 rowStride,
+                    qint32 rows, qint32 columns, qint32 pixelSize)
+{
+    for (qint32 column = 1; column < columns; column++) {
+        if (memcmp(data, data + column * pixelSize, pixelSize)) return false;
+    }
+
+    const qint32 lineSize = columns * pixelSize;
+    for (qint32 row = 1; row < rows; row++) {
+        if (memcmp(data, data + row * rowStride, lineSize)) return false;
+    }
+
+    return true;
+}
+
+}
+
+/**
+ * Composes a chunk of the source device, when either the source or the
+ * destination (or both) contain only one color. The uniformity of the
+ * source and the mask is taken from the flags cached in the tiles. The
+ * destination tiles are kept locked for write by \p dstIt between the
+ * chunks, so their flags are not reliable and the chunk memory itself
+ * is checked instead.
+ *
+ * \return true if the chunk has been handled and the generic composition
+ *         should be skipped
+ */
+bool KisPainter::Private::tryComposeUniformChunk(const KisPaintDevice *srcDev,
+                                                 const QRect &srcChunk,
+                                                 KisRandomAccessorSP dstIt,
+                                                 const QPoint &dstPos,
+                                                 const KisPaintDevice *maskDev)
+{
+    quint8 srcPixel[MAX_PIXEL_SIZE];
+    if (!srcDev->isRectUniform(srcChunk, srcPixel)) return false;
+
+    quint8 maskValue = OPACITY_OPAQUE_U8;
+    const bool maskIsUniform =
+        !maskDev || maskDev->isRectUniform(QRect(dstPos, srcChunk.size()), &maskValue);
+
+    /**
+     * Painting transparent color with OVER or painting through a fully
+     * deselected area doesn't change anything in the destination
+     */
+    if (compositeOp->id() == COMPOSITE_OVER &&
+        (srcDev->colorSpace()->opacityF(srcPixel) == 0.0 ||
+         (maskIsUniform && maskValue == MIN_SELECTED))) {
+
+        return true;
+    }
+
+    if (!maskIsUniform) return false;
+
+    const qint32 rows = srcChunk.height();
+    const qint32 columns = srcChunk.width();
+    const qint32 pixelSize = colorSpace->pixelSize();
+
+    dstIt->moveTo(dstPos.x(), dstPos.y());
+    const qint32 dstRowStride = dstIt->rowStride(dstPos.x(), dstPos.y());
+    quint8 *dstData = dstIt->rawData();
+
+    KoCompositeOp::ParameterInfo localParamInfo = paramInfo;
+
+    if (compositeOp->id() != COMPOSITE_DISSOLVE &&
+        isChunkUniform(dstData, dstRowStride, rows, columns, pixelSize)) {
+
+        quint8 resultPixel[MAX_PIXEL_SIZE];
+        memcpy(resultPixel, dstData, pixelSize);
+
+        localParamInfo.dstRowStart   = resultPixel;
+        localParamInfo.dstRowStride  = pixelSize;
+        localParamInfo.srcRowStart   = srcPixel;
+        localParamInfo.srcRowStride  = srcDev->pixelSize();
+        localParamInfo.maskRowStart  = maskDev ? &maskValue : 0;
+        localParamInfo.maskRowStride = maskDev ? 1 : 0;
+        localParamInfo.rows          = 1;
+        localParamInfo.cols          = 1;
+        colorSpace->bitBlt(srcDev->colorSpace(), localParamInfo, compositeOp, renderingIntent, conversionFlags);
+
+        if (!memcmp(resultPixel, dstData, pixelSize)) return true;
+
+        for (qint32 column = 0; column < columns; column++) {
+            memcpy(dstData + column * pixelSize, resultPixel, pixelSize);
+        }
+
+        const qint32 lineSize = columns * pixelSize;
+        for (qint32 row = 1; row < rows; row++) {
+            memcpy(dstData + row * dstRowStride, dstData, lineSize);
+        }
+
+        return true;
+    }
+
+    /**
+     * A constant source can be passed to the composite op with a zero
+     * row stride, but only when no conversion is needed, because the
+     * conversion step expects a real row of pixels
+     */
+    if (!maskDev && *srcDev->colorSpace() == *colorSpace) {
+        localParamInfo.dstRowStart   = dstData;
+        localParamInfo.dstRowStride  = dstRowStride;
+        localParamInfo.srcRowStart   = srcPixel;
+        localParamInfo.srcRowStride  = 0;
+        localParamInfo.maskRowStart  = 0;
+        localParamInfo.maskRowStride = 0;
+        localParamInfo.rows          = rows;
+        localParamInfo.cols          = columns;
+        colorSpace->bitBlt(srcDev->colorSpace(), localParamInfo, compositeOp, renderingIntent, conversionFlags);
+
+        return true;
+    }
+
+    return false;
+}
+
 void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
                                           const KisPaintDeviceSP srcDev,
                                           const KisFixedPaintDeviceSP selection,
@@ -499,8 +617,6 @@ void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
                                           qint32 srcX, qint32 srcY,
                                           qint32 srcWidth, qint32 srcHeight)
 {
-    // TODO: get selX and selY working as intended
-
     /* This check for nonsense ought to be a Q_ASSERT. However, when paintops are just
     initializing they perform some dummy passes with those parameters, and it must not crash */
     if (srcWidth == 0 || srcHeight == 0) return;
@@ -522,11 +638,16 @@ void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
      * An optimization, which crops the source rect by the bounds of
      * the source device when it is possible
      */
+    const QPoint unreducedSrcPos(srcX, srcY);
     if (d->tryReduceSourceRect(srcDev, &srcRect,
                                &srcX, &srcY,
                                &srcWidth, &srcHeight,
                                &dstX, &dstY)) return;
 
+    // the selection should be shifted together with the source rect
+    selX += srcX - unreducedSrcPos.x();
+    selY += srcY - unreducedSrcPos.y();
+
     /* Create an intermediate byte array to hold information before it is written
     to the current paint device (d->device) */
     quint8* dstBytes = 0;
@@ -671,6 +792,14 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
     KisRandomConstAccessorSP srcIt = srcDev->createRandomConstAccessorNG();
     KisRandomAccessorSP dstIt = d->device->createRandomAccessorNG();
 
+    /**
+     * The uniformity flags describe the current state of the tiles,
+     * so they cannot be used when reading old data. Blitting a device
+     * onto itself is excluded as well, since the source tiles are
+     * being changed while we read them.
+     */
+    const bool useUniformChunks = !useOldSrcData && srcDev != d->device;
+
     /* Here be a huge block of verbose code that does roughly the same than
     the other bit blit operations. This one is longer than the rest in an effort to
     optimize speed and memory use */
@@ -701,25 +830,31 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 columns = qMin(columns, numContiguousSelColumns);
                 columns = qMin(columns, columnsRemaining);
 
-                qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
-                srcIt->moveTo(srcX_, srcY_);
-
-                qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
-                dstIt->moveTo(dstX_, dstY_);
-
-                qint32 maskRowStride = maskIt->rowStride(dstX_, dstY_);
-                maskIt->moveTo(dstX_, dstY_);
-
-                d->paramInfo.dstRowStart   = dstIt->rawData();
-                d->paramInfo.dstRowStride  = dstRowStride;
-                // if we don't use the oldRawData, we need to access the rawData of the source device.
-                d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
-                d->paramInfo.srcRowStride  = srcRowStride;
-                d->paramInfo.maskRowStart  = static_cast<KisRandomAccessor2*>(maskIt.data())->rawData();
-                d->paramInfo.maskRowStride = maskRowStride;
-                d->paramInfo.rows          = rows;
-                d->paramInfo.cols          = columns;
-                d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+                if (!useUniformChunks ||
+                    !d->tryComposeUniformChunk(srcDev, QRect(srcX_, srcY_, columns, rows),
+                                               dstIt, QPoint(dstX_, dstY_),
+                                               selectionProjection.data())) {
+
+                    qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
+                    srcIt->moveTo(srcX_, srcY_);
+
+                    qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
+                    dstIt->moveTo(dstX_, dstY_);
+
+                    qint32 maskRowStride = maskIt->rowStride(dstX_, dstY_);
+                    maskIt->moveTo(dstX_, dstY_);
+
+                    d->paramInfo.dstRowStart   = dstIt->rawData();
+                    d->paramInfo.dstRowStride  = dstRowStride;
+                    // if we don't use the oldRawData, we need to access the rawData of the source device.
+                    d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
+                    d->paramInfo.srcRowStride  = srcRowStride;
+                    d->paramInfo.maskRowStart  = static_cast<KisRandomAccessor2*>(maskIt.data())->rawData();
+                    d->paramInfo.maskRowStride = maskRowStride;
+                    d->paramInfo.rows          = rows;
+                    d->paramInfo.cols          = columns;
+                    d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+                }
 
                 srcX_ += columns;
                 dstX_ += columns;
@@ -752,22 +887,27 @@ void KisPainter::bitBltImpl(qint32 dstX, qint32 dstY,
                 qint32 columns = qMin(numContiguousDstColumns, numContiguousSrcColumns);
                 columns = qMin(columns, columnsRemaining);
 
-                qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
-                srcIt->moveTo(srcX_, srcY_);
-
-                qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
-                dstIt->moveTo(dstX_, dstY_);
-
-                d->paramInfo.dstRowStart   = dstIt->rawData();
-                d->paramInfo.dstRowStride  = dstRowStride;
-                // if we don't use the oldRawData, we need to access the rawData of the source device.
-                d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
-                d->paramInfo.srcRowStride  = srcRowStride;
-                d->paramInfo.maskRowStart  = 0;
-                d->paramInfo.maskRowStride = 0;
-                d->paramInfo.rows          = rows;
-                d->paramInfo.cols          = columns;
-                d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+                if (!useUniformChunks ||
+                    !d->tryComposeUniformChunk(srcDev, QRect(srcX_, srcY_, columns, rows),
+                                               dstIt, QPoint(dstX_, dstY_), 0)) {
+
+                    qint32 srcRowStride = srcIt->rowStride(srcX_, srcY_);
+                    srcIt->moveTo(srcX_, srcY_);
+
+                    qint32 dstRowStride = dstIt->rowStride(dstX_, dstY_);
+                    dstIt->moveTo(dstX_, dstY_);
+
+                    d->paramInfo.dstRowStart   = dstIt->rawData();
+                    d->paramInfo.dstRowStride  = dstRowStride;
+                    // if we don't use the oldRawData, we need to access the rawData of the source device.
+                    d->paramInfo.srcRowStart   = useOldSrcData ? srcIt->oldRawData() : static_cast<KisRandomAccessor2*>(srcIt.data())->rawData();
+                    d->paramInfo.srcRowStride  = srcRowStride;
+                    d->paramInfo.maskRowStart  = 0;
+                    d->paramInfo.maskRowStride = 0;
+                    d->paramInfo.rows          = rows;
+                    d->paramInfo.cols          = columns;
+                    d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+                }
 
                 srcX_ += columns;
                 dstX_ += columns;
@@ -85,6 +85,12 @@ struct Q_DECL_HIDDEN KisPainter::Private {
                              qint32 *dstX,
                              qint32 *dstY);
 
+    bool tryComposeUniformChunk(const KisPaintDevice *srcDev,
+                                const QRect &srcChunk,
+                                KisRandomAccessorSP dstIt,
+                                const QPoint &dstPos,
+                                const KisPaintDevice *maskDev);
+
     void fillPainterPathImpl(const QPainterPath& path, const QRect &requestedRect);
 
     void applyDevice(const QRect &applyRect,
@@ -119,9 +119,9 @@ const KoColorSpace *KisPixelSelection::compositionSourceColorSpace() const
                    QString());
 }
 
-bool KisPixelSelection::read(QIODevice *stream)
+bool KisPixelSelection::read(QIODevice *stream, bool lazyDecoding)
 {
-    bool retval = KisPaintDevice::read(stream);
+    bool retval = KisPaintDevice::read(stream, lazyDecoding);
     m_d->outlineCacheValid = false;
     m_d->invalidateThumbnailImage();
     return retval;
@@ -60,7 +60,7 @@ public:
 
     const KoColorSpace* compositionSourceColorSpace() const override;
 
-    bool read(QIODevice *stream);
+    bool read(QIODevice *stream, bool lazyDecoding = false);
 
     /**
      * Fill the specified rect with the specified selectedness.
@@ -22,12 +22,18 @@
 #include <klocalizedstring.h>
 
 #include <KoColorSpace.h>
-#include "kis_convolution_painter.h"
-#include "kis_convolution_kernel.h"
 #include "kis_pixel_selection.h"
+#include "kis_global.h"
+#include "KisEuclideanDistanceTransform.h"
+#include "kis_gaussian_kernel.h"
+
+#include <QVector>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define RINT(x) floor ((x) + 0.5)
 
 KisSelectionFilter::~KisSelectionFilter()
@@ -313,155 +319,57 @@ void KisBorderSelectionFilter::process(KisPixelSelectionSP pixelSelection, const
         return;
     }
 
-    qint32* max = new qint32[rect.width() + 2 * m_xRadius];
-    for (qint32 i = 0; i < (rect.width() + 2 * m_xRadius); i++)
-        max[i] = m_yRadius + 2;
-    max += m_xRadius;
+    const int width = rect.width();
+    const int height = rect.height();
 
-    for (qint32 i = 0; i < 3; i++)
-        buf[i] = new quint8[rect.width()];
+    QVector<quint8> data(width * height);
+    pixelSelection->readBytes(data.data(), rect);
 
-    transition = new quint8*[m_yRadius + 1];
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        transition[i] = new quint8[rect.width() + 2 * m_xRadius];
-        memset(transition[i], 0, rect.width() + 2 * m_xRadius);
-        transition[i] += m_xRadius;
-    }
-    quint8* out = new quint8[rect.width()];
-    density = new quint8*[2 * m_xRadius + 1];
-    density += m_xRadius;
-
-    for (qint32 x = 0; x < (m_xRadius + 1); x++) { // allocate density[][]
-        density[ x]  = new quint8[2 * m_yRadius + 1];
-        density[ x] += m_yRadius;
-        density[-x]  = density[x];
+    QVector<quint8> transitions(width * height);
+    quint8 *rows[3];
+
+    for (int y = 0; y < height; y++) {
+        rows[0] = data.data() + qMax(y - 1, 0) * width;
+        rows[1] = data.data() + y * width;
+        rows[2] = data.data() + qMin(y + 1, height - 1) * width;
+
+        computeTransition(transitions.data() + y * width, rows, width);
     }
-    for (qint32 x = 0; x < (m_xRadius + 1); x++) { // compute density[][]
-        double tmpx, tmpy, dist;
-        quint8 a;
 
-        tmpx = x > 0.0 ? x - 0.5 : 0.0;
+    QVector<quint8> out(width * height, 0);
 
-        for (qint32 y = 0; y < (m_yRadius + 1); y++) {
-            tmpy = y > 0.0 ? y - 0.5 : 0.0;
+    /**
+     * The density of the border decreases with the distance to the
+     * nearest transition pixel, so only that pixel matters
+     */
+    KisEuclideanDistanceTransform edt(width, height,
+                                      1.0 / pow2(m_xRadius),
+                                      1.0 / pow2(m_yRadius));
 
-            dist = ((tmpy * tmpy) / (m_yRadius * m_yRadius) +
-                    (tmpx * tmpx) / (m_xRadius * m_xRadius));
-            if (dist < 1.0)
-                a = (quint8)(255 * (1.0 - sqrt(dist)));
-            else
-                a = 0;
-            density[ x][ y] = a;
-            density[ x][-y] = a;
-            density[-x][ y] = a;
-            density[-x][-y] = a;
-        }
-    }
-    pixelSelection->readBytes(buf[0], rect.x(), rect.y(), rect.width(), 1);
-    memcpy(buf[1], buf[0], rect.width());
-    if (rect.height() > 1)
-        pixelSelection->readBytes(buf[2], rect.x(), rect.y() + 1, rect.width(), 1);
-    else
-        memcpy(buf[2], buf[1], rect.width());
-    computeTransition(transition[1], buf, rect.width());
-
-    for (qint32 y = 1; y < m_yRadius && y + 1 < rect.height(); y++) { // set up top of image
-        rotatePointers(buf, 3);
-        pixelSelection->readBytes(buf[2], rect.x(), rect.y() + y + 1, rect.width(), 1);
-        computeTransition(transition[y + 1], buf, rect.width());
-    }
-    for (qint32 x = 0; x < rect.width(); x++) { // set up max[] for top of image
-        max[x] = -(m_yRadius + 7);
-        for (qint32 j = 1; j < m_yRadius + 1; j++)
-            if (transition[j][x]) {
-                max[x] = j;
-                break;
-            }
-    }
-    for (qint32 y = 0; y < rect.height(); y++) { // main calculation loop
-        rotatePointers(buf, 3);
-        rotatePointers(transition, m_yRadius + 1);
-        if (y < rect.height() - (m_yRadius + 1)) {
-            pixelSelection->readBytes(buf[2], rect.x(), rect.y() + y + m_yRadius + 1, rect.width(), 1);
-            computeTransition(transition[m_yRadius], buf, rect.width());
-        } else
-            memcpy(transition[m_yRadius], transition[m_yRadius - 1], rect.width());
-
-        for (qint32 x = 0; x < rect.width(); x++) { // update max array
-            if (max[x] < 1) {
-                if (max[x] <= -m_yRadius) {
-                    if (transition[m_yRadius][x])
-                        max[x] = m_yRadius;
-                    else
-                        max[x]--;
-                } else if (transition[-max[x]][x])
-                    max[x] = -max[x];
-                else if (transition[-max[x] + 1][x])
-                    max[x] = -max[x] + 1;
-                else
-                    max[x]--;
-            } else
-                max[x]--;
-            if (max[x] < -m_yRadius - 1)
-                max[x] = -m_yRadius - 1;
-        }
-        quint8 last_max =  max[0][density[-1]];
-        qint32 last_index = 1;
-        for (qint32 x = 0 ; x < rect.width(); x++) { // render scan line
-            last_index--;
-            if (last_index >= 0) {
-                last_max = 0;
-                for (qint32 i = m_xRadius; i >= 0; i--)
-                    if (max[x + i] <= m_yRadius && max[x + i] >= -m_yRadius && density[i][max[x+i]] > last_max) {
-                        last_max = density[i][max[x + i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
-            } else {
-                last_max = 0;
-                for (qint32 i = m_xRadius; i >= -m_xRadius; i--)
-                    if (max[x + i] <= m_yRadius && max[x + i] >= -m_yRadius && density[i][max[x + i]] > last_max) {
-                        last_max = density[i][max[x + i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
-            }
-            if (last_max == 0) {
-                qint32 i;
-                for (i = x + 1; i < rect.width(); i++) {
-                    if (max[i] >= -m_yRadius)
-                        break;
-                }
-                if (i - x > m_xRadius) {
-                    for (; x < i - m_xRadius; x++)
-                        out[x] = 0;
-                    x--;
-                }
-                last_index = m_xRadius;
-            }
-        }
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
-    }
-    delete [] out;
+    if (edt.compute(transitions.constData())) {
+        const qreal xRadius2 = pow2(m_xRadius);
+        const qreal yRadius2 = pow2(m_yRadius);
+        quint8 *dstPtr = out.data();
 
-    for (qint32 i = 0; i < 3; i++)
-        delete[] buf[i];
+        edt.processRows(
+            [dstPtr, width, xRadius2, yRadius2] (int y, const qint32 *nearestX, const qint32 *nearestY) {
+                quint8 *dstRow = dstPtr + y * width;
 
-    max -= m_xRadius;
-    delete[] max;
+                for (int x = 0; x < width; x++) {
+                    const int dx = qAbs(nearestX[x] - x);
+                    const int dy = qAbs(nearestY[x] - y);
 
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        transition[i] -= m_xRadius;
-        delete transition[i];
-    }
-    delete[] transition;
+                    const qreal tmpx = dx > 0 ? dx - 0.5 : 0.0;
+                    const qreal tmpy = dy > 0 ? dy - 0.5 : 0.0;
+
+                    const qreal dist = pow2(tmpy) / yRadius2 + pow2(tmpx) / xRadius2;
 
-    for (qint32 i = 0; i < m_xRadius + 1 ; i++) {
-        density[i] -= m_yRadius;
-        delete density[i];
+                    dstRow[x] = dist < 1.0 ? quint8(255 * (1.0 - std::sqrt(dist))) : 0;
+                }
+            });
     }
-    density -= m_xRadius;
-    delete[] density;
+
+    pixelSelection->writeBytes(out.constData(), rect);
 }
 
 
@@ -479,318 +387,425 @@ QRect KisFeatherSelectionFilter::changeRect(const QRect& rect, KisDefaultBoundsB
 {
     Q_UNUSED(defaultBounds);
 
-    return rect.adjusted(-m_radius, -m_radius,
-                         m_radius, m_radius);
+    const int halfSize = KisGaussianKernel::kernelSizeFromRadius(gaussianRadius()) / 2;
+    return rect.adjusted(-halfSize, -halfSize,
+                         halfSize, halfSize);
 }
 
 void KisFeatherSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
 {
-    // compute horizontal kernel
-    const uint kernelSize = m_radius * 2 + 1;
-    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> gaussianMatrix(1, kernelSize);
+    if (m_radius <= 0) return;
+
+    const qreal radius = gaussianRadius();
+
+    KisGaussianKernel::applyGaussian(pixelSelection, rect,
+                                     radius, radius,
+                                     QBitArray(), 0, false,
+                                     BORDER_REPEAT);
+}
+
+qreal KisFeatherSelectionFilter::gaussianRadius() const
+{
+    /**
+     * The feathering kernel is a Gaussian of sigma equal to the
+     * radius, truncated at the radius. The standard deviation of
+     * such a kernel is about 0.54 of the radius, so we apply a
+     * full Gaussian having the same deviation, which lets
+     * KisGaussianKernel use the recursive filter for big radii.
+     * The expression is the inverse of sigmaFromRadius().
+     */
+    const qreal sigma = 0.54 * m_radius;
+    return qMax(0.0, (sigma - 0.3) / 0.3);
+}
+
 
-    const qreal multiplicand = 1.0 / (2.0 * M_PI * m_radius * m_radius);
-    const qreal exponentMultiplicand = 1.0 / (2.0 * m_radius * m_radius);
+namespace {
 
-    for (uint x = 0; x < kernelSize; x++) {
-        uint xDistance = qAbs((int)m_radius - (int)x);
-        gaussianMatrix(0, x) = multiplicand * exp( -(qreal)((xDistance * xDistance) + (m_radius * m_radius)) * exponentMultiplicand );
+/**
+ * Replaces every element of \p src with the maximum over the window
+ * [x - radius, x + radius] and writes it into \p dst. The elements
+ * outside the row are considered to be \p outsideValue.
+ *
+ * Van Herk/Gil-Werman algorithm: the cost doesn't depend on the radius.
+ */
+void horizontalMaxFilter(const quint8 *src, quint8 *dst, int width, int radius, quint8 outsideValue,
+                         QVector<quint8> &prefixMax, QVector<quint8> &suffixMax)
+{
+    if (radius == 0) {
+        memcpy(dst, src, width);
+        return;
     }
 
-    KisConvolutionKernelSP kernelHoriz = KisConvolutionKernel::fromMatrix(gaussianMatrix, 0, gaussianMatrix.sum());
-    KisConvolutionKernelSP kernelVertical = KisConvolutionKernel::fromMatrix(gaussianMatrix.transpose(), 0, gaussianMatrix.sum());
+    const int windowSize = 2 * radius + 1;
+    const int paddedWidth = width + 2 * radius;
 
-    KisPaintDeviceSP interm = new KisPaintDevice(pixelSelection->colorSpace());
-    interm->prepareClone(pixelSelection);
+    prefixMax.resize(paddedWidth);
+    suffixMax.resize(paddedWidth);
 
-    KisConvolutionPainter horizPainter(interm);
-    horizPainter.setChannelFlags(interm->colorSpace()->channelFlags(false, true));
-    horizPainter.applyMatrix(kernelHoriz, pixelSelection, rect.topLeft(), rect.topLeft(), rect.size(), BORDER_REPEAT);
-    horizPainter.end();
+    auto paddedValue = [src, width, radius, outsideValue] (int i) {
+        const int x = i - radius;
+        return x >= 0 && x < width ? src[x] : outsideValue;
+    };
 
-    KisConvolutionPainter verticalPainter(pixelSelection);
-    verticalPainter.setChannelFlags(pixelSelection->colorSpace()->channelFlags(false, true));
-    verticalPainter.applyMatrix(kernelVertical, interm, rect.topLeft(), rect.topLeft(), rect.size(), BORDER_REPEAT);
-    verticalPainter.end();
-}
+    for (int i = 0; i < paddedWidth; i++) {
+        const quint8 value = paddedValue(i);
+        prefixMax[i] = i % windowSize ? qMax(prefixMax[i - 1], value) : value;
+    }
 
+    for (int i = paddedWidth - 1; i >= 0; i--) {
+        const quint8 value = paddedValue(i);
+        suffixMax[i] = (i + 1) % windowSize && i + 1 < paddedWidth ? qMax(suffixMax[i + 1], value) : value;
+    }
 
-KisGrowSelectionFilter::KisGrowSelectionFilter(qint32 xRadius, qint32 yRadius)
-    : m_xRadius(xRadius),
-        m_yRadius(yRadius)
-{
+    for (int x = 0; x < width; x++) {
+        dst[x] = qMax(suffixMax[x], prefixMax[x + windowSize - 1]);
+    }
 }
 
-KUndo2MagicString KisGrowSelectionFilter::name()
-{
-    return kundo2_i18n("Grow Selection");
-}
+/**
+ * The neighbourhood of the grow and shrink filters. It is the same
+ * mask the old GIMP-based filters used: \p circ is built by
+ * computeBorder() and circ[xRadius + dx] is the half-height of the
+ * neighbourhood at the horizontal offset dx.
+ */
+struct GrowNeighbourhood
+{
+    GrowNeighbourhood(const QVector<qint32> &_circ, qint32 _xRadius, qint32 _yRadius)
+        : circ(_circ),
+          xRadius(_xRadius),
+          yRadius(_yRadius),
+          xWeight(1.0 / pow2(_xRadius + 0.5)),
+          yWeight(1.0 / pow2(_yRadius + 0.5)),
+          chordRadii(_yRadius + 1, 0),
+          innerLimit(std::numeric_limits<qreal>::max()),
+          outerLimit(0.0)
+    {
+        // circ[] decreases with the offset, so the chords are nested
+        for (int dx = 0; dx <= xRadius; dx++) {
+            const int halfHeight = qMin(circ[xRadius + dx], yRadius);
+
+            for (int dy = 0; dy <= halfHeight; dy++) {
+                chordRadii[dy] = dx;
+            }
+        }
 
-QRect KisGrowSelectionFilter::changeRect(const QRect& rect, KisDefaultBoundsBaseSP defaultBounds)
+        /**
+         * The neighbourhood is not an ellipse, so the distance to the
+         * nearest selected pixel cannot tell alone whether there are
+         * selected pixels in the neighbourhood. Every point nearer
+         * than innerLimit belongs to the neighbourhood, and no point
+         * farther than outerLimit does. The pixels in the thin band
+         * in between are checked column by column.
+         */
+        for (int dy = 0; dy <= yRadius + 1; dy++) {
+            for (int dx = 0; dx <= xRadius + 1; dx++) {
+                const qreal distance = xWeight * pow2(qreal(dx)) + yWeight * pow2(qreal(dy));
+
+                if (contains(dx, dy)) {
+                    outerLimit = qMax(outerLimit, distance);
+                } else {
+                    innerLimit = qMin(innerLimit, distance);
+                }
+            }
+        }
+    }
+
+    inline bool contains(int dx, int dy) const {
+        return qAbs(dx) <= xRadius && qAbs(dy) <= circ[xRadius + dx];
+    }
+
+    const QVector<qint32> circ;
+    const qint32 xRadius;
+    const qint32 yRadius;
+
+    // the weights of the distance transform
+    const qreal xWeight;
+    const qreal yWeight;
+
+    // chordRadii[dy] is the half-width of the neighbourhood at the vertical offset dy
+    QVector<int> chordRadii;
+
+    qreal innerLimit;
+    qreal outerLimit;
+};
+
+/**
+ * Max filter for soft selections. The neighbourhood is split into
+ * horizontal chords, and every row of the result is the maximum of the
+ * source rows filtered with the widths of the chords.
+ *
+ * The chords are filtered in constant time per pixel, but every row
+ * combines 2 * yRadius + 1 of them, so the cost grows linearly with
+ * the vertical radius.
+ *
+ * \p window contains the area of the result with the margins of
+ * xRadius and yRadius pixels on each side.
+ */
+void softMaxFilter(const quint8 *window, const GrowNeighbourhood &neighbourhood,
+                   quint8 *result, int width, int height)
 {
-    Q_UNUSED(defaultBounds);
+    const int xRadius = neighbourhood.xRadius;
+    const int yRadius = neighbourhood.yRadius;
+    const int windowWidth = width + 2 * xRadius;
+    const int rowsPerChunk = 64;
 
-    return rect.adjusted(-m_xRadius, -m_yRadius, m_xRadius, m_yRadius);
+    QVector<QPair<int, int>> chunks;
+    for (int y = 0; y < height; y += rowsPerChunk) {
+        chunks.append(qMakePair(y, qMin(y + rowsPerChunk, height)));
+    }
+
+    QtConcurrent::blockingMap(chunks,
+        [window, result, width, windowWidth, xRadius, yRadius, &neighbourhood] (const QPair<int, int> &chunk) {
+            QVector<quint8> filteredRow(windowWidth);
+            QVector<quint8> prefixMax;
+            QVector<quint8> suffixMax;
+
+            for (int y = chunk.first; y < chunk.second; y++) {
+                quint8 *dstRow = result + y * width;
+                memset(dstRow, MIN_SELECTED, width);
+
+                for (int dy = -yRadius; dy <= yRadius; dy++) {
+                    const quint8 *srcRow = window + (y + yRadius + dy) * windowWidth;
+
+                    horizontalMaxFilter(srcRow, filteredRow.data(), windowWidth,
+                                        neighbourhood.chordRadii[qAbs(dy)], MIN_SELECTED,
+                                        prefixMax, suffixMax);
+
+                    const quint8 *filteredPtr = filteredRow.constData() + xRadius;
+
+                    for (int x = 0; x < width; x++) {
+                        dstRow[x] = qMax(dstRow[x], filteredPtr[x]);
+                    }
+                }
+            }
+        });
 }
 
-void KisGrowSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+/**
+ * Max filter for binary selections, that is for the ones containing
+ * only \p maxValue and MIN_SELECTED pixels.
+ *
+ * The distance transform finds the nearest selected pixel of every
+ * pixel. Most of the pixels are then either near enough to be always
+ * selected, or too far to be selected at all. Only the pixels on the
+ * edge of the grown area check the nearest selected pixels of every
+ * column of the neighbourhood. The cost of the rest doesn't depend on
+ * the radius.
+ *
+ * \p window contains the area of the result with the margins of
+ * xRadius and yRadius pixels on each side.
+ */
+void binaryMaxFilter(const quint8 *window, quint8 maxValue, const GrowNeighbourhood &neighbourhood,
+                     quint8 *result, int width, int height)
 {
-    if (m_xRadius <= 0 || m_yRadius <= 0) return;
+    const int xRadius = neighbourhood.xRadius;
+    const int yRadius = neighbourhood.yRadius;
+    const int windowWidth = width + 2 * xRadius;
+    const int windowHeight = height + 2 * yRadius;
 
-    /**
-        * Much code resembles Shrink filter, so please fix bugs
-        * in both filters
-        */
+    QVector<quint8> features(windowWidth * windowHeight);
+    std::transform(window, window + features.size(), features.begin(),
+                   [maxValue] (quint8 value) { return value == maxValue; });
 
-    quint8  **buf;  // caches the region's pixel data
-    quint8  **max;  // caches the largest values for each column
+    KisEuclideanDistanceTransform edt(windowWidth, windowHeight,
+                                      neighbourhood.xWeight, neighbourhood.yWeight);
 
-    max = new quint8* [rect.width() + 2 * m_xRadius];
-    buf = new quint8* [m_yRadius + 1];
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        buf[i] = new quint8[rect.width()];
+    if (!edt.compute(features.constData())) {
+        for (int y = 0; y < height; y++) {
+            memcpy(result + y * width, window + (y + yRadius) * windowWidth + xRadius, width);
+        }
+        return;
     }
-    quint8* buffer = new quint8[(rect.width() + 2 * m_xRadius) *(m_yRadius + 1)];
-    for (qint32 i = 0; i < rect.width() + 2 * m_xRadius; i++) {
-        if (i < m_xRadius)
-            max[i] = buffer;
-        else if (i < rect.width() + m_xRadius)
-            max[i] = &buffer[(m_yRadius + 1) * (i - m_xRadius)];
-        else
-            max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius - 1)];
 
-        for (qint32 j = 0; j < m_xRadius + 1; j++)
-            max[i][j] = 0;
-    }
-    /* offset the max pointer by m_xRadius so the range of the array
-        is [-m_xRadius] to [region->w + m_xRadius] */
-    max += m_xRadius;
+    // a safety margin for the rounding errors of the distance
+    const qreal epsilon = 1e-9;
+    const qreal innerLimit = neighbourhood.innerLimit - epsilon;
+    const qreal outerLimit = neighbourhood.outerLimit + epsilon;
 
-    quint8* out = new quint8[ rect.width()];  // holds the new scan line we are computing
+    edt.processRows(
+        [window, result, width, height, windowWidth, xRadius, yRadius, maxValue,
+         innerLimit, outerLimit, &neighbourhood, &edt] (int gridY, const qint32 *nearestX, const qint32 *nearestY) {
 
-    qint32* circ = new qint32[ 2 * m_xRadius + 1 ]; // holds the y coords of the filter's mask
-    computeBorder(circ, m_xRadius, m_yRadius);
+            const int y = gridY - yRadius;
+            if (y < 0 || y >= height) return;
 
-    /* offset the circ pointer by m_xRadius so the range of the array
-        is [-m_xRadius] to [m_xRadius] */
-    circ += m_xRadius;
+            const quint8 *srcRow = window + gridY * windowWidth + xRadius;
+            quint8 *dstRow = result + y * width;
 
-    memset(buf[0], 0, rect.width());
-    for (qint32 i = 0; i < m_yRadius && i < rect.height(); i++) { // load top of image
-        pixelSelection->readBytes(buf[i + 1], rect.x(), rect.y() + i, rect.width(), 1);
-    }
+            for (int x = 0; x < width; x++) {
+                const int gridX = x + xRadius;
+                const qreal distance = edt.distanceSquared(gridX, gridY, nearestX[gridX], nearestY[gridX]);
 
-    for (qint32 x = 0; x < rect.width() ; x++) { // set up max for top of image
-        max[x][0] = 0;         // buf[0][x] is always 0
-        max[x][1] = buf[1][x]; // MAX (buf[1][x], max[x][0]) always = buf[1][x]
-        for (qint32 j = 2; j < m_yRadius + 1; j++) {
-            max[x][j] = MAX(buf[j][x], max[x][j-1]);
-        }
-    }
+                bool isSelected = distance < innerLimit;
 
-    for (qint32 y = 0; y < rect.height(); y++) {
-        rotatePointers(buf, m_yRadius + 1);
-        if (y < rect.height() - (m_yRadius))
-            pixelSelection->readBytes(buf[m_yRadius], rect.x(), rect.y() + y + m_yRadius, rect.width(), 1);
-        else
-            memset(buf[m_yRadius], 0, rect.width());
-        for (qint32 x = 0; x < rect.width(); x++) { /* update max array */
-            for (qint32 i = m_yRadius; i > 0; i--) {
-                max[x][i] = MAX(MAX(max[x][i - 1], buf[i - 1][x]), buf[i][x]);
-            }
-            max[x][0] = buf[0][x];
-        }
-        qint32 last_max = max[0][circ[-1]];
-        qint32 last_index = 1;
-        for (qint32 x = 0; x < rect.width(); x++) { /* render scan line */
-            last_index--;
-            if (last_index >= 0) {
-                if (last_max == 255)
-                    out[x] = 255;
-                else {
-                    last_max = 0;
-                    for (qint32 i = m_xRadius; i >= 0; i--)
-                        if (last_max < max[x + i][circ[i]]) {
-                            last_max = max[x + i][circ[i]];
-                            last_index = i;
+                if (!isSelected && distance <= outerLimit) {
+                    for (int dx = -xRadius; dx <= xRadius; dx++) {
+                        const qint32 row = edt.nearestRowInColumn(gridX + dx, gridY);
+
+                        if (row >= 0 && neighbourhood.contains(dx, row - gridY)) {
+                            isSelected = true;
+                            break;
                         }
-                    out[x] = last_max;
+                    }
+                }
+
+                dstRow[x] = isSelected ? maxValue : srcRow[x];
+            }
+        });
+}
+
+/**
+ * Replaces every pixel with the maximum over the neighbourhood. The
+ * common part of the grow and shrink filters: shrinking is growing of
+ * the \p inverted selection. The pixels outside \p rect are considered
+ * to be deselected, or selected if \p outsideIsSelected is true (the
+ * values are taken after the inversion).
+ *
+ * The area is processed in tiles, each of them is read together with
+ * the margins the neighbourhood needs. That bounds the memory usage by
+ * the radius instead of the size of the area. The results are written
+ * into the selection right away, so the source pixels are read from a
+ * (copy-on-write) snapshot of it.
+ */
+void growSelection(KisPixelSelectionSP pixelSelection, const QRect &rect,
+                   const GrowNeighbourhood &neighbourhood,
+                   bool inverted, bool outsideIsSelected)
+{
+    const quint8 outsideValue = outsideIsSelected ? MAX_SELECTED : MIN_SELECTED;
+    const int xRadius = neighbourhood.xRadius;
+    const int yRadius = neighbourhood.yRadius;
+
+    // the margins should not be much bigger than the tiles themselves
+    const int minTileSize = 256;
+    const int tileWidth = qMax(minTileSize, 2 * xRadius);
+    const int tileHeight = qMax(minTileSize, 2 * yRadius);
+
+    auto invert = [] (quint8 value) { return quint8(MAX_SELECTED - value); };
+
+    KisPaintDeviceSP source = new KisPaintDevice(*pixelSelection);
+
+    for (int tileY = rect.y(); tileY <= rect.bottom(); tileY += tileHeight) {
+        for (int tileX = rect.x(); tileX <= rect.right(); tileX += tileWidth) {
+            const QRect tileRect = QRect(tileX, tileY, tileWidth, tileHeight) & rect;
+            const QRect windowRect = tileRect.adjusted(-xRadius, -yRadius, xRadius, yRadius);
+            const QRect sourceRect = windowRect & rect;
+
+            QVector<quint8> sourceData(sourceRect.width() * sourceRect.height());
+            source->readBytes(sourceData.data(), sourceRect);
+
+            QVector<quint8> window(windowRect.width() * windowRect.height(), outsideValue);
+
+            for (int y = 0; y < sourceRect.height(); y++) {
+                const quint8 *srcPtr = sourceData.constData() + y * sourceRect.width();
+                quint8 *dstPtr = window.data() +
+                    (sourceRect.y() - windowRect.y() + y) * windowRect.width() +
+                    sourceRect.x() - windowRect.x();
+
+                if (inverted) {
+                    std::transform(srcPtr, srcPtr + sourceRect.width(), dstPtr, invert);
+                } else {
+                    memcpy(dstPtr, srcPtr, sourceRect.width());
                 }
+            }
+
+            const auto range = std::minmax_element(window.constBegin(), window.constEnd());
+            const quint8 minValue = *range.first;
+            const quint8 maxValue = *range.second;
+
+            // uniform areas stay as they are
+            if (minValue == maxValue) continue;
+
+            const bool isBinary =
+                minValue == MIN_SELECTED &&
+                std::all_of(window.constBegin(), window.constEnd(),
+                            [maxValue] (quint8 value) {
+                                return value == maxValue || value == MIN_SELECTED;
+                            });
+
+            QVector<quint8> result(tileRect.width() * tileRect.height());
+
+            if (isBinary) {
+                binaryMaxFilter(window.constData(), maxValue, neighbourhood,
+                                result.data(), tileRect.width(), tileRect.height());
             } else {
-                last_index = m_xRadius;
-                last_max = max[x + m_xRadius][circ[m_xRadius]];
-                for (qint32 i = m_xRadius - 1; i >= -m_xRadius; i--)
-                    if (last_max < max[x + i][circ[i]]) {
-                        last_max = max[x + i][circ[i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
+                softMaxFilter(window.constData(), neighbourhood,
+                              result.data(), tileRect.width(), tileRect.height());
             }
+
+            if (inverted) {
+                std::transform(result.begin(), result.end(), result.begin(), invert);
+            }
+
+            pixelSelection->writeBytes(result.constData(), tileRect);
         }
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
     }
-    /* undo the offsets to the pointers so we can free the malloced memory */
-    circ -= m_xRadius;
-    max -= m_xRadius;
-
-    delete[] circ;
-    delete[] buffer;
-    delete[] max;
-    for (qint32 i = 0; i < m_yRadius + 1; i++)
-        delete[] buf[i];
-    delete[] buf;
-    delete[] out;
+}
+
 }
 
 
-KisShrinkSelectionFilter::KisShrinkSelectionFilter(qint32 xRadius, qint32 yRadius, bool edgeLock)
+KisGrowSelectionFilter::KisGrowSelectionFilter(qint32 xRadius, qint32 yRadius)
     : m_xRadius(xRadius),
-      m_yRadius(yRadius),
-      m_edgeLock(edgeLock)
+        m_yRadius(yRadius)
 {
 }
 
-KUndo2MagicString KisShrinkSelectionFilter::name()
+KUndo2MagicString KisGrowSelectionFilter::name()
 {
-    return kundo2_i18n("Shrink Selection");
+    return kundo2_i18n("Grow Selection");
 }
 
-QRect KisShrinkSelectionFilter::changeRect(const QRect& rect, KisDefaultBoundsBaseSP defaultBounds)
+QRect KisGrowSelectionFilter::changeRect(const QRect& rect, KisDefaultBoundsBaseSP defaultBounds)
 {
     Q_UNUSED(defaultBounds);
+
     return rect.adjusted(-m_xRadius, -m_yRadius, m_xRadius, m_yRadius);
 }
 
-void KisShrinkSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+void KisGrowSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
 {
     if (m_xRadius <= 0 || m_yRadius <= 0) return;
 
-    /*
-        pretty much the same as fatten_region only different
-        blame all bugs in this function on jaycox@gimp.org
-    */
-    /* If edge_lock is true  we assume that pixels outside the region
-        we are passed are identical to the edge pixels.
-        If edge_lock is false, we assume that pixels outside the region are 0
-    */
-    quint8  **buf;  // caches the region's pixels
-    quint8  **max;  // caches the smallest values for each column
-    qint32    last_max, last_index;
-
-    max = new quint8* [rect.width() + 2 * m_xRadius];
-    buf = new quint8* [m_yRadius + 1];
-    for (qint32 i = 0; i < m_yRadius + 1; i++) {
-        buf[i] = new quint8[rect.width()];
-    }
-
-    qint32 buffer_size = (rect.width() + 2 * m_xRadius + 1) * (m_yRadius + 1);
-    quint8* buffer = new quint8[buffer_size];
-
-    if (m_edgeLock)
-        memset(buffer, 255, buffer_size);
-    else
-        memset(buffer, 0, buffer_size);
-
-    for (qint32 i = 0; i < rect.width() + 2 * m_xRadius; i++) {
-        if (i < m_xRadius)
-            if (m_edgeLock)
-                max[i] = buffer;
-            else
-                max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius)];
-        else if (i < rect.width() + m_xRadius)
-            max[i] = &buffer[(m_yRadius + 1) * (i - m_xRadius)];
-        else if (m_edgeLock)
-            max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius - 1)];
-        else
-            max[i] = &buffer[(m_yRadius + 1) * (rect.width() + m_xRadius)];
-    }
-    if (!m_edgeLock)
-        for (qint32 j = 0 ; j < m_xRadius + 1; j++) max[0][j] = 0;
-
-    // offset the max pointer by m_xRadius so the range of the array is [-m_xRadius] to [region->w + m_xRadius]
-    max += m_xRadius;
-
-    quint8* out = new quint8[rect.width()]; // holds the new scan line we are computing
+    QVector<qint32> circ(2 * m_xRadius + 1);
+    computeBorder(circ.data(), m_xRadius, m_yRadius);
 
-    qint32* circ = new qint32[2 * m_xRadius + 1]; // holds the y coords of the filter's mask
-
-    computeBorder(circ, m_xRadius, m_yRadius);
-
-    // offset the circ pointer by m_xRadius so the range of the array is [-m_xRadius] to [m_xRadius]
-    circ += m_xRadius;
-
-    for (qint32 i = 0; i < m_yRadius && i < rect.height(); i++) // load top of image
-        pixelSelection->readBytes(buf[i + 1], rect.x(), rect.y() + i, rect.width(), 1);
+    growSelection(pixelSelection, rect, GrowNeighbourhood(circ, m_xRadius, m_yRadius), false, false);
+}
 
-    if (m_edgeLock)
-        memcpy(buf[0], buf[1], rect.width());
-    else
-        memset(buf[0], 0, rect.width());
 
+KisShrinkSelectionFilter::KisShrinkSelectionFilter(qint32 xRadius, qint32 yRadius, bool edgeLock)
+    : m_xRadius(xRadius),
+      m_yRadius(yRadius),
+      m_edgeLock(edgeLock)
+{
+}
 
-    for (qint32 x = 0; x < rect.width(); x++) { // set up max for top of image
-        max[x][0] = buf[0][x];
-        for (qint32 j = 1; j < m_yRadius + 1; j++)
-            max[x][j] = MIN(buf[j][x], max[x][j-1]);
-    }
+KUndo2MagicString KisShrinkSelectionFilter::name()
+{
+    return kundo2_i18n("Shrink Selection");
+}
 
-    for (qint32 y = 0; y < rect.height(); y++) {
-        rotatePointers(buf, m_yRadius + 1);
-        if (y < rect.height() - m_yRadius)
-            pixelSelection->readBytes(buf[m_yRadius], rect.x(), rect.y() + y + m_yRadius, rect.width(), 1);
-        else if (m_edgeLock)
-            memcpy(buf[m_yRadius], buf[m_yRadius - 1], rect.width());
-        else
-            memset(buf[m_yRadius], 0, rect.width());
+QRect KisShrinkSelectionFilter::changeRect(const QRect& rect, KisDefaultBoundsBaseSP defaultBounds)
+{
+    Q_UNUSED(defaultBounds);
+    return rect.adjusted(-m_xRadius, -m_yRadius, m_xRadius, m_yRadius);
+}
 
-        for (qint32 x = 0 ; x < rect.width(); x++) { // update max array
-            for (qint32 i = m_yRadius; i > 0; i--) {
-                max[x][i] = MIN(MIN(max[x][i - 1], buf[i - 1][x]), buf[i][x]);
-            }
-            max[x][0] = buf[0][x];
-        }
-        last_max =  max[0][circ[-1]];
-        last_index = 0;
-
-        for (qint32 x = 0 ; x < rect.width(); x++) { // render scan line
-            last_index--;
-            if (last_index >= 0) {
-                if (last_max == 0)
-                    out[x] = 0;
-                else {
-                    last_max = 255;
-                    for (qint32 i = m_xRadius; i >= 0; i--)
-                        if (last_max > max[x + i][circ[i]]) {
-                            last_max = max[x + i][circ[i]];
-                            last_index = i;
-                        }
-                    out[x] = last_max;
-                }
-            } else {
-                last_index = m_xRadius;
-                last_max = max[x + m_xRadius][circ[m_xRadius]];
-                for (qint32 i = m_xRadius - 1; i >= -m_xRadius; i--)
-                    if (last_max > max[x + i][circ[i]]) {
-                        last_max = max[x + i][circ[i]];
-                        last_index = i;
-                    }
-                out[x] = last_max;
-            }
-        }
-        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
-    }
+void KisShrinkSelectionFilter::process(KisPixelSelectionSP pixelSelection, const QRect& rect)
+{
+    if (m_xRadius <= 0 || m_yRadius <= 0) return;
 
-    // undo the offsets to the pointers so we can free the malloced memory
-    circ -= m_xRadius;
-    max -= m_xRadius;
+    QVector<qint32> circ(2 * m_xRadius + 1);
+    computeBorder(circ.data(), m_xRadius, m_yRadius);
 
-    delete[] circ;
-    delete[] buffer;
-    delete[] max;
-    for (qint32 i = 0; i < m_yRadius + 1; i++)
-        delete[] buf[i];
-    delete[] buf;
-    delete[] out;
+    /**
+     * Shrinking is growing of the inverted selection. If edge lock is
+     * true, we assume that pixels outside the region we are passed
+     * are identical to the edge pixels, which never makes them the
+     * nearest ones. If it is false, we assume that pixels outside the
+     * region are deselected.
+     */
+    growSelection(pixelSelection, rect, GrowNeighbourhood(circ, m_xRadius, m_yRadius), true, !m_edgeLock);
 }
 
 
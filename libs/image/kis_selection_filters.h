@@ -96,6 +96,9 @@ public:
     QRect changeRect(const QRect &rect, KisDefaultBoundsBaseSP defaultBounds) override;
 
     void process(KisPixelSelectionSP pixelSelection, const QRect &rect) override;
+private:
+    qreal gaussianRadius() const;
+
 private:
     qint32 m_radius;
 };
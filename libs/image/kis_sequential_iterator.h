@@ -33,11 +33,11 @@ struct DevicePolicy {
     DevicePolicy(Convertible sel) : m_dev(sel) {}
 
     KisHLineConstIteratorSP createConstIterator(const QRect &rect) {
-        return m_dev->createHLineConstIteratorNG(rect.x(), rect.y(), rect.width());
+        return m_dev->createHLineConstIteratorNG(rect.x(), rect.y(), rect.width(), rect.height());
     }
 
     KisHLineIteratorSP createIterator(const QRect &rect) {
-        return m_dev->createHLineIteratorNG(rect.x(), rect.y(), rect.width());
+        return m_dev->createHLineIteratorNG(rect.x(), rect.y(), rect.width(), rect.height());
     }
 
     int pixelSize() const {
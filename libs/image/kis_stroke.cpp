@@ -193,6 +193,9 @@ void KisStroke::cancelStroke()
         clearQueueOnCancel();
         enqueue(m_cancelStrategy.data(),
                 m_strokeStrategy->createCancelData());
+
+        // the job being executed right now can't be dropped from the queue
+        m_strokeStrategy->tryCancelCurrentStrokeJobAsync();
     }
     // else {
     //     too late ...
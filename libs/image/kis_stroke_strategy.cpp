@@ -64,6 +64,10 @@ void KisStrokeStrategy::notifyUserEndedStroke()
 {
 }
 
+void KisStrokeStrategy::tryCancelCurrentStrokeJobAsync()
+{
+}
+
 KisStrokeJobStrategy* KisStrokeStrategy::createInitStrategy()
 {
     return 0;
@@ -55,6 +55,18 @@ public:
      */
     virtual void notifyUserEndedStroke();
 
+    /**
+     * tryCancelCurrentStrokeJobAsync() is called by the strokes system when
+     * the stroke is cancelled. Cancelling only drops the pending jobs, so a
+     * long job that is already running may use this notification to stop
+     * early. The stroke will get cancelStrokeCallback() afterwards as usual.
+     *
+     * NOTE: this method will be executed in the context of the thread that
+     *       cancels the stroke, while a job of the stroke may be running
+     *       in a worker thread! Just set an atomic flag here.
+     */
+    virtual void tryCancelCurrentStrokeJobAsync();
+
     virtual KisStrokeJobStrategy* createInitStrategy();
     virtual KisStrokeJobStrategy* createFinishStrategy();
     virtual KisStrokeJobStrategy* createCancelStrategy();
@@ -26,6 +26,8 @@
 #include <klocalizedstring.h>
 
 #include <QTransform>
+#include <QMutex>
+#include <QtConcurrent>
 
 #include <KoColorSpace.h>
 #include <KoCompositeOpRegistry.h>
@@ -42,6 +44,7 @@
 #include "kis_progress_update_helper.h"
 #include "kis_pixel_selection.h"
 #include "kis_image.h"
+#include "kis_algebra_2d.h"
 
 
 KisTransformWorker::KisTransformWorker(KisPaintDeviceSP dev,
@@ -90,6 +93,50 @@ void KisTransformWorker::transformPixelSelectionOutline(KisPixelSelectionSP pixe
     }
 }
 
+namespace {
+
+struct LinesChunk {
+    int firstLine;
+    int numLines;
+
+    /// the bounds of the lines written by the chunk
+    KisFilterWeightsApplicator::LinePos dstBounds;
+};
+
+/**
+ * Splits the lines [firstLine, firstLine + numLines) into chunks lying
+ * in the same row (column) of tiles. When the lines are mirrored on
+ * writing, pass \p direction = -1, so that the chunks are aligned to
+ * the tiles of the destination. This way the chunks can be processed
+ * in parallel without two threads ever writing into the same tile.
+ */
+QVector<LinesChunk> splitLinesIntoChunks(int firstLine, int numLines, int direction = 1)
+{
+    const int tileSize = 64;
+
+    QVector<LinesChunk> chunks;
+    int lastTileIndex = 0;
+
+    for (int line = firstLine; line < firstLine + numLines; line++) {
+        const int tileIndex = KisAlgebra2D::divideFloor(direction * line, tileSize);
+
+        if (chunks.isEmpty() || tileIndex != lastTileIndex) {
+            LinesChunk chunk;
+            chunk.firstLine = line;
+            chunk.numLines = 1;
+            chunks.append(chunk);
+
+            lastTileIndex = tileIndex;
+        } else {
+            chunks.last().numLines++;
+        }
+    }
+
+    return chunks;
+}
+
+}
+
 QRect rotateWithTf(int rotation, KisPaintDeviceSP dev,
                    QRect boundRect,
                    KoUpdaterPtr progressUpdater,
@@ -101,26 +148,42 @@ QRect rotateWithTf(int rotation, KisPaintDeviceSP dev,
     KisPaintDeviceSP tmp = new KisPaintDevice(dev->colorSpace());
     tmp->prepareClone(dev);
 
-    KisRandomAccessorSP devAcc = dev->createRandomAccessorNG();
-    KisRandomAccessorSP tmpAcc = tmp->createRandomAccessorNG();
-    KisProgressUpdateHelper progressHelper(progressUpdater, portion, r.height());
-
     QTransform tf;
     tf = tf.rotate(rotation);
 
-    int ty = 0;
-    int tx = 0;
+    /**
+     * A row of the source device becomes a row or a column of the
+     * destination one, possibly mirrored, so the chunks of rows are
+     * aligned to the tiles of the destination.
+     */
+    const QPoint rowDirection = tf.map(QPoint(0, 1));
+    QVector<LinesChunk> chunks =
+        splitLinesIntoChunks(r.y(), r.height() + 1, rowDirection.x() + rowDirection.y());
+
+    KisProgressUpdateHelper progressHelper(progressUpdater, portion, chunks.size());
+    QMutex progressMutex;
 
-    for (qint32 y = r.y(); y <= r.height() + r.y(); ++y) {
-        for (qint32 x = r.x(); x <= r.width() + r.x(); ++x) {
-            tf.map(x, y, &tx, &ty);
-            devAcc->moveTo(x, y);
-            tmpAcc->moveTo(tx, ty);
+    QtConcurrent::blockingMap(chunks,
+        [dev, tmp, tf, r, pixelSize, &progressHelper, &progressMutex] (const LinesChunk &chunk) {
+            KisRandomConstAccessorSP devAcc = dev->createRandomConstAccessorNG();
+            KisRandomAccessorSP tmpAcc = tmp->createRandomAccessorNG();
 
-            memcpy(tmpAcc->rawData(), devAcc->rawData(), pixelSize);
-        }
-        progressHelper.step();
-    }
+            int ty = 0;
+            int tx = 0;
+
+            for (qint32 y = chunk.firstLine; y < chunk.firstLine + chunk.numLines; ++y) {
+                for (qint32 x = r.x(); x <= r.width() + r.x(); ++x) {
+                    tf.map(x, y, &tx, &ty);
+                    devAcc->moveTo(x, y);
+                    tmpAcc->moveTo(tx, ty);
+
+                    memcpy(tmpAcc->rawData(), devAcc->rawDataConst(), pixelSize);
+                }
+            }
+
+            QMutexLocker l(&progressMutex);
+            progressHelper.step();
+        });
 
     dev->makeCloneFrom(tmp, tmp->region().boundingRect());
     return r;
@@ -206,20 +269,43 @@ void KisTransformWorker::transformPass(KisPaintDevice *src, KisPaintDevice *dst,
     qint32 srcStart, srcLen, firstLine, numLines;
     calcDimensions<T>(m_boundRect, srcStart, srcLen, firstLine, numLines);
 
-    KisProgressUpdateHelper progressHelper(m_progressUpdater, portion, numLines);
     KisFilterWeightsBuffer buf(filterStrategy, qAbs(floatscale));
-    KisFilterWeightsApplicator applicator(src, dst, floatscale, shear, dx, clampToEdge);
+    const qreal support = filterStrategy->support(buf.weightsPositionScale().toFloat());
 
-    KisFilterWeightsApplicator::LinePos dstBounds;
+    /**
+     * Every line is read and written by processLine() independently
+     * from the others, so the chunks of lines belonging to different
+     * rows (columns) of tiles can be processed in parallel even when
+     * src and dst are the same device. The weights buffer is read-only
+     * and shared between the jobs.
+     */
+    QVector<LinesChunk> chunks = splitLinesIntoChunks(firstLine, numLines);
+
+    KisProgressUpdateHelper progressHelper(m_progressUpdater, portion, chunks.size());
+    QMutex progressMutex;
+
+    QtConcurrent::blockingMap(chunks,
+        [src, dst, floatscale, shear, dx, clampToEdge, srcStart, srcLen, support,
+         &buf, &progressHelper, &progressMutex] (LinesChunk &chunk) {
+
+            KisFilterWeightsApplicator applicator(src, dst, floatscale, shear, dx, clampToEdge);
 
-    for (int i = firstLine; i < firstLine + numLines; i++) {
-        KisFilterWeightsApplicator::LinePos dstPos;
-        KisFilterWeightsApplicator::LinePos srcPos(srcStart, srcLen);
+            for (int i = chunk.firstLine; i < chunk.firstLine + chunk.numLines; i++) {
+                KisFilterWeightsApplicator::LinePos dstPos;
+                KisFilterWeightsApplicator::LinePos srcPos(srcStart, srcLen);
 
-        dstPos = applicator.processLine<T>(srcPos, i, &buf, filterStrategy->support(buf.weightsPositionScale().toFloat()));
-        dstBounds.unite(dstPos);
+                dstPos = applicator.processLine<T>(srcPos, i, &buf, support);
+                chunk.dstBounds.unite(dstPos);
+            }
+
+            QMutexLocker l(&progressMutex);
+            progressHelper.step();
+        });
+
+    KisFilterWeightsApplicator::LinePos dstBounds;
 
-        progressHelper.step();
+    Q_FOREACH (const LinesChunk &chunk, chunks) {
+        dstBounds.unite(chunk.dstBounds);
     }
 
     updateBounds<T>(m_boundRect, dstBounds);
@@ -0,0 +1,252 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_update_job_executor.h"
+
+#include <atomic>
+#include <deque>
+
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+
+
+struct KisUpdateJobExecutor::Worker : public QThread
+{
+    Worker(KisUpdateJobExecutor::Private *_d, int _index)
+        : d(_d), index(_index)
+    {
+    }
+
+    void run() override;
+
+    KisUpdateJobExecutor::Private *d;
+    const int index;
+
+    QMutex queueLock;
+    std::deque<QRunnable*> queue;
+};
+
+struct Q_DECL_HIDDEN KisUpdateJobExecutor::Private
+{
+    QVector<Worker*> workers;
+    int threadCount {0};
+
+    /**
+     * Every image has its own updater context, so the threads are
+     * created lazily, when the first runnable is started
+     */
+    std::atomic<bool> workersStarted {false};
+    QMutex workersStartLock;
+
+    /**
+     * The number of the runnables waiting in the deques
+     */
+    std::atomic<int> numQueued {0};
+
+    /**
+     * The number of the runnables queued or being executed
+     */
+    std::atomic<int> numActive {0};
+
+    std::atomic<unsigned int> nextWorker {0};
+
+    QMutex sleepLock;
+    QWaitCondition wakeCondition;
+    QWaitCondition doneCondition;
+    bool shouldExit {false};
+
+    /**
+     * The worker that executes the current thread. Used to find
+     * out whether a runnable is started from inside the executor.
+     */
+    static thread_local Worker *currentWorker;
+
+    QRunnable* takeRunnable(Worker *worker);
+    void stopWorkers();
+    void startWorkers(int numWorkers);
+};
+
+thread_local KisUpdateJobExecutor::Worker *KisUpdateJobExecutor::Private::currentWorker = 0;
+
+QRunnable* KisUpdateJobExecutor::Private::takeRunnable(Worker *worker)
+{
+    QRunnable *runnable = 0;
+
+    {
+        QMutexLocker l(&worker->queueLock);
+        if (!worker->queue.empty()) {
+            runnable = worker->queue.back();
+            worker->queue.pop_back();
+        }
+    }
+
+    for (int i = 1; !runnable && i < workers.size(); i++) {
+        Worker *victim = workers[(worker->index + i) % workers.size()];
+
+        QMutexLocker l(&victim->queueLock);
+        if (!victim->queue.empty()) {
+            runnable = victim->queue.front();
+            victim->queue.pop_front();
+        }
+    }
+
+    if (runnable) {
+        numQueued--;
+    }
+
+    return runnable;
+}
+
+void KisUpdateJobExecutor::Worker::run()
+{
+    Private::currentWorker = this;
+
+    while (1) {
+        QRunnable *runnable = d->takeRunnable(this);
+
+        if (!runnable) {
+            QMutexLocker l(&d->sleepLock);
+
+            if (d->shouldExit) break;
+
+            /**
+             * The producer increments the counter before taking
+             * the lock for waking us up, so we cannot miss the
+             * notification if we check it here
+             */
+            if (d->numQueued > 0) continue;
+
+            d->wakeCondition.wait(&d->sleepLock);
+            continue;
+        }
+
+        runnable->run();
+
+        if (--d->numActive == 0) {
+            QMutexLocker l(&d->sleepLock);
+            d->doneCondition.wakeAll();
+        }
+    }
+
+    Private::currentWorker = 0;
+}
+
+void KisUpdateJobExecutor::Private::stopWorkers()
+{
+    {
+        QMutexLocker l(&sleepLock);
+        shouldExit = true;
+        wakeCondition.wakeAll();
+    }
+
+    Q_FOREACH (Worker *worker, workers) {
+        worker->wait();
+        KIS_SAFE_ASSERT_RECOVER_NOOP(worker->queue.empty());
+        delete worker;
+    }
+
+    workers.clear();
+    shouldExit = false;
+    workersStarted = false;
+}
+
+void KisUpdateJobExecutor::Private::startWorkers(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; i++) {
+        workers.append(new Worker(this, i));
+    }
+
+    Q_FOREACH (Worker *worker, workers) {
+        worker->start();
+    }
+
+    workersStarted = true;
+}
+
+
+KisUpdateJobExecutor::KisUpdateJobExecutor()
+    : m_d(new Private)
+{
+}
+
+KisUpdateJobExecutor::~KisUpdateJobExecutor()
+{
+    waitForDone();
+    m_d->stopWorkers();
+}
+
+void KisUpdateJobExecutor::setThreadCount(int value)
+{
+    KIS_SAFE_ASSERT_RECOVER(value > 0) {
+        value = 1;
+    }
+
+    if (value == m_d->threadCount) return;
+
+    waitForDone();
+    m_d->stopWorkers();
+    m_d->threadCount = value;
+}
+
+int KisUpdateJobExecutor::threadCount() const
+{
+    return m_d->threadCount;
+}
+
+void KisUpdateJobExecutor::start(QRunnable *runnable)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_d->threadCount > 0);
+
+    if (!m_d->workersStarted) {
+        QMutexLocker l(&m_d->workersStartLock);
+        if (!m_d->workersStarted) {
+            m_d->startWorkers(m_d->threadCount);
+        }
+    }
+
+    m_d->numActive++;
+
+    Worker *worker = Private::currentWorker;
+    if (!worker || worker->d != m_d.data()) {
+        worker = m_d->workers[m_d->nextWorker++ % m_d->workers.size()];
+    }
+
+    {
+        QMutexLocker l(&worker->queueLock);
+        worker->queue.push_back(runnable);
+    }
+
+    m_d->numQueued++;
+
+    QMutexLocker l(&m_d->sleepLock);
+    m_d->wakeCondition.wakeOne();
+}
+
+void KisUpdateJobExecutor::waitForDone()
+{
+    QMutexLocker l(&m_d->sleepLock);
+
+    while (m_d->numActive > 0) {
+        m_d->doneCondition.wait(&m_d->sleepLock);
+    }
+}
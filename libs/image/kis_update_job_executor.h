@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_UPDATE_JOB_EXECUTOR_H
+#define __KIS_UPDATE_JOB_EXECUTOR_H
+
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+
+class QRunnable;
+
+
+/**
+ * A work-stealing replacement for QThreadPool used by
+ * KisUpdaterContext.
+ *
+ * Every worker thread owns a deque of runnables. A runnable started
+ * from inside a worker (which is the usual case: the update job
+ * items pick the next jobs in KisUpdaterContext::doSomeUsefulWork()
+ * and jobFinished()) is pushed into the deque of that worker, so no
+ * global lock is taken. A runnable started from any other thread is
+ * distributed over the workers in a round-robin manner. The worker
+ * takes the runnables from the back of its own deque, and when the
+ * deque is empty, it steals from the front of the deques of the
+ * other workers, so an idle thread never stays idle while there is
+ * some queued work.
+ *
+ * The runnables are never deleted by the executor, independently of
+ * their autoDelete() value.
+ */
+class KRITAIMAGE_EXPORT KisUpdateJobExecutor
+{
+public:
+    KisUpdateJobExecutor();
+    ~KisUpdateJobExecutor();
+
+    /**
+     * Sets the number of the worker threads. The threads are
+     * created on the first call to start(). Blocks until all the
+     * queued runnables are executed.
+     */
+    void setThreadCount(int value);
+    int threadCount() const;
+
+    /**
+     * Queue \p runnable for execution
+     */
+    void start(QRunnable *runnable);
+
+    /**
+     * Blocks until all the started runnables are finished
+     */
+    void waitForDone();
+
+private:
+    struct Worker;
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_UPDATE_JOB_EXECUTOR_H */
@@ -19,7 +19,6 @@
 #include "kis_updater_context.h"
 
 #include <QThread>
-#include <QThreadPool>
 
 #include "kis_update_job_item.h"
 #include "kis_stroke_job.h"
@@ -39,7 +38,7 @@ KisUpdaterContext::KisUpdaterContext(qint32 threadCount, QObject *parent)
 
 KisUpdaterContext::~KisUpdaterContext()
 {
-    m_threadPool.waitForDone();
+    m_executor.waitForDone();
     for(qint32 i = 0; i < m_jobs.size(); i++)
         delete m_jobs[i];
 }
@@ -144,7 +143,7 @@ void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
     // it might happen that we call this function from within
     // the thread itself, right when it finished its work
     if (shouldStartThread) {
-        m_threadPool.start(m_jobs[jobIndex]);
+        m_executor.start(m_jobs[jobIndex]);
     }
 }
 
@@ -174,7 +173,7 @@ void KisUpdaterContext::addStrokeJob(KisStrokeJob *strokeJob)
     // it might happen that we call this function from within
     // the thread itself, right when it finished its work
     if (shouldStartThread) {
-        m_threadPool.start(m_jobs[jobIndex]);
+        m_executor.start(m_jobs[jobIndex]);
     }
 }
 
@@ -204,7 +203,7 @@ void KisUpdaterContext::addSpontaneousJob(KisSpontaneousJob *spontaneousJob)
     // it might happen that we call this function from within
     // the thread itself, right when it finished its work
     if (shouldStartThread) {
-        m_threadPool.start(m_jobs[jobIndex]);
+        m_executor.start(m_jobs[jobIndex]);
     }
 }
 
@@ -225,7 +224,7 @@ void KisUpdaterContext::addSpontaneousJobTest(KisSpontaneousJob *spontaneousJob)
 
 void KisUpdaterContext::waitForDone()
 {
-    m_threadPool.waitForDone();
+    m_executor.waitForDone();
 }
 
 bool KisUpdaterContext::walkerIntersectsJob(KisBaseRectsWalkerSP walker,
@@ -237,11 +236,25 @@ bool KisUpdaterContext::walkerIntersectsJob(KisBaseRectsWalkerSP walker,
 
 qint32 KisUpdaterContext::findSpareThread()
 {
-    for(qint32 i=0; i < m_jobs.size(); i++)
-        if(!m_jobs[i]->isRunning())
+    qint32 emptyIndex = -1;
+
+    /**
+     * Prefer the items that have just finished their jobs: their
+     * threads are still alive and will pick the new job up in the
+     * bulk-processing loop of KisUpdateJobItem::run(), without
+     * passing it through the executor.
+     */
+    for(qint32 i=0; i < m_jobs.size(); i++) {
+        const KisUpdateJobItem::Type type = m_jobs[i]->type();
+
+        if(type == KisUpdateJobItem::Type::WAITING)
             return i;
 
-    return -1;
+        if(type == KisUpdateJobItem::Type::EMPTY && emptyIndex < 0)
+            emptyIndex = i;
+    }
+
+    return emptyIndex;
 }
 
 void KisUpdaterContext::lock()
@@ -256,7 +269,7 @@ void KisUpdaterContext::unlock()
 
 void KisUpdaterContext::setThreadsLimit(int value)
 {
-    m_threadPool.setMaxThreadCount(value);
+    m_executor.setThreadCount(value);
 
     for (int i = 0; i < m_jobs.size(); i++) {
         KIS_SAFE_ASSERT_RECOVER_RETURN(!m_jobs[i]->isRunning());
@@ -276,7 +289,7 @@ void KisUpdaterContext::setThreadsLimit(int value)
 
 int KisUpdaterContext::threadsLimit() const
 {
-    KIS_SAFE_ASSERT_RECOVER_NOOP(m_jobs.size() == m_threadPool.maxThreadCount());
+    KIS_SAFE_ASSERT_RECOVER_NOOP(m_jobs.size() == m_executor.threadCount());
     return m_jobs.size();
 }
 
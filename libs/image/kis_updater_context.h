@@ -22,11 +22,11 @@
 #include <QObject>
 #include <QMutex>
 #include <QReadWriteLock>
-#include <QThreadPool>
 
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
 #include "kis_lock_free_lod_counter.h"
+#include "kis_update_job_executor.h"
 
 #include "KisUpdaterContextSnapshotEx.h"
 #include "kis_update_scheduler.h"
@@ -159,7 +159,7 @@ protected:
 
     QMutex m_lock;
     QVector<KisUpdateJobItem*> m_jobs;
-    QThreadPool m_threadPool;
+    KisUpdateJobExecutor m_executor;
     KisLockFreeLodCounter m_lodCounter;
     KisUpdateScheduler *m_scheduler;
 
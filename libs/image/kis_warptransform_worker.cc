@@ -258,8 +258,8 @@ void KisWarpTransformWorker::run()
 
     FunctionTransformOp functionOp(m_warpMathFunction, m_origPoint, m_transfPoint, m_alpha);
     GridIterationTools::PaintDevicePolygonOp polygonOp(srcdev, m_dev);
-    GridIterationTools::processGrid(polygonOp, functionOp,
-                                    srcBounds, pixelPrecision);
+    GridIterationTools::processGridInPatches(polygonOp, functionOp,
+                                             srcBounds, pixelPrecision);
 }
 
 #include "krita_utils.h"
@@ -0,0 +1,534 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisEuclideanDistanceTransformTest.h"
+
+#include <QTest>
+
+#include <limits>
+#include <cmath>
+
+#include "kis_pixel_selection.h"
+#include "kis_selection_filters.h"
+#include "kis_global.h"
+
+#include "KisEuclideanDistanceTransform.h"
+
+namespace {
+
+QVector<quint8> generateFeatures(int width, int height, int density, quint32 seed)
+{
+    QVector<quint8> features(width * height);
+
+    for (int i = 0; i < features.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        features[i] = int((seed >> 16) % 100) < density;
+    }
+
+    return features;
+}
+
+QVector<quint8> generateSoftSelection(int width, int height, int density, quint32 seed)
+{
+    QVector<quint8> data = generateFeatures(width, height, density, seed);
+
+    for (int i = 0; i < data.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = data[i] ? quint8(1 + (seed >> 16) % MAX_SELECTED) : MIN_SELECTED;
+    }
+
+    return data;
+}
+
+/**
+ * The grow and shrink filters as they were implemented before the
+ * switch to the distance transform (ported from GIMP). The current
+ * filters must give exactly the same results. The only change is that
+ * the column buffer of the grow filter is zero-initialized: the old
+ * code read uninitialized memory at the right edge of the area when
+ * yRadius was bigger than xRadius.
+ */
+void computeBorder(qint32* circ, qint32 xradius, qint32 yradius)
+{
+    qint32 i;
+    qint32 diameter = xradius * 2 + 1;
+    double tmp;
+
+    for (i = 0; i < diameter; i++) {
+        if (i > xradius)
+            tmp = (i - xradius) - 0.5;
+        else if (i < xradius)
+            tmp = (xradius - i) - 0.5;
+        else
+            tmp = 0.0;
+
+        double divisor = (double) xradius;
+        if (divisor == 0.0) {
+            divisor = 1.0;
+        }
+        circ[i] = (qint32) floor(yradius * sqrt(xradius * xradius - tmp * tmp) / divisor + 0.5);
+    }
+}
+
+void rotatePointers(quint8** p, quint32 n)
+{
+    quint32 i;
+    quint8  *p0 = p[0];
+    for (i = 0; i < n - 1; i++) {
+        p[i] = p[i + 1];
+    }
+    p[i] = p0;
+}
+
+void baselineGrow(KisPixelSelectionSP pixelSelection, const QRect& rect, qint32 xRadius, qint32 yRadius)
+{
+    if (xRadius <= 0 || yRadius <= 0) return;
+
+    /**
+        * Much code resembles Shrink filter, so please fix bugs
+        * in both filters
+        */
+
+    quint8  **buf;  // caches the region's pixel data
+    quint8  **max;  // caches the largest values for each column
+
+    max = new quint8* [rect.width() + 2 * xRadius];
+    buf = new quint8* [yRadius + 1];
+    for (qint32 i = 0; i < yRadius + 1; i++) {
+        buf[i] = new quint8[rect.width()];
+    }
+    quint8* buffer = new quint8[(rect.width() + 2 * xRadius) *(yRadius + 1)]();
+    for (qint32 i = 0; i < rect.width() + 2 * xRadius; i++) {
+        if (i < xRadius)
+            max[i] = buffer;
+        else if (i < rect.width() + xRadius)
+            max[i] = &buffer[(yRadius + 1) * (i - xRadius)];
+        else
+            max[i] = &buffer[(yRadius + 1) * (rect.width() + xRadius - 1)];
+
+        for (qint32 j = 0; j < xRadius + 1; j++)
+            max[i][j] = 0;
+    }
+    /* offset the max pointer by xRadius so the range of the array
+        is [-xRadius] to [region->w + xRadius] */
+    max += xRadius;
+
+    quint8* out = new quint8[ rect.width()];  // holds the new scan line we are computing
+
+    qint32* circ = new qint32[ 2 * xRadius + 1 ]; // holds the y coords of the filter's mask
+    computeBorder(circ, xRadius, yRadius);
+
+    /* offset the circ pointer by xRadius so the range of the array
+        is [-xRadius] to [xRadius] */
+    circ += xRadius;
+
+    memset(buf[0], 0, rect.width());
+    for (qint32 i = 0; i < yRadius && i < rect.height(); i++) { // load top of image
+        pixelSelection->readBytes(buf[i + 1], rect.x(), rect.y() + i, rect.width(), 1);
+    }
+
+    for (qint32 x = 0; x < rect.width() ; x++) { // set up max for top of image
+        max[x][0] = 0;         // buf[0][x] is always 0
+        max[x][1] = buf[1][x]; // MAX (buf[1][x], max[x][0]) always = buf[1][x]
+        for (qint32 j = 2; j < yRadius + 1; j++) {
+            max[x][j] = qMax(buf[j][x], max[x][j-1]);
+        }
+    }
+
+    for (qint32 y = 0; y < rect.height(); y++) {
+        rotatePointers(buf, yRadius + 1);
+        if (y < rect.height() - (yRadius))
+            pixelSelection->readBytes(buf[yRadius], rect.x(), rect.y() + y + yRadius, rect.width(), 1);
+        else
+            memset(buf[yRadius], 0, rect.width());
+        for (qint32 x = 0; x < rect.width(); x++) { /* update max array */
+            for (qint32 i = yRadius; i > 0; i--) {
+                max[x][i] = qMax(qMax(max[x][i - 1], buf[i - 1][x]), buf[i][x]);
+            }
+            max[x][0] = buf[0][x];
+        }
+        qint32 last_max = max[0][circ[-1]];
+        qint32 last_index = 1;
+        for (qint32 x = 0; x < rect.width(); x++) { /* render scan line */
+            last_index--;
+            if (last_index >= 0) {
+                if (last_max == 255)
+                    out[x] = 255;
+                else {
+                    last_max = 0;
+                    for (qint32 i = xRadius; i >= 0; i--)
+                        if (last_max < max[x + i][circ[i]]) {
+                            last_max = max[x + i][circ[i]];
+                            last_index = i;
+                        }
+                    out[x] = last_max;
+                }
+            } else {
+                last_index = xRadius;
+                last_max = max[x + xRadius][circ[xRadius]];
+                for (qint32 i = xRadius - 1; i >= -xRadius; i--)
+                    if (last_max < max[x + i][circ[i]]) {
+                        last_max = max[x + i][circ[i]];
+                        last_index = i;
+                    }
+                out[x] = last_max;
+            }
+        }
+        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
+    }
+    /* undo the offsets to the pointers so we can free the malloced memory */
+    circ -= xRadius;
+    max -= xRadius;
+
+    delete[] circ;
+    delete[] buffer;
+    delete[] max;
+    for (qint32 i = 0; i < yRadius + 1; i++)
+        delete[] buf[i];
+    delete[] buf;
+    delete[] out;
+}
+
+void baselineShrink(KisPixelSelectionSP pixelSelection, const QRect& rect, qint32 xRadius, qint32 yRadius, bool edgeLock)
+{
+    if (xRadius <= 0 || yRadius <= 0) return;
+
+    /*
+        pretty much the same as fatten_region only different
+        blame all bugs in this function on jaycox@gimp.org
+    */
+    /* If edge_lock is true  we assume that pixels outside the region
+        we are passed are identical to the edge pixels.
+        If edge_lock is false, we assume that pixels outside the region are 0
+    */
+    quint8  **buf;  // caches the region's pixels
+    quint8  **max;  // caches the smallest values for each column
+    qint32    last_max, last_index;
+
+    max = new quint8* [rect.width() + 2 * xRadius];
+    buf = new quint8* [yRadius + 1];
+    for (qint32 i = 0; i < yRadius + 1; i++) {
+        buf[i] = new quint8[rect.width()];
+    }
+
+    qint32 buffer_size = (rect.width() + 2 * xRadius + 1) * (yRadius + 1);
+    quint8* buffer = new quint8[buffer_size];
+
+    if (edgeLock)
+        memset(buffer, 255, buffer_size);
+    else
+        memset(buffer, 0, buffer_size);
+
+    for (qint32 i = 0; i < rect.width() + 2 * xRadius; i++) {
+        if (i < xRadius)
+            if (edgeLock)
+                max[i] = buffer;
+            else
+                max[i] = &buffer[(yRadius + 1) * (rect.width() + xRadius)];
+        else if (i < rect.width() + xRadius)
+            max[i] = &buffer[(yRadius + 1) * (i - xRadius)];
+        else if (edgeLock)
+            max[i] = &buffer[(yRadius + 1) * (rect.width() + xRadius - 1)];
+        else
+            max[i] = &buffer[(yRadius + 1) * (rect.width() + xRadius)];
+    }
+    if (!edgeLock)
+        for (qint32 j = 0 ; j < xRadius + 1; j++) max[0][j] = 0;
+
+    // offset the max pointer by xRadius so the range of the array is [-xRadius] to [region->w + xRadius]
+    max += xRadius;
+
+    quint8* out = new quint8[rect.width()]; // holds the new scan line we are computing
+
+    qint32* circ = new qint32[2 * xRadius + 1]; // holds the y coords of the filter's mask
+
+    computeBorder(circ, xRadius, yRadius);
+
+    // offset the circ pointer by xRadius so the range of the array is [-xRadius] to [xRadius]
+    circ += xRadius;
+
+    for (qint32 i = 0; i < yRadius && i < rect.height(); i++) // load top of image
+        pixelSelection->readBytes(buf[i + 1], rect.x(), rect.y() + i, rect.width(), 1);
+
+    if (edgeLock)
+        memcpy(buf[0], buf[1], rect.width());
+    else
+        memset(buf[0], 0, rect.width());
+
+
+    for (qint32 x = 0; x < rect.width(); x++) { // set up max for top of image
+        max[x][0] = buf[0][x];
+        for (qint32 j = 1; j < yRadius + 1; j++)
+            max[x][j] = qMin(buf[j][x], max[x][j-1]);
+    }
+
+    for (qint32 y = 0; y < rect.height(); y++) {
+        rotatePointers(buf, yRadius + 1);
+        if (y < rect.height() - yRadius)
+            pixelSelection->readBytes(buf[yRadius], rect.x(), rect.y() + y + yRadius, rect.width(), 1);
+        else if (edgeLock)
+            memcpy(buf[yRadius], buf[yRadius - 1], rect.width());
+        else
+            memset(buf[yRadius], 0, rect.width());
+
+        for (qint32 x = 0 ; x < rect.width(); x++) { // update max array
+            for (qint32 i = yRadius; i > 0; i--) {
+                max[x][i] = qMin(qMin(max[x][i - 1], buf[i - 1][x]), buf[i][x]);
+            }
+            max[x][0] = buf[0][x];
+        }
+        last_max =  max[0][circ[-1]];
+        last_index = 0;
+
+        for (qint32 x = 0 ; x < rect.width(); x++) { // render scan line
+            last_index--;
+            if (last_index >= 0) {
+                if (last_max == 0)
+                    out[x] = 0;
+                else {
+                    last_max = 255;
+                    for (qint32 i = xRadius; i >= 0; i--)
+                        if (last_max > max[x + i][circ[i]]) {
+                            last_max = max[x + i][circ[i]];
+                            last_index = i;
+                        }
+                    out[x] = last_max;
+                }
+            } else {
+                last_index = xRadius;
+                last_max = max[x + xRadius][circ[xRadius]];
+                for (qint32 i = xRadius - 1; i >= -xRadius; i--)
+                    if (last_max > max[x + i][circ[i]]) {
+                        last_max = max[x + i][circ[i]];
+                        last_index = i;
+                    }
+                out[x] = last_max;
+            }
+        }
+        pixelSelection->writeBytes(out, rect.x(), rect.y() + y, rect.width(), 1);
+    }
+
+    // undo the offsets to the pointers so we can free the malloced memory
+    circ -= xRadius;
+    max -= xRadius;
+
+    delete[] circ;
+    delete[] buffer;
+    delete[] max;
+    for (qint32 i = 0; i < yRadius + 1; i++)
+        delete[] buf[i];
+    delete[] buf;
+    delete[] out;
+}
+
+KisPixelSelectionSP createSelection(const QVector<quint8> &data, const QRect &rc)
+{
+    KisPixelSelectionSP selection = new KisPixelSelection();
+    selection->writeBytes(data.constData(), rc);
+    return selection;
+}
+
+QVector<quint8> growWithBaseline(const QVector<quint8> &data, const QRect &rc,
+                                 int xRadius, int yRadius)
+{
+    KisPixelSelectionSP selection = createSelection(data, rc);
+    baselineGrow(selection, rc, xRadius, yRadius);
+
+    QVector<quint8> result(data.size());
+    selection->readBytes(result.data(), rc);
+    return result;
+}
+
+QVector<quint8> shrinkWithBaseline(const QVector<quint8> &data, const QRect &rc,
+                                   int xRadius, int yRadius, bool edgeLock)
+{
+    KisPixelSelectionSP selection = createSelection(data, rc);
+    baselineShrink(selection, rc, xRadius, yRadius, edgeLock);
+
+    QVector<quint8> result(data.size());
+    selection->readBytes(result.data(), rc);
+    return result;
+}
+
+}
+
+void KisEuclideanDistanceTransformTest::testNearestFeature()
+{
+    const int width = 73;
+    const int height = 41;
+
+    const QVector<quint8> features = generateFeatures(width, height, 2, 17);
+
+    KisEuclideanDistanceTransform edt(width, height, 1.0, 0.3);
+    QVERIFY(edt.compute(features.constData()));
+
+    int numFailures = 0;
+
+    edt.processRows(
+        [&] (int y, const qint32 *nearestX, const qint32 *nearestY) {
+            for (int x = 0; x < width; x++) {
+                qreal bestDistance = std::numeric_limits<qreal>::max();
+
+                for (int j = 0; j < height; j++) {
+                    for (int i = 0; i < width; i++) {
+                        if (!features[j * width + i]) continue;
+                        bestDistance = qMin(bestDistance, edt.distanceSquared(x, y, i, j));
+                    }
+                }
+
+                if (!features[nearestY[x] * width + nearestX[x]] ||
+                    !qFuzzyCompare(edt.distanceSquared(x, y, nearestX[x], nearestY[x]) + 1.0,
+                                   bestDistance + 1.0)) {
+
+                    numFailures++;
+                }
+            }
+        });
+
+    QCOMPARE(numFailures, 0);
+}
+
+void KisEuclideanDistanceTransformTest::testEmptyArea()
+{
+    const QVector<quint8> features(16 * 16, 0);
+
+    KisEuclideanDistanceTransform edt(16, 16);
+    QVERIFY(!edt.compute(features.constData()));
+}
+
+void KisEuclideanDistanceTransformTest::testGrowBinarySelection()
+{
+    const QRect rc(0, 0, 97, 65);
+    QVector<quint8> data = generateFeatures(rc.width(), rc.height(), 1, 3);
+
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = data[i] ? MAX_SELECTED : MIN_SELECTED;
+    }
+
+    for (const QSize &radius : {QSize(7, 4), QSize(3, 3), QSize(2, 9)}) {
+        KisPixelSelectionSP selection = createSelection(data, rc);
+
+        KisGrowSelectionFilter filter(radius.width(), radius.height());
+        filter.process(selection, rc);
+
+        QVector<quint8> result(data.size());
+        selection->readBytes(result.data(), rc);
+
+        QCOMPARE(result, growWithBaseline(data, rc, radius.width(), radius.height()));
+    }
+}
+
+void KisEuclideanDistanceTransformTest::testShrinkBinarySelection()
+{
+    const QRect rc(0, 0, 97, 65);
+    QVector<quint8> data = generateFeatures(rc.width(), rc.height(), 1, 5);
+
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = data[i] ? MIN_SELECTED : MAX_SELECTED;
+    }
+
+    for (bool edgeLock : {false, true}) {
+        KisPixelSelectionSP selection = createSelection(data, rc);
+
+        KisShrinkSelectionFilter filter(5, 9, edgeLock);
+        filter.process(selection, rc);
+
+        QVector<quint8> result(data.size());
+        selection->readBytes(result.data(), rc);
+
+        QCOMPARE(result, shrinkWithBaseline(data, rc, 5, 9, edgeLock));
+    }
+}
+
+void KisEuclideanDistanceTransformTest::testGrowSoftSelection()
+{
+    const QRect rc(0, 0, 97, 65);
+    const QVector<quint8> data = generateSoftSelection(rc.width(), rc.height(), 3, 7);
+
+    KisPixelSelectionSP selection = createSelection(data, rc);
+
+    KisGrowSelectionFilter filter(6, 3);
+    filter.process(selection, rc);
+
+    QVector<quint8> result(data.size());
+    selection->readBytes(result.data(), rc);
+
+    QCOMPARE(result, growWithBaseline(data, rc, 6, 3));
+}
+
+void KisEuclideanDistanceTransformTest::testShrinkSoftSelection()
+{
+    const QRect rc(0, 0, 97, 65);
+    const QVector<quint8> data = generateSoftSelection(rc.width(), rc.height(), 90, 11);
+
+    for (bool edgeLock : {false, true}) {
+        KisPixelSelectionSP selection = createSelection(data, rc);
+
+        KisShrinkSelectionFilter filter(4, 7, edgeLock);
+        filter.process(selection, rc);
+
+        QVector<quint8> result(data.size());
+        selection->readBytes(result.data(), rc);
+
+        QCOMPARE(result, shrinkWithBaseline(data, rc, 4, 7, edgeLock));
+    }
+}
+
+void KisEuclideanDistanceTransformTest::testGrowShrinkMultipleTiles()
+{
+    /**
+     * The filters process big areas in tiles, check that the tiles
+     * see the pixels of their neighbours
+     */
+    const QRect rc(-37, 15, 611, 389);
+
+    QVector<quint8> binaryData = generateFeatures(rc.width(), rc.height(), 1, 13);
+    for (int i = 0; i < binaryData.size(); i++) {
+        binaryData[i] = binaryData[i] ? MAX_SELECTED : MIN_SELECTED;
+    }
+
+    const QVector<quint8> softData = generateSoftSelection(rc.width(), rc.height(), 60, 19);
+
+    for (const QVector<quint8> &data : {binaryData, softData}) {
+        {
+            KisPixelSelectionSP selection = createSelection(data, rc);
+
+            KisGrowSelectionFilter filter(40, 25);
+            filter.process(selection, rc);
+
+            QVector<quint8> result(data.size());
+            selection->readBytes(result.data(), rc);
+
+            QCOMPARE(result, growWithBaseline(data, rc, 40, 25));
+        }
+
+        {
+            KisPixelSelectionSP selection = createSelection(data, rc);
+
+            KisShrinkSelectionFilter filter(3, 150, false);
+            filter.process(selection, rc);
+
+            QVector<quint8> result(data.size());
+            selection->readBytes(result.data(), rc);
+
+            QCOMPARE(result, shrinkWithBaseline(data, rc, 3, 150, false));
+        }
+    }
+}
+
+QTEST_MAIN(KisEuclideanDistanceTransformTest)
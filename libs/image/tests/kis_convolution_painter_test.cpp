@@ -23,6 +23,7 @@
 
 #include <QBitArray>
 #include <QElapsedTimer>
+#include <QtConcurrent>
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
@@ -438,6 +439,114 @@ void KisConvolutionPainterTest::testGaussianDetailsFFTW()
     testGaussianDetails(true);
 }
 
+void KisConvolutionPainterTest::testGaussianRecursive()
+{
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    const QRect applyRect = dev->exactBounds();
+    const QBitArray channelFlags = dev->colorSpace()->channelFlags(true, true);
+
+    for (qreal radius = 10; radius <= 40; radius *= 2) {
+        // reference: two spatial passes over the same kernels
+        KisPaintDeviceSP spatialDev = new KisPaintDevice(*dev);
+        KisPaintDeviceSP interm = new KisPaintDevice(dev->colorSpace());
+
+        KisConvolutionKernelSP kernelHoriz = KisGaussianKernel::createHorizontalKernel(radius);
+        KisConvolutionKernelSP kernelVertical = KisGaussianKernel::createVerticalKernel(radius);
+        const int verticalMargin = kernelVertical->height() / 2 + 1;
+
+        KisConvolutionPainter horizPainter(interm, KisConvolutionPainter::SPATIAL);
+        horizPainter.setChannelFlags(channelFlags);
+        horizPainter.applyMatrix(kernelHoriz, dev,
+                                 applyRect.topLeft() - QPoint(0, verticalMargin),
+                                 applyRect.topLeft() - QPoint(0, verticalMargin),
+                                 applyRect.size() + QSize(0, 2 * verticalMargin),
+                                 BORDER_REPEAT);
+
+        KisConvolutionPainter verticalPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+        verticalPainter.setChannelFlags(channelFlags);
+        verticalPainter.applyMatrix(kernelVertical, interm,
+                                    applyRect.topLeft(), applyRect.topLeft(),
+                                    applyRect.size(), BORDER_REPEAT);
+
+        KisPaintDeviceSP recursiveDev = new KisPaintDevice(*dev);
+        const qreal sigma = KisGaussianKernel::sigmaFromRadius(radius);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        KisConvolutionPainter painter(recursiveDev);
+        painter.setChannelFlags(channelFlags);
+        painter.applyGaussian(recursiveDev, applyRect.topLeft(), applyRect.topLeft(),
+                              applyRect.size(), sigma, sigma, BORDER_REPEAT);
+
+        dbgKrita << "Radius:" << radius << "recursive gaussian:" << timer.elapsed() << "ms";
+
+        QPoint pt;
+        const QImage spatialImage = spatialDev->convertToQImage(0, applyRect);
+        const QImage recursiveImage = recursiveDev->convertToQImage(0, applyRect);
+
+        if (!TestUtil::compareQImages(pt, spatialImage, recursiveImage, 4, 4)) {
+            QFAIL(QString("Recursive gaussian differs from the spatial one, radius %1, point %2,%3")
+                  .arg(radius).arg(pt.x()).arg(pt.y()).toLatin1());
+        }
+    }
+}
+
+void KisConvolutionPainterTest::testFFTWConcurrent()
+{
+    if (!KisConvolutionPainter::supportsFFTW()) {
+        QSKIP("FFTW is not available");
+    }
+
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    const QRect applyRect = dev->exactBounds();
+
+    struct Job {
+        qreal radius;
+        KisPaintDeviceSP serialDev;
+        KisPaintDeviceSP concurrentDev;
+    };
+
+    auto applyKernel = [applyRect] (KisPaintDeviceSP dst, KisPaintDeviceSP src, qreal radius) {
+        KisConvolutionKernelSP kernel = KisGaussianKernel::createUniform2DKernel(radius, radius);
+        KisConvolutionPainter painter(dst, KisConvolutionPainter::FFTW);
+        painter.applyMatrix(kernel, src, applyRect.topLeft(), applyRect.topLeft(), applyRect.size());
+    };
+
+    // every size is used twice to make the jobs share the cached plans
+    QVector<Job> jobs;
+    for (int i = 0; i < 8; i++) {
+        Job job;
+        job.radius = 3 + 2 * (i / 2);
+        job.serialDev = new KisPaintDevice(dev->colorSpace());
+        job.concurrentDev = new KisPaintDevice(dev->colorSpace());
+        jobs << job;
+    }
+
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        applyKernel(it->serialDev, dev, it->radius);
+    }
+
+    QtConcurrent::blockingMap(jobs,
+        [dev, applyKernel] (Job &job) {
+            applyKernel(job.concurrentDev, dev, job.radius);
+        });
+
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        QPoint pt;
+        if (!TestUtil::comparePaintDevices(pt, it->serialDev, it->concurrentDev)) {
+            QFAIL(QString("Concurrent FFTW convolution differs, radius %1, point %2,%3")
+                  .arg(it->radius).arg(pt.x()).arg(pt.y()).toLatin1());
+        }
+    }
+}
+
 #include "kis_transaction.h"
 
 void KisConvolutionPainterTest::testDilate()
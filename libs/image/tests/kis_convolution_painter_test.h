@@ -57,6 +57,10 @@ private Q_SLOTS:
     void testGaussianDetailsSpatial();
     void testGaussianDetailsFFTW();
 
+    void testGaussianRecursive();
+
+    void testFFTWConcurrent();
+
     void testDilate();
     void testErode();
 };
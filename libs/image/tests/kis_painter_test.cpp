@@ -38,6 +38,7 @@
 #include <kis_fixed_paint_device.h>
 #include "testutil.h"
 #include <kis_iterator_ng.h>
+#include "kis_sequential_iterator.h"
 
 void KisPainterTest::allCsApplicator(void (KisPainterTest::* funcPtr)(const KoColorSpace*cs))
 {
@@ -346,6 +347,23 @@ void KisPainterTest::testSelectionBitBltFixedSelection()
     painter.end();
 
     QCOMPARE(dst->exactBounds(), QRect(5, 5, 10, 10));
+
+    /**
+     * The source rect starts outside the source device, so it gets
+     * cropped, and the selection should be shifted together with it
+     */
+    KisFixedPaintDeviceSP offsetSelection = new KisFixedPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    offsetSelection->setRect(QRect(0, 0, 30, 30));
+    offsetSelection->initialize();
+    quint8 selected = MAX_SELECTED;
+    offsetSelection->fill(5, 5, 10, 10, &selected);
+
+    dst->clear();
+    painter.begin(dst);
+    painter.bitBltWithFixedSelection(0, 0, src, offsetSelection, 0, 0, -10, -10, 30, 30);
+    painter.end();
+
+    QCOMPARE(dst->exactBounds(), QRect(10, 10, 5, 5));
     /*
 dbgKrita << "canary1.5";
     dst->clear();
@@ -480,6 +498,134 @@ void KisPainterTest::testBitBltOldData()
     srcGc.deleteTransaction();
 }
 
+namespace {
+
+KisPaintDeviceSP createUniformChunksDestination(const KoColorSpace *cs)
+{
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    KoColor color(Qt::blue, cs);
+    color.setOpacity(quint8(200));
+    dev->fill(QRect(0, 0, 320, 256), color);
+
+    // a part of the tiles is not uniform
+    quint32 seed = 1;
+    KisSequentialIterator it(dev, QRect(128, 64, 100, 150));
+    while (it.nextPixel()) {
+        for (int i = 0; i < cs->pixelSize(); i++) {
+            seed = seed * 1103515245 + 12345;
+            it.rawData()[i] = quint8(seed >> 16);
+        }
+    }
+
+    return dev;
+}
+
+void checkUniformChunksBitBlt(KisPaintDeviceSP src, const QRect &srcRect, const QPoint &dstPos,
+                              const QString &compositeOpId, quint8 opacity,
+                              KisSelectionSP selection)
+{
+    const KoColorSpace *cs = src->colorSpace();
+
+    KisPaintDeviceSP dst = createUniformChunksDestination(cs);
+    KisPaintDeviceSP referenceDst = createUniformChunksDestination(cs);
+
+    {
+        KisPainter painter(dst);
+        painter.setCompositeOp(compositeOpId);
+        painter.setOpacity(opacity);
+        painter.setSelection(selection);
+        painter.bitBlt(dstPos, src, srcRect);
+        painter.end();
+    }
+
+    {
+        // the uniform chunks are never used when blitting the old data
+        KisPainter srcPainter(src);
+        srcPainter.beginTransaction();
+
+        KisPainter painter(referenceDst);
+        painter.setCompositeOp(compositeOpId);
+        painter.setOpacity(opacity);
+        painter.setSelection(selection);
+        painter.bitBltOldData(dstPos, src, srcRect);
+        painter.end();
+
+        srcPainter.deleteTransaction();
+    }
+
+    const QRect checkRect = dst->extent() | referenceDst->extent();
+
+    QVector<quint8> result(checkRect.width() * checkRect.height() * cs->pixelSize());
+    QVector<quint8> expected(result.size());
+
+    dst->readBytes(result.data(), checkRect);
+    referenceDst->readBytes(expected.data(), checkRect);
+
+    if (result != expected) {
+        qWarning() << "Uniform chunks failed:"
+                   << ppVar(srcRect) << ppVar(dstPos) << ppVar(compositeOpId)
+                   << ppVar(opacity) << ppVar(selection.isNull());
+    }
+
+    QVERIFY(result == expected);
+}
+
+}
+
+void KisPainterTest::testBitBltUniformChunks()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // uniform tiles
+    KisPaintDeviceSP uniformSrc = new KisPaintDevice(cs);
+    KoColor color(Qt::red, cs);
+    color.setOpacity(quint8(180));
+    uniformSrc->fill(QRect(0, 0, 320, 256), color);
+
+    // the tiles between the filled corners are default ones
+    KisPaintDeviceSP defaultPixelSrc = new KisPaintDevice(cs);
+    KoColor defaultColor(Qt::green, cs);
+    defaultColor.setOpacity(quint8(120));
+    defaultPixelSrc->setDefaultPixel(defaultColor);
+    defaultPixelSrc->fill(QRect(0, 0, 10, 10), color);
+    defaultPixelSrc->fill(QRect(300, 240, 10, 10), color);
+
+    KisPaintDeviceSP transparentSrc = new KisPaintDevice(cs);
+    transparentSrc->fill(QRect(0, 0, 10, 10), color);
+    transparentSrc->fill(QRect(300, 240, 10, 10), color);
+
+    // whole tiles partially selected, a partial tile and deselected tiles
+    KisSelectionSP selection = new KisSelection();
+    selection->pixelSelection()->select(QRect(64, 0, 192, 256), 200);
+    selection->pixelSelection()->select(QRect(20, 30, 30, 40), MAX_SELECTED);
+    selection->updateProjection();
+
+    const QVector<KisPaintDeviceSP> sources({uniformSrc, defaultPixelSrc, transparentSrc});
+    const QVector<KisSelectionSP> selections({KisSelectionSP(), selection});
+    const QStringList compositeOps({COMPOSITE_OVER, COMPOSITE_MULT, COMPOSITE_COPY});
+    const QVector<quint8> opacities({OPACITY_OPAQUE_U8, 128});
+
+    // tile-aligned and unaligned rects
+    const QVector<QPair<QRect, QPoint>> rects({
+        qMakePair(QRect(0, 0, 256, 192), QPoint(0, 0)),
+        qMakePair(QRect(10, 17, 230, 150), QPoint(37, 5))
+    });
+
+    Q_FOREACH (KisPaintDeviceSP src, sources) {
+        Q_FOREACH (KisSelectionSP sel, selections) {
+            Q_FOREACH (const QString &compositeOpId, compositeOps) {
+                Q_FOREACH (quint8 opacity, opacities) {
+                    for (auto it = rects.begin(); it != rects.end(); ++it) {
+                        checkUniformChunksBitBlt(src, it->first, it->second,
+                                                 compositeOpId, opacity, sel);
+                    }
+                }
+            }
+        }
+    }
+}
+
 #include "kis_paint_device_debug_utils.h"
 #include "KisRenderedDab.h"
 
@@ -30,6 +30,10 @@
 #include <KoColorSpaceRegistry.h>
 #include "kis_types.h"
 #include "kis_paint_device.h"
+#include "kis_pixel_selection.h"
+#include "kis_painter.h"
+
+#include <numeric>
 
 
 void KisScanlineFillTest::testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
@@ -295,4 +299,113 @@ void KisScanlineFillTest::testExternalFill()
     QCOMPARE(c, QColor(Qt::blue));
 }
 
+/**
+ * Creates a device with a noise of several colors, so that the
+ * contiguous areas have complicated shapes and cross the tile borders
+ * many times
+ */
+inline KisPaintDeviceSP createNoiseDevice(const QRect &rc, const QVector<QColor> &colors, const QVector<int> &weights)
+{
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    const int totalWeight = std::accumulate(weights.begin(), weights.end(), 0);
+    quint32 seed = 12345;
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        for (int x = rc.left(); x <= rc.right(); x++) {
+            seed = seed * 1103515245 + 12345;
+            int value = (seed >> 16) % totalWeight;
+
+            int i = 0;
+            while (value >= weights[i]) {
+                value -= weights[i];
+                i++;
+            }
+
+            dev->setPixel(x, y, colors[i]);
+        }
+    }
+
+    return dev;
+}
+
+void KisScanlineFillTest::testParallelFillColor()
+{
+    const QRect boundingRect(-37, -21, 300, 200);
+    KisPaintDeviceSP dev = createNoiseDevice(boundingRect,
+                                             {Qt::red, Qt::green, QColor(250, 0, 0)},
+                                             {12, 7, 1});
+
+    const KoColor fillColor(Qt::blue, dev->colorSpace());
+
+    for (int threshold : {1, 20}) {
+        KisPaintDeviceSP sequentialDev = new KisPaintDevice(*dev);
+        KisPaintDeviceSP parallelDev = new KisPaintDevice(*dev);
+
+        KisScanlineFill sequentialFill(sequentialDev, QPoint(100, 100), boundingRect);
+        sequentialFill.setThreshold(threshold);
+        sequentialFill.setUseParallelFill(false);
+        sequentialFill.fillColor(fillColor);
+
+        KisScanlineFill parallelFill(parallelDev, QPoint(100, 100), boundingRect);
+        parallelFill.setThreshold(threshold);
+        parallelFill.fillColor(fillColor);
+
+        QPoint errorPoint;
+        QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequentialDev, parallelDev));
+    }
+}
+
+void KisScanlineFillTest::testParallelFillSelection()
+{
+    const QRect boundingRect(-37, -21, 300, 200);
+    KisPaintDeviceSP dev = createNoiseDevice(boundingRect,
+                                             {Qt::red, Qt::green, QColor(220, 30, 0)},
+                                             {12, 7, 3});
+
+    KisPixelSelectionSP sequentialSelection = new KisPixelSelection();
+    KisPixelSelectionSP parallelSelection = new KisPixelSelection();
+
+    KisScanlineFill sequentialFill(dev, QPoint(100, 100), boundingRect);
+    sequentialFill.setThreshold(50);
+    sequentialFill.setUseParallelFill(false);
+    sequentialFill.fillSelection(sequentialSelection);
+
+    KisScanlineFill parallelFill(dev, QPoint(100, 100), boundingRect);
+    parallelFill.setThreshold(50);
+    parallelFill.fillSelection(parallelSelection);
+
+    QVERIFY(!parallelSelection->exactBounds().isEmpty());
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequentialSelection, parallelSelection));
+}
+
+void KisScanlineFillTest::testParallelFillContiguousGroup()
+{
+    const QRect boundingRect(0, 0, 300, 200);
+    KisPaintDeviceSP dev = createNoiseDevice(boundingRect,
+                                             {Qt::white, Qt::black},
+                                             {3, 2});
+
+    KisPaintDeviceSP scribble = KisPainter::convertToAlphaAsGray(dev);
+
+    KisPaintDeviceSP sequentialScribble = new KisPaintDevice(*scribble);
+    KisPaintDeviceSP parallelScribble = new KisPaintDevice(*scribble);
+
+    KisPaintDeviceSP sequentialGroupMap = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    KisPaintDeviceSP parallelGroupMap = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    KisScanlineFill sequentialFill(sequentialScribble, QPoint(150, 100), boundingRect);
+    sequentialFill.setUseParallelFill(false);
+    sequentialFill.fillContiguousGroup(sequentialGroupMap, 7);
+
+    KisScanlineFill parallelFill(parallelScribble, QPoint(150, 100), boundingRect);
+    parallelFill.fillContiguousGroup(parallelGroupMap, 7);
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequentialScribble, parallelScribble));
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequentialGroupMap, parallelGroupMap));
+}
+
 QTEST_MAIN(KisScanlineFillTest)
@@ -39,6 +39,10 @@ private Q_SLOTS:
     void testClearNonZeroComponent();
     void testExternalFill();
 
+    void testParallelFillColor();
+    void testParallelFillSelection();
+    void testParallelFillContiguousGroup();
+
 private:
     void testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
                          const QVector<QColor> &expectedResult,
@@ -190,4 +190,32 @@ void KisStrokeTest::testCancelStrokeCase6()
     stroke.clearQueueOnCancel();
 }
 
+void KisStrokeTest::testCancelNotifiesRunningJob()
+{
+    struct Strategy : public KisTestingStrokeStrategy
+    {
+        void tryCancelCurrentStrokeJobAsync() override {
+            numCancelRequests++;
+        }
+
+        int numCancelRequests = 0;
+    };
+
+    Strategy *strategy = new Strategy();
+    KisStroke stroke(strategy);
+
+    stroke.addJob(0);
+    delete stroke.popOneJob(); // init
+    delete stroke.popOneJob(); // dab, still running
+
+    stroke.cancelStroke();
+    QCOMPARE(strategy->numCancelRequests, 1);
+
+    // cancelling twice does nothing
+    stroke.cancelStroke();
+    QCOMPARE(strategy->numCancelRequests, 1);
+
+    delete stroke.popOneJob(); // cancel
+}
+
 QTEST_MAIN(KisStrokeTest)
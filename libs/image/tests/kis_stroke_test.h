@@ -33,6 +33,7 @@ private Q_SLOTS:
     void testCancelStrokeCase5();
     void testCancelStrokeCase4();
     void testCancelStrokeCase6();
+    void testCancelNotifiesRunningJob();
 };
 
 #endif /* __KIS_STROKE_TEST_H */
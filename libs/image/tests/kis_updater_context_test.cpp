@@ -27,6 +27,7 @@
 
 #include "kis_merge_walker.h"
 #include "kis_updater_context.h"
+#include "kis_update_job_executor.h"
 #include "kis_image.h"
 
 #include "scheduler_utils.h"
@@ -245,5 +246,83 @@ void KisUpdaterContextTest::stressTestExclusiveJobs()
              << "/" << NUM_CHECKS * NUM_JOBS;
 }
 
+class SpawningRunnable : public QRunnable
+{
+public:
+    SpawningRunnable(KisUpdateJobExecutor &executor, int numChildren,
+                     QAtomicInt &counter, QMutex &threadsLock, QSet<Qt::HANDLE> &threads)
+        : m_executor(executor),
+          m_numChildren(numChildren),
+          m_counter(counter),
+          m_threadsLock(threadsLock),
+          m_threads(threads)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override {
+        {
+            QMutexLocker l(&m_threadsLock);
+            m_threads.insert(QThread::currentThreadId());
+        }
+
+        for (int i = 0; i < m_numChildren; i++) {
+            SpawningRunnable *child =
+                new SpawningRunnable(m_executor, 0, m_counter, m_threadsLock, m_threads);
+            m_children.append(child);
+
+            // goes to the deque of the current worker
+            m_executor.start(child);
+        }
+
+        // keep the spawning thread busy, the children should be stolen
+        QTest::qSleep(CHECK_DELAY);
+        m_counter.ref();
+    }
+
+    ~SpawningRunnable() override {
+        qDeleteAll(m_children);
+    }
+
+private:
+    KisUpdateJobExecutor &m_executor;
+    int m_numChildren;
+    QAtomicInt &m_counter;
+    QMutex &m_threadsLock;
+    QSet<Qt::HANDLE> &m_threads;
+    QVector<SpawningRunnable*> m_children;
+};
+
+void KisUpdaterContextTest::testExecutorWorkStealing()
+{
+    const int numChildren = 100;
+
+    KisUpdateJobExecutor executor;
+    executor.setThreadCount(4);
+    QCOMPARE(executor.threadCount(), 4);
+
+    QAtomicInt counter;
+    QMutex threadsLock;
+    QSet<Qt::HANDLE> threads;
+
+    SpawningRunnable root(executor, numChildren, counter, threadsLock, threads);
+    executor.start(&root);
+    executor.waitForDone();
+
+    QCOMPARE(int(counter), numChildren + 1);
+
+    // the children have been stolen by the other workers
+    QVERIFY(threads.size() > 1);
+
+    // the executor can be reused after resizing
+    executor.setThreadCount(2);
+
+    SpawningRunnable root2(executor, 10, counter, threadsLock, threads);
+    executor.start(&root2);
+    executor.waitForDone();
+
+    QCOMPARE(int(counter), numChildren + 1 + 11);
+}
+
 QTEST_MAIN(KisUpdaterContextTest)
 
@@ -24,6 +24,7 @@
 #include "kis_warptransform_worker.h"
 
 #include <KoProgressUpdater.h>
+#include <qmath.h>
 
 struct WarpTransforWorkerData {
 
@@ -295,6 +296,39 @@ void KisWarpTransformWorkerTest::testGridSize()
     QCOMPARE(GridIterationTools::calcGridDimension(-1, 9, 4), 5);
 
     QCOMPARE(GridIterationTools::calcGridDimension(0, 300, 8), 39);
+
+    QCOMPARE(GridIterationTools::Private::calcGridLines(1, 9, 4), QVector<int>({1, 4, 8, 9}));
+    QCOMPARE(GridIterationTools::Private::calcGridLines(0, 300, 8).size(), 39);
+}
+
+struct FoldingTransformOp
+{
+    QPointF operator() (const QPointF &pt) const {
+        // folds the image horizontally, so that the cells overlap
+        return QPointF(pt.x() + 80.0 * qSin(pt.y() / 40.0), 0.7 * pt.y() + 0.2 * pt.x());
+    }
+};
+
+void KisWarpTransformWorkerTest::testGridInPatches()
+{
+    WarpTransforWorkerData d;
+
+    const QRect srcBounds = d.dev->exactBounds();
+    const int pixelPrecision = 8;
+    FoldingTransformOp transformOp;
+
+    KisPaintDeviceSP sequentialDev = new KisPaintDevice(d.dev->colorSpace());
+    GridIterationTools::PaintDevicePolygonOp sequentialOp(d.dev, sequentialDev);
+    GridIterationTools::processGrid(sequentialOp, transformOp, srcBounds, pixelPrecision);
+
+    KisPaintDeviceSP parallelDev = new KisPaintDevice(d.dev->colorSpace());
+    GridIterationTools::PaintDevicePolygonOp parallelOp(d.dev, parallelDev);
+    GridIterationTools::processGridInPatches(parallelOp, transformOp, srcBounds, pixelPrecision);
+
+    QCOMPARE(parallelDev->exactBounds(), sequentialDev->exactBounds());
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequentialDev, parallelDev));
 }
 
 void KisWarpTransformWorkerTest::testBackwardInterpolatorExtrapolation()
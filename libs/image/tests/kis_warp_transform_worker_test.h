@@ -33,6 +33,7 @@ private Q_SLOTS:
     void testBackwardInterpolatorXYShear();
     void testBackwardInterpolatorRoundTrip();
     void testGridSize();
+    void testGridInPatches();
     void testBackwardInterpolatorExtrapolation();
 
     void testNeedChangeRects();
@@ -19,7 +19,7 @@
 #include "kis_hline_iterator.h"
 
 
-KisHLineIterator2::KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *competionListener)
+KisHLineIterator2::KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *competionListener, qint32 h)
     : KisBaseIterator(dataManager, writable, competionListener),
       m_offsetX(offsetX),
       m_offsetY(offsetY)
@@ -50,6 +50,8 @@ KisHLineIterator2::KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint
     m_row = yToRow(m_y);
     m_yInTile = calcYInTile(m_y, m_row);
 
+    m_lastPrefetchRow = yToRow(m_top + qMax(1, h) - 1);
+
     m_leftInLeftmostTile = m_left - m_leftCol * KisTileData::WIDTH;
 
     m_tilesCacheSize = m_rightCol - m_leftCol + 1;
@@ -118,6 +120,16 @@ void KisHLineIterator2::nextRow()
     } else {
         ++m_row;
         m_yInTile = 0;
+
+        /**
+         * We are walking down, so ask the store to load the next
+         * row of tiles while we are processing the current one. The
+         * rows below the iterated area would be loaded for nothing.
+         */
+        if (m_row < m_lastPrefetchRow) {
+            m_dataManager->prefetchTiles(m_leftCol, m_row + 1, m_rightCol, m_row + 1);
+        }
+
         preallocateTiles();
     }
     m_index = 0;
@@ -37,7 +37,13 @@ public:
 
 
 public:    
-    KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *listener);
+    /**
+     * \p h is the number of rows the caller is going to walk through
+     * with nextRow(). It doesn't limit the iteration itself, it only
+     * tells the iterator which rows of swapped tiles are worth
+     * prefetching. With the default value nothing is prefetched.
+     */
+    KisHLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 w, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *listener, qint32 h = 1);
     ~KisHLineIterator2() override;
     
     bool nextPixel() override;
@@ -71,6 +77,7 @@ private:
     qint32 m_top;
     qint32 m_leftCol;
     qint32 m_rightCol;
+    qint32 m_lastPrefetchRow;
 
     qint32 m_rightmostInTile; // limited by the current tile border only
 
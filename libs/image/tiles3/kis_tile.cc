@@ -227,7 +227,11 @@ void KisTile::lockForRead() const
 }
 
 
-#define lazyCopying() (m_tileData->m_usersCount>1)
+/**
+ * The memory of a deduplicated tile data may be used by other
+ * tile datas as well, so it should be copied before writing
+ */
+#define lazyCopying() (m_tileData->m_usersCount>1 || m_tileData->isDataShared())
 
 void KisTile::lockForWrite()
 {
@@ -269,11 +273,20 @@ void KisTile::lockForWrite()
 #endif
     }
 
+    /**
+     * The data is going to be changed, so the cached uniformity is
+     * not valid anymore. Readers may still check it while we are
+     * writing, so the tile data should not cache anything until
+     * unlockForWrite() is called.
+     */
+    m_tileData->beginWriteAccess();
+
     DEBUG_LOG_ACTION("lock [W]");
 }
 
 void KisTile::unlockForWrite()
 {
+    m_tileData->endWriteAccess();
     unblockSwapping();
     DEBUG_LOG_ACTION("unlock [W]");
 
@@ -283,6 +296,16 @@ void KisTile::unlockForWrite()
 #endif
 }
 
+void KisTile::prefetchTileData()
+{
+    /**
+     * m_tileData can be replaced only under m_COWMutex, so
+     * holding it guarantees the tile data is still alive
+     */
+    QMutexLocker locker(&m_COWMutex);
+    m_tileData->m_store->prefetchTileData(m_tileData);
+}
+
 void KisTile::unlockForRead() const
 {
     unblockSwapping();
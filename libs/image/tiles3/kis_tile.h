@@ -92,6 +92,12 @@ public:
     void unlockForWrite();
     void unlockForRead() const;
 
+    /**
+     * Asks the tile data store to load the data of the tile from the
+     * swap in a background thread. Doesn't lock the tile.
+     */
+    void prefetchTileData();
+
 
     /* this allows us work directly on tile's data */
     inline quint8 *data() const {
@@ -20,18 +20,173 @@
 
 #include "kis_tile_data.h"
 #include "kis_tile_data_store.h"
+#include "swap/kis_lazy_tile_source.h"
 
 #include <kis_debug.h>
 
+#include <atomic>
+#include <new>
 #include <boost/pool/singleton_pool.hpp>
 #include "kis_tile_data_store_iterators.h"
 
-// BPP == bytes per pixel
-#define TILE_SIZE_4BPP (4 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
-#define TILE_SIZE_8BPP (8 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
+/**
+ * A user allocator for boost pools that keeps track of the memory
+ * the pools have actually requested from the system. The size of the
+ * block is stored in front of it, because boost doesn't pass it to
+ * free().
+ */
+struct KisTileDataPoolAllocator
+{
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    static const size_type headerSize = 16; // keeps the alignment of SSE data
+
+    static char* malloc(const size_type bytes) {
+        char *ptr = new (std::nothrow) char[bytes + headerSize];
+        if (!ptr) return 0;
+
+        *reinterpret_cast<size_type*>(ptr) = bytes;
+        s_reservedMemory += bytes;
+
+        return ptr + headerSize;
+    }
+
+    static void free(char * const block) {
+        char *ptr = block - headerSize;
+
+        s_reservedMemory -= *reinterpret_cast<size_type*>(ptr);
+        delete[] ptr;
+    }
+
+    static std::atomic<qint64> s_reservedMemory;
+};
+
+std::atomic<qint64> KisTileDataPoolAllocator::s_reservedMemory(0);
+
+/**
+ * Every pool requests about 4 MiB from the system at once and the
+ * requests grow up to 64 MiB. For 4 and 8 bytes per pixel it gives
+ * the same values that were used before the pools were generalized.
+ */
+template <int pixelSize>
+struct KisTileDataPool
+{
+    static const int tileSize = pixelSize * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT;
+    static const int nextSize = (4 * 1024 * 1024) / tileSize;
+
+    typedef boost::singleton_pool<KisTileData, tileSize,
+                                  KisTileDataPoolAllocator,
+                                  boost::details::pool::default_mutex,
+                                  nextSize, 16 * nextSize> type;
+};
+
+namespace {
+
+quint8* poolMalloc(int pixelSize)
+{
+    switch (pixelSize) {
+    case 1:
+        return (quint8*)KisTileDataPool<1>::type::malloc();
+    case 2:
+        return (quint8*)KisTileDataPool<2>::type::malloc();
+    case 4:
+        return (quint8*)KisTileDataPool<4>::type::malloc();
+    case 5:
+        return (quint8*)KisTileDataPool<5>::type::malloc();
+    case 8:
+        return (quint8*)KisTileDataPool<8>::type::malloc();
+    case 10:
+        return (quint8*)KisTileDataPool<10>::type::malloc();
+    case 16:
+        return (quint8*)KisTileDataPool<16>::type::malloc();
+    case 20:
+        return (quint8*)KisTileDataPool<20>::type::malloc();
+    default:
+        return 0;
+    }
+}
 
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_4BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 256, 4096> BoostPool4BPP;
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_8BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 128, 2048> BoostPool8BPP;
+void poolFree(quint8 *ptr, int pixelSize)
+{
+    switch (pixelSize) {
+    case 1:
+        KisTileDataPool<1>::type::free(ptr);
+        break;
+    case 2:
+        KisTileDataPool<2>::type::free(ptr);
+        break;
+    case 4:
+        KisTileDataPool<4>::type::free(ptr);
+        break;
+    case 5:
+        KisTileDataPool<5>::type::free(ptr);
+        break;
+    case 8:
+        KisTileDataPool<8>::type::free(ptr);
+        break;
+    case 10:
+        KisTileDataPool<10>::type::free(ptr);
+        break;
+    case 16:
+        KisTileDataPool<16>::type::free(ptr);
+        break;
+    case 20:
+        KisTileDataPool<20>::type::free(ptr);
+        break;
+    default:
+        KIS_ASSERT(0 && "the pixel size is not pooled");
+    }
+}
+
+void poolPurge(int pixelSize)
+{
+    switch (pixelSize) {
+    case 1:
+        KisTileDataPool<1>::type::purge_memory();
+        break;
+    case 2:
+        KisTileDataPool<2>::type::purge_memory();
+        break;
+    case 4:
+        KisTileDataPool<4>::type::purge_memory();
+        break;
+    case 5:
+        KisTileDataPool<5>::type::purge_memory();
+        break;
+    case 8:
+        KisTileDataPool<8>::type::purge_memory();
+        break;
+    case 10:
+        KisTileDataPool<10>::type::purge_memory();
+        break;
+    case 16:
+        KisTileDataPool<16>::type::purge_memory();
+        break;
+    case 20:
+        KisTileDataPool<20>::type::purge_memory();
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * The pools can be purged only when no tile uses them. The lock is
+ * taken for read on every allocation/deallocation of a pooled tile
+ * and for write when the pools are purged.
+ */
+QReadWriteLock s_poolsLock;
+
+/**
+ * The number of the pooled blocks occupied by the tiles (or
+ * their clones), per pool index
+ */
+std::atomic<int> s_pooledBlocksInUse[SimpleCache::NUM_POOLS];
+
+}
+
+const int SimpleCache::pooledPixelSizes[SimpleCache::NUM_POOLS] = {1, 2, 4, 5, 8, 10, 16, 20};
 
 const qint32 KisTileData::WIDTH = __TILE_DATA_WIDTH;
 const qint32 KisTileData::HEIGHT = __TILE_DATA_HEIGHT;
@@ -48,24 +203,23 @@ void SimpleCache::clear()
     QWriteLocker l(&m_cacheLock);
     quint8 *ptr = 0;
 
-    while (m_4Pool.pop(ptr)) {
-        BoostPool4BPP::free(ptr);
-    }
-
-    while (m_8Pool.pop(ptr)) {
-        BoostPool8BPP::free(ptr);
-    }
-
-    while (m_16Pool.pop(ptr)) {
-        free(ptr);
+    for (int i = 0; i < NUM_POOLS; i++) {
+        while (m_pools[i].pop(ptr)) {
+            poolFree(ptr, pooledPixelSizes[i]);
+        }
     }
 }
 
 
 KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store, bool checkFreeMemory)
     : m_state(NORMAL),
+      m_lazyChunk(0),
       m_mementoFlag(0),
       m_age(0),
+      m_uniformState(UNIFORM),
+      m_uniformWritersCount(0),
+      m_dataOwner(0),
+      m_dataSharersCount(0),
       m_usersCount(0),
       m_refCount(0),
       m_pixelSize(pixelSize),
@@ -93,8 +247,15 @@ KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataSt
  */
 KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
     : m_state(NORMAL),
+      m_lazyChunk(0),
       m_mementoFlag(0),
       m_age(0),
+      m_uniformState(rhs.m_uniformWritersCount.loadAcquire() > 0 ?
+                     int(UNIFORM_UNKNOWN) :
+                     rhs.m_uniformState.loadAcquire() & UNIFORM_STATE_MASK),
+      m_uniformWritersCount(0),
+      m_dataOwner(0),
+      m_dataSharersCount(0),
       m_usersCount(0),
       m_refCount(0),
       m_pixelSize(rhs.m_pixelSize),
@@ -108,10 +269,28 @@ KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
     memcpy(m_data, rhs.data(), m_pixelSize * WIDTH * HEIGHT);
 }
 
+KisTileData::KisTileData(qint32 pixelSize, KisLazyTileChunk *lazyChunk, KisTileDataStore *store)
+    : m_state(NORMAL),
+      m_lazyChunk(lazyChunk),
+      m_mementoFlag(0),
+      m_age(0),
+      m_uniformState(UNIFORM_UNKNOWN),
+      m_uniformWritersCount(0),
+      m_data(0),
+      m_dataOwner(0),
+      m_dataSharersCount(0),
+      m_usersCount(0),
+      m_refCount(0),
+      m_pixelSize(pixelSize),
+      m_store(store)
+{
+}
+
 
 KisTileData::~KisTileData()
 {
     releaseMemory();
+    delete m_lazyChunk;
 }
 
 void KisTileData::fillWithPixel(const quint8 *defPixel)
@@ -125,7 +304,14 @@ void KisTileData::fillWithPixel(const quint8 *defPixel)
 
 void KisTileData::releaseMemory()
 {
-    if (m_data) {
+    if (m_dataOwner) {
+        KisTileData *owner = m_dataOwner;
+        m_dataOwner = 0;
+        m_data = 0;
+
+        owner->m_dataSharersCount.deref();
+        owner->deref();
+    } else if (m_data) {
         freeData(m_data, m_pixelSize);
         m_data = 0;
     }
@@ -148,18 +334,18 @@ quint8* KisTileData::allocateData(const qint32 pixelSize)
 {
     quint8 *ptr = 0;
 
-    if (!m_cache.pop(pixelSize, ptr)) {
-        switch (pixelSize) {
-        case 4:
-            ptr = (quint8*)BoostPool4BPP::malloc();
-            break;
-        case 8:
-            ptr = (quint8*)BoostPool8BPP::malloc();
-            break;
-        default:
-            ptr = (quint8*) malloc(pixelSize * WIDTH * HEIGHT);
-            break;
+    const int poolIndex = SimpleCache::poolIndex(pixelSize);
+
+    if (poolIndex >= 0) {
+        QReadLocker l(&s_poolsLock);
+
+        if (!m_cache.pop(pixelSize, ptr)) {
+            ptr = poolMalloc(pixelSize);
         }
+
+        s_pooledBlocksInUse[poolIndex]++;
+    } else {
+        ptr = (quint8*) malloc(pixelSize * WIDTH * HEIGHT);
     }
 
     return ptr;
@@ -167,21 +353,46 @@ quint8* KisTileData::allocateData(const qint32 pixelSize)
 
 void KisTileData::freeData(quint8* ptr, const qint32 pixelSize)
 {
-    if (!m_cache.push(pixelSize, ptr)) {
-        switch (pixelSize) {
-        case 4:
-            BoostPool4BPP::free(ptr);
-            break;
-        case 8:
-            BoostPool8BPP::free(ptr);
-            break;
-        default:
-            free(ptr);
-            break;
+    const int poolIndex = SimpleCache::poolIndex(pixelSize);
+
+    if (poolIndex >= 0) {
+        QReadLocker l(&s_poolsLock);
+
+        if (!m_cache.push(pixelSize, ptr)) {
+            poolFree(ptr, pixelSize);
+        }
+
+        s_pooledBlocksInUse[poolIndex]--;
+    } else {
+        free(ptr);
+    }
+}
+
+void KisTileData::releaseUnusedPools()
+{
+    QWriteLocker l(&s_poolsLock);
+
+    m_cache.clear();
+
+    for (int i = 0; i < SimpleCache::NUM_POOLS; i++) {
+        if (!s_pooledBlocksInUse[i]) {
+            poolPurge(SimpleCache::pooledPixelSizes[i]);
         }
     }
 }
 
+qint64 KisTileData::unusedPoolsMemory()
+{
+    qint64 usedMemory = 0;
+
+    for (int i = 0; i < SimpleCache::NUM_POOLS; i++) {
+        usedMemory += qint64(s_pooledBlocksInUse[i]) *
+            SimpleCache::pooledPixelSizes[i] * WIDTH * HEIGHT;
+    }
+
+    return qMax(qint64(0), qint64(KisTileDataPoolAllocator::s_reservedMemory) - usedMemory);
+}
+
 //#define DEBUG_POOL_RELEASE
 
 #ifdef DEBUG_POOL_RELEASE
@@ -210,9 +421,12 @@ void KisTileData::releaseInternalPools()
             }
 
             // check if the tile data has actually been pooled
-            if (item->m_pixelSize != 4 &&
-                item->m_pixelSize != 8) {
+            if (SimpleCache::poolIndex(item->m_pixelSize) < 0) {
+                continue;
+            }
 
+            // the shared memory cannot be moved, it has several users
+            if (item->isDataShared()) {
                 continue;
             }
 
@@ -232,10 +446,13 @@ void KisTileData::releaseInternalPools()
         }
 
         if (!failedToLock) {
+            Q_FOREACH (KisTileData *item, dataObjects) {
+                freeData(item->m_data, item->m_pixelSize);
+                item->m_data = 0;
+            }
+
             // purge the pools memory
-            m_cache.clear();
-            BoostPool4BPP::purge_memory();
-            BoostPool8BPP::purge_memory();
+            releaseUnusedPools();
 
             auto it = dataObjects.begin();
             auto chunkIt = memoryChunks.constBegin();
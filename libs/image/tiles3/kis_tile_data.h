@@ -37,7 +37,61 @@ inline quint8* KisTileData::data() const {
 
 void KisTileData::setData(const quint8 *data) {
     Q_ASSERT(m_data);
+    Q_ASSERT(!isDataShared());
     memcpy(m_data, data, m_pixelSize*WIDTH*HEIGHT);
+    resetUniformState();
+}
+
+inline bool KisTileData::isUniform() const {
+    const int value = m_uniformState.loadAcquire();
+    int state = value & UNIFORM_STATE_MASK;
+
+    if (state == UNIFORM_UNKNOWN) {
+        /**
+         * The data is uniform iff it is equal to itself shifted
+         * by one pixel.
+         */
+        const int dataSize = m_pixelSize * WIDTH * HEIGHT;
+        state = memcmp(m_data, m_data + m_pixelSize, dataSize - m_pixelSize) == 0 ?
+            UNIFORM : NOT_UNIFORM;
+
+        /**
+         * Someone could have been writing into the data while we
+         * were reading it. If the write is still in progress, the
+         * writers counter is non-zero; if it has started or finished
+         * after we loaded the state, the generation has changed and
+         * the CAS fails. In both cases the result is not cached.
+         */
+        if (m_uniformWritersCount.loadAcquire() <= 0) {
+            m_uniformState.testAndSetOrdered(value, value | state);
+        }
+    }
+
+    return state == UNIFORM;
+}
+
+inline void KisTileData::resetUniformState() {
+    int oldValue;
+    int newValue;
+
+    do {
+        oldValue = m_uniformState.loadAcquire();
+        newValue = int(quint32(oldValue & ~UNIFORM_STATE_MASK) + UNIFORM_GENERATION_STEP);
+    } while (!m_uniformState.testAndSetOrdered(oldValue, newValue));
+}
+
+inline void KisTileData::beginWriteAccess() {
+    m_uniformWritersCount.ref();
+    resetUniformState();
+}
+
+inline void KisTileData::endWriteAccess() {
+    resetUniformState();
+    m_uniformWritersCount.deref();
+}
+
+inline bool KisTileData::isDataShared() const {
+    return m_dataOwner || m_dataSharersCount.loadAcquire();
 }
 
 inline quint32 KisTileData::pixelSize() const {
@@ -108,6 +162,13 @@ inline void KisTileData::setSwapChunk(KisChunk chunk) {
     m_swapChunk = chunk;
 }
 
+inline KisLazyTileChunk* KisTileData::lazyChunk() const {
+    return m_lazyChunk;
+}
+inline void KisTileData::setLazyChunk(KisLazyTileChunk *chunk) {
+    m_lazyChunk = chunk;
+}
+
 inline bool KisTileData::mementoed() const {
     return m_mementoFlag;
 }
@@ -28,6 +28,7 @@
 
 class KisTileData;
 class KisTileDataStore;
+struct KisLazyTileChunk;
 
 /**
  * WARNING: Those definitions for internal use only!
@@ -52,45 +53,61 @@ public:
     bool push(int pixelSize, quint8 *&ptr)
     {
         QReadLocker l(&m_cacheLock);
-        switch (pixelSize) {
-        case 4:
-            m_4Pool.push(ptr);
-            break;
-        case 8:
-            m_8Pool.push(ptr);
-            break;
-        case 16:
-            m_16Pool.push(ptr);
-            break;
-        default:
-            return false;
-        }
+        const int index = poolIndex(pixelSize);
+        if (index < 0) return false;
 
+        m_pools[index].push(ptr);
         return true;
     }
 
     bool pop(int pixelSize, quint8 *&ptr)
     {
         QReadLocker l(&m_cacheLock);
+        const int index = poolIndex(pixelSize);
+        if (index < 0) return false;
+
+        return m_pools[index].pop(ptr);
+    }
+
+    void clear();
+
+    /**
+     * Every pixel size that can be produced by the color spaces
+     * shipped with Krita (from Alpha8 up to CMYKA F32) has its own
+     * pool. The tiles of all other sizes are allocated with malloc()
+     * directly and are not cached.
+     *
+     * \return the index of the pool or -1 if the pixel size is not pooled
+     */
+    static inline int poolIndex(int pixelSize) {
         switch (pixelSize) {
+        case 1:
+            return 0;
+        case 2:
+            return 1;
         case 4:
-            return m_4Pool.pop(ptr);
+            return 2;
+        case 5:
+            return 3;
         case 8:
-            return m_8Pool.pop(ptr);
+            return 4;
+        case 10:
+            return 5;
         case 16:
-            return m_16Pool.pop(ptr);
+            return 6;
+        case 20:
+            return 7;
         default:
-            return false;
+            return -1;
         }
     }
 
-    void clear();
+    static const int NUM_POOLS = 8;
+    static const int pooledPixelSizes[NUM_POOLS];
 
 private:
     QReadWriteLock m_cacheLock;
-    KisLocklessStack<quint8*> m_4Pool;
-    KisLocklessStack<quint8*> m_8Pool;
-    KisLocklessStack<quint8*> m_16Pool;
+    KisLocklessStack<quint8*> m_pools[NUM_POOLS];
 };
 
 
@@ -105,6 +122,13 @@ public:
 private:
     KisTileData(const KisTileData& rhs, bool checkFreeMemory = true);
 
+    /**
+     * Creates a tile data without any memory allocated. The data will
+     * be decompressed from \p lazyChunk on the first access.
+     * The tile data takes the ownership of the chunk.
+     */
+    KisTileData(qint32 pixelSize, KisLazyTileChunk *lazyChunk, KisTileDataStore *store);
+
 public:
     ~KisTileData();
 
@@ -121,6 +145,42 @@ public:
     inline void setData(const quint8 *data);
     inline quint32 pixelSize() const;
 
+    /**
+     * Checks whether all the pixels of the tile data have the same
+     * value (the value itself can be read from data()). The result
+     * is cached until the data is written again, see
+     * beginWriteAccess() and endWriteAccess().
+     *
+     * NOTE: the data must be loaded, that is the caller should block
+     *       swapping of the tile data
+     */
+    inline bool isUniform() const;
+
+    /**
+     * Forgets the cached value of isUniform(). Should be called
+     * by everyone who writes into the tile data
+     */
+    inline void resetUniformState();
+
+    /**
+     * Should wrap every write access to the tile data (see
+     * KisTile::lockForWrite() and KisTile::unlockForWrite()).
+     * Write locks do not exclude read locks, so isUniform() may
+     * be called while the data is being changed. These calls make
+     * sure that a value calculated during a write is never cached.
+     */
+    inline void beginWriteAccess();
+    inline void endWriteAccess();
+
+    /**
+     * Returns true if the pixels of the tile data are shared with
+     * another tile data with the same content (see
+     * KisTileDataStore::tryShareTileData()). Such tile data cannot be
+     * written in place, it should be copied-on-write even if it has
+     * a single user. It is not swapped out either.
+     */
+    inline bool isDataShared() const;
+
     /**
      * Increments usersCount of a TD and refs shared pointer counter
      * Used by KisTile for COW
@@ -165,6 +225,13 @@ public:
     inline KisChunk swapChunk() const;
     inline void setSwapChunk(KisChunk chunk);
 
+    /**
+     * The position of the tile data in a lazy tile source,
+     * if it has not been loaded yet
+     */
+    inline KisLazyTileChunk* lazyChunk() const;
+    inline void setLazyChunk(KisLazyTileChunk *chunk);
+
     /**
      * Show whether a tile data is a part of history
      */
@@ -220,6 +287,22 @@ public:
      */
     static void releaseInternalPools();
 
+    /**
+     * Returns the memory cached by the tile pools back to the system.
+     * Unlike releaseInternalPools() it doesn't migrate the tiles, so
+     * only the pools of the pixel sizes that have no living tiles can
+     * actually be purged. It is cheap enough to be called by the
+     * swapper every time the memory limit is reached.
+     */
+    static void releaseUnusedPools();
+
+    /**
+     * \return the amount of memory (in bytes) the pools have
+     * requested from the system, but which is not occupied by any
+     * tile at the moment
+     */
+    static qint64 unusedPoolsMemory();
+
 private:
     void fillWithPixel(const quint8 *defPixel);
 
@@ -264,6 +347,11 @@ private:
      */
     KisChunk m_swapChunk;
 
+    /**
+     * The position of the tile data in the file it has been read
+     * from. Used by KisTileDataStore for lazy loading of the tiles.
+     */
+    KisLazyTileChunk *m_lazyChunk;
 
     /**
      * The flag is set by KisMementoItem to show this
@@ -283,6 +371,31 @@ private:
     int m_age;
 
 
+    enum UniformState {
+        UNIFORM_UNKNOWN = 0,
+        UNIFORM,
+        NOT_UNIFORM,
+
+        UNIFORM_STATE_MASK = 0x3,
+        UNIFORM_GENERATION_STEP = 0x4
+    };
+
+    /**
+     * The cached value of isUniform(), one of UniformState values,
+     * stored in the lowest two bits. The rest of the bits is a write
+     * generation, which is increased (and the state is reset) on the
+     * beginning and on the end of every write access to the tile
+     * data. isUniform() stores the calculated state only if the
+     * generation hasn't changed while it was reading the data.
+     */
+    mutable QAtomicInt m_uniformState;
+
+    /**
+     * The number of writers currently accessing the tile data. While
+     * it is non-zero, isUniform() doesn't cache anything.
+     */
+    QAtomicInt m_uniformWritersCount;
+
     /**
      * The primitive for controlling swapping of the tile.
      * lockForRead() - used by regular threads to ensure swapper
@@ -301,6 +414,18 @@ private:
      */
     mutable quint8* m_data;
 
+    /**
+     * If the tile data has been merged with another tile data of
+     * the same content, m_data points to the memory of m_dataOwner,
+     * and the owner is referenced until this tile data is destroyed
+     */
+    KisTileData *m_dataOwner;
+
+    /**
+     * The number of tile datas, which borrow m_data of this one
+     */
+    QAtomicInt m_dataSharersCount;
+
     /**
      * How many tiles/mementoes use
      * this tiledata through COW?
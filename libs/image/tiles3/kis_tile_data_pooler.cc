@@ -18,12 +18,14 @@
 
 
 #include <stdio.h>
+#include <QHash>
 #include "kis_tile_data.h"
 #include "kis_tile_data_store.h"
 #include "kis_tile_data_store_iterators.h"
 #include "kis_debug.h"
 #include "kis_tile_data_pooler.h"
 #include "kis_image_config.h"
+#include "kis_memory_statistics_server.h"
 
 
 const qint32 KisTileDataPooler::MAX_NUM_CLONES = 16;
@@ -94,6 +96,8 @@ KisTileDataPooler::KisTileDataPooler(KisTileDataStore *store, qint32 memoryLimit
     m_lastPoolMemoryMetric = 0;
     m_lastRealMemoryMetric = 0;
     m_lastHistoricalMemoryMetric = 0;
+    m_deduplicationRequestedFlag = 0;
+    m_deduplicationEnabled = KisImageConfig(true).enableTileDeduplication();
 
     if(memoryLimit >= 0) {
         m_memoryLimit = memoryLimit;
@@ -112,6 +116,12 @@ void KisTileDataPooler::kick()
     m_semaphore.release();
 }
 
+void KisTileDataPooler::requestDeduplication()
+{
+    m_deduplicationRequestedFlag = true;
+    kick();
+}
+
 void KisTileDataPooler::terminatePooler()
 {
     unsigned long exitTimeout = 100;
@@ -217,6 +227,19 @@ void KisTileDataPooler::run()
 
         DEBUG_TILE_STATISTICS();
         DEBUG_SIMPLE_ACTION("cycle finished");
+
+        if (m_deduplicationRequestedFlag.testAndSetOrdered(1, 0) &&
+            m_deduplicationEnabled) {
+
+            deduplicateTileData();
+
+            /**
+             * The server lives in the GUI thread, so
+             * its timers should be started from there
+             */
+            QMetaObject::invokeMethod(KisMemoryStatisticsServer::instance(),
+                                      "notifyImageChanged", Qt::QueuedConnection);
+        }
     }
 }
 
@@ -392,6 +415,69 @@ bool KisTileDataPooler::processLists(QList<KisTileData*> &beggers,
     return hadWork;
 }
 
+void KisTileDataPooler::deduplicateTileData()
+{
+    DEBUG_SIMPLE_ACTION("deduplication started");
+
+    /**
+     * Hashing of the whole store takes time, so we cannot hold the
+     * iterator lock while doing that. Instead, we just reference the
+     * tile datas to keep them alive and release the lock.
+     */
+    QVector<KisTileData*> items;
+
+    KisTileDataStoreIterator *iter = m_store->beginIteration();
+    while (iter->hasNext()) {
+        KisTileData *item = iter->next();
+        item->ref();
+        items.append(item);
+    }
+    m_store->endIteration(iter);
+
+    QHash<uint, KisTileData*> owners;
+
+    Q_FOREACH (KisTileData *item, items) {
+        if (m_shouldExitFlag) break;
+
+        /**
+         * Someone is using the tile data right now, so it
+         * is probably not a good candidate for sharing
+         */
+        if (!item->m_swapLock.tryLockForRead()) continue;
+
+        uint hash = 0;
+        const bool canBeShared = item->m_data && !item->m_dataOwner;
+
+        if (canBeShared) {
+            hash = qHashBits(item->m_data, item->m_pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT);
+        }
+
+        item->m_swapLock.unlock();
+
+        if (!canBeShared) continue;
+
+        /**
+         * The content might have changed after we calculated the
+         * hash, but tryShareTileData() compares the data anyway
+         */
+        auto it = owners.find(hash);
+        if (it == owners.end()) {
+            owners.insert(hash, item);
+        } else if (!m_store->tryShareTileData(*it, item) &&
+                   m_store->tryShareTileData(item, *it)) {
+
+            // the item has already been shared during the previous pass
+            *it = item;
+        }
+    }
+
+    Q_FOREACH (KisTileData *item, items) {
+        item->deref();
+    }
+
+    DEBUG_SIMPLE_ACTION("deduplication finished");
+}
+
 void KisTileDataPooler::debugTileStatistics()
 {
     /**
@@ -417,4 +503,5 @@ void KisTileDataPooler::debugTileStatistics()
 void KisTileDataPooler::testingRereadConfig()
 {
     m_memoryLimit = MiB_TO_METRIC(KisImageConfig(true).poolLimit());
+    m_deduplicationEnabled = KisImageConfig(true).enableTileDeduplication();
 }
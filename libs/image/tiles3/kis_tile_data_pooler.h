@@ -40,6 +40,12 @@ public:
     void kick();
     void terminatePooler();
 
+    /**
+     * Asks the thread to share the memory of the tile datas with
+     * identical content after the next pooling cycle
+     */
+    void requestDeduplication();
+
     void testingRereadConfig();
 
     qint64 lastPoolMemoryMetric() const;
@@ -83,7 +89,10 @@ protected:
                       QList<KisTileData*> &donors,
                       qint32 &memoryOccupied);
 
+    void deduplicateTileData();
+
 private:
+    friend class KisTileDataPoolerTest;
     void debugTileStatistics();
 protected:
     QSemaphore m_semaphore;
@@ -95,6 +104,8 @@ protected:
     qint32 m_lastPoolMemoryMetric;
     qint32 m_lastRealMemoryMetric;
     qint32 m_lastHistoricalMemoryMetric;
+    QAtomicInt m_deduplicationRequestedFlag;
+    bool m_deduplicationEnabled;
 };
 
 
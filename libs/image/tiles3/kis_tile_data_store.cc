@@ -27,6 +27,7 @@
 #include "kis_debug.h"
 
 #include "kis_tile_data_store_iterators.h"
+#include "swap/kis_lazy_tile_source.h"
 
 Q_GLOBAL_STATIC(KisTileDataStore, s_instance)
 
@@ -70,17 +71,21 @@ qint64 __preclone_miss_age = 0;
 KisTileDataStore::KisTileDataStore()
     : m_pooler(this),
       m_swapper(this),
+      m_prefetcher(this),
       m_numTiles(0),
       m_memoryMetric(0),
+      m_sharedMemoryMetric(0),
       m_counter(1),
       m_clockIndex(1)
 {
     m_pooler.start();
     m_swapper.start();
+    m_prefetcher.start();
 }
 
 KisTileDataStore::~KisTileDataStore()
 {
+    m_prefetcher.terminatePrefetcher();
     m_pooler.terminatePooler();
     m_swapper.terminateSwapper();
 
@@ -113,10 +118,16 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
     stats.realMemorySize = m_pooler.lastRealMemoryMetric() * metricCoeff;
     stats.historicalMemorySize = m_pooler.lastHistoricalMemoryMetric() * metricCoeff;
     stats.poolSize = m_pooler.lastPoolMemoryMetric() * metricCoeff;
+    stats.allocatorPoolSize = KisTileData::unusedPoolsMemory();
 
-    stats.totalMemorySize = memoryMetric() * metricCoeff + stats.poolSize;
+    stats.totalMemorySize = memoryMetric() * metricCoeff + stats.poolSize + stats.allocatorPoolSize;
 
     stats.swapSize = m_swappedStore.totalMemoryMetric() * metricCoeff;
+    stats.swapFileSize = m_swappedStore.swapFileSize();
+    stats.swapCompactionSavedSize = m_swappedStore.compactionSavedSize();
+    stats.swapCompactionProgress = m_swappedStore.compactionProgress();
+
+    stats.deduplicatedSize = m_sharedMemoryMetric.loadAcquire() * metricCoeff;
 
     return stats;
 }
@@ -160,7 +171,12 @@ inline void KisTileDataStore::unregisterTileDataImp(KisTileData *td)
     td->m_tileNumber = -1;
     m_tileDataMap.erase(index);
     m_numTiles.deref();
-    m_memoryMetric -= td->pixelSize();
+
+    if (td->m_dataOwner) {
+        m_sharedMemoryMetric -= td->pixelSize();
+    } else {
+        m_memoryMetric -= td->pixelSize();
+    }
 
     m_tileDataMap.getGC().unlockRawPointerAccess();
 }
@@ -178,6 +194,11 @@ KisTileData *KisTileDataStore::allocTileData(qint32 pixelSize, const quint8 *def
     return td;
 }
 
+KisTileData *KisTileDataStore::createLazyTileData(qint32 pixelSize, KisLazyTileChunk *lazyChunk)
+{
+    return new KisTileData(pixelSize, lazyChunk, this);
+}
+
 KisTileData *KisTileDataStore::duplicateTileData(KisTileData *rhs)
 {
     KisTileData *td = 0;
@@ -207,7 +228,9 @@ void KisTileDataStore::freeTileData(KisTileData *td)
     td->m_swapLock.lockForWrite();
 
     if (!td->data()) {
-        m_swappedStore.forgetTileData(td);
+        if (!td->lazyChunk()) {
+            m_swappedStore.forgetTileData(td);
+        }
     } else {
         unregisterTileDataImp(td);
     }
@@ -231,8 +254,13 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
         /**
          * The order of this heavy locking is very important.
          * Change it only in case, you really know what you are doing.
+         *
+         * The read lock is enough here: registration of the tile
+         * data is safe under it (see registerTileData()), and it
+         * still excludes the swapper's iteration. It lets several
+         * threads load their tiles from the swap at the same time.
          */
-        m_iteratorLock.lockForWrite();
+        m_iteratorLock.lockForRead();
 
         /**
          * If someone has managed to load the td from swap, then, most
@@ -247,11 +275,22 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
          * m_listLock.
          */
 
-        if (!td->data()) {
-            td->m_swapLock.lockForWrite();
-
-            m_swappedStore.swapInTileData(td);
-            registerTileDataImp(td);
+        /**
+         * Since the iterator lock is shared now, another thread might
+         * be loading the same td right now. We must not wait for its
+         * swap lock while holding the iterator lock, so if the lock
+         * is busy, just go to the next cycle and wait for the swap
+         * lock there.
+         */
+        if (!td->data() && td->m_swapLock.tryLockForWrite()) {
+            if (!td->data()) {
+                if (td->lazyChunk()) {
+                    loadLazyTileData(td);
+                } else {
+                    m_swappedStore.swapInTileData(td);
+                }
+                registerTileDataImp(td);
+            }
 
             td->m_swapLock.unlock();
         }
@@ -266,6 +305,21 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
     }
 }
 
+void KisTileDataStore::loadLazyTileData(KisTileData *td)
+{
+    KisLazyTileChunk *chunk = td->lazyChunk();
+
+    td->allocateMemory();
+
+    if (!chunk->source->loadTileData(td, chunk->offset, chunk->size)) {
+        warnTiles << "Failed to decompress a tile, the file may be corrupted";
+        memset(td->data(), 0, td->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT);
+    }
+
+    td->setLazyChunk(0);
+    delete chunk;
+}
+
 bool KisTileDataStore::trySwapTileData(KisTileData *td)
 {
     /**
@@ -275,7 +329,11 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     bool result = false;
     if (!td->m_swapLock.tryLockForWrite()) return result;
 
-    if (td->data()) {
+    /**
+     * The memory of the shared tile data cannot be released,
+     * it is used by other tile datas as well
+     */
+    if (td->data() && !td->isDataShared()) {
         if (m_swappedStore.trySwapOutTileData(td)) {
             unregisterTileDataImp(td);
             result = true;
@@ -286,6 +344,64 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     return result;
 }
 
+bool KisTileDataStore::tryShareTileData(KisTileData *owner, KisTileData *td)
+{
+    if (owner == td ||
+        owner->m_pixelSize != td->m_pixelSize ||
+        owner->m_dataOwner || td->m_dataOwner ||
+        td->m_dataSharersCount.loadAcquire()) {
+
+        return false;
+    }
+
+    /**
+     * Holding the swap locks for write guarantees that no one
+     * reads or writes the tile datas at the moment. Everyone who
+     * comes later will see them shared and will do copy-on-write.
+     */
+    if (!owner->m_swapLock.tryLockForWrite()) return false;
+
+    if (!td->m_swapLock.tryLockForWrite()) {
+        owner->m_swapLock.unlock();
+        return false;
+    }
+
+    bool result = false;
+    const int dataSize = td->m_pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    if (owner->m_data && td->m_data &&
+        !memcmp(owner->m_data, td->m_data, dataSize)) {
+
+        KisTileData::freeData(td->m_data, td->m_pixelSize);
+        td->m_data = owner->m_data;
+        td->m_dataOwner = owner;
+
+        owner->m_dataSharersCount.ref();
+        owner->ref();
+
+        m_memoryMetric -= td->pixelSize();
+        m_sharedMemoryMetric += td->pixelSize();
+
+        result = true;
+    }
+
+    td->m_swapLock.unlock();
+    owner->m_swapLock.unlock();
+
+    return result;
+}
+
+bool KisTileDataStore::compactSwap(std::function<void()> stepCallback)
+{
+    /**
+     * Don't block the swapping-in threads for more
+     * than a few milliseconds at once
+     */
+    const quint64 compactionStep = 4 * MiB;
+
+    return m_swappedStore.compact(compactionStep, stepCallback);
+}
+
 KisTileDataStoreIterator* KisTileDataStore::beginIteration()
 {
     m_iteratorLock.lockForWrite();
@@ -359,6 +475,21 @@ void KisTileDataStore::debugClear()
     QWriteLocker l(&m_iteratorLock);
     ConcurrentMap<int, KisTileData*>::Iterator iter(m_tileDataMap);
 
+    /**
+     * The owners of the shared data are going to be deleted
+     * as well, so just forget about them
+     */
+    while (iter.isValid()) {
+        KisTileData *td = iter.getValue();
+        if (td->m_dataOwner) {
+            td->m_data = 0;
+            td->m_dataOwner = 0;
+        }
+        iter.next();
+    }
+
+    iter = ConcurrentMap<int, KisTileData*>::Iterator(m_tileDataMap);
+
     while (iter.isValid()) {
         delete iter.getValue();
         iter.next();
@@ -368,6 +499,7 @@ void KisTileDataStore::debugClear()
     m_clockIndex = 1;
     m_numTiles = 0;
     m_memoryMetric = 0;
+    m_sharedMemoryMetric = 0;
 }
 
 void KisTileDataStore::testingRereadConfig()
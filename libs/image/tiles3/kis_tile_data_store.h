@@ -27,6 +27,7 @@
 
 #include "kis_tile_data_pooler.h"
 #include "swap/kis_tile_data_swapper.h"
+#include "swap/kis_tile_data_prefetcher.h"
 #include "swap/kis_swapped_data_store.h"
 #include "3rdparty/lock_free_map/concurrent_map.h"
 
@@ -53,7 +54,28 @@ public:
 
         qint64 poolSize;
 
+        /**
+         * The memory reserved by the tile allocation pools that
+         * is not occupied by any tile data at the moment
+         */
+        qint64 allocatorPoolSize;
+
         qint64 swapSize;
+
+        /**
+         * The size of the swap file on disk, the number of bytes
+         * the compaction has given back to the system and the
+         * progress of the running compaction pass in percents
+         */
+        qint64 swapFileSize;
+        qint64 swapCompactionSavedSize;
+        int swapCompactionProgress;
+
+        /**
+         * The memory saved by sharing the tile datas
+         * with identical content
+         */
+        qint64 deduplicatedSize;
     };
 
     MemoryStatistics memoryStatistics();
@@ -80,6 +102,29 @@ public:
         m_swapper.checkFreeMemory();
     }
 
+    /**
+     * Returns true if at least one tile is in the swap at the moment.
+     * Used as a cheap check before prefetching the tiles.
+     */
+    inline bool hasSwappedTiles() const
+    {
+        return m_swappedStore.numTiles() > 0;
+    }
+
+    /**
+     * Asks the prefetcher thread to load \p td from the swap in the
+     * background. Does nothing if the data is already in memory.
+     * The caller should guarantee that \p td is alive during the call.
+     *
+     * \see KisTileDataPrefetcher
+     */
+    inline void prefetchTileData(KisTileData *td)
+    {
+        if (!td->data()) {
+            m_prefetcher.prefetch(td);
+        }
+    }
+
     /**
      * \see m_memoryMetric
      */
@@ -102,6 +147,51 @@ public:
         return allocTileData(pixelSize, defPixel);
     }
 
+    /**
+     * Creates a tile data, which will be decompressed from \p lazyChunk
+     * on the first access. Until then it occupies no memory and is not
+     * registered in the store, just like the swapped-out tile datas.
+     * The tile data takes the ownership of the chunk.
+     */
+    KisTileData* createLazyTileData(qint32 pixelSize, KisLazyTileChunk *lazyChunk);
+
+    /**
+     * Asks the swapper thread to compact the swap file. Should
+     * be called when the user is idle, e.g. by KisIdleWatcher.
+     */
+    inline void requestSwapCompaction()
+    {
+        m_swapper.requestCompaction();
+    }
+
+    /**
+     * Compacts the swap file synchronously. Called by the swapper
+     * thread, don't use it from the GUI thread. \p stepCallback is
+     * called between the compaction steps.
+     */
+    bool compactSwap(std::function<void()> stepCallback = std::function<void()>());
+
+    /**
+     * Asks the pooler thread to look for the tile datas with
+     * identical content and make them share the memory. Should
+     * be called when the user is idle, e.g. by KisIdleWatcher.
+     */
+    inline void requestDeduplication()
+    {
+        m_pooler.requestDeduplication();
+    }
+
+    /**
+     * Makes \p td use the memory of \p owner if their content is
+     * byte-identical. Both tile datas stay alive and keep their
+     * users, but any write to them will cause copy-on-write. Fails
+     * if any of the tile datas is being accessed at the moment.
+     *
+     * The caller must guarantee both tile datas are alive during
+     * the call, e.g. by holding a reference to them.
+     */
+    bool tryShareTileData(KisTileData *owner, KisTileData *td);
+
     // Called by The Memento Manager after every commit
     inline void kickPooler()
     {
@@ -146,12 +236,19 @@ public:
 private:
     KisTileData *allocTileData(qint32 pixelSize, const quint8 *defPixel);
 
+    /**
+     * Decompresses the data of a lazily loaded tile data.
+     * PRECONDITIONS: td->m_swapLock is locked for write
+     */
+    void loadLazyTileData(KisTileData *td);
+
     inline void registerTileDataImp(KisTileData *td);
     inline void unregisterTileDataImp(KisTileData *td);
     void freeRegisteredTiles();
 
     friend class DeadlockyThread;
     friend class KisLowMemoryTests;
+    friend class KisSwapBenchmark;
     void debugSwapAll();
     void debugClear();
 
@@ -169,6 +266,8 @@ private:
     friend class KisTileDataPoolerTest;
     KisSwappedDataStore m_swappedStore;
 
+    KisTileDataPrefetcher m_prefetcher;
+
     /**
      * This metric is used for computing the volume
      * of memory occupied by tile data objects.
@@ -176,6 +275,12 @@ private:
      */
     QAtomicInt m_numTiles;
     QAtomicInt m_memoryMetric;
+
+    /**
+     * The memory (in metric units) of the tile datas, which share
+     * their data with other ones and, therefore, occupy nothing
+     */
+    QAtomicInt m_sharedMemoryMetric;
     QAtomicInt m_counter;
     QAtomicInt m_clockIndex;
     ConcurrentMap<int, KisTileData*> m_tileDataMap;
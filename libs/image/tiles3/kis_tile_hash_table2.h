@@ -19,6 +19,8 @@
 #ifndef KIS_TILEHASHTABLE_2_H
 #define KIS_TILEHASHTABLE_2_H
 
+#include <QMutex>
+
 #include "kis_shared.h"
 #include "kis_shared_ptr.h"
 #include "3rdparty/lock_free_map/concurrent_map.h"
@@ -34,10 +36,25 @@
  * be   stored   here.    It   is   used   in   KisTiledDataManager   and
  * KisMementoManager.
  *
- * How to use:
- *   1) each hash must be unique, otherwise tiles would rewrite each-other
- *   2) 0 key is reserved, so can't be used
- *   3) col and row must be less than 0x7FFF to guarantee uniqueness of hash for each pair
+ * The lock-free map can store only unique 32-bit keys, which is not
+ * enough for the whole coordinate space of the tiles. Therefore the
+ * index has two levels:
+ *
+ *   1) the plane is split into square blocks of (2^14 x 2^14) tiles, the
+ *      blocks are stored in a lock-free map of their own, keyed by the
+ *      upper bits of the tile coordinates;
+ *
+ *   2) every block has a lock-free map of tiles, keyed by the lower bits
+ *      of the coordinates.
+ *
+ * Both levels are accessed without locks in reading paths. The blocks are
+ * created lazily and are never deleted until the table is destroyed, so a
+ * pointer to a block stays valid without any garbage collection. The block
+ * at the origin is cached in the table, so the images of a usual size never
+ * touch the first level at all.
+ *
+ * Tile coordinates may take any value that a qint32 pixel coordinate can
+ * map to, that is [-2^25, 2^25) with 64-pixel tiles.
  */
 
 template <class T>
@@ -127,68 +144,139 @@ private:
         TileType *d;
     };
 
-    inline quint32 calculateHash(qint32 col, qint32 row)
+    typedef ConcurrentMap<quint32, TileType*> LockFreeTileMap;
+    typedef typename LockFreeTileMap::Mutator LockFreeTileMapMutator;
+
+    struct Block {
+        LockFreeTileMap map;
+    };
+
+    typedef ConcurrentMap<quint32, Block*> LockFreeBlockMap;
+
+    static const int BlockBits = 14;
+    static const int BlockIndexBits = 12;
+    static const qint32 MaxTileCoordinate = 1 << (BlockBits + BlockIndexBits - 1);
+
+    /**
+     * Key of the tile inside its block. The key is never zero,
+     * because zero is reserved by the lock-free map.
+     */
+    static inline quint32 tileKey(qint32 col, qint32 row)
+    {
+        const quint32 mask = (1 << BlockBits) - 1;
+        return ((static_cast<quint32>(row) & mask) << BlockBits |
+                (static_cast<quint32>(col) & mask)) + 1;
+    }
+
+    static inline quint32 blockKey(qint32 col, qint32 row)
     {
 #ifdef SANITY_CHECK
-        KIS_ASSERT_RECOVER_NOOP(row < 0x7FFF && col < 0x7FFF);
+        KIS_ASSERT_RECOVER_NOOP(col >= -MaxTileCoordinate && col < MaxTileCoordinate &&
+                                row >= -MaxTileCoordinate && row < MaxTileCoordinate);
 #endif // SANITY_CHECK
 
-        if (col == 0 && row == 0) {
-            col = 0x7FFF;
-            row = 0x7FFF;
+        const quint32 mask = (1 << BlockIndexBits) - 1;
+        return ((static_cast<quint32>(row >> BlockBits) & mask) << BlockIndexBits |
+                (static_cast<quint32>(col >> BlockBits) & mask)) + 1;
+    }
+
+    /**
+     * Returns the block containing tile (col, row) or null if
+     * no tile has ever been added into the area
+     */
+    inline Block* existingBlock(qint32 col, qint32 row)
+    {
+        const quint32 key = blockKey(col, row);
+        if (key == m_homeBlockKey) return m_homeBlock;
+
+        m_blocks.getGC().lockRawPointerAccess();
+        Block *block = m_blocks.get(key);
+        m_blocks.getGC().unlockRawPointerAccess();
+
+        return block;
+    }
+
+    inline Block* blockLazy(qint32 col, qint32 row)
+    {
+        Block *block = existingBlock(col, row);
+        if (block) return block;
+
+        const quint32 key = blockKey(col, row);
+
+        {
+            // the first level map cannot be iterated while being changed
+            QReadLocker locker(&m_iteratorLock);
+            QMutexLocker blockLocker(&m_blockCreationLock);
+
+            m_blocks.getGC().lockRawPointerAccess();
+
+            block = m_blocks.get(key);
+            if (!block) {
+                block = new Block();
+                m_blocks.assign(key, block);
+            }
+
+            m_blocks.getGC().unlockRawPointerAccess();
         }
 
-        return ((static_cast<quint32>(row) << 16) | (static_cast<quint32>(col) & 0xFFFF));
+        // table migrations of the first level might have been postponed
+        m_blocks.getGC().update();
+
+        return block;
     }
 
-    inline void insert(quint32 idx, TileTypeSP item)
+    inline void insert(qint32 col, qint32 row, TileTypeSP item)
     {
+        Block *block = blockLazy(col, row);
+        const quint32 idx = tileKey(col, row);
+
         TileTypeSP::ref(&item, item.data());
         TileType *tile = 0;
 
         {
             QReadLocker locker(&m_iteratorLock);
-            m_map.getGC().lockRawPointerAccess();
-            tile = m_map.assign(idx, item.data());
+            block->map.getGC().lockRawPointerAccess();
+            tile = block->map.assign(idx, item.data());
         }
 
         if (tile) {
             tile->notifyDeadWithoutDetaching();
-            m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
+            block->map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
         } else {
             m_numTiles.fetchAndAddRelaxed(1);
         }
 
-        m_map.getGC().unlockRawPointerAccess();
+        block->map.getGC().unlockRawPointerAccess();
 
-        m_map.getGC().update();
+        block->map.getGC().update();
     }
 
-    inline bool erase(quint32 idx)
+    inline bool erase(Block *block, quint32 idx)
     {
-        m_map.getGC().lockRawPointerAccess();
+        block->map.getGC().lockRawPointerAccess();
 
         bool wasDeleted = false;
-        TileType *tile = m_map.erase(idx);
+        TileType *tile = block->map.erase(idx);
 
         if (tile) {
             tile->notifyDetachedFromDataManager();
 
             wasDeleted = true;
             m_numTiles.fetchAndSubRelaxed(1);
-            m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
+            block->map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
         }
 
-        m_map.getGC().unlockRawPointerAccess();
+        block->map.getGC().unlockRawPointerAccess();
 
-        m_map.getGC().update();
+        block->map.getGC().update();
         return wasDeleted;
     }
 
 private:
-    typedef ConcurrentMap<quint32, TileType*> LockFreeTileMap;
-    typedef typename LockFreeTileMap::Mutator LockFreeTileMapMutator;
-    mutable LockFreeTileMap m_map;
+    mutable LockFreeBlockMap m_blocks;
+    Block *m_homeBlock;
+    quint32 m_homeBlockKey;
+    QMutex m_blockCreationLock;
 
     /**
      * We still need something to guard changes in m_defaultTileData,
@@ -208,12 +296,15 @@ class KisTileHashTableIteratorTraits2
 public:
     typedef T TileType;
     typedef KisSharedPtr<T> TileTypeSP;
-    typedef typename ConcurrentMap<quint32, TileType*>::Iterator Iterator;
+    typedef typename KisTileHashTableTraits2<T>::Block Block;
+    typedef typename KisTileHashTableTraits2<T>::LockFreeTileMap::Iterator Iterator;
+    typedef typename KisTileHashTableTraits2<T>::LockFreeBlockMap::Iterator BlockIterator;
 
     KisTileHashTableIteratorTraits2(KisTileHashTableTraits2<T> *ht) : m_ht(ht)
     {
         m_ht->m_iteratorLock.lockForWrite();
-        m_iter.setMap(m_ht->m_map);
+        m_blockIter.setMap(m_ht->m_blocks);
+        seekNonEmptyBlock();
     }
 
     ~KisTileHashTableIteratorTraits2()
@@ -224,6 +315,11 @@ public:
     void next()
     {
         m_iter.next();
+
+        if (!m_iter.isValid()) {
+            m_blockIter.next();
+            seekNonEmptyBlock();
+        }
     }
 
     TileTypeSP tile() const
@@ -233,34 +329,50 @@ public:
 
     bool isDone() const
     {
-        return !m_iter.isValid();
+        return !m_blockIter.isValid();
     }
 
     void deleteCurrent()
     {
-        m_ht->erase(m_iter.getKey());
+        m_ht->erase(m_blockIter.getValue(), m_iter.getKey());
         next();
     }
 
     void moveCurrentToHashTable(KisTileHashTableTraits2<T> *newHashTable)
     {
         TileTypeSP tile = m_iter.getValue();
+        Block *block = m_blockIter.getValue();
+        quint32 idx = m_iter.getKey();
         next();
 
-        quint32 idx = m_ht->calculateHash(tile->col(), tile->row());
-        m_ht->erase(idx);
-        newHashTable->insert(idx, tile);
+        m_ht->erase(block, idx);
+        newHashTable->insert(tile->col(), tile->row(), tile);
+    }
+
+private:
+    void seekNonEmptyBlock()
+    {
+        while (m_blockIter.isValid()) {
+            m_iter.setMap(m_blockIter.getValue()->map);
+            if (m_iter.isValid()) break;
+
+            m_blockIter.next();
+        }
     }
 
 private:
     KisTileHashTableTraits2<T> *m_ht;
+    BlockIterator m_blockIter;
     Iterator m_iter;
 };
 
 template <class T>
 KisTileHashTableTraits2<T>::KisTileHashTableTraits2(KisMementoManager *mm)
-    : m_numTiles(0), m_defaultTileData(0), m_mementoManager(mm)
+    : m_homeBlock(new Block()),
+      m_homeBlockKey(blockKey(0, 0)),
+      m_numTiles(0), m_defaultTileData(0), m_mementoManager(mm)
 {
+    m_blocks.assign(m_homeBlockKey, m_homeBlock);
 }
 
 template <class T>
@@ -270,12 +382,18 @@ KisTileHashTableTraits2<T>::KisTileHashTableTraits2(const KisTileHashTableTraits
     setDefaultTileData(ht.m_defaultTileData);
 
     QWriteLocker locker(&ht.m_iteratorLock);
-    typename ConcurrentMap<quint32, TileType*>::Iterator iter(ht.m_map);
+    typename LockFreeBlockMap::Iterator blockIter(ht.m_blocks);
 
-    while (iter.isValid()) {
-        TileTypeSP tile = new TileType(*iter.getValue(), m_mementoManager);
-        insert(iter.getKey(), tile);
-        iter.next();
+    while (blockIter.isValid()) {
+        typename LockFreeTileMap::Iterator iter(blockIter.getValue()->map);
+
+        while (iter.isValid()) {
+            TileTypeSP tile = new TileType(*iter.getValue(), m_mementoManager);
+            insert(tile->col(), tile->row(), tile);
+            iter.next();
+        }
+
+        blockIter.next();
     }
 }
 
@@ -284,6 +402,12 @@ KisTileHashTableTraits2<T>::~KisTileHashTableTraits2()
 {
     clear();
     setDefaultTileData(0);
+
+    typename LockFreeBlockMap::Iterator blockIter(m_blocks);
+    while (blockIter.isValid()) {
+        delete blockIter.getValue();
+        blockIter.next();
+    }
 }
 
 template<class T>
@@ -295,13 +419,16 @@ bool KisTileHashTableTraits2<T>::tileExists(qint32 col, qint32 row)
 template <class T>
 typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getExistingTile(qint32 col, qint32 row)
 {
-    quint32 idx = calculateHash(col, row);
+    Block *block = existingBlock(col, row);
+    if (!block) return TileTypeSP();
+
+    quint32 idx = tileKey(col, row);
 
-    m_map.getGC().lockRawPointerAccess();
-    TileTypeSP tile = m_map.get(idx);
-    m_map.getGC().unlockRawPointerAccess();
+    block->map.getGC().lockRawPointerAccess();
+    TileTypeSP tile = block->map.get(idx);
+    block->map.getGC().unlockRawPointerAccess();
 
-    m_map.getGC().update();
+    block->map.getGC().update();
     return tile;
 }
 
@@ -309,18 +436,20 @@ template <class T>
 typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getTileLazy(qint32 col, qint32 row, bool &newTile)
 {
     newTile = false;
-    quint32 idx = calculateHash(col, row);
+
+    Block *block = blockLazy(col, row);
+    quint32 idx = tileKey(col, row);
 
     // we are going to assign a raw-pointer tile from the table
     // to a shared pointer...
-    m_map.getGC().lockRawPointerAccess();
+    block->map.getGC().lockRawPointerAccess();
 
-    TileTypeSP tile = m_map.get(idx);
+    TileTypeSP tile = block->map.get(idx);
 
     while (!tile) {
         // we shouldn't try to acquire **any** lock with
         // raw-pointer lock held
-        m_map.getGC().unlockRawPointerAccess();
+        block->map.getGC().unlockRawPointerAccess();
 
         {
             QReadLocker locker(&m_defaultPixelDataLock);
@@ -335,11 +464,11 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
         m_iteratorLock.lockForRead();
 
         // and now lock raw-pointers again
-        m_map.getGC().lockRawPointerAccess();
+        block->map.getGC().lockRawPointerAccess();
 
         // mutator might have become invalidated when
         // we released raw pointers, so we need to reinitialize it
-        LockFreeTileMapMutator mutator = m_map.insertOrFind(idx);
+        LockFreeTileMapMutator mutator = block->map.insertOrFind(idx);
         if (!mutator.getValue()) {
             discardedTile = mutator.exchangeValue(tile.data());
         } else {
@@ -355,9 +484,9 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
             tile = 0;
 
             discardedTile->notifyDeadWithoutDetaching();
-            m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(discardedTile));
+            block->map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(discardedTile));
 
-            tile = m_map.get(idx);
+            tile = block->map.get(idx);
             continue;
 
         } else {
@@ -367,20 +496,27 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getT
             tile->notifyAttachedToDataManager(m_mementoManager);
         }
     }
-    m_map.getGC().unlockRawPointerAccess();
+    block->map.getGC().unlockRawPointerAccess();
 
-    m_map.getGC().update();
+    block->map.getGC().update();
     return tile;
 }
 
 template <class T>
 typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getReadOnlyTileLazy(qint32 col, qint32 row, bool &existingTile)
 {
-    quint32 idx = calculateHash(col, row);
+    TileTypeSP tile;
+
+    Block *block = existingBlock(col, row);
+    if (block) {
+        quint32 idx = tileKey(col, row);
 
-    m_map.getGC().lockRawPointerAccess();
-    TileTypeSP tile = m_map.get(idx);
-    m_map.getGC().unlockRawPointerAccess();
+        block->map.getGC().lockRawPointerAccess();
+        tile = block->map.get(idx);
+        block->map.getGC().unlockRawPointerAccess();
+
+        block->map.getGC().update();
+    }
 
     existingTile = tile;
 
@@ -389,15 +525,13 @@ typename KisTileHashTableTraits2<T>::TileTypeSP KisTileHashTableTraits2<T>::getR
         tile = new TileType(col, row, m_defaultTileData, 0);
     }
 
-    m_map.getGC().update();
     return tile;
 }
 
 template <class T>
 void KisTileHashTableTraits2<T>::addTile(TileTypeSP tile)
 {
-    quint32 idx = calculateHash(tile->col(), tile->row());
-    insert(idx, tile);
+    insert(tile->col(), tile->row(), tile);
 }
 
 template <class T>
@@ -409,8 +543,8 @@ bool KisTileHashTableTraits2<T>::deleteTile(TileTypeSP tile)
 template <class T>
 bool KisTileHashTableTraits2<T>::deleteTile(qint32 col, qint32 row)
 {
-    quint32 idx = calculateHash(col, row);
-    return erase(idx);
+    Block *block = existingBlock(col, row);
+    return block ? erase(block, tileKey(col, row)) : false;
 }
 
 template<class T>
@@ -419,27 +553,42 @@ void KisTileHashTableTraits2<T>::clear()
     {
         QWriteLocker locker(&m_iteratorLock);
 
-        typename ConcurrentMap<quint32, TileType*>::Iterator iter(m_map);
-        TileType *tile = 0;
+        typename LockFreeBlockMap::Iterator blockIter(m_blocks);
 
-        while (iter.isValid()) {
-            m_map.getGC().lockRawPointerAccess();
-            tile = m_map.erase(iter.getKey());
+        while (blockIter.isValid()) {
+            Block *block = blockIter.getValue();
+
+            typename LockFreeTileMap::Iterator iter(block->map);
+            TileType *tile = 0;
+
+            while (iter.isValid()) {
+                block->map.getGC().lockRawPointerAccess();
+                tile = block->map.erase(iter.getKey());
 
-            if (tile) {
-                tile->notifyDetachedFromDataManager();
-                m_map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
+                if (tile) {
+                    tile->notifyDetachedFromDataManager();
+                    block->map.getGC().enqueue(&MemoryReclaimer::destroy, new MemoryReclaimer(tile));
+                }
+                block->map.getGC().unlockRawPointerAccess();
+
+                iter.next();
             }
-            m_map.getGC().unlockRawPointerAccess();
 
-            iter.next();
+            blockIter.next();
         }
 
         m_numTiles.store(0);
     }
 
-    // garbage collection must **not** be run with locks held
-    m_map.getGC().update();
+    // garbage collection must **not** be run with the iterator lock held;
+    // the creation lock is fine, nobody accesses raw pointers under it
+    QMutexLocker blockLocker(&m_blockCreationLock);
+
+    typename LockFreeBlockMap::Iterator blockIter(m_blocks);
+    while (blockIter.isValid()) {
+        blockIter.getValue()->map.getGC().update();
+        blockIter.next();
+    }
 }
 
 template <class T>
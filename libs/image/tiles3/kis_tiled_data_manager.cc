@@ -18,6 +18,7 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <QBuffer>
 #include <QRect>
 #include <QVector>
 
@@ -28,10 +29,12 @@
 #include "kis_memento_manager.h"
 #include "swap/kis_legacy_tile_compressor.h"
 #include "swap/kis_tile_compressor_factory.h"
+#include "swap/kis_lazy_tile_source.h"
 
 #include "kis_paint_device_writer.h"
 
 #include "kis_global.h"
+#include "kis_image_config.h"
 
 
 /* The data area is divided into tiles each say 64x64 pixels (defined at compiletime)
@@ -124,8 +127,11 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
     KisTileHashTableConstIterator iter(m_hashTable);
     KisTileSP tile;
 
+    const KisTileCompressor2::CompressionType compressionType =
+        KisTileCompressor2::compressionTypeFromName(KisImageConfig(true).tilesSaveCompression());
+
     KisAbstractTileCompressorSP compressor =
-        KisTileCompressorFactory::create(CURRENT_VERSION);
+        KisTileCompressorFactory::create(CURRENT_VERSION, compressionType);
 
     while ((tile = iter.tile())) {
         retval = compressor->writeTile(tile, store);
@@ -138,7 +144,7 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
 
     return retval;
 }
-bool KisTiledDataManager::read(QIODevice *stream)
+bool KisTiledDataManager::read(QIODevice *stream, bool lazyDecoding)
 {
     clear();
 
@@ -176,9 +182,29 @@ bool KisTiledDataManager::read(QIODevice *stream)
         KisTileCompressorFactory::create(tilesVersion);
 
     bool readSuccess = true;
-    for (quint32 i = 0; i < numTiles; i++) {
-        if (!compressor->readTile(stream, this)) {
-            readSuccess = false;
+
+    /**
+     * Lazy decoding is supported by the second version of the tiles
+     * format only: we need to know the size of the compressed data
+     * of every tile beforehand to be able to skip it.
+     */
+    if (lazyDecoding && tilesVersion == 2) {
+        KisLazyTileSourceSP source(new KisLazyTileSource(stream->readAll(), tilesVersion));
+
+        QBuffer buffer;
+        buffer.setData(source->data());
+        buffer.open(QIODevice::ReadOnly);
+
+        for (quint32 i = 0; i < numTiles; i++) {
+            if (!compressor->readTileLazy(&buffer, this, source)) {
+                readSuccess = false;
+            }
+        }
+    } else {
+        for (quint32 i = 0; i < numTiles; i++) {
+            if (!compressor->readTile(stream, this)) {
+                readSuccess = false;
+            }
         }
     }
 
@@ -186,6 +212,18 @@ bool KisTiledDataManager::read(QIODevice *stream)
     return readSuccess;
 }
 
+void KisTiledDataManager::addLazyTile(qint32 col, qint32 row, KisTileData *td)
+{
+    const bool wasDeleted = m_hashTable->deleteTile(col, row);
+
+    KisTileSP tile(new KisTile(col, row, td, m_mementoManager));
+    m_hashTable->addTile(tile);
+
+    if (!wasDeleted) {
+        m_extentManager.notifyTileAdded(col, row);
+    }
+}
+
 bool KisTiledDataManager::writeTilesHeader(KisPaintDeviceWriter &store, quint32 numTiles)
 {
     QString buffer;
@@ -272,7 +310,6 @@ void KisTiledDataManager::purge(const QRect& area)
 {
     QList<KisTileSP> tilesToDelete;
     {
-        const qint32 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize();
         KisTileData *tileData = m_hashTable->defaultTileData();
         tileData->blockSwapping();
         const quint8 *defaultData = tileData->data();
@@ -283,7 +320,9 @@ void KisTiledDataManager::purge(const QRect& area)
         while ((tile = iter.tile())) {
             if (tile->extent().intersects(area)) {
                 tile->lockForRead();
-                if(memcmp(defaultData, tile->data(), tileDataSize) == 0) {
+                if (tile->tileData()->isUniform() &&
+                    memcmp(defaultData, tile->data(), pixelSize()) == 0) {
+
                     tilesToDelete.push_back(tile);
                 }
                 tile->unlockForRead();
@@ -350,6 +389,12 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
     quint32 maxRunLength = qMin(clearRect.width(), KisTileData::WIDTH);
     clearPixelData = duplicatePixel(maxRunLength, clearPixel);
 
+    /**
+     * The tiles that are already filled with clearPixel are
+     * skipped, so they don't need to be copied on write
+     */
+    QVector<quint8> uniformPixel(pixelSize);
+
     KisTileData *td = 0;
     if (!pixelBytesAreDefault &&
         clearRect.width() >= KisTileData::WIDTH &&
@@ -381,7 +426,9 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
                      m_hashTable->addTile(clearedTile);
                      m_extentManager.notifyTileAdded(column, row);
                  }
-            } else {
+            } else if (!tileUniformPixel(column, row, uniformPixel.data()) ||
+                       memcmp(uniformPixel.data(), clearPixel, pixelSize)) {
+
                 const qint32 lineSize = clearTileRect.width() * pixelSize;
                 qint32 rowsRemaining = clearTileRect.height();
 
@@ -783,6 +830,140 @@ qint32 KisTiledDataManager::rowStride(qint32 x, qint32 y) const
     return KisTileData::WIDTH * pixelSize();
 }
 
+void KisTiledDataManager::prefetchTiles(qint32 firstCol, qint32 firstRow, qint32 lastCol, qint32 lastRow)
+{
+    if (!KisTileDataStore::instance()->hasSwappedTiles()) return;
+
+    for (qint32 row = firstRow; row <= lastRow; row++) {
+        for (qint32 col = firstCol; col <= lastCol; col++) {
+            KisTileSP tile = m_hashTable->getExistingTile(col, row);
+            if (tile) {
+                tile->prefetchTileData();
+            }
+        }
+    }
+}
+
+bool KisTiledDataManager::tileUniformPixel(qint32 col, qint32 row, quint8 *pixel) const
+{
+    bool unused;
+    KisTileSP tile = m_hashTable->getReadOnlyTileLazy(col, row, unused);
+
+    tile->lockForRead();
+    const bool result = tile->tileData()->isUniform();
+    if (result) {
+        memcpy(pixel, tile->data(), pixelSize());
+    }
+    tile->unlockForRead();
+
+    return result;
+}
+
+bool KisTiledDataManager::hasSameTiles(KisTiledDataManager *rhs) const
+{
+    if (rhs == this) return true;
+
+    QReadLocker locker(&m_lock);
+    QReadLocker rhsLocker(&rhs->m_lock);
+
+    if (m_pixelSize != rhs->m_pixelSize ||
+        m_hashTable->numTiles() != rhs->m_hashTable->numTiles()) {
+
+        return false;
+    }
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        KisTileSP rhsTile = rhs->m_hashTable->getExistingTile(tile->col(), tile->row());
+
+        if (!rhsTile || rhsTile->tileData() != tile->tileData()) {
+            return false;
+        }
+        iter.next();
+    }
+
+    return true;
+}
+
+quint64 KisTiledDataManager::tilesFingerprint() const
+{
+    QReadLocker locker(&m_lock);
+
+    quint64 result = m_pixelSize;
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    /**
+     * The tiles are iterated in the order of the hash table, which
+     * depends on its history, so the values are combined with
+     * a commutative operation
+     */
+    while ((tile = iter.tile())) {
+        quint64 value = quint64(quintptr(tile->tileData())) ^
+            (quint64(quint32(tile->col())) << 32 | quint32(tile->row()));
+
+        // splitmix64 finalizer
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+
+        result += value;
+        iter.next();
+    }
+
+    return result;
+}
+
+bool KisTiledDataManager::hasUnsharedTiles() const
+{
+    QReadLocker locker(&m_lock);
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        if (tile->tileData()->numUsers() <= 1) {
+            return true;
+        }
+        iter.next();
+    }
+
+    return false;
+}
+
+bool KisTiledDataManager::isRectUniform(const QRect &rect, quint8 *pixel) const
+{
+    if (rect.isEmpty()) return false;
+
+    const qint32 pixelSize = this->pixelSize();
+    QVector<quint8> tilePixel(pixelSize);
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 lastColumn = xToCol(rect.right());
+
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    if (!tileUniformPixel(firstColumn, firstRow, pixel)) return false;
+
+    for (qint32 row = firstRow; row <= lastRow; ++row) {
+        for (qint32 column = firstColumn; column <= lastColumn; ++column) {
+            if (row == firstRow && column == firstColumn) continue;
+
+            if (!tileUniformPixel(column, row, tilePixel.data()) ||
+                memcmp(pixel, tilePixel.data(), pixelSize)) {
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 void KisTiledDataManager::releaseInternalPools()
 {
     KisTileData::releaseInternalPools();
@@ -114,6 +114,48 @@ public:
         }
     }
 
+    /**
+     * Hints the tiles store that the tiles in the given range are
+     * going to be accessed soon. The tiles that have been swapped
+     * out are loaded back by a background thread, so the iterator
+     * doesn't need to wait for their decompression. The tiles that
+     * don't exist are skipped.
+     */
+    void prefetchTiles(qint32 firstCol, qint32 firstRow, qint32 lastCol, qint32 lastRow);
+
+    /**
+     * Checks whether all the pixels of \p rect have the same value and,
+     * if so, copies it into \p pixel. Only the uniformity flags cached
+     * by the tile datas are used, so every tile is scanned at most once
+     * until it is written again. The check is not exact: the rect may
+     * have uniform content even if the tiles under it are not uniform.
+     */
+    bool isRectUniform(const QRect &rect, quint8 *pixel) const;
+
+    /**
+     * Returns true if \p rhs consists of exactly the same tile datas
+     * as this data manager. Shared tile datas are copied on write, so
+     * if \p rhs is a copy of this data manager that has been kept
+     * unchanged, it means that this data manager has not been
+     * changed since the copy was made either.
+     */
+    bool hasSameTiles(KisTiledDataManager *rhs) const;
+
+    /**
+     * Returns a hash of the tile datas of the data manager. The data
+     * managers that hasSameTiles() always have the same fingerprint.
+     */
+    quint64 tilesFingerprint() const;
+
+    /**
+     * Returns true if some tile data of the data manager is not used
+     * by any other tile or memento, that is, no other data manager
+     * can have the same tiles. The check is conservative: a tile data
+     * shared between several tiles of the same data manager is
+     * considered to be shared.
+     */
+    bool hasUnsharedTiles() const;
+
     inline KisTileSP getTile(qint32 col, qint32 row, bool writable) {
         if (writable) {
             bool newTile;
@@ -209,7 +251,7 @@ protected:
      * Reads and writes the tiles 
      */
     bool write(KisPaintDeviceWriter &store);
-    bool read(QIODevice *stream);
+    bool read(QIODevice *stream, bool lazyDecoding = false);
 
     void purge(const QRect& area);
 
@@ -357,9 +399,18 @@ private:
     // and pixel size
     friend class KisAbstractTileCompressor;
     friend class KisTileDataWrapper;
+    bool tileUniformPixel(qint32 col, qint32 row, quint8 *pixel) const;
+
     qint32 xToCol(qint32 x) const;
     qint32 yToRow(qint32 y) const;
 
+    /**
+     * Adds a tile whose data has not been decoded yet. Used by
+     * KisAbstractTileCompressor::readTileLazy() only, m_lock must
+     * already be held for writing.
+     */
+    void addLazyTile(qint32 col, qint32 row, KisTileData *td);
+
 private:
     void setDefaultPixelImpl(const quint8 *defPixel);
 
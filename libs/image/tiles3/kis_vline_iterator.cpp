@@ -21,7 +21,7 @@
 
 #include <iostream>
 
-KisVLineIterator2::KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 h, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *completeListener)
+KisVLineIterator2::KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 h, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *completeListener, qint32 w)
     : KisBaseIterator(dataManager, writable, completeListener),
       m_offsetX(offsetX),
       m_offsetY(offsetY)
@@ -55,6 +55,8 @@ KisVLineIterator2::KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint
     m_column = xToCol(m_x);
     m_xInTile = calcXInTile(m_x, m_column);
 
+    m_lastPrefetchColumn = xToCol(m_left + qMax(1, w) - 1);
+
     m_topInTopmostTile = m_top - m_topRow * KisTileData::WIDTH;
 
     m_tilesCacheSize = m_bottomRow - m_topRow + 1;
@@ -123,6 +125,17 @@ void KisVLineIterator2::nextColumn()
     } else {
         ++m_column;
         m_xInTile = 0;
+
+        /**
+         * We are walking right, so ask the store to load the next
+         * column of tiles while we are processing the current one.
+         * The columns beyond the iterated area would be loaded for
+         * nothing.
+         */
+        if (m_column < m_lastPrefetchColumn) {
+            m_dataManager->prefetchTiles(m_column + 1, m_topRow, m_column + 1, m_bottomRow);
+        }
+
         preallocateTiles();
     }
     m_index = 0;
@@ -38,7 +38,12 @@ public:
 
 
 public:
-    KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 h, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *completeListener);
+    /**
+     * \p w is the number of columns the caller is going to walk
+     * through with nextColumn(). It only limits the prefetching of
+     * the swapped tiles, see KisHLineIterator2.
+     */
+    KisVLineIterator2(KisDataManager *dataManager, qint32 x, qint32 y, qint32 h, qint32 offsetX, qint32 offsetY, bool writable, KisIteratorCompleteListener *completeListener, qint32 w = 1);
     ~KisVLineIterator2() override;
 
     void resetPixelPos() override;
@@ -73,6 +78,7 @@ private:
     qint32 m_left;
     qint32 m_topRow;
     qint32 m_bottomRow;
+    qint32 m_lastPrefetchColumn;
 
     qint32 m_topInTopmostTile;
     qint32 m_xInTile;
@@ -17,6 +17,7 @@
  */
 
 #include "kis_abstract_tile_compressor.h"
+#include "kis_lazy_tile_source.h"
 
 KisAbstractTileCompressor::KisAbstractTileCompressor()
 {
@@ -25,3 +26,9 @@ KisAbstractTileCompressor::KisAbstractTileCompressor()
 KisAbstractTileCompressor::~KisAbstractTileCompressor()
 {
 }
+
+bool KisAbstractTileCompressor::readTileLazy(QIODevice *stream, KisTiledDataManager *dm, KisLazyTileSourceSP source)
+{
+    Q_UNUSED(source);
+    return readTile(stream, dm);
+}
@@ -24,6 +24,8 @@
 #include "../kis_tiled_data_manager.h"
 
 class KisPaintDeviceWriter;
+class KisLazyTileSource;
+typedef KisSharedPtr<KisLazyTileSource> KisLazyTileSourceSP;
 /**
  * Base class for compressing a tile and wrapping it with a header
  */
@@ -55,6 +57,18 @@ public:
      */
     virtual bool readTile(QIODevice *stream, KisTiledDataManager *dm) = 0;
 
+    /**
+     * Reads the header of the tile from the \a stream, but doesn't
+     * decompress its data. Instead, the tile is created with a tile
+     * data that will be decompressed from \a source on the first
+     * access. The offsets in the \a stream should correspond to the
+     * ones in the \a source.
+     *
+     * The default implementation just decompresses the tile with
+     * readTile().
+     */
+    virtual bool readTileLazy(QIODevice *stream, KisTiledDataManager *dm, KisLazyTileSourceSP source);
+
     /**
      * Compresses a \p tileData and writes it into the \p buffer.
      * The buffer must be at least tileDataBufferSize() bytes long.
@@ -102,6 +116,10 @@ protected:
     inline qint32 pixelSize(KisTiledDataManager *dm) {
         return dm->pixelSize();
     }
+
+    inline void addLazyTile(KisTiledDataManager *dm, qint32 col, qint32 row, KisTileData *td) {
+        dm->addLazyTile(col, row, td);
+    }
 };
 
 #endif /* __KIS_ABSTRACT_TILE_COMPRESSOR_H */
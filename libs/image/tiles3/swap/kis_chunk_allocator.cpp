@@ -125,6 +125,52 @@ void KisChunkAllocator::freeChunk(KisChunk chunk)
 }
 
 
+bool KisChunkAllocator::compact(quint64 maxBytes, MoveChunkFunc moveFunc, quint64 *bytesMoved)
+{
+    quint64 moved = 0;
+    quint64 lowBound = 0;
+    bool finished = true;
+
+    KisChunkDataListIterator i;
+
+    for(i = m_list.begin(); i != m_list.end(); ++i) {
+        if(i->m_begin > lowBound) {
+            if(moved > maxBytes) {
+                finished = false;
+                break;
+            }
+
+            KisChunkData newChunk(lowBound, i->size());
+
+            if(!moveFunc(*i, newChunk)) {
+                finished = false;
+                break;
+            }
+
+            *i = newChunk;
+            moved += newChunk.size();
+        }
+
+        lowBound = i->m_end + 1;
+    }
+
+    if(finished) {
+        const quint64 numSlabs = qMax(1ULL, (lowBound + m_storeSlabSize - 1) / m_storeSlabSize);
+        m_storeSize = numSlabs * m_storeSlabSize;
+    }
+
+    if(bytesMoved) {
+        *bytesMoved = moved;
+    }
+
+    return finished;
+}
+
+quint64 KisChunkAllocator::usedSize() const
+{
+    return !m_list.isEmpty() ? m_list.last().m_end + 1 : 0;
+}
+
 
 /**************************************************************/
 /*******             Debugging features                ********/
@@ -20,6 +20,7 @@
 #define __KIS_CHUNK_LIST_H
 
 #include <QLinkedList>
+#include <functional>
 #include "kritaimage_export.h"
 
 #define MiB (1ULL << 20)
@@ -139,6 +140,37 @@ public:
     KisChunk getChunk(quint64 size);
     void freeChunk(KisChunk chunk);
 
+    /**
+     * The function that copies the data of the chunk \p from
+     * to the position of the chunk \p to. Returns false if the
+     * data couldn't be moved.
+     */
+    typedef std::function<bool (const KisChunkData &from, const KisChunkData &to)> MoveChunkFunc;
+
+    /**
+     * Moves the allocated chunks towards the beginning of the
+     * store to close the gaps between them. The relative order of
+     * the chunks is preserved, and every chunk is relocated in
+     * place, so all the KisChunk objects stay valid.
+     *
+     * The pass stops as soon as more than \p maxBytes bytes are
+     * moved, so it can be split into several short steps. When the
+     * store is compacted completely, its size is shrunk to the
+     * smallest number of slabs that holds all the chunks.
+     *
+     * @param moveFunc is called before every relocation to move the
+     *        data of the chunk
+     * @param bytesMoved the number of bytes moved during this step
+     * @return true if there are no gaps left in the store
+     */
+    bool compact(quint64 maxBytes, MoveChunkFunc moveFunc, quint64 *bytesMoved);
+
+    /**
+     * Returns the end of the last allocated chunk, that is the
+     * minimal size the backing file should have
+     */
+    quint64 usedSize() const;
+
     void debugChunks();
     bool sanityCheck(bool pleaseCrash = true);
     qreal debugFragmentation(bool toStderr = true);
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_lazy_tile_source.h"
+
+#include "kis_tile_compressor_factory.h"
+#include "kis_debug.h"
+
+
+KisLazyTileSource::KisLazyTileSource(const QByteArray &data, qint32 tilesVersion)
+    : m_data(data),
+      m_tilesVersion(tilesVersion)
+{
+}
+
+KisLazyTileSource::~KisLazyTileSource()
+{
+}
+
+bool KisLazyTileSource::loadTileData(KisTileData *td, qint32 offset, qint32 size)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(offset >= 0 && offset + size <= m_data.size(), false);
+
+    KisAbstractTileCompressorSP compressor = acquireCompressor();
+
+    // the compressors never write into the source buffer
+    quint8 *buffer = reinterpret_cast<quint8*>(const_cast<char*>(m_data.constData())) + offset;
+    const bool result = compressor->decompressTileData(buffer, size, td);
+
+    releaseCompressor(compressor);
+
+    return result;
+}
+
+const QByteArray& KisLazyTileSource::data() const
+{
+    return m_data;
+}
+
+KisAbstractTileCompressorSP KisLazyTileSource::acquireCompressor()
+{
+    /**
+     * The compressors have internal buffers, so every thread needs its
+     * own one. Several threads may fetch the tiles of the same device
+     * at once, so keep a small pool of them.
+     */
+    QMutexLocker l(&m_compressorsLock);
+
+    return !m_compressors.isEmpty() ?
+        m_compressors.takeLast() :
+        KisTileCompressorFactory::create(m_tilesVersion);
+}
+
+void KisLazyTileSource::releaseCompressor(KisAbstractTileCompressorSP compressor)
+{
+    QMutexLocker l(&m_compressorsLock);
+    m_compressors.append(compressor);
+}
@@ -0,0 +1,90 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_LAZY_TILE_SOURCE_H
+#define __KIS_LAZY_TILE_SOURCE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+
+#include "kritaimage_export.h"
+#include "kis_shared.h"
+#include "kis_shared_ptr.h"
+#include "kis_abstract_tile_compressor.h"
+
+class KisTileData;
+class KisLazyTileSource;
+typedef KisSharedPtr<KisLazyTileSource> KisLazyTileSourceSP;
+
+/**
+ * Keeps the compressed tiles of a paint device read from a file, so
+ * that they could be decompressed on the first access instead of the
+ * loading time. The tile datas referring to the source are created in
+ * the same state as the swapped-out ones (without any memory allocated),
+ * so KisTileDataStore loads them on the first call to blockSwapping().
+ */
+class KRITAIMAGE_EXPORT KisLazyTileSource : public KisShared
+{
+public:
+    /**
+     * \param data the tiles stream in the format of \p tilesVersion
+     */
+    KisLazyTileSource(const QByteArray &data, qint32 tilesVersion);
+    ~KisLazyTileSource();
+
+    /**
+     * Decompresses the tile stored at \p offset into \p td. The
+     * memory of the tile data should already be allocated.
+     */
+    bool loadTileData(KisTileData *td, qint32 offset, qint32 size);
+
+    /**
+     * The stream the offsets of the chunks are counted from
+     */
+    const QByteArray& data() const;
+
+private:
+    KisAbstractTileCompressorSP acquireCompressor();
+    void releaseCompressor(KisAbstractTileCompressorSP compressor);
+
+private:
+    const QByteArray m_data;
+    const qint32 m_tilesVersion;
+
+    QMutex m_compressorsLock;
+    QVector<KisAbstractTileCompressorSP> m_compressors;
+};
+
+/**
+ * The position of a tile inside a lazy tile source. Owned by the
+ * tile data until it is loaded.
+ */
+struct KisLazyTileChunk
+{
+    KisLazyTileChunk(KisLazyTileSourceSP _source, qint32 _offset, qint32 _size)
+        : source(_source), offset(_offset), size(_size)
+    {
+    }
+
+    KisLazyTileSourceSP source;
+    qint32 offset;
+    qint32 size;
+};
+
+#endif /* __KIS_LAZY_TILE_SOURCE_H */
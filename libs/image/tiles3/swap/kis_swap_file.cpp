@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_swap_file.h"
+
+#include <QDir>
+
+#include "kis_debug.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define SWP_PREFIX "KRITA_SWAP_FILE_XXXXXX"
+
+namespace {
+
+#ifdef Q_OS_WIN
+
+inline HANDLE osHandle(int fd)
+{
+    return reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+}
+
+inline void fillOverlapped(OVERLAPPED *overlapped, quint64 offset)
+{
+    memset(overlapped, 0, sizeof(OVERLAPPED));
+    overlapped->Offset = DWORD(offset & 0xFFFFFFFFULL);
+    overlapped->OffsetHigh = DWORD(offset >> 32);
+}
+
+bool positionalRead(int fd, quint8 *buffer, quint64 size, quint64 offset)
+{
+    while (size > 0) {
+        OVERLAPPED overlapped;
+        fillOverlapped(&overlapped, offset);
+
+        DWORD bytesRead = 0;
+        if (!ReadFile(osHandle(fd), buffer, DWORD(size), &bytesRead, &overlapped) || !bytesRead) {
+            return false;
+        }
+
+        buffer += bytesRead;
+        offset += bytesRead;
+        size -= bytesRead;
+    }
+    return true;
+}
+
+bool positionalWrite(int fd, const quint8 *buffer, quint64 size, quint64 offset)
+{
+    while (size > 0) {
+        OVERLAPPED overlapped;
+        fillOverlapped(&overlapped, offset);
+
+        DWORD bytesWritten = 0;
+        if (!WriteFile(osHandle(fd), buffer, DWORD(size), &bytesWritten, &overlapped) || !bytesWritten) {
+            return false;
+        }
+
+        buffer += bytesWritten;
+        offset += bytesWritten;
+        size -= bytesWritten;
+    }
+    return true;
+}
+
+#else
+
+bool positionalRead(int fd, quint8 *buffer, quint64 size, quint64 offset)
+{
+    while (size > 0) {
+        const ssize_t bytesRead = pread(fd, buffer, size, off_t(offset));
+
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead <= 0) return false;
+
+        buffer += bytesRead;
+        offset += bytesRead;
+        size -= bytesRead;
+    }
+    return true;
+}
+
+bool positionalWrite(int fd, const quint8 *buffer, quint64 size, quint64 offset)
+{
+    while (size > 0) {
+        const ssize_t bytesWritten = pwrite(fd, buffer, size, off_t(offset));
+
+        if (bytesWritten < 0 && errno == EINTR) continue;
+        if (bytesWritten <= 0) return false;
+
+        buffer += bytesWritten;
+        offset += bytesWritten;
+        size -= bytesWritten;
+    }
+    return true;
+}
+
+#endif
+
+}
+
+KisSwapFile::KisSwapFile(const QString &swapDir)
+{
+    m_valid = true;
+
+    // see a comment in KisMemoryWindow::KisMemoryWindow()
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!swapDir.isEmpty());
+
+    QDir d(swapDir);
+    if (!d.exists()) {
+        m_valid = d.mkpath(swapDir);
+    }
+
+    const QString swapFileTemplate = swapDir + '/' + SWP_PREFIX;
+
+    if (m_valid) {
+        m_file.setFileTemplate(swapFileTemplate);
+        bool res = m_file.open();
+        if (!res || m_file.fileName().isEmpty() || m_file.handle() < 0) {
+            m_valid = false;
+        }
+    }
+
+    if (!m_valid) {
+        qWarning() << "Could not create or open swapfile; disabling swapfile" << swapFileTemplate;
+    }
+}
+
+KisSwapFile::~KisSwapFile()
+{
+}
+
+bool KisSwapFile::isValid() const
+{
+    return m_valid;
+}
+
+bool KisSwapFile::readChunk(const KisChunkData &chunk, quint8 *buffer)
+{
+    if (!m_valid) return false;
+    return positionalRead(m_file.handle(), buffer, chunk.size(), chunk.m_begin);
+}
+
+bool KisSwapFile::writeChunk(const KisChunkData &chunk, const quint8 *buffer)
+{
+    if (!m_valid) return false;
+    return positionalWrite(m_file.handle(), buffer, chunk.size(), chunk.m_begin);
+}
+
+quint64 KisSwapFile::size() const
+{
+    return m_valid ? quint64(m_file.size()) : 0;
+}
+
+bool KisSwapFile::truncate(quint64 newSize)
+{
+    if (!m_valid) return false;
+    if (newSize >= size()) return true;
+
+    return m_file.resize(qint64(newSize));
+}
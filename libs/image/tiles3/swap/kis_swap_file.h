@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_SWAP_FILE_H
+#define __KIS_SWAP_FILE_H
+
+#include <QTemporaryFile>
+
+#include "kis_chunk_allocator.h"
+
+
+/**
+ * The backing file of the swap. In contrast to KisMemoryWindow, it
+ * doesn't map any part of the file into memory. Every chunk is
+ * read or written with a single positional I/O call (pread()/pwrite()
+ * on Unix, overlapped ReadFile()/WriteFile() on Windows), so the
+ * calls don't share any state and several threads can swap in their
+ * tiles concurrently. The file grows implicitly when a chunk is
+ * written past its end.
+ *
+ * It is the responsibility of the caller to guarantee that the chunk
+ * being read is not written or freed concurrently.
+ */
+class KRITAIMAGE_EXPORT KisSwapFile
+{
+public:
+    /**
+     * @param swapDir If the dir doesn't exist, it'll be created
+     */
+    KisSwapFile(const QString &swapDir);
+    ~KisSwapFile();
+
+    bool isValid() const;
+
+    inline bool readChunk(KisChunk chunk, quint8 *buffer) {
+        return readChunk(chunk.data(), buffer);
+    }
+
+    inline bool writeChunk(KisChunk chunk, const quint8 *buffer) {
+        return writeChunk(chunk.data(), buffer);
+    }
+
+    /**
+     * Reads the contents of \p chunk into \p buffer. The buffer
+     * should be at least chunk.size() bytes long.
+     */
+    bool readChunk(const KisChunkData &chunk, quint8 *buffer);
+
+    /**
+     * Writes chunk.size() bytes of \p buffer into the place of
+     * \p chunk in the file.
+     */
+    bool writeChunk(const KisChunkData &chunk, const quint8 *buffer);
+
+    /**
+     * The current size of the file on disk
+     */
+    quint64 size() const;
+
+    /**
+     * Cuts the file down to \p newSize bytes. The caller must
+     * guarantee that no chunk is being read or written concurrently.
+     */
+    bool truncate(quint64 newSize);
+
+private:
+    QTemporaryFile m_file;
+    bool m_valid;
+};
+
+#endif /* __KIS_SWAP_FILE_H */
@@ -16,9 +16,9 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
-//#include "kis_debug.h"
+#include "kis_debug.h"
 #include "kis_swapped_data_store.h"
-#include "kis_memory_window.h"
+#include "kis_swap_file.h"
 #include "kis_image_config.h"
 
 #include "kis_tile_compressor_2.h"
@@ -26,22 +26,31 @@
 //#define COMPRESSOR_VERSION 2
 
 KisSwappedDataStore::KisSwappedDataStore()
-    : m_memoryMetric(0)
+    : m_memoryMetric(0),
+      m_swapFileSize(0),
+      m_compactionSavedSize(0),
+      m_compactionProgress(100)
 {
     KisImageConfig config(true);
     const quint64 maxSwapSize = config.maxSwapSize() * MiB;
     const quint64 swapSlabSize = config.swapSlabSize() * MiB;
-    const quint64 swapWindowSize = config.swapWindowSize() * MiB;
 
     m_allocator = new KisChunkAllocator(swapSlabSize, maxSwapSize);
-    m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
+    m_swapSpace = new KisSwapFile(config.swapDir());
 
     // FIXME: use a factory after the patch is committed
-    m_compressor = new KisTileCompressor2();
+    m_compressor = new KisTileCompressor2(
+        KisTileCompressor2::compressionTypeFromName(config.swapCompression()));
 }
 
 KisSwappedDataStore::~KisSwappedDataStore()
 {
+    ReadContext *context = 0;
+    while (m_readContexts.pop(context)) {
+        delete context->compressor;
+        delete context;
+    }
+
     delete m_compressor;
     delete m_swapSpace;
     delete m_allocator;
@@ -74,12 +83,13 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     m_compressor->compressTileData(td, (quint8*) m_buffer.data(), m_buffer.size(), bytesWritten);
 
     KisChunk chunk = m_allocator->getChunk(bytesWritten);
-    quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
-    if (!ptr) {
+    if (!m_swapSpace->writeChunk(chunk, (quint8*) m_buffer.data())) {
         qWarning() << "swap out of tile failed";
+        m_allocator->freeChunk(chunk);
         return false;
     }
-    memcpy(ptr, m_buffer.data(), bytesWritten);
+
+    m_swapFileSize = m_swapSpace->size();
 
     td->releaseMemory();
     td->setSwapChunk(chunk);
@@ -89,23 +99,64 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     return true;
 }
 
+KisSwappedDataStore::ReadContext* KisSwappedDataStore::acquireReadContext()
+{
+    ReadContext *context = 0;
+
+    if (!m_readContexts.pop(context)) {
+        KisImageConfig config(true);
+
+        context = new ReadContext();
+        context->compressor = new KisTileCompressor2(
+            KisTileCompressor2::compressionTypeFromName(config.swapCompression()));
+    }
+
+    return context;
+}
+
+void KisSwappedDataStore::releaseReadContext(ReadContext *context)
+{
+    m_readContexts.push(context);
+}
+
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
     Q_ASSERT(!td->data());
-    QMutexLocker locker(&m_lock);
 
     // see comment in swapOutTileData()
 
+    /**
+     * The chunk stays allocated until the data is read, so nobody
+     * can reuse its place in the file. The list node of the chunk
+     * is not modified by other threads, so we can access it without
+     * taking the lock.
+     */
+    QReadLocker compactionLocker(&m_compactionLock);
+
     KisChunk chunk = td->swapChunk();
+    const KisChunkData chunkData = chunk.data();
+
+    ReadContext *context = acquireReadContext();
+
+    if (context->buffer.size() < qint32(chunkData.size())) {
+        context->buffer.resize(chunkData.size());
+    }
 
     td->allocateMemory();
     td->setSwapChunk(KisChunk());
 
-    quint8 *ptr = m_swapSpace->getReadChunkPtr(chunk);
-    Q_ASSERT(ptr);
-    m_compressor->decompressTileData(ptr, chunk.size(), td);
-    m_allocator->freeChunk(chunk);
+    quint8 *ptr = (quint8*) context->buffer.data();
+    const bool readSucceeded = m_swapSpace->readChunk(chunkData, ptr);
+    KIS_SAFE_ASSERT_RECOVER_NOOP(readSucceeded);
 
+    if (readSucceeded) {
+        context->compressor->decompressTileData(ptr, chunkData.size(), td);
+    }
+
+    releaseReadContext(context);
+
+    QMutexLocker locker(&m_lock);
+    m_allocator->freeChunk(chunk);
     m_memoryMetric -= td->pixelSize();
 }
 
@@ -119,6 +170,80 @@ void KisSwappedDataStore::forgetTileData(KisTileData *td)
     m_memoryMetric -= td->pixelSize();
 }
 
+bool KisSwappedDataStore::compact(quint64 maxBytesPerStep, std::function<void()> stepCallback)
+{
+    bool finished = false;
+    qreal initialFragmentation = 0.0;
+
+    {
+        QMutexLocker locker(&m_lock);
+        initialFragmentation = m_allocator->debugFragmentation(false);
+    }
+
+    m_compactionProgress = 0;
+
+    while (!finished) {
+        if (stepCallback) {
+            stepCallback();
+        }
+
+        QWriteLocker compactionLocker(&m_compactionLock);
+        QMutexLocker locker(&m_lock);
+
+        KisChunkAllocator::MoveChunkFunc moveFunc =
+            [this] (const KisChunkData &from, const KisChunkData &to) {
+                if (m_buffer.size() < qint32(from.size())) {
+                    m_buffer.resize(from.size());
+                }
+
+                quint8 *ptr = (quint8*) m_buffer.data();
+                return m_swapSpace->readChunk(from, ptr) &&
+                    m_swapSpace->writeChunk(to, ptr);
+            };
+
+        quint64 bytesMoved = 0;
+        finished = m_allocator->compact(maxBytesPerStep, moveFunc, &bytesMoved);
+
+        if (!finished && !bytesMoved) {
+            qWarning() << "KisSwappedDataStore: failed to compact the swap file";
+            m_compactionProgress = 100;
+            return false;
+        }
+
+        if (!finished && initialFragmentation > 0.0) {
+            const qreal fragmentation = m_allocator->debugFragmentation(false);
+            m_compactionProgress = qBound(0, qRound(100.0 * (1.0 - fragmentation / initialFragmentation)), 99);
+        }
+    }
+
+    QWriteLocker compactionLocker(&m_compactionLock);
+    QMutexLocker locker(&m_lock);
+
+    const quint64 oldSize = m_swapSpace->size();
+    if (m_swapSpace->truncate(m_allocator->usedSize())) {
+        m_compactionSavedSize += oldSize - m_swapSpace->size();
+    }
+    m_swapFileSize = m_swapSpace->size();
+    m_compactionProgress = 100;
+
+    return true;
+}
+
+qint64 KisSwappedDataStore::swapFileSize() const
+{
+    return m_swapFileSize;
+}
+
+int KisSwappedDataStore::compactionProgress() const
+{
+    return m_compactionProgress;
+}
+
+qint64 KisSwappedDataStore::compactionSavedSize() const
+{
+    return m_compactionSavedSize;
+}
+
 qint64 KisSwappedDataStore::totalMemoryMetric() const
 {
     return m_memoryMetric;
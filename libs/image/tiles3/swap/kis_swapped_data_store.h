@@ -22,14 +22,19 @@
 #include "kritaimage_export.h"
 
 #include <QMutex>
+#include <QReadWriteLock>
 #include <QByteArray>
+#include <QAtomicInteger>
+#include <functional>
+
+#include "tiles3/kis_lockless_stack.h"
 
 
 class QMutex;
 class KisTileData;
 class KisAbstractTileCompressor;
 class KisChunkAllocator;
-class KisMemoryWindow;
+class KisSwapFile;
 
 class KRITAIMAGE_EXPORT KisSwappedDataStore
 {
@@ -55,6 +60,10 @@ public:
      * stored in the swap file.
      * LOCKING: the lock on the tile data should be taken
      *          by the caller before making a call.
+     *
+     * Reading and decompression of the data are done without
+     * holding the store lock, so several threads can swap in
+     * different tiles concurrently.
      */
     void swapInTileData(KisTileData *td);
 
@@ -71,21 +80,76 @@ public:
      */
     qint64 totalMemoryMetric() const;
 
+    /**
+     * Moves the swapped tiles towards the beginning of the swap file
+     * and cuts the freed tail of the file off. The work is split into
+     * steps of about \p maxBytesPerStep bytes; swapping in and out
+     * is blocked only during a step, not during the whole pass.
+     *
+     * \p stepCallback is called after every step, so that the
+     * caller could report the progress of the pass.
+     *
+     * Returns true when the file is compacted completely.
+     */
+    bool compact(quint64 maxBytesPerStep, std::function<void()> stepCallback = std::function<void()>());
+
+    /**
+     * The size of the swap file on disk
+     */
+    qint64 swapFileSize() const;
+
+    /**
+     * The progress of the running compaction pass in percents.
+     * Returns 100 if no compaction is running.
+     */
+    int compactionProgress() const;
+
+    /**
+     * Total number of bytes the compaction has given back
+     * to the file system during the session
+     */
+    qint64 compactionSavedSize() const;
+
     /**
      * Some debugging output
      */
     void debugStatistics();
 
+private:
+    /**
+     * The compressors are not thread-safe, so every swapping-in
+     * thread borrows its own compressor and read buffer
+     */
+    struct ReadContext {
+        QByteArray buffer;
+        KisAbstractTileCompressor *compressor;
+    };
+
+    ReadContext* acquireReadContext();
+    void releaseReadContext(ReadContext *context);
+
 private:
     QByteArray m_buffer;
     KisAbstractTileCompressor *m_compressor;
 
+    KisLocklessStack<ReadContext*> m_readContexts;
+
     KisChunkAllocator *m_allocator;
-    KisMemoryWindow *m_swapSpace;
+    KisSwapFile *m_swapSpace;
 
     QMutex m_lock;
 
+    /**
+     * Swapping in reads the position of the chunk without holding
+     * m_lock, so the compaction, which moves the chunks, should
+     * wait until all the readers are done
+     */
+    QReadWriteLock m_compactionLock;
+
     qint64 m_memoryMetric;
+    QAtomicInteger<qint64> m_swapFileSize;
+    QAtomicInteger<qint64> m_compactionSavedSize;
+    QAtomicInt m_compactionProgress;
 };
 
 #endif /* __KIS_SWAPPED_DATA_STORE_H */
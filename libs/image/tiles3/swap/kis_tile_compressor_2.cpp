@@ -18,21 +18,126 @@
 
 #include "kis_tile_compressor_2.h"
 #include "kis_lzf_compression.h"
+#include "kis_lazy_tile_source.h"
+#include "tiles3/kis_tile_data_store.h"
 #include <QIODevice>
 #include "kis_paint_device_writer.h"
-#define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
+#include "kis_debug.h"
+
+#include <algorithm>
+#include <config-tile-compression.h>
+
+#ifdef HAVE_LZ4
+#include "kis_lz4_compression.h"
+#endif
 
-const QString KisTileCompressor2::m_compressionName = "LZF";
+#ifdef HAVE_ZSTD
+#include "kis_zstd_compression.h"
+#endif
+
+#define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
 
 
-KisTileCompressor2::KisTileCompressor2()
+KisTileCompressor2::KisTileCompressor2(CompressionType compressionType)
+    : m_compressionType(compressionType)
 {
-    m_compression = new KisLzfCompression();
+    std::fill(m_compressions, m_compressions + MAX_COMPRESSION_FLAG + 1, nullptr);
+
+    if (!isCompressionSupported(m_compressionType)) {
+        warnTiles << "Tiles compression" << compressionName(m_compressionType)
+                  << "is not supported, falling back to LZF";
+        m_compressionType = LzfCompression;
+    }
 }
 
 KisTileCompressor2::~KisTileCompressor2()
 {
-    delete m_compression;
+    for (int i = 0; i <= MAX_COMPRESSION_FLAG; i++) {
+        delete m_compressions[i];
+    }
+}
+
+KisTileCompressor2::CompressionType KisTileCompressor2::compressionType() const
+{
+    return m_compressionType;
+}
+
+bool KisTileCompressor2::isCompressionSupported(CompressionType type)
+{
+    switch (type) {
+    case LzfCompression:
+        return true;
+    case Lz4Compression:
+#ifdef HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case ZstdCompression:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+KisTileCompressor2::CompressionType KisTileCompressor2::compressionTypeFromName(const QString &name)
+{
+    CompressionType type = LzfCompression;
+
+    if (name == compressionName(Lz4Compression)) {
+        type = Lz4Compression;
+    } else if (name == compressionName(ZstdCompression)) {
+        type = ZstdCompression;
+    }
+
+    return isCompressionSupported(type) ? type : LzfCompression;
+}
+
+QString KisTileCompressor2::compressionName(CompressionType type)
+{
+    switch (type) {
+    case LzfCompression:
+        return "LZF";
+    case Lz4Compression:
+        return "LZ4";
+    case ZstdCompression:
+        return "ZSTD";
+    }
+
+    return QString();
+}
+
+KisAbstractCompression* KisTileCompressor2::compressionForFlag(qint8 flag)
+{
+    if (flag <= RAW_DATA_FLAG || flag > MAX_COMPRESSION_FLAG) {
+        return nullptr;
+    }
+
+    KisAbstractCompression *&compression = m_compressions[flag];
+
+    if (!compression) {
+        switch (CompressionType(flag)) {
+        case LzfCompression:
+            compression = new KisLzfCompression();
+            break;
+        case Lz4Compression:
+#ifdef HAVE_LZ4
+            compression = new KisLz4Compression();
+#endif
+            break;
+        case ZstdCompression:
+#ifdef HAVE_ZSTD
+            compression = new KisZstdCompression();
+#endif
+            break;
+        }
+    }
+
+    return compression;
 }
 
 bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
@@ -60,38 +165,89 @@ bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
     return retval;
 }
 
-bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
+bool KisTileCompressor2::readTileHeader(QIODevice *stream, qint32 maxDataSize,
+                                        qint32 *x, qint32 *y, qint32 *dataSize)
 {
-    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize(dm));
-    prepareStreamingBuffer(tileDataSize);
-
     QByteArray header = stream->readLine(maxHeaderLength());
 
     QList<QByteArray> headerItems = header.trimmed().split(',');
     if (headerItems.size() == 4) {
-        qint32 x = headerItems.takeFirst().toInt();
-        qint32 y = headerItems.takeFirst().toInt();
+        *x = headerItems.takeFirst().toInt();
+        *y = headerItems.takeFirst().toInt();
         QString compressionName = headerItems.takeFirst();
-        qint32 dataSize = headerItems.takeFirst().toInt();
+        *dataSize = headerItems.takeFirst().toInt();
 
         Q_ASSERT(headerItems.isEmpty());
-        Q_ASSERT(compressionName == m_compressionName);
 
-        qint32 row = yToRow(dm, y);
-        qint32 col = xToCol(dm, x);
-
-        KisTileSP tile = dm->getTile(col, row, true);
+        /**
+         * The actual codec is defined by the flag stored in the
+         * compressed data itself, the header is checked only for
+         * the sanity of the stream.
+         */
+        if (compressionName != KisTileCompressor2::compressionName(LzfCompression) &&
+            compressionName != KisTileCompressor2::compressionName(Lz4Compression) &&
+            compressionName != KisTileCompressor2::compressionName(ZstdCompression)) {
+
+            warnTiles << "Unknown tiles compression:" << compressionName;
+            return false;
+        }
 
-        stream->read(m_streamingBuffer.data(), dataSize);
+        if (*dataSize < 0 || *dataSize > maxDataSize) {
+            warnTiles << "Corrupted tile data size:" << *dataSize;
+            return false;
+        }
 
-        tile->lockForWrite();
-        bool res = decompressTileData((quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
-        tile->unlockForWrite();
-        return res;
+        return true;
     }
     return false;
 }
 
+bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
+{
+    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize(dm));
+    prepareStreamingBuffer(tileDataSize);
+
+    qint32 x, y, dataSize;
+    if (!readTileHeader(stream, m_streamingBuffer.size(), &x, &y, &dataSize)) {
+        return false;
+    }
+
+    qint32 row = yToRow(dm, y);
+    qint32 col = xToCol(dm, x);
+
+    KisTileSP tile = dm->getTile(col, row, true);
+
+    stream->read(m_streamingBuffer.data(), dataSize);
+
+    tile->lockForWrite();
+    bool res = decompressTileData((quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
+    tile->unlockForWrite();
+    return res;
+}
+
+bool KisTileCompressor2::readTileLazy(QIODevice *stream, KisTiledDataManager *dm, KisLazyTileSourceSP source)
+{
+    const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize(dm));
+
+    qint32 x, y, dataSize;
+    if (!readTileHeader(stream, tileDataSize + 1, &x, &y, &dataSize)) {
+        return false;
+    }
+
+    const qint64 offset = stream->pos();
+    if (offset + dataSize > stream->size() || !stream->seek(offset + dataSize)) {
+        warnTiles << "Unexpected end of the tiles stream";
+        return false;
+    }
+
+    KisTileData *td = KisTileDataStore::instance()->createLazyTileData(
+        pixelSize(dm), new KisLazyTileChunk(source, offset, dataSize));
+
+    addLazyTile(dm, xToCol(dm, x), yToRow(dm, y), td);
+
+    return true;
+}
+
 void KisTileCompressor2::prepareStreamingBuffer(qint32 tileDataSize)
 {
     /**
@@ -101,9 +257,9 @@ void KisTileCompressor2::prepareStreamingBuffer(qint32 tileDataSize)
     m_streamingBuffer.resize(tileDataSize + 1);
 }
 
-void KisTileCompressor2::prepareWorkBuffers(qint32 tileDataSize)
+void KisTileCompressor2::prepareWorkBuffers(KisAbstractCompression *compression, qint32 tileDataSize)
 {
-    const qint32 bufferSize = m_compression->outputBufferSize(tileDataSize);
+    const qint32 bufferSize = compression->outputBufferSize(tileDataSize);
 
     m_linearizationBuffer.resize(tileDataSize);
     m_compressionBuffer.resize(bufferSize);
@@ -121,16 +277,19 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
     Q_UNUSED(bufferSize);
     Q_ASSERT(bufferSize >= tileDataSize + 1);
 
-    prepareWorkBuffers(tileDataSize);
+    KisAbstractCompression *compression = compressionForFlag(m_compressionType);
+    Q_ASSERT(compression);
+
+    prepareWorkBuffers(compression, tileDataSize);
 
     KisAbstractCompression::linearizeColors(tileData->data(), (quint8*)m_linearizationBuffer.data(),
                                             tileDataSize, pixelSize);
 
-    compressedBytes = m_compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
-                                              (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
+    compressedBytes = compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
+                                            (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
 
-    if(compressedBytes < tileDataSize) {
-        buffer[0] = COMPRESSED_DATA_FLAG;
+    if(compressedBytes > 0 && compressedBytes < tileDataSize) {
+        buffer[0] = m_compressionType;
         memcpy(buffer + 1, m_compressionBuffer.data(), compressedBytes);
         bytesWritten = compressedBytes + 1;
     }
@@ -148,12 +307,19 @@ bool KisTileCompressor2::decompressTileData(quint8 *buffer,
     const qint32 pixelSize = tileData->pixelSize();
     const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
 
-    if(buffer[0] == COMPRESSED_DATA_FLAG) {
-        prepareWorkBuffers(tileDataSize);
+    if(buffer[0] != RAW_DATA_FLAG) {
+        KisAbstractCompression *compression = compressionForFlag(buffer[0]);
+
+        if (!compression) {
+            warnTiles << "Tile data is compressed with an unsupported codec:" << int(buffer[0]);
+            return false;
+        }
+
+        prepareWorkBuffers(compression, tileDataSize);
 
         qint32 bytesWritten;
-        bytesWritten = m_compression->decompress(buffer + 1, bufferSize - 1,
-                                                 (quint8*)m_linearizationBuffer.data(), tileDataSize);
+        bytesWritten = compression->decompress(buffer + 1, bufferSize - 1,
+                                               (quint8*)m_linearizationBuffer.data(), tileDataSize);
         if (bytesWritten == tileDataSize) {
             KisAbstractCompression::delinearizeColors((quint8*)m_linearizationBuffer.data(),
                                                       tileData->data(),
@@ -191,5 +357,5 @@ inline QString KisTileCompressor2::getHeader(KisTileSP tile,
     qint32 width, height;
     tile->extent().getRect(&x, &y, &width, &height);
 
-    return QString("%1,%2,%3,%4\n").arg(x).arg(y).arg(m_compressionName).arg(compressedSize);
+    return QString("%1,%2,%3,%4\n").arg(x).arg(y).arg(compressionName(m_compressionType)).arg(compressedSize);
 }
@@ -23,14 +23,35 @@
 
 class KisAbstractCompression;
 
+/**
+ * The second version of the tiles format. Every tile is tagged with the
+ * codec that was used for compressing it (both, in the header of the
+ * stream and in the first byte of the compressed buffer), so the tiles
+ * compressed with different codecs can be freely mixed in the same
+ * stream or swap file. The codec used for writing is selected in the
+ * constructor, the reading side picks up the codec from the tag.
+ */
 class KRITAIMAGE_EXPORT KisTileCompressor2 : public KisAbstractTileCompressor
 {
 public:
-    KisTileCompressor2();
+    /**
+     * The values are written into the swap and into .kra files, so
+     * they must never be changed. LzfCompression corresponds to the
+     * "compressed" flag used by the older versions of Krita.
+     */
+    enum CompressionType {
+        LzfCompression = 1,
+        Lz4Compression = 2,
+        ZstdCompression = 3
+    };
+
+public:
+    KisTileCompressor2(CompressionType compressionType = LzfCompression);
     ~KisTileCompressor2() override;
 
     bool writeTile(KisTileSP tile, KisPaintDeviceWriter &store) override;
     bool readTile(QIODevice *io, KisTiledDataManager *dm) override;
+    bool readTileLazy(QIODevice *stream, KisTiledDataManager *dm, KisLazyTileSourceSP source) override;
 
 
     void compressTileData(KisTileData *tileData,quint8 *buffer,
@@ -38,6 +59,21 @@ public:
     bool decompressTileData(quint8 *buffer, qint32 bufferSize, KisTileData *tileData) override;
     qint32 tileDataBufferSize(KisTileData *tileData) override;
 
+    CompressionType compressionType() const;
+
+    /**
+     * \return true if the codec has been compiled in
+     */
+    static bool isCompressionSupported(CompressionType type);
+
+    /**
+     * Converts codec name ("LZF", "LZ4" or "ZSTD") into its type. If
+     * the codec is unknown or not supported by the current build, LZF
+     * is returned.
+     */
+    static CompressionType compressionTypeFromName(const QString &name);
+    static QString compressionName(CompressionType type);
+
 private:
     /**
      * Quite self describing
@@ -45,20 +81,24 @@ private:
     qint32 maxHeaderLength();
 
     QString getHeader(KisTileSP tile, qint32 compressedSize);
+    bool readTileHeader(QIODevice *stream, qint32 maxDataSize,
+                        qint32 *x, qint32 *y, qint32 *dataSize);
 
-    void prepareWorkBuffers(qint32 tileDataSize);
+    void prepareWorkBuffers(KisAbstractCompression *compression, qint32 tileDataSize);
     void prepareStreamingBuffer(qint32 tileDataSize);
 
+    KisAbstractCompression* compressionForFlag(qint8 flag);
+
 private:
     static const qint8 RAW_DATA_FLAG = 0;
-    static const qint8 COMPRESSED_DATA_FLAG = 1;
+    static const qint8 MAX_COMPRESSION_FLAG = ZstdCompression;
 
 private:
     QByteArray m_linearizationBuffer;
     QByteArray m_compressionBuffer;
     QByteArray m_streamingBuffer;
-    KisAbstractCompression *m_compression;
-    static const QString m_compressionName;
+    CompressionType m_compressionType;
+    KisAbstractCompression *m_compressions[MAX_COMPRESSION_FLAG + 1];
 };
 
 #endif /* __KIS_TILE_COMPRESSOR_2_H */
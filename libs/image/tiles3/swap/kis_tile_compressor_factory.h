@@ -25,13 +25,19 @@
 class KRITAIMAGE_EXPORT KisTileCompressorFactory
 {
 public:
-    static KisAbstractTileCompressorSP create(qint32 version) {
+    /**
+     * Creates a compressor for the tiles format \p version. The
+     * \p compressionType is used for writing the tiles only, on
+     * reading the codec is detected automatically.
+     */
+    static KisAbstractTileCompressorSP create(qint32 version,
+                                              KisTileCompressor2::CompressionType compressionType = KisTileCompressor2::LzfCompression) {
         switch(version) {
         case 1:
             return KisAbstractTileCompressorSP(new KisLegacyTileCompressor());
             break;
         case 2:
-            return KisAbstractTileCompressorSP(new KisTileCompressor2());
+            return KisAbstractTileCompressorSP(new KisTileCompressor2(compressionType));
             break;
         default:
             qFatal("Unknown version of the tiles");
@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_data_prefetcher.h"
+
+#include <QMutex>
+#include <QSemaphore>
+#include <QQueue>
+
+#include "tiles3/kis_tile_data.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "kis_debug.h"
+
+/**
+ * Two rows of tiles of a 8K image
+ */
+const int KisTileDataPrefetcher::MAX_QUEUE_SIZE = 256;
+
+
+struct Q_DECL_HIDDEN KisTileDataPrefetcher::Private
+{
+    QSemaphore semaphore;
+    QAtomicInt shouldExitFlag;
+    KisTileDataStore *store;
+
+    QMutex queueLock;
+    QQueue<KisTileData*> queue;
+};
+
+KisTileDataPrefetcher::KisTileDataPrefetcher(KisTileDataStore *store)
+    : QThread(),
+      m_d(new Private())
+{
+    m_d->shouldExitFlag = 0;
+    m_d->store = store;
+}
+
+KisTileDataPrefetcher::~KisTileDataPrefetcher()
+{
+    dropQueue();
+    delete m_d;
+}
+
+void KisTileDataPrefetcher::prefetch(KisTileData *td)
+{
+    {
+        QMutexLocker l(&m_d->queueLock);
+        if (m_d->queue.size() >= MAX_QUEUE_SIZE) return;
+
+        td->ref();
+        m_d->queue.enqueue(td);
+    }
+
+    m_d->semaphore.release();
+}
+
+void KisTileDataPrefetcher::terminatePrefetcher()
+{
+    unsigned long exitTimeout = 100;
+    do {
+        m_d->shouldExitFlag = true;
+        m_d->semaphore.release();
+    } while(!wait(exitTimeout));
+
+    dropQueue();
+}
+
+void KisTileDataPrefetcher::dropQueue()
+{
+    QMutexLocker l(&m_d->queueLock);
+
+    while (!m_d->queue.isEmpty()) {
+        m_d->queue.dequeue()->deref();
+    }
+}
+
+void KisTileDataPrefetcher::run()
+{
+    while (1) {
+        m_d->semaphore.acquire();
+
+        if (m_d->shouldExitFlag)
+            return;
+
+        KisTileData *td = 0;
+
+        {
+            QMutexLocker l(&m_d->queueLock);
+            if (m_d->queue.isEmpty()) continue;
+            td = m_d->queue.dequeue();
+        }
+
+        /**
+         * If the data is still in the swap, blockSwapping() will
+         * load it and reset its age, so that the swapper didn't
+         * push it back before the iterator comes.
+         */
+        td->blockSwapping();
+        td->unblockSwapping();
+
+        td->deref();
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_TILE_DATA_PREFETCHER_H_
+#define KIS_TILE_DATA_PREFETCHER_H_
+
+#include <QThread>
+
+#include "kritaimage_export.h"
+
+
+class KisTileDataStore;
+class KisTileData;
+
+/**
+ * A background thread that loads the tile data from the swap before
+ * the iterators actually reach them. The iterators announce the tiles
+ * they are going to walk through via
+ * KisTiledDataManager::prefetchTiles(), so the decompression of the
+ * swapped tiles overlaps with the processing of the previous ones.
+ *
+ * The prefetching is just a hint: if the queue is full, or the tile
+ * has already been loaded by someone else, the request is dropped.
+ */
+class KRITAIMAGE_EXPORT KisTileDataPrefetcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    KisTileDataPrefetcher(KisTileDataStore *store);
+    ~KisTileDataPrefetcher() override;
+
+    /**
+     * Queue \p td for loading from the swap. The prefetcher takes its
+     * own reference to the tile data, so the caller must only
+     * guarantee that \p td is alive during the call.
+     */
+    void prefetch(KisTileData *td);
+
+    void terminatePrefetcher();
+
+private:
+    void run() override;
+    void dropQueue();
+
+private:
+    static const int MAX_QUEUE_SIZE;
+
+private:
+    struct Private;
+    Private * const m_d;
+};
+
+#endif /* KIS_TILE_DATA_PREFETCHER_H_ */
@@ -24,6 +24,7 @@
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
 #include "kis_debug.h"
+#include "kis_memory_statistics_server.h"
 
 #define SEC 1000
 
@@ -49,6 +50,7 @@ struct Q_DECL_HIDDEN KisTileDataSwapper::Private
 public:
     QSemaphore semaphore;
     QAtomicInt shouldExitFlag;
+    QAtomicInt compactionRequestedFlag;
     KisTileDataStore *store;
     KisStoreLimits limits;
     QMutex cycleLock;
@@ -59,6 +61,7 @@ KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
       m_d(new Private())
 {
     m_d->shouldExitFlag = 0;
+    m_d->compactionRequestedFlag = 0;
     m_d->store = store;
 }
 
@@ -72,6 +75,12 @@ void KisTileDataSwapper::kick()
     m_d->semaphore.release();
 }
 
+void KisTileDataSwapper::requestCompaction()
+{
+    m_d->compactionRequestedFlag = true;
+    kick();
+}
+
 void KisTileDataSwapper::terminateSwapper()
 {
     unsigned long exitTimeout = 100;
@@ -97,6 +106,10 @@ void KisTileDataSwapper::run()
         QThread::msleep(DELAY);
 
         doJob();
+
+        if (m_d->compactionRequestedFlag.testAndSetOrdered(1, 0)) {
+            doCompaction();
+        }
     }
 }
 
@@ -140,9 +153,39 @@ void KisTileDataSwapper::doJob()
             memoryMetric -= pass<AggressiveSwapStrategy>(hardFree);
             DEBUG_VALUE(memoryMetric);
         }
+
+        /**
+         * The swapped out tiles return their memory to the tile
+         * pools, so let the pools give the unused memory back
+         * to the system
+         */
+        KisTileData::releaseUnusedPools();
     }
 }
 
+void KisTileDataSwapper::doCompaction()
+{
+    /**
+     * The thread doesn't swap tiles out while it is compacting
+     * the file, so postpone the compaction if memory is short
+     */
+    if (m_d->store->memoryMetric() > m_d->limits.hardLimitThreshold()) return;
+
+    /**
+     * The server lives in the GUI thread, so its timers should be
+     * started from there. It compresses the updates itself, so it
+     * is fine to poke it after every step of the pass.
+     */
+    auto notifyStatisticsServer = [] () {
+        QMetaObject::invokeMethod(KisMemoryStatisticsServer::instance(),
+                                  "notifyImageChanged", Qt::QueuedConnection);
+    };
+
+    DEBUG_ACTION("Started swap compaction");
+    m_d->store->compactSwap(notifyStatisticsServer);
+
+    notifyStatisticsServer();
+}
 
 class SoftSwapStrategy
 {
@@ -38,6 +38,12 @@ public:
 
     void kick();
     void terminateSwapper();
+
+    /**
+     * Asks the thread to compact the swap file after the
+     * next swapping cycle
+     */
+    void requestCompaction();
     void checkFreeMemory();
 
     void testingRereadConfig();
@@ -47,6 +53,7 @@ private:
     void run() override;
 
     void doJob();
+    void doCompaction();
     template<class strategy> qint64 pass(qint64 needToFreeMetric);
 
 private:
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_ZSTD_COMPRESSION_H
+#define __KIS_ZSTD_COMPRESSION_H
+
+#include "kis_abstract_compression.h"
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+/**
+ * A wrapper around Zstandard compression. It is slower than LZF on
+ * compression, but gives much better ratio, so it is intended for
+ * tiles written into .kra files rather than for the swap.
+ *
+ * The compression contexts are kept alive for the whole lifetime of
+ * the object, so the object must not be shared between threads.
+ */
+class KRITAIMAGE_EXPORT KisZstdCompression : public KisAbstractCompression
+{
+public:
+    KisZstdCompression(int compressionLevel = 3);
+    ~KisZstdCompression() override;
+
+    qint32 compress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength) override;
+    qint32 decompress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength) override;
+
+    qint32 outputBufferSize(qint32 dataSize) override;
+
+private:
+    int m_compressionLevel;
+    ZSTD_CCtx_s *m_compressionContext;
+    ZSTD_DCtx_s *m_decompressionContext;
+};
+
+#endif /* __KIS_ZSTD_COMPRESSION_H */
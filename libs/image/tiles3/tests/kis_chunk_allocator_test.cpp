@@ -120,6 +120,56 @@ void KisChunkAllocatorTest::testFragmentation()
 
 }
 
+void KisChunkAllocatorTest::testCompaction()
+{
+    KisChunkAllocator allocator(100, 1000);
+
+    allocator.getChunk(10);
+    KisChunk chunk2 = allocator.getChunk(15);
+    KisChunk chunk3 = allocator.getChunk(20);
+    KisChunk chunk4 = allocator.getChunk(25);
+    KisChunk chunk5 = allocator.getChunk(30);
+
+    allocator.freeChunk(chunk2);
+    allocator.freeChunk(chunk4);
+    QCOMPARE(allocator.usedSize(), 100ULL);
+
+    QList<QPair<quint64, quint64>> moves;
+    KisChunkAllocator::MoveChunkFunc moveFunc =
+        [&moves] (const KisChunkData &from, const KisChunkData &to) {
+            moves.append(qMakePair(from.m_begin, to.m_begin));
+            return true;
+        };
+
+    quint64 bytesMoved = 0;
+
+    // the first step moves a single chunk only
+    QVERIFY(!allocator.compact(0, moveFunc, &bytesMoved));
+    QCOMPARE(bytesMoved, 20ULL);
+    QCOMPARE(moves.size(), 1);
+    QCOMPARE(moves[0], qMakePair(25ULL, 10ULL));
+    QCOMPARE(chunk3.begin(), 10ULL);
+
+    QVERIFY(allocator.compact(1000, moveFunc, &bytesMoved));
+    QCOMPARE(bytesMoved, 30ULL);
+    QCOMPARE(moves.size(), 2);
+    QCOMPARE(moves[1], qMakePair(70ULL, 30ULL));
+    QCOMPARE(chunk5.begin(), 30ULL);
+    QCOMPARE(chunk5.end(), 59ULL);
+
+    QVERIFY(allocator.sanityCheck(false));
+    QCOMPARE(allocator.usedSize(), 60ULL);
+    QVERIFY(qFuzzyIsNull(allocator.debugFragmentation(false)));
+
+    // a compacted store has nothing to move
+    QVERIFY(allocator.compact(1000, moveFunc, &bytesMoved));
+    QCOMPARE(bytesMoved, 0ULL);
+    QCOMPARE(moves.size(), 2);
+
+    // the freed space is allocated again
+    KisChunk chunk6 = allocator.getChunk(40);
+    QCOMPARE(chunk6.begin(), 60ULL);
+}
 
 QTEST_MAIN(KisChunkAllocatorTest)
 
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_swap_file_test.h"
+#include <QTest>
+
+#include <QTemporaryDir>
+#include <QtConcurrent>
+
+#include "kis_debug.h"
+
+#include "../swap/kis_swap_file.h"
+
+void KisSwapFileTest::testReadWrite()
+{
+    QTemporaryDir swapDir;
+    KisSwapFile file(swapDir.path());
+    QVERIFY(file.isValid());
+
+    quint8 oddValue = 0xee;
+    const quint8 chunkLength = 10;
+
+    quint8 oddBuf[chunkLength];
+    memset(oddBuf, oddValue, chunkLength);
+
+    quint8 readBuf[chunkLength];
+
+    KisChunkData chunk1(0, chunkLength);
+    KisChunkData chunk2(1025, chunkLength);
+
+    // writing past the end of the file grows it
+    QVERIFY(file.writeChunk(chunk2, oddBuf));
+    QVERIFY(file.writeChunk(chunk1, oddBuf));
+
+    memset(readBuf, 0, chunkLength);
+    QVERIFY(file.readChunk(chunk2, readBuf));
+    QVERIFY(!memcmp(readBuf, oddBuf, chunkLength));
+
+    memset(readBuf, 0, chunkLength);
+    QVERIFY(file.readChunk(chunk1, readBuf));
+    QVERIFY(!memcmp(readBuf, oddBuf, chunkLength));
+
+    // reading past the end of the file fails
+    QVERIFY(!file.readChunk(KisChunkData(4096, chunkLength), readBuf));
+}
+
+void KisSwapFileTest::testConcurrentReads()
+{
+    QTemporaryDir swapDir;
+    KisSwapFile file(swapDir.path());
+    QVERIFY(file.isValid());
+
+    const int numChunks = 256;
+    const int chunkLength = 4096;
+
+    QByteArray buffer(chunkLength, 0);
+    for (int i = 0; i < numChunks; i++) {
+        buffer.fill(char(i));
+        QVERIFY(file.writeChunk(KisChunkData(i * chunkLength, chunkLength), (quint8*)buffer.data()));
+    }
+
+    QVector<int> indexes;
+    for (int i = 0; i < 16 * numChunks; i++) {
+        indexes << (i * 7) % numChunks;
+    }
+
+    std::function<bool (int)> readAndCheck =
+        [&file, chunkLength] (int index) {
+            QByteArray readBuffer(chunkLength, 0);
+
+            if (!file.readChunk(KisChunkData(index * chunkLength, chunkLength),
+                                (quint8*)readBuffer.data())) {
+                return false;
+            }
+
+            return readBuffer == QByteArray(chunkLength, char(index));
+        };
+
+    QVector<bool> results = QtConcurrent::blockingMapped(indexes, readAndCheck);
+
+    Q_FOREACH (bool result, results) {
+        QVERIFY(result);
+    }
+}
+
+QTEST_MAIN(KisSwapFileTest)
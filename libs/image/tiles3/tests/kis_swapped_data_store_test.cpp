@@ -131,5 +131,49 @@ void KisSwappedDataStoreTest::testRandomAccess()
         delete tileDataList[i];
 }
 
+void KisSwappedDataStoreTest::testCompaction()
+{
+    const qint32 pixelSize = 1;
+    const quint8 defaultPixel = 128;
+    const qint32 NUM_TILES = 1000;
+
+    KisImageConfig config(false);
+    config.setMaxSwapSize(4);
+    config.setSwapSlabSize(1);
+
+    KisSwappedDataStore store;
+
+    QList<KisTileData*> tileDataList;
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = new KisTileData(pixelSize, &defaultPixel, KisTileDataStore::instance());
+        memset(td->data(), COLUMN2COLOR(i), TILESIZE);
+        QVERIFY(store.trySwapOutTileData(td));
+        tileDataList.append(td);
+    }
+
+    // free the first half of the file
+    for(qint32 i = 0; i < NUM_TILES / 2; i++) {
+        store.swapInTileData(tileDataList[i]);
+    }
+
+    const qint64 fileSizeBefore = store.swapFileSize();
+    QVERIFY(fileSizeBefore > 0);
+
+    QVERIFY(store.compact(1024));
+
+    QVERIFY(store.swapFileSize() < fileSizeBefore);
+    QCOMPARE(store.compactionSavedSize(), fileSizeBefore - store.swapFileSize());
+    QCOMPARE(store.compactionProgress(), 100);
+
+    for(qint32 i = NUM_TILES / 2; i < NUM_TILES; i++) {
+        KisTileData *td = tileDataList[i];
+        store.swapInTileData(td);
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data(), TILESIZE));
+    }
+
+    for(qint32 i = 0; i < NUM_TILES; i++)
+        delete tileDataList[i];
+}
+
 QTEST_MAIN(KisSwappedDataStoreTest)
 
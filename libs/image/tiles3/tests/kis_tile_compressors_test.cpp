@@ -18,10 +18,12 @@
 
 #include "kis_tile_compressors_test.h"
 #include <QTest>
+#include <QBuffer>
 
 #include "tiles3/kis_tiled_data_manager.h"
 #include "tiles3/swap/kis_legacy_tile_compressor.h"
 #include "tiles3/swap/kis_tile_compressor_2.h"
+#include "tiles3/swap/kis_lazy_tile_source.h"
 
 #include "tiles_test_utils.h"
 
@@ -179,6 +181,126 @@ void KisTileCompressorsTest::testLowLevelRoundTripIncompressible2()
     delete compressor;
 }
 
+void KisTileCompressorsTest::testLazyRoundTrip2()
+{
+    KisTileCompressor2 compressor;
+
+    quint8 defaultPixel = 0;
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    dm.clear(64, 64, 64, 64, &oddPixel1);
+    dm.clear(128, 64, 64, 64, &oddPixel2);
+
+    KoStoreFake fakeStore;
+    KisFakePaintDeviceWriter writer(&fakeStore);
+
+    QVERIFY(compressor.writeTile(dm.getTile(1, 1, false), writer));
+    QVERIFY(compressor.writeTile(dm.getTile(2, 1, false), writer));
+
+    fakeStore.startReading();
+
+    KisLazyTileSourceSP source(new KisLazyTileSource(fakeStore.device()->readAll(), 2));
+    QBuffer buffer;
+    buffer.setData(source->data());
+    buffer.open(QIODevice::ReadOnly);
+
+    dm.clear();
+
+    QVERIFY(compressor.readTileLazy(&buffer, &dm, source));
+    QVERIFY(compressor.readTileLazy(&buffer, &dm, source));
+    QVERIFY(buffer.atEnd());
+    QCOMPARE(dm.extent(), QRect(64, 64, 128, 64));
+
+    // the tiles are decompressed on the first access only
+    quint8 value = 0;
+    dm.readBytes(&value, 70, 70, 1, 1);
+    QCOMPARE(value, oddPixel1);
+
+    // writing into a decompressed tile should not touch the other one
+    dm.writeBytes(&defaultPixel, 70, 70, 1, 1);
+    dm.readBytes(&value, 70, 70, 1, 1);
+    QCOMPARE(value, defaultPixel);
+
+    dm.readBytes(&value, 140, 70, 1, 1);
+    QCOMPARE(value, oddPixel2);
+}
+
+void KisTileCompressorsTest::testRoundTripCodecs_data()
+{
+    QTest::addColumn<int>("compressionType");
+
+    QTest::newRow("lzf") << int(KisTileCompressor2::LzfCompression);
+    QTest::newRow("lz4") << int(KisTileCompressor2::Lz4Compression);
+    QTest::newRow("zstd") << int(KisTileCompressor2::ZstdCompression);
+}
+
+void KisTileCompressorsTest::testRoundTripCodecs()
+{
+    QFETCH(int, compressionType);
+
+    const KisTileCompressor2::CompressionType type =
+        KisTileCompressor2::CompressionType(compressionType);
+
+    if (!KisTileCompressor2::isCompressionSupported(type)) {
+        QSKIP("The codec is not available in this build");
+    }
+
+    KisTileCompressor2 *compressor = new KisTileCompressor2(type);
+    QCOMPARE(compressor->compressionType(), type);
+
+    doRoundTrip(compressor);
+    doLowLevelRoundTrip(compressor);
+    doLowLevelRoundTripIncompressible(compressor);
+    delete compressor;
+}
+
+void KisTileCompressorsTest::testLowLevelMixedCodecs_data()
+{
+    testRoundTripCodecs_data();
+}
+
+void KisTileCompressorsTest::testLowLevelMixedCodecs()
+{
+    QFETCH(int, compressionType);
+
+    const KisTileCompressor2::CompressionType type =
+        KisTileCompressor2::CompressionType(compressionType);
+
+    if (!KisTileCompressor2::isCompressionSupported(type)) {
+        QSKIP("The codec is not available in this build");
+    }
+
+    const qint32 pixelSize = 1;
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    KisTiledDataManager dm(pixelSize, &oddPixel1);
+    KisTileSP tile = dm.getTile(0, 0, true);
+    tile->lockForWrite();
+
+    KisTileData *td = tile->tileData();
+
+    KisTileCompressor2 writer(type);
+    KisTileCompressor2 reader(KisTileCompressor2::LzfCompression);
+
+    qint32 bufferSize = writer.tileDataBufferSize(td);
+    quint8 *buffer = new quint8[bufferSize];
+    qint32 bytesWritten;
+    writer.compressTileData(td, buffer, bufferSize, bytesWritten);
+
+    // the data is tagged with the codec, so the reader doesn't care about its own codec
+    QCOMPARE(int(buffer[0]), compressionType);
+
+    memset(td->data(), oddPixel2, TILESIZE);
+    QVERIFY(reader.decompressTileData(buffer, bytesWritten, td));
+    QVERIFY(memoryIsFilled(oddPixel1, td->data(), TILESIZE));
+
+    delete[] buffer;
+    tile->unlock();
+}
+
 
 QTEST_MAIN(KisTileCompressorsTest)
 
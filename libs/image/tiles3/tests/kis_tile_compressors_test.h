@@ -38,6 +38,12 @@ private Q_SLOTS:
     void testRoundTrip2();
     void testLowLevelRoundTrip2();
     void testLowLevelRoundTripIncompressible2();
+    void testLazyRoundTrip2();
+
+    void testRoundTripCodecs_data();
+    void testRoundTripCodecs();
+    void testLowLevelMixedCodecs_data();
+    void testLowLevelMixedCodecs();
 };
 
 #endif /* KIS_TILE_COMPRESSORS_TEST_H */
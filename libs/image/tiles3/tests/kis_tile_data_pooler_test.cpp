@@ -111,4 +111,58 @@ void KisTileDataPoolerTest::testCycles()
     KisTileDataStore::instance()->debugClear();
 }
 
+void KisTileDataPoolerTest::testDeduplication()
+{
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 0;
+
+    KisTileDataStore::instance()->debugClear();
+
+    const int tileSize = KisTileData::WIDTH * KisTileData::HEIGHT;
+    QVector<quint8> sameData(tileSize, 42);
+    QVector<quint8> otherData(tileSize, 43);
+
+    {
+        KisTiledDataManager dm1(pixelSize, &defaultPixel);
+        KisTiledDataManager dm2(pixelSize, &defaultPixel);
+
+        dm1.writeBytes(sameData.data(), 0, 0, KisTileData::WIDTH, KisTileData::HEIGHT);
+        dm2.writeBytes(sameData.data(), 0, 0, KisTileData::WIDTH, KisTileData::HEIGHT);
+        dm2.writeBytes(otherData.data(), 64, 0, KisTileData::WIDTH, KisTileData::HEIGHT);
+
+        KisTileData *td1 = dm1.getTile(0, 0, false)->tileData();
+        KisTileData *td2 = dm2.getTile(0, 0, false)->tileData();
+        KisTileData *td3 = dm2.getTile(1, 0, false)->tileData();
+
+        QVERIFY(td1->data() != td2->data());
+
+        {
+            KisTileDataPooler pooler(KisTileDataStore::instance());
+            pooler.deduplicateTileData();
+        }
+
+        QCOMPARE(td1->data(), td2->data());
+        QVERIFY(td1->isDataShared());
+        QVERIFY(td2->isDataShared());
+        QVERIFY(!td3->isDataShared());
+
+        // default tile datas of the two devices might be merged as well
+        QVERIFY(KisTileDataStore::instance()->memoryStatistics().deduplicatedSize >= tileSize);
+
+        // writing into one of the devices should not touch the other one
+        dm1.clear(QRect(0, 0, 16, 16), &defaultPixel);
+
+        QVector<quint8> result(tileSize);
+        dm2.readBytes(result.data(), 0, 0, KisTileData::WIDTH, KisTileData::HEIGHT);
+        QCOMPARE(result, sameData);
+
+        dm1.readBytes(result.data(), 16, 16, 1, 1);
+        QCOMPARE(result[0], quint8(42));
+        dm1.readBytes(result.data(), 0, 0, 1, 1);
+        QCOMPARE(result[0], defaultPixel);
+    }
+
+    KisTileDataStore::instance()->debugClear();
+}
+
 QTEST_MAIN(KisTileDataPoolerTest)
@@ -28,6 +28,7 @@
 
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
+#include "tiles3/kis_hline_iterator.h"
 
 
 void KisTileDataStoreTest::testClockIterator()
@@ -188,5 +189,137 @@ void KisTileDataStoreTest::testSwapping()
     }
 }
 
+void KisTileDataStoreTest::testPooledPixelSizes()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+
+    KisTileData::releaseUnusedPools();
+    const qint64 initialUnusedMemory = KisTileData::unusedPoolsMemory();
+
+    Q_FOREACH (qint32 pixelSize, QVector<qint32>({1, 2, 4, 5, 8, 10, 16, 20})) {
+        QVERIFY(SimpleCache::poolIndex(pixelSize) >= 0);
+    }
+
+    /**
+     * CMYKA U8, CMYKA U16, RGBA F32 and CMYKA F32 tiles. No other
+     * tiles of these sizes are alive in the test, so their pools
+     * must be purged completely.
+     */
+    const QVector<qint32> pixelSizes({5, 10, 16, 20});
+    QList<KisTileData*> tileDataList;
+
+    Q_FOREACH (qint32 pixelSize, pixelSizes) {
+        QByteArray defaultPixel(pixelSize, 128);
+        KisTileData *item = new KisTileData(pixelSize, (const quint8*)defaultPixel.constData(), store, false);
+        store->registerTileData(item);
+
+        QVERIFY(memoryIsFilled(128, item->data(), pixelSize * TILESIZE));
+        tileDataList.append(item);
+    }
+
+    Q_FOREACH (KisTileData *item, tileDataList) {
+        store->freeTileData(item);
+    }
+
+    // the blocks stay in the pools until they are released
+    QVERIFY(KisTileData::unusedPoolsMemory() > initialUnusedMemory);
+
+    KisTileData::releaseUnusedPools();
+    QCOMPARE(KisTileData::unusedPoolsMemory(), initialUnusedMemory);
+
+    KisTileDataStore::MemoryStatistics stats = store->memoryStatistics();
+    QCOMPARE(stats.allocatorPoolSize, initialUnusedMemory);
+}
+
+void KisTileDataStoreTest::testPrefetchSwappedTiles()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    for(qint32 col = 0; col < 10; col++) {
+        KisTileSP tile = dm.getTile(col, 0, true);
+        tile->lockForWrite();
+        memset(tile->tileData()->data(), COLUMN2COLOR(col), TILESIZE);
+        tile->unlockForWrite();
+    }
+
+    store->debugSwapAll();
+    QVERIFY(store->hasSwappedTiles());
+
+    dm.prefetchTiles(0, 0, 9, 0);
+
+    /**
+     * The tiles must be loaded by the prefetcher thread itself, before
+     * anyone locks them: locking would load them synchronously anyway
+     */
+    QTRY_VERIFY(!store->hasSwappedTiles());
+
+    // the tile outside the image should just be skipped
+    dm.prefetchTiles(10, 0, 10, 0);
+
+    for(qint32 col = 0; col < 10; col++) {
+        KisTileSP tile = dm.getTile(col, 0, false);
+        tile->lockForRead();
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(col), tile->tileData()->data(), TILESIZE));
+        tile->unlockForRead();
+    }
+}
+
+void KisTileDataStoreTest::testIteratorPrefetchIsClamped()
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    const qint32 numRows = 4;
+
+    for(qint32 row = 0; row < numRows; row++) {
+        KisTileSP tile = dm.getTile(0, row, true);
+        tile->lockForWrite();
+        memset(tile->tileData()->data(), COLUMN2COLOR(row), TILESIZE);
+        tile->unlockForWrite();
+    }
+
+    store->debugSwapAll();
+    QCOMPARE(store->m_swappedStore.numTiles(), numRows);
+
+    {
+        // walk through the first two rows of tiles only
+        const qint32 h = 2 * KisTileData::HEIGHT;
+        KisHLineIterator2 it(&dm, 0, 0, KisTileData::WIDTH, 0, 0, false, 0, h);
+        for (qint32 y = 1; y < h; y++) {
+            it.nextRow();
+        }
+    }
+
+    // give the prefetcher a chance to load anything it was asked for
+    QTest::qWait(200);
+
+    // the rows below the iterated area should stay in the swap
+    QCOMPARE(store->m_swappedStore.numTiles(), numRows - 2);
+
+    {
+        /**
+         * Now the caller declares the whole area, but stops before
+         * the last row, so that row is loaded by the prefetcher only
+         */
+        const qint32 h = numRows * KisTileData::HEIGHT;
+        KisHLineIterator2 it(&dm, 0, 0, KisTileData::WIDTH, 0, 0, false, 0, h);
+        for (qint32 y = 1; y < h - KisTileData::HEIGHT; y++) {
+            it.nextRow();
+        }
+    }
+
+    QTRY_VERIFY(!store->hasSwappedTiles());
+}
+
 QTEST_MAIN(KisTileDataStoreTest)
 
@@ -539,6 +539,151 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
     QVERIFY(memoryIsFilled(oddPixel2, tile10->data(), TILESIZE));
 }
 
+void KisTiledDataManagerTest::testUniformTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+    quint8 pixel = 255;
+
+    QVERIFY(dm.isRectUniform(QRect(0,0,200,200), &pixel));
+    QCOMPARE(pixel, defaultPixel);
+    QVERIFY(!dm.isRectUniform(QRect(), &pixel));
+
+    dm.clear(QRect(0,0,64,64), &oddPixel1);
+
+    QVERIFY(dm.isRectUniform(QRect(10,10,20,20), &pixel));
+    QCOMPARE(pixel, oddPixel1);
+    QVERIFY(!dm.isRectUniform(QRect(0,0,128,64), &pixel));
+
+    // the flag should be dropped on write...
+    dm.writeBytes(&oddPixel2, 70, 10, 1, 1);
+    QVERIFY(!dm.isRectUniform(QRect(64,0,64,64), &pixel));
+
+    // ... and recalculated when the tile becomes uniform again
+    dm.writeBytes(&defaultPixel, 70, 10, 1, 1);
+    QVERIFY(dm.isRectUniform(QRect(64,0,64,64), &pixel));
+    QCOMPARE(pixel, defaultPixel);
+
+    // clearing the tile with its own color should not even copy it
+    KisTileSP tile00 = dm.getTile(0, 0, false);
+    KisTileData *tileData = tile00->tileData();
+
+    KisMementoSP memento = dm.getMemento();
+    dm.clear(QRect(8,8,16,16), &oddPixel1);
+    dm.commit();
+
+    tile00 = dm.getTile(0, 0, false);
+    QCOMPARE(tile00->tileData(), tileData);
+
+    // uniform tiles of the default color should be purged
+    QCOMPARE(dm.extent(), QRect(0,0,128,64));
+    dm.purge(QRect(0,0,128,64));
+    QCOMPARE(dm.extent(), QRect(0,0,64,64));
+}
+
+void KisTiledDataManagerTest::testHasSameTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    dm.clear(QRect(0,0,128,64), &oddPixel1);
+
+    KisTiledDataManager snapshot(dm);
+    QVERIFY(dm.hasSameTiles(&snapshot));
+    QVERIFY(snapshot.hasSameTiles(&dm));
+
+    // the write should copy the tile shared with the snapshot
+    dm.writeBytes(&oddPixel2, 70, 10, 1, 1);
+    QVERIFY(!dm.hasSameTiles(&snapshot));
+
+    quint8 value = 0;
+    snapshot.readBytes(&value, 70, 10, 1, 1);
+    QCOMPARE(value, oddPixel1);
+
+    // new tiles should be noticed as well
+    KisTiledDataManager snapshot2(dm);
+    dm.writeBytes(&oddPixel2, 200, 10, 1, 1);
+    QVERIFY(!dm.hasSameTiles(&snapshot2));
+}
+
+void KisTiledDataManagerTest::testHasUnsharedTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    dm.writeBytes(&oddPixel1, 10, 10, 1, 1);
+    dm.writeBytes(&oddPixel1, 70, 10, 1, 1);
+
+    KisTiledDataManager snapshot(dm);
+    QVERIFY(!snapshot.hasUnsharedTiles());
+    QCOMPARE(snapshot.tilesFingerprint(), dm.tilesFingerprint());
+
+    // the snapshot is now the only owner of the old tile
+    dm.writeBytes(&oddPixel2, 70, 10, 1, 1);
+    QVERIFY(snapshot.hasUnsharedTiles());
+    QVERIFY(snapshot.tilesFingerprint() != dm.tilesFingerprint());
+
+    // the same happens when the original data manager is destroyed
+    QScopedPointer<KisTiledDataManager> original(new KisTiledDataManager(1, &defaultPixel));
+    original->writeBytes(&oddPixel1, 10, 10, 1, 1);
+
+    KisTiledDataManager snapshot2(*original);
+    QVERIFY(!snapshot2.hasUnsharedTiles());
+
+    original.reset();
+    QVERIFY(snapshot2.hasUnsharedTiles());
+}
+
+void KisTiledDataManagerTest::testHugeCoordinates()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    /**
+     * The tiles are far beyond 0x7FFF and some of them have the same
+     * lower bits of the coordinates, so they would collide if the
+     * index were not two-level
+     */
+    const QVector<QPoint> tiles({QPoint(0, 0),
+                                 QPoint(1 << 14, 0),
+                                 QPoint(0, -(1 << 14)),
+                                 QPoint(30000000, 30000000),
+                                 QPoint(-30000000, 3),
+                                 QPoint(-1, -1)});
+
+    for (int i = 0; i < tiles.size(); i++) {
+        quint8 value = i + 1;
+        dm.writeBytes(&value, tiles[i].x() * 64, tiles[i].y() * 64, 1, 1);
+    }
+
+    for (int i = 0; i < tiles.size(); i++) {
+        bool existingTile = false;
+        dm.getReadOnlyTileLazy(tiles[i].x(), tiles[i].y(), existingTile);
+        QVERIFY(existingTile);
+
+        quint8 value = 0;
+        dm.readBytes(&value, tiles[i].x() * 64, tiles[i].y() * 64, 1, 1);
+        QCOMPARE(int(value), i + 1);
+    }
+
+    dm.clear();
+
+    for (int i = 0; i < tiles.size(); i++) {
+        bool existingTile = true;
+        dm.getReadOnlyTileLazy(tiles[i].x(), tiles[i].y(), existingTile);
+        QVERIFY(!existingTile);
+    }
+}
+
 //#include <valgrind/callgrind.h>
 
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
@@ -995,6 +1140,74 @@ void KisTiledDataManagerTest::stressTestExtentsColumn()
     QVERIFY(column.max() < column.min()); // really empty :)
 }
 
+void KisTiledDataManagerTest::stressTestUniformTilesConcurrentWriter()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    const QRect tileRect(0, 0, KisTileData::WIDTH, KisTileData::HEIGHT);
+    dm.clear(tileRect, 1);
+
+    /**
+     * Readers keep checking the uniformity of the tile while the
+     * writer changes it, so some of the checks happen in the middle
+     * of a write. Such checks must not cache the result.
+     */
+    struct Reader : public QRunnable
+    {
+        Reader(KisTiledDataManager &dm, const QRect &rect, QAtomicInt &stopFlag)
+            : m_dm(dm), m_rect(rect), m_stopFlag(stopFlag) {}
+
+        void run() override {
+            quint8 pixel = 0;
+            while (!m_stopFlag.loadAcquire()) {
+                m_dm.isRectUniform(m_rect, &pixel);
+            }
+        }
+
+        KisTiledDataManager &m_dm;
+        const QRect m_rect;
+        QAtomicInt &m_stopFlag;
+    };
+
+#ifdef LIMIT_LONG_TESTS
+    const int numThreads = 4;
+    const int numCycles = 10000;
+#else
+    const int numThreads = 8;
+    const int numCycles = 100000;
+#endif
+
+    QAtomicInt stopFlag;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    for(qint32 i = 0; i < numThreads - 1; i++) {
+        pool.start(new Reader(dm, tileRect, stopFlag));
+    }
+
+    int numFailures = 0;
+
+    for(qint32 i = 0; i < numCycles; i++) {
+        // even iterations make the tile non-uniform, odd ones restore it
+        const bool shouldBeUniform = i & 0x1;
+        const quint8 value = shouldBeUniform ? 1 : 2;
+
+        dm.writeBytes(&value, 10, 10, 1, 1);
+
+        quint8 pixel = 0;
+        if (dm.isRectUniform(tileRect, &pixel) != shouldBeUniform) {
+            numFailures++;
+        }
+    }
+
+    stopFlag.storeRelease(1);
+    pool.waitForDone();
+
+    QCOMPARE(numFailures, 0);
+}
+
 void KisTiledDataManagerTest::benchmaskQRegion()
 {
     QVector<QRect> rects;
@@ -52,6 +52,10 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testUniformTiles();
+    void testHasSameTiles();
+    void testHasUnsharedTiles();
+    void testHugeCoordinates();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
@@ -65,6 +69,8 @@ private Q_SLOTS:
 
     void stressTestExtentsColumn();
 
+    void stressTestUniformTilesConcurrentWriter();
+
     void benchmaskQRegion();
     void benchmaskKisRegion();
 };
@@ -20,12 +20,18 @@
 #include "KoColorConversionCache.h"
 
 #include <QHash>
-#include <QList>
-#include <QMutex>
+#include <QAtomicInt>
+#include <QSharedPointer>
 #include <QThreadStorage>
 
 #include <KoColorSpace.h>
 
+/**
+ * Maximum number of transformations kept by a single thread. When the
+ * limit is reached, the thread's cache is just reset.
+ */
+static const int maxCachedTransformationsPerThread = 64;
+
 struct KoColorConversionCacheKey {
 
     KoColorConversionCacheKey(const KoColorSpace* _src,
@@ -39,8 +45,14 @@ struct KoColorConversionCacheKey {
     {
     }
 
+    /**
+     * The keys are compared by pointers only: the entries of the cache
+     * may still refer to color spaces that have just been destroyed (see
+     * KoColorConversionCache::colorSpaceIsDestroyed()), so they must
+     * never be dereferenced here.
+     */
     bool operator==(const KoColorConversionCacheKey& rhs) const {
-        return (*src == *(rhs.src)) && (*dst == *(rhs.dst))
+        return (src == rhs.src) && (dst == rhs.dst)
                 && (renderingIntent == rhs.renderingIntent)
                 && (conversionFlags == rhs.conversionFlags);
     }
@@ -59,28 +71,57 @@ uint qHash(const KoColorConversionCacheKey& key)
 struct KoColorConversionCache::CachedTransformation {
 
     CachedTransformation(KoColorConversionTransformation* _transfo)
-        : transfo(_transfo), use(0)
+        : transfo(_transfo)
     {}
 
     ~CachedTransformation() {
         delete transfo;
     }
 
-    bool available() {
-        return use == 0;
-    }
-
     KoColorConversionTransformation* transfo;
-    int use;
 };
 
-typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
+typedef QSharedPointer<KoColorConversionCache::CachedTransformation> CachedTransformationSP;
+
+/**
+ * Every thread owns its own set of transformations, so neither the
+ * lookup nor the conversion itself needs any locking. The cache
+ * holds a strong reference to every transformation, and every
+ * KoCachedColorConversionTransformation handed out holds one more, so
+ * a transformation is never deleted while in use.
+ */
+struct ThreadLocalCache {
+    int generation = 0;
+    QHash<KoColorConversionCacheKey, CachedTransformationSP> transformations;
+};
 
 struct KoColorConversionCache::Private {
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
-    QMutex cacheMutex;
+    QThreadStorage<ThreadLocalCache*> threadCaches;
+
+    /**
+     * Incremented every time a color space is destroyed. Each thread
+     * compares it with the generation of its own cache and drops the
+     * cache if they differ. Destruction of color spaces is rare, so it
+     * is cheaper than tracking the stale entries in all the threads.
+     */
+    QAtomicInt generation;
+
+    ThreadLocalCache* localCache() {
+        ThreadLocalCache *cache = threadCaches.localData();
+
+        if (!cache) {
+            cache = new ThreadLocalCache();
+            threadCaches.setLocalData(cache);
+        }
 
-    QThreadStorage<FastPathCacheItem*> fastStorage;
+        const int currentGeneration = generation.loadAcquire();
+        if (cache->generation != currentGeneration) {
+            cache->transformations.clear();
+            cache->generation = currentGeneration;
+        }
+
+        return cache;
+    }
 };
 
 
@@ -90,9 +131,6 @@ KoColorConversionCache::KoColorConversionCache() : d(new Private)
 
 KoColorConversionCache::~KoColorConversionCache()
 {
-    Q_FOREACH (CachedTransformation* transfo, d->cache) {
-        delete transfo;
-    }
     delete d;
 }
 
@@ -103,83 +141,61 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
 {
     KoColorConversionCacheKey key(src, dst, _renderingIntent, _conversionFlags);
 
-    FastPathCacheItem *cacheItem =
-        d->fastStorage.localData();
+    ThreadLocalCache *cache = d->localCache();
 
-    if (cacheItem) {
-        if (cacheItem->first == key) {
-            return cacheItem->second;
-        }
-    }
-
-    cacheItem = 0;
+    QHash<KoColorConversionCacheKey, CachedTransformationSP>::const_iterator it =
+        cache->transformations.constFind(key);
 
-    QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
-        Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
-            if (ct->available()) {
-                ct->transfo->setSrcColorSpace(src);
-                ct->transfo->setDstColorSpace(dst);
-
-                cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
-                break;
-            }
-        }
+    if (it != cache->transformations.constEnd()) {
+        return KoCachedColorConversionTransformation(it.value());
     }
-    if (!cacheItem) {
-        KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
-        CachedTransformation* ct = new CachedTransformation(transfo);
-        d->cache.insert(key, ct);
-        cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
+
+    if (cache->transformations.size() >= maxCachedTransformationsPerThread) {
+        cache->transformations.clear();
     }
 
-    d->fastStorage.setLocalData(cacheItem);
-    return cacheItem->second;
+    KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
+    CachedTransformationSP ct(new CachedTransformation(transfo));
+    cache->transformations.insert(key, ct);
+
+    return KoCachedColorConversionTransformation(ct);
 }
 
 void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
 {
-    d->fastStorage.setLocalData(0);
-
-    QMutexLocker lock(&d->cacheMutex);
-    QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
-    for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
-        if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
-            delete it.value();
-            it = d->cache.erase(it);
-        } else {
-            ++it;
-        }
+    Q_UNUSED(cs);
+
+    d->generation.ref();
+
+    /**
+     * The caches of other threads are dropped on their next lookup,
+     * but the current one is released right away
+     */
+    ThreadLocalCache *cache = d->threadCaches.localData();
+    if (cache) {
+        cache->transformations.clear();
+        cache->generation = d->generation.loadAcquire();
     }
 }
 
 //--------- KoCachedColorConversionTransformation ----------//
 
 struct KoCachedColorConversionTransformation::Private {
-    KoColorConversionCache* cache;
-    KoColorConversionCache::CachedTransformation* transfo;
+    CachedTransformationSP transfo;
 };
 
 
-KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoColorConversionCache* cache, KoColorConversionCache::CachedTransformation* transfo) : d(new Private)
+KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(QSharedPointer<KoColorConversionCache::CachedTransformation> transfo) : d(new Private)
 {
-    Q_ASSERT(transfo->available());
-    d->cache = cache;
     d->transfo = transfo;
-    d->transfo->use++;
 }
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
 {
-    d->transfo->use++;
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
     delete d;
 }
 
@@ -187,4 +203,3 @@ const KoColorConversionTransformation* KoCachedColorConversionTransformation::tr
 {
     return d->transfo->transfo;
 }
-
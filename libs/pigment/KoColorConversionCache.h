@@ -23,11 +23,17 @@
 class KoCachedColorConversionTransformation;
 class KoColorSpace;
 
+#include <QSharedPointer>
+
 #include "KoColorConversionTransformation.h"
 
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
+ * Every thread has its own set of cached transformations, so requesting
+ * a converter takes no locks and two threads never share the same
+ * transformation object.
+ *
  * This class is not part of public API, and can be changed without notice.
  */
 class KoColorConversionCache
@@ -39,8 +45,8 @@ public:
     ~KoColorConversionCache();
 
     /**
-     * This function returns a cached color transformation if available
-     * or create one.
+     * This function returns a color transformation cached by the
+     * calling thread, or creates one.
      * @param src source color space
      * @param dst destination color space
      * @param _renderingIntent rendering intent
@@ -55,6 +61,8 @@ public:
      * This function is called by the destructor of the color space to
      * warn the cache that any pointers to this color space is going to
      * be invalid and that the cache needs to stop using those pointers.
+     * The transformations cached by other threads are dropped when
+     * these threads request a converter next time.
      * @param src source color space
      */
     void colorSpaceIsDestroyed(const KoColorSpace* src);
@@ -65,8 +73,8 @@ private:
 
 /**
  * This class hold a cached color conversion. It can only be created
- * by the cache and when it's deleted it return the transformation to
- * the pool of available color conversion transformation.
+ * by the cache and keeps the transformation alive even if the cache
+ * drops it in the meantime. It should not be passed to other threads.
  *
  * This class is not part of public API, and can be changed without notice.
  */
@@ -74,8 +82,7 @@ class KoCachedColorConversionTransformation
 {
     friend class KoColorConversionCache;
 private:
-    KoCachedColorConversionTransformation(KoColorConversionCache* cache,
-                                          KoColorConversionCache::CachedTransformation* transfo);
+    KoCachedColorConversionTransformation(QSharedPointer<KoColorConversionCache::CachedTransformation> transfo);
 public:
     KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation&);
     ~KoCachedColorConversionTransformation();
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOMATRIXTRCKERNEL_H
+#define KOMATRIXTRCKERNEL_H
+
+#include "KoMatrixTrcKernelBase.h"
+#include "KoVcMultiArchBuildSupport.h"
+
+
+template<Vc::Implementation _impl,
+         typename EnableDummyType = void>
+struct KoMatrixTrcKernel : public KoMatrixTrcKernelBase
+{
+    KoMatrixTrcKernel(const Params &params)
+        : KoMatrixTrcKernelBase(params)
+    {
+    }
+
+    void process(float *red, float *green, float *blue, qint32 nPixels) const override {
+        processScalar(red, green, blue, nPixels);
+    }
+};
+
+#ifdef HAVE_VC
+
+#include "KoStreamedMath.h"
+
+template<Vc::Implementation _impl>
+struct KoMatrixTrcKernel<
+        _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type> : public KoMatrixTrcKernelBase
+{
+    using int_v = typename KoStreamedMath<_impl>::int_v;
+
+    KoMatrixTrcKernel(const Params &params)
+        : KoMatrixTrcKernelBase(params)
+    {
+    }
+
+    void process(float *red, float *green, float *blue, qint32 nPixels) const override
+    {
+        const int block1 = nPixels / Vc::float_v::size();
+        const int block2 = nPixels % Vc::float_v::size();
+
+        const Vc::float_v m0(m_matrix[0]);
+        const Vc::float_v m1(m_matrix[1]);
+        const Vc::float_v m2(m_matrix[2]);
+        const Vc::float_v m3(m_matrix[3]);
+        const Vc::float_v m4(m_matrix[4]);
+        const Vc::float_v m5(m_matrix[5]);
+        const Vc::float_v m6(m_matrix[6]);
+        const Vc::float_v m7(m_matrix[7]);
+        const Vc::float_v m8(m_matrix[8]);
+
+        for (int i = 0; i < block1; i++) {
+            const Vc::float_v r(red, Vc::Unaligned);
+            const Vc::float_v g(green, Vc::Unaligned);
+            const Vc::float_v b(blue, Vc::Unaligned);
+
+            Vc::float_v dstR = m0 * r + m1 * g + m2 * b;
+            Vc::float_v dstG = m3 * r + m4 * g + m5 * b;
+            Vc::float_v dstB = m6 * r + m7 * g + m8 * b;
+
+            if (m_hasCurves) {
+                dstR = encode(dstR, m_curves[0]);
+                dstG = encode(dstG, m_curves[1]);
+                dstB = encode(dstB, m_curves[2]);
+            }
+
+            dstR.store(red, Vc::Unaligned);
+            dstG.store(green, Vc::Unaligned);
+            dstB.store(blue, Vc::Unaligned);
+
+            red += Vc::float_v::size();
+            green += Vc::float_v::size();
+            blue += Vc::float_v::size();
+        }
+
+        processScalar(red, green, blue, block2);
+    }
+
+    /**
+     * Looks up the value in the sampled curve with linear interpolation
+     * between the neighbouring samples, fetched with two gathers
+     */
+    inline Vc::float_v encode(Vc::float_v value, const float *curve) const
+    {
+        value = Vc::max(Vc::min(value, Vc::float_v(1.0f)), Vc::float_v(0.0f));
+
+        const Vc::float_v pos = value * Vc::float_v(m_curveScale);
+        const int_v index = Vc::min(Vc::simd_cast<int_v>(pos), int_v(m_curveSize - 2));
+        const Vc::float_v frac = pos - Vc::simd_cast<Vc::float_v>(index);
+
+        const Vc::float_v v0(curve, index);
+        const Vc::float_v v1(curve + 1, index);
+
+        return v0 + frac * (v1 - v0);
+    }
+};
+
+#endif /* HAVE_VC */
+
+#endif // KOMATRIXTRCKERNEL_H
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoMatrixTrcKernelBase.h"
+
+#include <algorithm>
+
+#include <kis_assert.h>
+
+KoMatrixTrcKernelBase::KoMatrixTrcKernelBase(const Params &params)
+    : m_curveSize(params.encodingCurves[0].size()),
+      m_curveScale(qMax(0, m_curveSize - 1)),
+      m_hasCurves(m_curveSize >= 2)
+{
+    std::copy(params.matrix, params.matrix + 9, m_matrix);
+
+    for (int i = 0; i < 3; i++) {
+        KIS_SAFE_ASSERT_RECOVER(params.encodingCurves[i].size() == m_curveSize) {
+            m_hasCurves = false;
+        }
+
+        m_curveStorage[i] = params.encodingCurves[i];
+        m_curves[i] = m_curveStorage[i].constData();
+    }
+}
+
+KoMatrixTrcKernelBase::~KoMatrixTrcKernelBase()
+{
+}
+
+void KoMatrixTrcKernelBase::processScalar(float *red, float *green, float *blue, qint32 nPixels) const
+{
+    for (int i = 0; i < nPixels; i++) {
+        const float r = red[i];
+        const float g = green[i];
+        const float b = blue[i];
+
+        red[i] = m_matrix[0] * r + m_matrix[1] * g + m_matrix[2] * b;
+        green[i] = m_matrix[3] * r + m_matrix[4] * g + m_matrix[5] * b;
+        blue[i] = m_matrix[6] * r + m_matrix[7] * g + m_matrix[8] * b;
+
+        if (m_hasCurves) {
+            red[i] = encodeScalar(red[i], 0);
+            green[i] = encodeScalar(green[i], 1);
+            blue[i] = encodeScalar(blue[i], 2);
+        }
+    }
+}
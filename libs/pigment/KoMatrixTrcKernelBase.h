@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOMATRIXTRCKERNELBASE_H
+#define KOMATRIXTRCKERNELBASE_H
+
+#include "kritapigment_export.h"
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * A kernel converting colors between two RGB matrix/TRC (matrix-shaper)
+ * profiles. It takes linear RGB values of the source profile, multiplies
+ * them by a 3x3 matrix and, optionally, encodes the result with transfer
+ * curves of the destination profile sampled into lookup tables.
+ *
+ * The values are passed in planar form and are processed in place.
+ */
+class KRITAPIGMENT_EXPORT KoMatrixTrcKernelBase
+{
+public:
+    struct Params {
+        /**
+         * Row-major 3x3 matrix converting linear RGB of the source
+         * profile into linear RGB of the destination one
+         */
+        float matrix[9];
+
+        /**
+         * Transfer curves of the destination profile, sampled uniformly
+         * in [0, 1]. If empty, the values are left linear and unclamped.
+         */
+        QVector<float> encodingCurves[3];
+    };
+
+public:
+    KoMatrixTrcKernelBase(const Params &params);
+    virtual ~KoMatrixTrcKernelBase();
+
+    virtual void process(float *red, float *green, float *blue, qint32 nPixels) const = 0;
+
+protected:
+    void processScalar(float *red, float *green, float *blue, qint32 nPixels) const;
+
+    inline float encodeScalar(float value, int channel) const {
+        value = qBound(0.0f, value, 1.0f);
+
+        const float pos = value * m_curveScale;
+        const int index = qMin(int(pos), m_curveSize - 2);
+        const float frac = pos - index;
+
+        const float *curve = m_curves[channel];
+        return curve[index] + frac * (curve[index + 1] - curve[index]);
+    }
+
+protected:
+    float m_matrix[9];
+    QVector<float> m_curveStorage[3];
+    const float *m_curves[3];
+    int m_curveSize;
+    float m_curveScale;
+    bool m_hasCurves;
+};
+
+#endif // KOMATRIXTRCKERNELBASE_H
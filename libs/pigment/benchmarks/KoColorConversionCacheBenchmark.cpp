@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoColorConversionCacheBenchmark.h"
+
+#include <QTest>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpace.h>
+
+/**
+ * The updater threads usually convert small chunks of pixels (a tile
+ * row or a dab), so the cost of fetching a converter from the cache
+ * matters as much as the conversion itself
+ */
+#define NB_PIXELS 64
+#define NB_CONVERSIONS 20000
+
+namespace {
+
+class ConversionJob : public QRunnable
+{
+public:
+    ConversionJob(const KoColorSpace *srcCs, const QList<const KoColorSpace*> &dstSpaces)
+        : m_srcCs(srcCs),
+          m_dstSpaces(dstSpaces)
+    {
+    }
+
+    void run() override {
+        QVector<quint8> src(NB_PIXELS * m_srcCs->pixelSize(), 128);
+        QVector<quint8> dst(NB_PIXELS * 8);
+
+        for (int i = 0; i < NB_CONVERSIONS; i++) {
+            const KoColorSpace *dstCs = m_dstSpaces[i % m_dstSpaces.size()];
+            m_srcCs->convertPixelsTo(src.constData(), dst.data(), dstCs, NB_PIXELS,
+                                     KoColorConversionTransformation::internalRenderingIntent(),
+                                     KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+
+private:
+    const KoColorSpace *m_srcCs;
+    QList<const KoColorSpace*> m_dstSpaces;
+};
+
+}
+
+void KoColorConversionCacheBenchmark::benchmarkConcurrentConversion_data()
+{
+    QTest::addColumn<int>("numThreads");
+
+    const int maxThreads = QThread::idealThreadCount();
+
+    for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+        QTest::newRow(QString("%1 threads").arg(numThreads).toLatin1()) << numThreads;
+    }
+    QTest::newRow(QString("%1 threads").arg(maxThreads).toLatin1()) << maxThreads;
+}
+
+void KoColorConversionCacheBenchmark::benchmarkConcurrentConversion()
+{
+    QFETCH(int, numThreads);
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCs = registry->rgb8();
+
+    // every thread alternates between two destinations
+    QList<const KoColorSpace*> dstSpaces;
+    dstSpaces << registry->rgb16() << registry->lab16();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    QBENCHMARK {
+        for (int i = 0; i < numThreads; i++) {
+            pool.start(new ConversionJob(srcCs, dstSpaces));
+        }
+        pool.waitForDone();
+    }
+}
+
+QTEST_GUILESS_MAIN(KoColorConversionCacheBenchmark)
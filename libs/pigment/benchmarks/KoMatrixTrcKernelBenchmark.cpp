@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoMatrixTrcKernelBenchmark.h"
+
+#include <QTest>
+#include <QScopedPointer>
+
+#include <algorithm>
+#include <cmath>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpace.h>
+#include <KoColorModelStandardIds.h>
+
+#include "KoMatrixTrcKernel.h"
+#include "KoMatrixTrcKernelFactory.h"
+
+#define NB_PIXELS 1000000
+
+namespace {
+
+KoMatrixTrcKernelBase::Params createParams()
+{
+    // linear Rec. 709 -> linear Rec. 2020
+    const float matrix[9] = {
+        0.6274f, 0.3293f, 0.0433f,
+        0.0691f, 0.9195f, 0.0114f,
+        0.0164f, 0.0880f, 0.8956f
+    };
+
+    KoMatrixTrcKernelBase::Params params;
+    std::copy(matrix, matrix + 9, params.matrix);
+
+    const int curveSize = 16385;
+
+    for (int ch = 0; ch < 3; ch++) {
+        params.encodingCurves[ch].resize(curveSize);
+        for (int i = 0; i < curveSize; i++) {
+            params.encodingCurves[ch][i] = std::pow(float(i) / (curveSize - 1), 1.0f / 2.2f);
+        }
+    }
+
+    return params;
+}
+
+void runKernel(const KoMatrixTrcKernelBase *kernel)
+{
+    const int chunkSize = 256;
+
+    QVector<float> red(chunkSize);
+    QVector<float> green(chunkSize);
+    QVector<float> blue(chunkSize);
+
+    for (int i = 0; i < chunkSize; i++) {
+        red[i] = float(i) / chunkSize;
+        green[i] = 1.0f - red[i];
+        blue[i] = 0.5f * red[i];
+    }
+
+    QBENCHMARK {
+        for (int i = 0; i < NB_PIXELS; i += chunkSize) {
+            kernel->process(red.data(), green.data(), blue.data(), chunkSize);
+        }
+    }
+}
+
+}
+
+void KoMatrixTrcKernelBenchmark::benchmarkScalarKernel()
+{
+    KoMatrixTrcKernel<Vc::ScalarImpl> kernel(createParams());
+    runKernel(&kernel);
+}
+
+void KoMatrixTrcKernelBenchmark::benchmarkOptimizedKernel()
+{
+    QScopedPointer<KoMatrixTrcKernelBase> kernel(KoMatrixTrcKernelFactory::create(createParams()));
+    runKernel(kernel.data());
+}
+
+void KoMatrixTrcKernelBenchmark::benchmarkConversion_data()
+{
+    QTest::addColumn<QString>("srcDepth");
+    QTest::addColumn<QString>("dstDepth");
+    QTest::addColumn<bool>("noOptimization");
+
+    QList<QPair<KoID, KoID>> pairs;
+    pairs << qMakePair(Integer8BitsColorDepthID, Integer8BitsColorDepthID);
+    pairs << qMakePair(Integer8BitsColorDepthID, Integer16BitsColorDepthID);
+    pairs << qMakePair(Integer16BitsColorDepthID, Integer8BitsColorDepthID);
+    pairs << qMakePair(Integer8BitsColorDepthID, Float32BitsColorDepthID);
+
+    typedef QPair<KoID, KoID> DepthPair;
+    Q_FOREACH (const DepthPair &pair, pairs) {
+        const QString name = QString("%1-%2").arg(pair.first.id()).arg(pair.second.id());
+
+        QTest::newRow((name + "-fast").toLatin1()) << pair.first.id() << pair.second.id() << false;
+        QTest::newRow((name + "-lcms").toLatin1()) << pair.first.id() << pair.second.id() << true;
+    }
+}
+
+void KoMatrixTrcKernelBenchmark::benchmarkConversion()
+{
+    QFETCH(QString, srcDepth);
+    QFETCH(QString, dstDepth);
+    QFETCH(bool, noOptimization);
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    // sRGB -> linear Rec. 2020 is handled by the matrix-shaper fast path,
+    // unless the optimizations are explicitly disabled
+    const KoColorSpace *srcCs = registry->colorSpace(RGBAColorModelID.id(), srcDepth, registry->rgb8()->profile());
+    const KoColorSpace *dstCs = registry->colorSpace(RGBAColorModelID.id(), dstDepth, registry->p2020G10Profile());
+    QVERIFY(srcCs);
+    QVERIFY(dstCs);
+
+    const KoColorConversionTransformation::ConversionFlags flags =
+        noOptimization ?
+        KoColorConversionTransformation::NoOptimization :
+        KoColorConversionTransformation::internalConversionFlags();
+
+    QScopedPointer<KoColorConversionTransformation> transform(
+        srcCs->createColorConverter(dstCs, KoColorConversionTransformation::internalRenderingIntent(), flags));
+
+    QVector<quint8> src(NB_PIXELS * srcCs->pixelSize());
+    QVector<quint8> dst(NB_PIXELS * dstCs->pixelSize());
+
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = quint8(i * 37);
+    }
+
+    QBENCHMARK {
+        transform->transform(src.constData(), dst.data(), NB_PIXELS);
+    }
+}
+
+QTEST_GUILESS_MAIN(KoMatrixTrcKernelBenchmark)
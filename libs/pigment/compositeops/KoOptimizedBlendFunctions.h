@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDBLENDFUNCTIONS_H
+#define KOOPTIMIZEDBLENDFUNCTIONS_H
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "KoStreamedMath.h"
+
+/**
+ * Vectorized versions of the separable blending functions from
+ * KoCompositeOpFunctions.h. Every functor implements the same
+ * formula twice: for a single float and for a Vc::float_v. All the
+ * values are normalized to the [0.0, 1.0] range, the results are
+ * \b not clamped, it is done by the compositor if needed.
+ *
+ * The functors are used by KoOptimizedCompositeOpGeneric32 and
+ * KoOptimizedCompositeOpGeneric128.
+ */
+
+struct KoOptimizedBlendMultiply {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return src * dst;
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src * dst;
+    }
+};
+
+struct KoOptimizedBlendScreen {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return src + dst - src * dst;
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src + dst - src * dst;
+    }
+};
+
+/**
+ * Overlay is Hard Light with swapped arguments, see cfOverlay()
+ */
+struct KoOptimizedBlendOverlay {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        const float dst2 = dst + dst;
+
+        return dst > 0.5f ?
+            (dst2 - 1.0f) + src - (dst2 - 1.0f) * src :
+            dst2 * src;
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        const Vc::float_v oneValue(Vc::One);
+        const Vc::float_v dst2 = dst + dst;
+        const Vc::float_v screen = (dst2 - oneValue) + src - (dst2 - oneValue) * src;
+
+        return Vc::iif(dst > Vc::float_v(0.5f), screen, dst2 * src);
+    }
+};
+
+struct KoOptimizedBlendAddition {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return src + dst;
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src + dst;
+    }
+};
+
+struct KoOptimizedBlendSubtract {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return dst - src;
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return dst - src;
+    }
+};
+
+struct KoOptimizedBlendDarken {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return qMin(src, dst);
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::min(src, dst);
+    }
+};
+
+struct KoOptimizedBlendLighten {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return qMax(src, dst);
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::max(src, dst);
+    }
+};
+
+struct KoOptimizedBlendDifference {
+    static ALWAYS_INLINE float apply(float src, float dst) {
+        return std::abs(src - dst);
+    }
+    static ALWAYS_INLINE Vc::float_v apply(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::abs(src - dst);
+    }
+};
+
+#endif // KOOPTIMIZEDBLENDFUNCTIONS_H
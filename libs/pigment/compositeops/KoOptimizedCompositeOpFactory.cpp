@@ -20,10 +20,41 @@
 #include "KoOptimizedCompositeOpFactoryPerArch.h" // vc.h must come first
 #include "KoOptimizedCompositeOpFactory.h"
 
+#include <KoCompositeOpRegistry.h>
+
 #if defined(__clang__)
 #pragma GCC diagnostic ignored "-Wundef"
 #endif
 
+namespace {
+
+bool optimizedBlendModeForId(const QString &id, KoOptimizedBlendMode *mode)
+{
+    if (id == COMPOSITE_MULT) {
+        *mode = KoOptimizedBlendMode::Multiply;
+    } else if (id == COMPOSITE_SCREEN) {
+        *mode = KoOptimizedBlendMode::Screen;
+    } else if (id == COMPOSITE_OVERLAY) {
+        *mode = KoOptimizedBlendMode::Overlay;
+    } else if (id == COMPOSITE_ADD || id == COMPOSITE_LINEAR_DODGE) {
+        *mode = KoOptimizedBlendMode::Addition;
+    } else if (id == COMPOSITE_SUBTRACT) {
+        *mode = KoOptimizedBlendMode::Subtract;
+    } else if (id == COMPOSITE_DARKEN) {
+        *mode = KoOptimizedBlendMode::Darken;
+    } else if (id == COMPOSITE_LIGHTEN) {
+        *mode = KoOptimizedBlendMode::Lighten;
+    } else if (id == COMPOSITE_DIFF) {
+        *mode = KoOptimizedBlendMode::Difference;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+}
+
 
 KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpHard32(const KoColorSpace *cs)
 {
@@ -63,3 +94,27 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    KoOptimizedGenericOpParams params = {cs, KoOptimizedBlendMode::Multiply, id, description, category};
+    if (!optimizedBlendModeForId(id, &params.mode)) return 0;
+
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32> >(params);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp64(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    KoOptimizedGenericOpParams params = {cs, KoOptimizedBlendMode::Multiply, id, description, category};
+    if (!optimizedBlendModeForId(id, &params.mode)) return 0;
+
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric64> >(params);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    KoOptimizedGenericOpParams params = {cs, KoOptimizedBlendMode::Multiply, id, description, category};
+    if (!optimizedBlendModeForId(id, &params.mode)) return 0;
+
+    return createOptimizedClass<KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128> >(params);
+}
@@ -22,6 +22,7 @@
 
 #include "kritapigment_export.h"
 
+class QString;
 class KoCompositeOp;
 class KoColorSpace;
 
@@ -46,6 +47,16 @@ public:
     static KoCompositeOp* createAlphaDarkenOpHard128(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+    /**
+     * Creates a vectorized version of a separable blending mode
+     * (Multiply, Screen, Overlay, Addition and so on). Returns null
+     * if there is no optimized implementation for \p id, then the
+     * caller should fall back to KoCompositeOpGenericSC.
+     */
+    static KoCompositeOp* createGenericOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
+    static KoCompositeOp* createGenericOp64(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
+    static KoCompositeOp* createGenericOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
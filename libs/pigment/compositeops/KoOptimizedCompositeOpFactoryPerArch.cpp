@@ -26,6 +26,9 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedCompositeOpGeneric32.h"
+#include "KoOptimizedCompositeOpGeneric64.h"
+#include "KoOptimizedCompositeOpGeneric128.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -85,3 +88,27 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpGeneric32<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric64>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric64>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpGeneric64<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpGeneric128<Vc::CurrentImplementation::current()>(param);
+}
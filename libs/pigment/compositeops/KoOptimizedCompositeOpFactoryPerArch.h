@@ -23,6 +23,7 @@
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
 
+#include <QString>
 
 class KoCompositeOp;
 class KoColorSpace;
@@ -46,6 +47,15 @@ class KoOptimizedCompositeOpAlphaDarkenCreamy128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpGeneric32;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpGeneric64;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpGeneric128;
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -56,5 +66,44 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+/**
+ * Separable blending modes that have a vectorized implementation
+ * in KoOptimizedCompositeOpGeneric32, KoOptimizedCompositeOpGeneric64 and
+ * KoOptimizedCompositeOpGeneric128
+ */
+enum class KoOptimizedBlendMode {
+    Multiply,
+    Screen,
+    Overlay,
+    Addition,
+    Subtract,
+    Darken,
+    Lighten,
+    Difference
+};
+
+struct KoOptimizedGenericOpParams
+{
+    const KoColorSpace *cs;
+    KoOptimizedBlendMode mode;
+    QString id;
+    QString description;
+    QString category;
+};
+
+/**
+ * The generic ops implement a family of blending modes, so they need
+ * more information than just a color space to be created
+ */
+template<template<Vc::Implementation I> class CompositeOp>
+struct KoOptimizedGenericCompositeOpFactoryPerArch
+{
+    typedef const KoOptimizedGenericOpParams& ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
+
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
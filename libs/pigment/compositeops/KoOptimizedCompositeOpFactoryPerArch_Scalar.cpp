@@ -23,6 +23,38 @@
 #include "KoCompositeOpAlphaDarken.h"
 #include "KoAlphaDarkenParamsWrapper.h"
 #include "KoCompositeOpOver.h"
+#include "KoCompositeOpGeneric.h"
+
+namespace {
+
+template<class Traits>
+KoCompositeOp* createScalarGenericOp(const KoOptimizedGenericOpParams &param)
+{
+    typedef typename Traits::channels_type Arg;
+
+    switch (param.mode) {
+    case KoOptimizedBlendMode::Multiply:
+        return new KoCompositeOpGenericSC<Traits, &cfMultiply<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Screen:
+        return new KoCompositeOpGenericSC<Traits, &cfScreen<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Overlay:
+        return new KoCompositeOpGenericSC<Traits, &cfOverlay<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Addition:
+        return new KoCompositeOpGenericSC<Traits, &cfAddition<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Subtract:
+        return new KoCompositeOpGenericSC<Traits, &cfSubtract<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Darken:
+        return new KoCompositeOpGenericSC<Traits, &cfDarkenOnly<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Lighten:
+        return new KoCompositeOpGenericSC<Traits, &cfLightenOnly<Arg>>(param.cs, param.id, param.description, param.category);
+    case KoOptimizedBlendMode::Difference:
+        return new KoCompositeOpGenericSC<Traits, &cfDifference<Arg>>(param.cs, param.id, param.description, param.category);
+    }
+
+    return 0;
+}
+
+}
 
 template<>
 template<>
@@ -72,3 +104,27 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoCompositeOpOver<KoRgbF32Traits>(param);
 }
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric32>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return createScalarGenericOp<KoBgrU8Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric64>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric64>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return createScalarGenericOp<KoBgrU16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128>::ReturnType
+KoOptimizedGenericCompositeOpFactoryPerArch<KoOptimizedCompositeOpGeneric128>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return createScalarGenericOp<KoRgbF32Traits>(param);
+}
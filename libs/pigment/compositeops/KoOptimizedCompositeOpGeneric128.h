@@ -0,0 +1,251 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERIC128_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERIC128_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoOptimizedBlendFunctions.h"
+#include "KoOptimizedCompositeOpFactoryPerArch.h"
+
+
+/**
+ * A vectorized version of KoCompositeOpGenericSC for 32-bit float
+ * colorspaces. The blended values are not clamped, so the HDR
+ * values are preserved in the same way as in the generic op.
+ */
+template<class BlendFunc, typename channels_type, bool alphaLocked, bool allChannelsFlag>
+struct GenericSCCompositor128 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    struct Pixel {
+        channels_type red;
+        channels_type green;
+        channels_type blue;
+        channels_type alpha;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Pixel *sp = reinterpret_cast<const Pixel*>(src);
+        Pixel *dp = reinterpret_cast<Pixel*>(dst);
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_alpha;
+        Vc::float_v dst_alpha;
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> data(const_cast<Pixel*>(sp));
+        tie(src_c1, src_c2, src_c3, src_alpha) = data[indexes];
+
+        src_alpha *= Vc::float_v(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1((float)1.0 / 255);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> dataDest(dp);
+        tie(dst_c1, dst_c2, dst_c3, dst_alpha) = dataDest[indexes];
+
+        const Vc::float_v new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+        // \see the derivation in GenericSCCompositor32::compositeVector()
+        Vc::float_v new_alpha_rec = oneValue / new_alpha;
+        new_alpha_rec.setZero(new_alpha == zeroValue);
+
+        const Vc::float_v src_weight = src_alpha * (oneValue - dst_alpha) * new_alpha_rec;
+        const Vc::float_v blend_weight = src_alpha * dst_alpha * new_alpha_rec;
+
+        dst_c1 += (src_c1 - dst_c1) * src_weight + (BlendFunc::apply(src_c1, dst_c1) - dst_c1) * blend_weight;
+        dst_c2 += (src_c2 - dst_c2) * src_weight + (BlendFunc::apply(src_c2, dst_c2) - dst_c2) * blend_weight;
+        dst_c3 += (src_c3 - dst_c3) * src_weight + (BlendFunc::apply(src_c3, dst_c3) - dst_c3) * blend_weight;
+
+        dataDest[indexes] = tie(dst_c1, dst_c2, dst_c3, new_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const channels_type *s = reinterpret_cast<const channels_type*>(src);
+        channels_type *d = reinterpret_cast<channels_type*>(dst);
+
+        const QBitArray &channelFlags = oparams.channelFlags;
+
+        if (!allChannelsFlag && d[alpha_pos] == 0.0f) {
+            KoStreamedMathFunctions::clearPixel<16>(dst);
+        }
+
+        float srcAlpha = s[alpha_pos] * opacity;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0 / 255;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha == 0.0f) return;
+
+        const float dstAlpha = d[alpha_pos];
+
+        if (alphaLocked) {
+            if (dstAlpha != 0.0f) {
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || channelFlags.at(i)) {
+                        d[i] += (BlendFunc::apply(s[i], d[i]) - d[i]) * srcAlpha;
+                    }
+                }
+            }
+        } else {
+            const float newAlpha = srcAlpha + dstAlpha - srcAlpha * dstAlpha;
+
+            if (newAlpha != 0.0f) {
+                const float srcWeight = srcAlpha * (1.0f - dstAlpha) / newAlpha;
+                const float blendWeight = srcAlpha * dstAlpha / newAlpha;
+
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || channelFlags.at(i)) {
+                        d[i] += (s[i] - d[i]) * srcWeight + (BlendFunc::apply(s[i], d[i]) - d[i]) * blendWeight;
+                    }
+                }
+            }
+
+            d[alpha_pos] = newAlpha;
+        }
+    }
+};
+
+/**
+ * An optimized version of the generic separable composite ops for the
+ * use in 16 byte colorspaces with alpha channel placed at the last
+ * channel of the pixel: C1_C2_C3_A. The actual blending function is
+ * selected by KoOptimizedBlendMode.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpGeneric128 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric128(const KoOptimizedGenericOpParams &params)
+        : KoCompositeOp(params.cs, params.id, params.description, params.category),
+          m_mode(params.mode)
+    {
+    }
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        switch (m_mode) {
+        case KoOptimizedBlendMode::Multiply:
+            composite<KoOptimizedBlendMultiply>(params);
+            break;
+        case KoOptimizedBlendMode::Screen:
+            composite<KoOptimizedBlendScreen>(params);
+            break;
+        case KoOptimizedBlendMode::Overlay:
+            composite<KoOptimizedBlendOverlay>(params);
+            break;
+        case KoOptimizedBlendMode::Addition:
+            composite<KoOptimizedBlendAddition>(params);
+            break;
+        case KoOptimizedBlendMode::Subtract:
+            composite<KoOptimizedBlendSubtract>(params);
+            break;
+        case KoOptimizedBlendMode::Darken:
+            composite<KoOptimizedBlendDarken>(params);
+            break;
+        case KoOptimizedBlendMode::Lighten:
+            composite<KoOptimizedBlendLighten>(params);
+            break;
+        case KoOptimizedBlendMode::Difference:
+            composite<KoOptimizedBlendDifference>(params);
+            break;
+        }
+    }
+
+private:
+    template <class BlendFunc>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if(params.maskRowStart) {
+            composite<true, BlendFunc>(params);
+        } else {
+            composite<false, BlendFunc>(params);
+        }
+    }
+
+    template <bool haveMask, class BlendFunc>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite128<haveMask, false, GenericSCCompositor128<BlendFunc, float, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericSCCompositor128<BlendFunc, float, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericSCCompositor128<BlendFunc, float, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericSCCompositor128<BlendFunc, float, true, false> >(params);
+            }
+        }
+    }
+
+private:
+    const KoOptimizedBlendMode m_mode;
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERIC128_H_
@@ -0,0 +1,263 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERIC32_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERIC32_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoOptimizedBlendFunctions.h"
+#include "KoOptimizedCompositeOpFactoryPerArch.h"
+
+
+/**
+ * A vectorized version of KoCompositeOpGenericSC for 8-bit colorspaces.
+ * The math is done in normalized floats, so the result may differ from
+ * the integer implementation by a rounding error.
+ */
+template<class BlendFunc, typename channels_type, typename pixel_type, bool alphaLocked, bool allChannelsFlag>
+struct GenericSCCompositor32 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    static ALWAYS_INLINE Vc::float_v blendChannel(Vc::float_v::AsArg src, Vc::float_v::AsArg dst)
+    {
+        const Vc::float_v uint8Max(255.0f);
+        const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+
+        Vc::float_v result = BlendFunc::apply(src * uint8MaxRec1, dst * uint8MaxRec1);
+        result = Vc::min(Vc::max(result, Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+        return result * uint8Max;
+    }
+
+    static ALWAYS_INLINE float blendChannel(float src, float dst)
+    {
+        const float uint8Rec1 = 1.0f / 255.0f;
+
+        const float result = BlendFunc::apply(src * uint8Rec1, dst * uint8Rec1);
+        return qBound(0.0f, result, 1.0f) * 255.0f;
+    }
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Vc::float_v uint8Max(255.0f);
+        const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<src_aligned>(src);
+        src_alpha *= Vc::float_v(opacity) * uint8MaxRec1;
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        const Vc::float_v dst_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<true>(dst) * uint8MaxRec1;
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        KoStreamedMath<_impl>::template fetch_colors_32<src_aligned>(src, src_c1, src_c2, src_c3);
+        KoStreamedMath<_impl>::template fetch_colors_32<true>(dst, dst_c1, dst_c2, dst_c3);
+
+        const Vc::float_v new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+        /**
+         * The value of new_alpha can have *some* zero values. The colors
+         * of such pixels should be kept unchanged, so we just nullify
+         * the weights of the source and of the blended color.
+         *
+         * dst = (src * srcWeight + dst * dstWeight + blend * blendWeight) / new_alpha
+         *     = dst + (src - dst) * srcWeight / new_alpha + (blend - dst) * blendWeight / new_alpha
+         */
+        Vc::float_v new_alpha_rec = oneValue / new_alpha;
+        new_alpha_rec.setZero(new_alpha == zeroValue);
+
+        const Vc::float_v src_weight = src_alpha * (oneValue - dst_alpha) * new_alpha_rec;
+        const Vc::float_v blend_weight = src_alpha * dst_alpha * new_alpha_rec;
+
+        dst_c1 += (src_c1 - dst_c1) * src_weight + (blendChannel(src_c1, dst_c1) - dst_c1) * blend_weight;
+        dst_c2 += (src_c2 - dst_c2) * src_weight + (blendChannel(src_c2, dst_c2) - dst_c2) * blend_weight;
+        dst_c3 += (src_c3 - dst_c3) * src_weight + (blendChannel(src_c3, dst_c3) - dst_c3) * blend_weight;
+
+        KoStreamedMath<_impl>::write_channels_32(dst, new_alpha * uint8Max, dst_c1, dst_c2, dst_c3);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const channels_type *src, channels_type *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+        const float uint8Rec1 = 1.0f / 255.0f;
+
+        const QBitArray &channelFlags = oparams.channelFlags;
+
+        if (!allChannelsFlag && dst[alpha_pos] == 0) {
+            KoStreamedMathFunctions::clearPixel<4>(dst);
+        }
+
+        float srcAlpha = float(src[alpha_pos]) * opacity * uint8Rec1;
+
+        if (haveMask) {
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha == 0.0f) return;
+
+        const float dstAlpha = float(dst[alpha_pos]) * uint8Rec1;
+
+        if (alphaLocked) {
+            if (dstAlpha != 0.0f) {
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || channelFlags.at(i)) {
+                        const quint8 blended = KoStreamedMath<_impl>::round_float_to_uint(blendChannel(float(src[i]), float(dst[i])));
+                        dst[i] = KoStreamedMath<_impl>::lerp_mixed_u8_float(dst[i], blended, srcAlpha);
+                    }
+                }
+            }
+        } else {
+            const float newAlpha = srcAlpha + dstAlpha - srcAlpha * dstAlpha;
+
+            if (newAlpha != 0.0f) {
+                const float srcWeight = srcAlpha * (1.0f - dstAlpha) / newAlpha;
+                const float blendWeight = srcAlpha * dstAlpha / newAlpha;
+
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || channelFlags.at(i)) {
+                        const float d = dst[i];
+                        const float result = d + (src[i] - d) * srcWeight + (blendChannel(float(src[i]), float(dst[i])) - d) * blendWeight;
+                        dst[i] = KoStreamedMath<_impl>::round_float_to_uint(result);
+                    }
+                }
+            }
+
+            dst[alpha_pos] = KoStreamedMath<_impl>::round_float_to_uint(newAlpha * 255.0f);
+        }
+    }
+};
+
+/**
+ * An optimized version of the generic separable composite ops for the
+ * use in 4 byte colorspaces with alpha channel placed at the last byte
+ * of the pixel: C1_C2_C3_A. The actual blending function is selected
+ * by KoOptimizedBlendMode.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpGeneric32 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric32(const KoOptimizedGenericOpParams &params)
+        : KoCompositeOp(params.cs, params.id, params.description, params.category),
+          m_mode(params.mode)
+    {
+    }
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        switch (m_mode) {
+        case KoOptimizedBlendMode::Multiply:
+            composite<KoOptimizedBlendMultiply>(params);
+            break;
+        case KoOptimizedBlendMode::Screen:
+            composite<KoOptimizedBlendScreen>(params);
+            break;
+        case KoOptimizedBlendMode::Overlay:
+            composite<KoOptimizedBlendOverlay>(params);
+            break;
+        case KoOptimizedBlendMode::Addition:
+            composite<KoOptimizedBlendAddition>(params);
+            break;
+        case KoOptimizedBlendMode::Subtract:
+            composite<KoOptimizedBlendSubtract>(params);
+            break;
+        case KoOptimizedBlendMode::Darken:
+            composite<KoOptimizedBlendDarken>(params);
+            break;
+        case KoOptimizedBlendMode::Lighten:
+            composite<KoOptimizedBlendLighten>(params);
+            break;
+        case KoOptimizedBlendMode::Difference:
+            composite<KoOptimizedBlendDifference>(params);
+            break;
+        }
+    }
+
+private:
+    template <class BlendFunc>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if(params.maskRowStart) {
+            composite<true, BlendFunc>(params);
+        } else {
+            composite<false, BlendFunc>(params);
+        }
+    }
+
+    template <bool haveMask, class BlendFunc>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite32<haveMask, false, GenericSCCompositor32<BlendFunc, quint8, quint32, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunc, quint8, quint32, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunc, quint8, quint32, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunc, quint8, quint32, true, false> >(params);
+            }
+        }
+    }
+
+private:
+    const KoOptimizedBlendMode m_mode;
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERIC32_H_
@@ -0,0 +1,273 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERIC64_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERIC64_H_
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoOptimizedBlendFunctions.h"
+#include "KoOptimizedCompositeOpFactoryPerArch.h"
+
+
+/**
+ * A vectorized version of KoCompositeOpGenericSC for 16-bit integer
+ * colorspaces. The channels are gathered from the interleaved pixels
+ * into float vectors and the math is done in normalized floats, so the
+ * result may differ from the integer implementation by a rounding error.
+ */
+template<class BlendFunc, bool alphaLocked, bool allChannelsFlag>
+struct GenericSCCompositor64 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    static ALWAYS_INLINE Vc::float_v blendChannel(Vc::float_v::AsArg src, Vc::float_v::AsArg dst)
+    {
+        const Vc::float_v result = BlendFunc::apply(src, dst);
+        return Vc::min(Vc::max(result, Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+    }
+
+    static ALWAYS_INLINE float blendChannel(float src, float dst)
+    {
+        return qBound(0.0f, BlendFunc::apply(src, dst), 1.0f);
+    }
+
+    static ALWAYS_INLINE quint16 round_float_to_u16(float value) {
+        return quint16(value + 0.5f);
+    }
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const quint16 *s = reinterpret_cast<const quint16*>(src);
+        quint16 *d = reinterpret_cast<quint16*>(dst);
+
+        const Vc::float_v uint16Max(65535.0f);
+        const Vc::float_v uint16MaxRec1(1.0f / 65535.0f);
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        /**
+         * Every pixel consists of four 16-bit channels, so the channel
+         * values of the neighbouring pixels are placed four entries apart
+         */
+        const Vc::float_v::IndexType pixelIndexes = Vc::float_v::IndexType(Vc::IndexesFromZero) * 4;
+
+        Vc::float_v src_alpha(s + 3, pixelIndexes);
+        src_alpha *= Vc::float_v(opacity) * uint16MaxRec1;
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        const Vc::float_v dst_alpha = Vc::float_v(d + 3, pixelIndexes) * uint16MaxRec1;
+
+        const Vc::float_v src_c1 = Vc::float_v(s + 0, pixelIndexes) * uint16MaxRec1;
+        const Vc::float_v src_c2 = Vc::float_v(s + 1, pixelIndexes) * uint16MaxRec1;
+        const Vc::float_v src_c3 = Vc::float_v(s + 2, pixelIndexes) * uint16MaxRec1;
+
+        Vc::float_v dst_c1 = Vc::float_v(d + 0, pixelIndexes) * uint16MaxRec1;
+        Vc::float_v dst_c2 = Vc::float_v(d + 1, pixelIndexes) * uint16MaxRec1;
+        Vc::float_v dst_c3 = Vc::float_v(d + 2, pixelIndexes) * uint16MaxRec1;
+
+        const Vc::float_v new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+        // \see the derivation in GenericSCCompositor32::compositeVector()
+        Vc::float_v new_alpha_rec = oneValue / new_alpha;
+        new_alpha_rec.setZero(new_alpha == zeroValue);
+
+        const Vc::float_v src_weight = src_alpha * (oneValue - dst_alpha) * new_alpha_rec;
+        const Vc::float_v blend_weight = src_alpha * dst_alpha * new_alpha_rec;
+
+        dst_c1 += (src_c1 - dst_c1) * src_weight + (blendChannel(src_c1, dst_c1) - dst_c1) * blend_weight;
+        dst_c2 += (src_c2 - dst_c2) * src_weight + (blendChannel(src_c2, dst_c2) - dst_c2) * blend_weight;
+        dst_c3 += (src_c3 - dst_c3) * src_weight + (blendChannel(src_c3, dst_c3) - dst_c3) * blend_weight;
+
+        // the scatter truncates the values, so round them beforehand
+        const Vc::float_v roundingOffset(0.5f);
+
+        (dst_c1 * uint16Max + roundingOffset).scatter(d + 0, pixelIndexes);
+        (dst_c2 * uint16Max + roundingOffset).scatter(d + 1, pixelIndexes);
+        (dst_c3 * uint16Max + roundingOffset).scatter(d + 2, pixelIndexes);
+        (new_alpha * uint16Max + roundingOffset).scatter(d + 3, pixelIndexes);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+        const float uint16Rec1 = 1.0f / 65535.0f;
+
+        const quint16 *s = reinterpret_cast<const quint16*>(src);
+        quint16 *d = reinterpret_cast<quint16*>(dst);
+
+        const QBitArray &channelFlags = oparams.channelFlags;
+
+        if (!allChannelsFlag && d[alpha_pos] == 0) {
+            KoStreamedMathFunctions::clearPixel<8>(dst);
+        }
+
+        float srcAlpha = float(s[alpha_pos]) * opacity * uint16Rec1;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0f / 255.0f;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (srcAlpha == 0.0f) return;
+
+        const float dstAlpha = float(d[alpha_pos]) * uint16Rec1;
+
+        if (alphaLocked) {
+            if (dstAlpha != 0.0f) {
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || channelFlags.at(i)) {
+                        const float dc = float(d[i]) * uint16Rec1;
+                        const float blended = blendChannel(float(s[i]) * uint16Rec1, dc);
+                        d[i] = round_float_to_u16((dc + (blended - dc) * srcAlpha) * 65535.0f);
+                    }
+                }
+            }
+        } else {
+            const float newAlpha = srcAlpha + dstAlpha - srcAlpha * dstAlpha;
+
+            if (newAlpha != 0.0f) {
+                const float srcWeight = srcAlpha * (1.0f - dstAlpha) / newAlpha;
+                const float blendWeight = srcAlpha * dstAlpha / newAlpha;
+
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || channelFlags.at(i)) {
+                        const float sc = float(s[i]) * uint16Rec1;
+                        const float dc = float(d[i]) * uint16Rec1;
+                        const float result = dc + (sc - dc) * srcWeight + (blendChannel(sc, dc) - dc) * blendWeight;
+                        d[i] = round_float_to_u16(result * 65535.0f);
+                    }
+                }
+            }
+
+            d[alpha_pos] = round_float_to_u16(newAlpha * 65535.0f);
+        }
+    }
+};
+
+/**
+ * An optimized version of the generic separable composite ops for the
+ * use in 8 byte colorspaces with alpha channel placed at the last
+ * channel of the pixel: C1_C2_C3_A. The actual blending function is
+ * selected by KoOptimizedBlendMode.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpGeneric64 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGeneric64(const KoOptimizedGenericOpParams &params)
+        : KoCompositeOp(params.cs, params.id, params.description, params.category),
+          m_mode(params.mode)
+    {
+    }
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        switch (m_mode) {
+        case KoOptimizedBlendMode::Multiply:
+            composite<KoOptimizedBlendMultiply>(params);
+            break;
+        case KoOptimizedBlendMode::Screen:
+            composite<KoOptimizedBlendScreen>(params);
+            break;
+        case KoOptimizedBlendMode::Overlay:
+            composite<KoOptimizedBlendOverlay>(params);
+            break;
+        case KoOptimizedBlendMode::Addition:
+            composite<KoOptimizedBlendAddition>(params);
+            break;
+        case KoOptimizedBlendMode::Subtract:
+            composite<KoOptimizedBlendSubtract>(params);
+            break;
+        case KoOptimizedBlendMode::Darken:
+            composite<KoOptimizedBlendDarken>(params);
+            break;
+        case KoOptimizedBlendMode::Lighten:
+            composite<KoOptimizedBlendLighten>(params);
+            break;
+        case KoOptimizedBlendMode::Difference:
+            composite<KoOptimizedBlendDifference>(params);
+            break;
+        }
+    }
+
+private:
+    template <class BlendFunc>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if(params.maskRowStart) {
+            composite<true, BlendFunc>(params);
+        } else {
+            composite<false, BlendFunc>(params);
+        }
+    }
+
+    template <bool haveMask, class BlendFunc>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite64<haveMask, false, GenericSCCompositor64<BlendFunc, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, GenericSCCompositor64<BlendFunc, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, GenericSCCompositor64<BlendFunc, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite64_novector<haveMask, false, GenericSCCompositor64<BlendFunc, true, false> >(params);
+            }
+        }
+    }
+
+private:
+    const KoOptimizedBlendMode m_mode;
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERIC64_H_
@@ -97,6 +97,12 @@ template<bool useMask, bool useFlow, class Compositor>
     genericComposite_novector<useMask, useFlow, Compositor, 4>(params);
 }
 
+template<bool useMask, bool useFlow, class Compositor>
+    static void genericComposite64_novector(const KoCompositeOp::ParameterInfo& params)
+{
+    genericComposite_novector<useMask, useFlow, Compositor, 8>(params);
+}
+
 template<bool useMask, bool useFlow, class Compositor>
     static void genericComposite128_novector(const KoCompositeOp::ParameterInfo& params)
 {
@@ -376,6 +382,12 @@ template<bool useMask, bool useFlow, class Compositor>
     genericComposite<useMask, useFlow, Compositor, 4>(params);
 }
 
+template<bool useMask, bool useFlow, class Compositor>
+    static void genericComposite64(const KoCompositeOp::ParameterInfo& params)
+{
+    genericComposite<useMask, useFlow, Compositor, 8>(params);
+}
+
 template<bool useMask, bool useFlow, class Compositor>
     static void genericComposite128(const KoCompositeOp::ParameterInfo& params)
 {
@@ -396,6 +408,13 @@ ALWAYS_INLINE void clearPixel<4>(quint8* dst)
     *d = 0;
 }
 
+template<>
+ALWAYS_INLINE void clearPixel<8>(quint8* dst)
+{
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = 0;
+}
+
 template<>
 ALWAYS_INLINE void clearPixel<16>(quint8* dst)
 {
@@ -415,6 +434,14 @@ ALWAYS_INLINE void copyPixel<4>(const quint8 *src, quint8* dst)
     *d = *s;
 }
 
+template<>
+ALWAYS_INLINE void copyPixel<8>(const quint8 *src, quint8* dst)
+{
+    const quint64 *s = reinterpret_cast<const quint64*>(src);
+    quint64 *d = reinterpret_cast<quint64*>(dst);
+    *d = *s;
+}
+
 template<>
 ALWAYS_INLINE void copyPixel<16>(const quint8 *src, quint8* dst)
 {
@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoColorConversionCache.h"
+
+#include <QTest>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QScopedPointer>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorConversionTransformation.h>
+
+namespace {
+
+const int numPixels = 256;
+const int numIterations = 200;
+
+struct ConversionCase {
+    const KoColorSpace *dstCs;
+    QByteArray expected;
+};
+
+/**
+ * Converts the same pixels into several color spaces in turn, so that
+ * every thread keeps switching between the cached transformations
+ */
+class ConversionJob : public QRunnable
+{
+public:
+    ConversionJob(const KoColorSpace *srcCs,
+                  const QByteArray &src,
+                  const QList<ConversionCase> &cases,
+                  QAtomicInt *numFailures)
+        : m_srcCs(srcCs),
+          m_src(src),
+          m_cases(cases),
+          m_numFailures(numFailures)
+    {
+    }
+
+    void run() override {
+        for (int i = 0; i < numIterations; i++) {
+            Q_FOREACH (const ConversionCase &c, m_cases) {
+                QByteArray dst(c.expected.size(), 0);
+
+                m_srcCs->convertPixelsTo(reinterpret_cast<const quint8*>(m_src.constData()),
+                                         reinterpret_cast<quint8*>(dst.data()),
+                                         c.dstCs, numPixels,
+                                         KoColorConversionTransformation::internalRenderingIntent(),
+                                         KoColorConversionTransformation::internalConversionFlags());
+
+                if (dst != c.expected) {
+                    m_numFailures->ref();
+                }
+            }
+        }
+    }
+
+private:
+    const KoColorSpace *m_srcCs;
+    QByteArray m_src;
+    QList<ConversionCase> m_cases;
+    QAtomicInt *m_numFailures;
+};
+
+}
+
+void TestKoColorConversionCache::testConcurrentConversion()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCs = registry->rgb8();
+
+    QList<const KoColorSpace*> dstSpaces;
+    dstSpaces << registry->rgb16() << registry->lab16() << registry->alpha8();
+
+    QByteArray src(numPixels * srcCs->pixelSize(), 0);
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = char(i * 13);
+    }
+
+    QList<ConversionCase> cases;
+
+    Q_FOREACH (const KoColorSpace *dstCs, dstSpaces) {
+        QVERIFY(dstCs);
+
+        QScopedPointer<KoColorConversionTransformation> transform(
+            srcCs->createColorConverter(dstCs,
+                                        KoColorConversionTransformation::internalRenderingIntent(),
+                                        KoColorConversionTransformation::internalConversionFlags()));
+
+        ConversionCase c;
+        c.dstCs = dstCs;
+        c.expected = QByteArray(numPixels * dstCs->pixelSize(), 0);
+        transform->transform(reinterpret_cast<const quint8*>(src.constData()),
+                             reinterpret_cast<quint8*>(c.expected.data()),
+                             numPixels);
+        cases << c;
+    }
+
+    QAtomicInt numFailures;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(8);
+
+    for (int i = 0; i < 16; i++) {
+        pool.start(new ConversionJob(srcCs, src, cases, &numFailures));
+    }
+
+    pool.waitForDone();
+
+    QCOMPARE(numFailures.load(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestKoColorConversionCache)
@@ -21,17 +21,16 @@
 #include <QBuffer>
 #include "psd_utils.h"
 #include "kis_debug.h"
+#include "kis_assert.h"
 #include <QtEndian>
 
 // from gimp's psd-save.c
-static quint32 pack_pb_line (const QByteArray &src,
-                             QByteArray &dst)
+static quint32 pack_pb_line (const char *start, quint32 length,
+                             char *dst)
 {
-    quint32 length = src.size();
     quint32 remaining = length;
     quint8  i, j;
     quint32 dest_ptr = 0;
-    const char *start = src.constData();
 
     length = 0;
     while (remaining > 0)
@@ -89,7 +88,7 @@ static quint32 pack_pb_line (const QByteArray &src,
 
 
 // from gimp's psd-util.c
-quint32 decode_packbits(const char *src, char* dst, quint16 packed_len, quint32 unpacked_len)
+quint32 decode_packbits(const char *src, char* dst, quint32 packed_len, quint32 unpacked_len)
 {
     /*
      *  Decode a PackBits chunk.
@@ -209,10 +208,8 @@ QByteArray Compression::uncompress(quint32 unpacked_len, QByteArray bytes, Compr
         return bytes;
     case RLE:
     {
-        char *dst = new char[unpacked_len];
-        decode_packbits(bytes.constData(), dst, bytes.length(), unpacked_len);
-        QByteArray ba(dst, unpacked_len);
-        delete[] dst;
+        QByteArray ba(unpacked_len, Qt::Uninitialized);
+        decode_packbits(bytes.constData(), ba.data(), bytes.length(), unpacked_len);
         return ba;
      }
     case ZIP:
@@ -248,9 +245,7 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
     case RLE:
     {
         QByteArray dst;
-        int packed_len = pack_pb_line(bytes, dst);
-        Q_ASSERT(packed_len == dst.size());
-        Q_UNUSED(packed_len);
+        compress(bytes.constData(), bytes.size(), dst, RLE);
         return dst;
     }
     case ZIP:
@@ -263,3 +258,50 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
     return QByteArray();
 }
 
+bool Compression::uncompress(const char *src, quint32 packed_len, char *dst, quint32 unpacked_len, Compression::CompressionType compressionType)
+{
+    switch(compressionType) {
+    case Uncompressed:
+        memcpy(dst, src, qMin(packed_len, unpacked_len));
+        return packed_len == unpacked_len;
+    case RLE:
+        return !decode_packbits(src, dst, packed_len, unpacked_len);
+    default:
+        warnKrita << "Cannot uncompress a row of data: unsupported compression type" << compressionType;
+    }
+
+    return false;
+}
+
+void Compression::compress(const char *src, quint32 len, QByteArray &dst, Compression::CompressionType compressionType)
+{
+    switch(compressionType) {
+    case Uncompressed:
+        dst.resize(len);
+        memcpy(dst.data(), src, len);
+        break;
+    case RLE:
+    {
+        // resizing down doesn't free the memory, so the buffer
+        // grows only once when reused for all the rows
+        dst.resize(maxRLECompressedSize(len));
+        const quint32 packed_len = pack_pb_line(src, len, dst.data());
+        KIS_ASSERT_RECOVER_NOOP(packed_len <= quint32(dst.size()));
+        dst.resize(packed_len);
+        break;
+    }
+    case ZIP:
+    case ZIPWithPrediction:
+        dst = qCompress(reinterpret_cast<const uchar*>(src), len);
+        break;
+    default:
+        qFatal("Cannot compress layer data: invalid compression type");
+    }
+}
+
+quint32 Compression::maxRLECompressedSize(quint32 len)
+{
+    // every literal run of up to 128 bytes gets one header byte,
+    // plus the trailing byte of a row may be packed separately
+    return len + (len + 127) / 128 + 1;
+}
@@ -35,6 +35,29 @@ public:
 
     static QByteArray uncompress(quint32 unpacked_len, QByteArray bytes, CompressionType compressionType);
     static QByteArray compress(QByteArray bytes, CompressionType compressionType);
+
+    /**
+     * Uncompresses \p packed_len bytes of \p src into a preallocated buffer
+     * \p dst of \p unpacked_len bytes. No memory is allocated, so the same
+     * buffer can be reused for all the rows of a channel. Only Uncompressed
+     * and RLE modes are supported, ZIP data is stored as a single stream per
+     * channel and cannot be decoded row by row.
+     *
+     * \return true if the data has been decoded without errors
+     */
+    static bool uncompress(const char *src, quint32 packed_len, char *dst, quint32 unpacked_len, CompressionType compressionType);
+
+    /**
+     * Compresses \p len bytes of \p src into \p dst. The capacity of \p dst
+     * is kept between the calls, so the same array can be passed for all
+     * the rows of a channel.
+     */
+    static void compress(const char *src, quint32 len, QByteArray &dst, CompressionType compressionType);
+
+    /**
+     * \return the maximum size of \p len bytes compressed with RLE
+     */
+    static quint32 maxRLECompressedSize(quint32 len);
 };
 
 #endif // PSD_COMPRESSION_H
@@ -32,24 +32,202 @@
 #include <QTextCodec>
 #include <QByteArray>
 #include <QBuffer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QQueue>
 
 #include <KConfig>
 #include <KSharedConfig>
 #include <KConfigGroup>
 
+#include <kis_assert.h>
+
+namespace {
+
+/**
+ * A file entry that has been closed by the user, but is not yet
+ * written into the archive. The data is deflated by one of the
+ * compression threads and appended to the archive by the writer
+ * thread.
+ */
+struct PendingEntry {
+    QString fileName;
+    QByteArray data;
+    int method {Z_DEFLATED};
+    int compressionLevel {Z_DEFAULT_COMPRESSION};
+    quint32 crc {0};
+    qint64 uncompressedSize {0};
+    bool isReady {false};
+    bool isValid {false};
+};
+
+typedef QSharedPointer<PendingEntry> PendingEntrySP;
+
+bool deflateRaw(const QByteArray &src, int level, QByteArray *dst)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // negative window bits produce a raw deflate stream without
+    // zlib headers, which is exactly what zip entries contain
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    dst->resize(deflateBound(&stream, src.size()));
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src.constData()));
+    stream.avail_in = src.size();
+    stream.next_out = reinterpret_cast<Bytef*>(dst->data());
+    stream.avail_out = dst->size();
+
+    const int result = deflate(&stream, Z_FINISH);
+    dst->resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return result == Z_STREAM_END;
+}
+
+template <class Func>
+struct FunctionRunnable : public QRunnable
+{
+    FunctionRunnable(Func func) : m_func(func) {}
+    void run() override { m_func(); }
+    Func m_func;
+};
+
+template <class Func>
+QRunnable* makeRunnable(Func func) {
+    return new FunctionRunnable<Func>(func);
+}
+
+}
+
 struct KoQuaZipStore::Private {
 
-    Private() {}
+    Private() {
+        writerPool.setMaxThreadCount(1);
+    }
     ~Private() {}
 
+    /**
+     * The amount of uncompressed data that may wait for
+     * compression before closeWrite() starts to block
+     */
+    static const qint64 maxPendingBytes = 256 * 1024 * 1024;
+
     QuaZip *archive {0};
     QuaZipFile *currentFile {0};
+    QString currentFileName;
     int compressionLevel {Z_DEFAULT_COMPRESSION};
     bool usingSaveFile {false};
     QByteArray cache;
     QBuffer buffer;
+
+    QThreadPool compressionPool;
+    QThreadPool writerPool;
+
+    QMutex pendingLock;
+    QWaitCondition pendingCondition;
+    QQueue<PendingEntrySP> pendingEntries;
+    qint64 pendingBytes {0};
+    bool hasWriteErrors {false};
+
+    void enqueueEntry(PendingEntrySP entry);
+    void compressEntry(PendingEntrySP entry);
+    void writeNextEntry();
+    void waitForPendingEntries();
 };
 
+void KoQuaZipStore::Private::compressEntry(PendingEntrySP entry)
+{
+    const QByteArray rawData = entry->data;
+
+    QByteArray compressedData;
+    const bool isValid = deflateRaw(rawData, entry->compressionLevel, &compressedData);
+
+    const quint32 crc =
+        crc32(crc32(0L, Z_NULL, 0),
+              reinterpret_cast<const Bytef*>(rawData.constData()), rawData.size());
+
+    QMutexLocker l(&pendingLock);
+    entry->data = compressedData;
+    entry->crc = crc;
+    entry->isValid = isValid;
+    entry->isReady = true;
+    pendingCondition.wakeAll();
+}
+
+void KoQuaZipStore::Private::writeNextEntry()
+{
+    PendingEntrySP entry;
+
+    {
+        QMutexLocker l(&pendingLock);
+        KIS_ASSERT_RECOVER_RETURN(!pendingEntries.isEmpty());
+
+        // the entries are written in the same order they were closed
+        entry = pendingEntries.head();
+        while (!entry->isReady) {
+            pendingCondition.wait(&pendingLock);
+        }
+    }
+
+    bool result = entry->isValid;
+
+    if (result) {
+        QuaZipFile file(archive);
+        QuaZipNewInfo newInfo(entry->fileName);
+        newInfo.setPermissions(QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+        newInfo.uncompressedSize = entry->uncompressedSize;
+
+        result = file.open(QIODevice::WriteOnly, newInfo, 0, entry->crc, entry->method, entry->compressionLevel, true);
+
+        if (result) {
+            result = file.write(entry->data) == entry->data.size();
+            file.close();
+            result &= file.getZipError() == ZIP_OK;
+        }
+    }
+
+    if (!result) {
+        qWarning() << "Could not write" << entry->fileName << "to the archive" << archive->getZipError();
+    }
+
+    QMutexLocker l(&pendingLock);
+    pendingEntries.dequeue();
+    pendingBytes -= entry->uncompressedSize;
+    hasWriteErrors |= !result;
+    pendingCondition.wakeAll();
+}
+
+void KoQuaZipStore::Private::enqueueEntry(PendingEntrySP entry)
+{
+    QMutexLocker l(&pendingLock);
+
+    /**
+     * Don't let the user fill the memory with the data that the
+     * compression threads cannot keep up with
+     */
+    while (!pendingEntries.isEmpty() &&
+           pendingBytes + entry->uncompressedSize > maxPendingBytes) {
+
+        pendingCondition.wait(&pendingLock);
+    }
+
+    pendingEntries.enqueue(entry);
+    pendingBytes += entry->uncompressedSize;
+}
+
+void KoQuaZipStore::Private::waitForPendingEntries()
+{
+    writerPool.waitForDone();
+    KIS_SAFE_ASSERT_RECOVER_NOOP(pendingEntries.isEmpty());
+}
+
 
 KoQuaZipStore::KoQuaZipStore(const QString &_filename, KoStore::Mode _mode, const QByteArray &appIdentification, bool writeMimetype)
     : KoStore(_mode, writeMimetype)
@@ -168,10 +346,15 @@ bool KoQuaZipStore::doFinalize()
     Q_D(KoStore);
 
     d->stream = 0;
+
+    if (d->mode == Write) {
+        dd->waitForPendingEntries();
+    }
+
     if (!dd->usingSaveFile) {
         dd->archive->close();
     }
-    return dd->archive->getZipError() == ZIP_OK;
+    return !dd->hasWriteErrors && dd->archive->getZipError() == ZIP_OK;
 
 }
 
@@ -184,20 +367,17 @@ bool KoQuaZipStore::openWrite(const QString &name)
     delete d->stream;
     d->stream = 0; // Not used when writing
 
-    delete dd->currentFile;
-    dd->currentFile = new QuaZipFile(dd->archive);
-    QuaZipNewInfo newInfo(fixedPath);
-    newInfo.setPermissions(QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
-    bool r = dd->currentFile->open(QIODevice::WriteOnly, newInfo, 0, 0, Z_DEFLATED, dd->compressionLevel);
-    if (!r) {
-        qWarning() << "Could not open" << name << dd->currentFile->getZipError();
-    }
+    /**
+     * The entry is added to the archive only when it is closed,
+     * see closeWrite()
+     */
+    dd->currentFileName = fixedPath;
 
     dd->cache = QByteArray();
     dd->buffer.setBuffer(&dd->cache);
     dd->buffer.open(QBuffer::WriteOnly);
 
-    return r;
+    return true;
 }
 
 bool KoQuaZipStore::openRead(const QString &name)
@@ -239,15 +419,29 @@ bool KoQuaZipStore::closeWrite()
 {
     Q_D(KoStore);
 
-    bool r = true;
-    if (!dd->currentFile->write(dd->cache)) {
-        qWarning() << "Could not write buffer to the file";
-        r = false;
-    }
     dd->buffer.close();
-    dd->currentFile->close();
     d->stream = 0;
-    return (r && dd->currentFile->getZipError() == ZIP_OK);
+
+    PendingEntrySP entry(new PendingEntry());
+    entry->fileName = dd->currentFileName;
+    entry->data = dd->cache;
+    entry->compressionLevel = dd->compressionLevel;
+    entry->uncompressedSize = dd->cache.size();
+
+    dd->cache = QByteArray();
+
+    dd->enqueueEntry(entry);
+
+    /**
+     * The entries are deflated in parallel, but the writer thread
+     * appends them to the archive in order. The write errors are
+     * reported by finalize().
+     */
+    Private *priv = dd.data();
+    dd->compressionPool.start(makeRunnable([priv, entry] () { priv->compressEntry(entry); }));
+    dd->writerPool.start(makeRunnable([priv] () { priv->writeNextEntry(); }));
+
+    return true;
 }
 
 bool KoQuaZipStore::closeRead()
@@ -289,3 +483,64 @@ bool KoQuaZipStore::fileExists(const QString &absPath) const
 
     return dd->archive->getFileNameList().contains(fixedPath);
 }
+
+bool KoQuaZipStore::copyRawFile(KoStore *source, const QString &sourceName, const QString &name)
+{
+    KoQuaZipStore *zipSource = dynamic_cast<KoQuaZipStore*>(source);
+    if (!zipSource) return false;
+
+    QString fixedSourceName = sourceName;
+    fixedSourceName.replace("//", "/");
+
+    QString fixedName = name;
+    fixedName.replace("//", "/");
+
+    QuaZip *sourceArchive = zipSource->dd->archive;
+
+    if (!sourceArchive->setCurrentFile(fixedSourceName)) {
+        return false;
+    }
+
+    QuaZipFileInfo64 info;
+    if (!sourceArchive->getCurrentFileInfo(&info)) {
+        return false;
+    }
+
+    /**
+     * Read the entry in raw mode, that is, without inflating it. It
+     * will be appended to the archive as it is, after the entries that
+     * are already waiting for compression.
+     */
+    QuaZipFile file(sourceArchive);
+    int method = 0;
+    int level = 0;
+    if (!file.open(QIODevice::ReadOnly, &method, &level, true)) {
+        return false;
+    }
+
+    PendingEntrySP entry(new PendingEntry());
+    entry->fileName = fixedName;
+    entry->data = file.readAll();
+    entry->method = method;
+    entry->compressionLevel = level;
+    entry->crc = info.crc;
+    entry->uncompressedSize = info.uncompressedSize;
+    entry->isReady = true;
+    entry->isValid = true;
+
+    file.close();
+
+    if (file.getZipError() != UNZ_OK ||
+        quint64(entry->data.size()) != info.compressedSize) {
+
+        warnStore << "Could not read raw data of" << fixedSourceName << file.getZipError();
+        return false;
+    }
+
+    dd->enqueueEntry(entry);
+
+    Private *priv = dd.data();
+    dd->writerPool.start(makeRunnable([priv] () { priv->writeNextEntry(); }));
+
+    return true;
+}
@@ -51,6 +51,7 @@ protected:
     bool enterRelativeDirectory(const QString& dirName) override;
     bool enterAbsoluteDirectory(const QString& path) override;
     bool fileExists(const QString& absPath) const override;
+    bool copyRawFile(KoStore *source, const QString &sourceName, const QString &name) override;
 
 private:
     struct Private;
@@ -417,6 +417,44 @@ void KoStore::setCompressionEnabled(bool /*e*/)
 {
 }
 
+bool KoStore::copyFileFrom(KoStore *source, const QString &sourceName, const QString &name)
+{
+    Q_D(KoStore);
+
+    if (d->mode != Write || source->mode() != Read) {
+        warnStore << "KoStore: Can copy files only from a read store to a write store";
+        return false;
+    }
+
+    if (d->isOpen || source->isOpen()) {
+        warnStore << "KoStore: Can not copy files while a file is opened";
+        return false;
+    }
+
+    const QString fileName = d->toExternalNaming(name);
+    const QString sourceFileName = source->d_ptr->toExternalNaming(sourceName);
+
+    if (d->filesList.contains(fileName)) {
+        warnStore << "KoStore: Duplicate filename" << fileName;
+        return false;
+    }
+
+    if (!copyRawFile(source, sourceFileName, fileName)) {
+        return false;
+    }
+
+    d->filesList.append(fileName);
+    return true;
+}
+
+bool KoStore::copyRawFile(KoStore *source, const QString &sourceName, const QString &name)
+{
+    Q_UNUSED(source);
+    Q_UNUSED(sourceName);
+    Q_UNUSED(name);
+    return false;
+}
+
 void KoStore::setSubstitution(const QString &name, const QString &substitution)
 {
     Q_D(KoStore);
@@ -267,6 +267,17 @@ public:
     /// When reading, in the paths in the store where name occurs, substitution is used.
     void setSubstitution(const QString &name, const QString &substitution);
 
+    /**
+     * Copies the file @p sourceName of @p source into this store as the
+     * file @p name, without uncompressing and compressing its data again.
+     * The names are resolved the same way as in open(). Only supported
+     * by the ZIP backend, when @p source is a ZIP store opened for reading.
+     *
+     * @return false if the file could not be copied. The caller should
+     * write the file in the usual way then.
+     */
+    bool copyFileFrom(KoStore *source, const QString &sourceName, const QString &name);
+
 protected:
     KoStore(Mode mode, bool writeMimetype = true);
 
@@ -321,6 +332,14 @@ protected:
      */
     virtual bool fileExists(const QString &absPath) const = 0;
 
+    /**
+     * Copy the file @p sourceName of @p source as the file @p name
+     * @param sourceName "absolute path" (in the source archive) to the file to copy
+     * @param name "absolute path" (in the archive) to the new file
+     * @return true on success. The default implementation does nothing.
+     */
+    virtual bool copyRawFile(KoStore *source, const QString &sourceName, const QString &name);
+
 protected:
     KoStorePrivate *d_ptr;
 
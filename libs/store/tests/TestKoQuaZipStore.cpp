@@ -0,0 +1,165 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoQuaZipStore.h"
+
+#include <KoStore.h>
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+
+namespace {
+
+QByteArray generateData(int index)
+{
+    QByteArray data;
+
+    if (index % 3 == 0) {
+        // well-compressible data
+        data.fill(char(index), 1000 * index + 1);
+    } else {
+        // poorly-compressible data
+        data.resize(5000 * index + 17);
+        quint32 seed = 0x12345678 + index;
+        for (int i = 0; i < data.size(); i++) {
+            seed = seed * 1103515245 + 12345;
+            data[i] = char(seed >> 16);
+        }
+    }
+
+    return data;
+}
+
+}
+
+void TestKoQuaZipStore::testParallelWriteRoundtrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString fileName = dir.filePath("test.kra");
+    const int numEntries = 50;
+
+    {
+        QScopedPointer<KoStore> store(
+            KoStore::createStore(fileName, KoStore::Write, "application/x-krita", KoStore::Zip));
+        QVERIFY(!store->bad());
+
+        for (int i = 0; i < numEntries; i++) {
+            store->setCompressionEnabled(i & 1);
+
+            QVERIFY(store->open(QString("layers/layer%1").arg(i)));
+            QVERIFY(store->write(generateData(i)) > 0);
+            QVERIFY(store->close());
+        }
+
+        store->setCompressionEnabled(true);
+
+        QVERIFY(store->finalize());
+    }
+
+    QScopedPointer<KoStore> store(
+        KoStore::createStore(fileName, KoStore::Read, "application/x-krita", KoStore::Zip));
+    QVERIFY(!store->bad());
+
+    const QStringList entries = store->directoryList();
+    QCOMPARE(entries.size(), numEntries + 1);
+
+    // the mimetype should always be the first entry, and the rest
+    // should be written in the same order they were added
+    QCOMPARE(entries[0], QString("mimetype"));
+
+    for (int i = 0; i < numEntries; i++) {
+        const QString entryName = QString("layers/layer%1").arg(i);
+        QCOMPARE(entries[i + 1], entryName);
+
+        QByteArray data;
+        QVERIFY(store->extractFile(entryName, data));
+        QCOMPARE(data, generateData(i));
+    }
+}
+
+void TestKoQuaZipStore::testCopyFileFrom()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString sourceFileName = dir.filePath("source.kra");
+    const QString fileName = dir.filePath("test.kra");
+    const int numEntries = 6;
+
+    {
+        QScopedPointer<KoStore> store(
+            KoStore::createStore(sourceFileName, KoStore::Write, "application/x-krita", KoStore::Zip));
+        QVERIFY(!store->bad());
+
+        for (int i = 0; i < numEntries; i++) {
+            store->setCompressionEnabled(i & 1);
+
+            QVERIFY(store->open(QString("layers/layer%1").arg(i)));
+            QVERIFY(store->write(generateData(i)) > 0);
+            QVERIFY(store->close());
+        }
+
+        QVERIFY(store->finalize());
+    }
+
+    {
+        QScopedPointer<KoStore> source(
+            KoStore::createStore(sourceFileName, KoStore::Read, "application/x-krita", KoStore::Zip));
+        QVERIFY(!source->bad());
+
+        QScopedPointer<KoStore> store(
+            KoStore::createStore(fileName, KoStore::Write, "application/x-krita", KoStore::Zip));
+        QVERIFY(!store->bad());
+
+        // mix the copied entries with the newly written ones
+        for (int i = 0; i < numEntries; i++) {
+            const QString entryName = QString("layers/layer%1").arg(i);
+
+            if (i % 2) {
+                QVERIFY(store->copyFileFrom(source.data(), entryName, "tar:/" + entryName));
+            } else {
+                QVERIFY(store->open(entryName));
+                QVERIFY(store->write(generateData(i)) > 0);
+                QVERIFY(store->close());
+            }
+        }
+
+        QVERIFY(!store->copyFileFrom(source.data(), "layers/nonexistent", "layers/nonexistent"));
+        QVERIFY(!store->copyFileFrom(source.data(), "layers/layer1", "layers/layer1"));
+
+        QVERIFY(store->finalize());
+    }
+
+    QScopedPointer<KoStore> store(
+        KoStore::createStore(fileName, KoStore::Read, "application/x-krita", KoStore::Zip));
+    QVERIFY(!store->bad());
+
+    QCOMPARE(store->directoryList().size(), numEntries + 1);
+
+    for (int i = 0; i < numEntries; i++) {
+        QByteArray data;
+        QVERIFY(store->extractFile(QString("layers/layer%1").arg(i), data));
+        QCOMPARE(data, generateData(i));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestKoQuaZipStore)
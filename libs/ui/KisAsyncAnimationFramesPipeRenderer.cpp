@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAsyncAnimationFramesPipeRenderer.h"
+
+#include <KoColorSpace.h>
+#include <KoColorConversionTransformation.h>
+
+#include "kis_image.h"
+#include "kis_paint_device.h"
+#include "kis_time_range.h"
+#include "KisOrderedFramesWriter.h"
+
+
+struct KisAsyncAnimationFramesPipeRenderer::Private
+{
+    KisOrderedFramesWriter *writer = 0;
+    KisTimeRange range;
+    const KoColorSpace *dstColorSpace = 0;
+};
+
+KisAsyncAnimationFramesPipeRenderer::KisAsyncAnimationFramesPipeRenderer(KisOrderedFramesWriter *writer,
+                                                                         const KisTimeRange &range,
+                                                                         const KoColorSpace *dstColorSpace)
+    : m_d(new Private)
+{
+    m_d->writer = writer;
+    m_d->range = range;
+    m_d->dstColorSpace = dstColorSpace;
+
+    connect(this, SIGNAL(sigCompleteRegenerationInternal(int)), SLOT(notifyFrameCompleted(int)));
+    connect(this, SIGNAL(sigCancelRegenerationInternal(int)), SLOT(notifyFrameCancelled(int)));
+}
+
+KisAsyncAnimationFramesPipeRenderer::~KisAsyncAnimationFramesPipeRenderer()
+{
+}
+
+void KisAsyncAnimationFramesPipeRenderer::frameCompletedCallback(int frame, const KisRegion &requestedRegion)
+{
+    KisImageSP image = requestedImage();
+    if (!image) return;
+
+    KIS_SAFE_ASSERT_RECOVER (requestedRegion == image->bounds()) {
+        emit sigCancelRegenerationInternal(frame);
+        return;
+    }
+
+    const QRect bounds = image->bounds();
+    const int numPixels = bounds.width() * bounds.height();
+
+    KisPaintDeviceSP projection = image->projection();
+    const KoColorSpace *srcColorSpace = projection->colorSpace();
+
+    QByteArray data(numPixels * m_d->dstColorSpace->pixelSize(), Qt::Uninitialized);
+
+    if (*srcColorSpace == *m_d->dstColorSpace) {
+        projection->readBytes(reinterpret_cast<quint8*>(data.data()), bounds);
+    } else {
+        QByteArray srcData(numPixels * srcColorSpace->pixelSize(), Qt::Uninitialized);
+        projection->readBytes(reinterpret_cast<quint8*>(srcData.data()), bounds);
+
+        srcColorSpace->convertPixelsTo(reinterpret_cast<const quint8*>(srcData.constData()),
+                                       reinterpret_cast<quint8*>(data.data()),
+                                       m_d->dstColorSpace, numPixels,
+                                       KoColorConversionTransformation::internalRenderingIntent(),
+                                       KoColorConversionTransformation::internalConversionFlags());
+    }
+
+    // the identical frames are not regenerated, just repeated in the stream
+    KisTimeRange identicals = KisTimeRange::calculateIdenticalFramesRecursive(image->root(), frame);
+    identicals &= m_d->range;
+
+    const int numRepeats =
+        identicals.isValid() && identicals.end() >= frame ?
+        identicals.end() - frame + 1 : 1;
+
+    m_d->writer->addFrame(frame, numRepeats, data);
+
+    emit sigCompleteRegenerationInternal(frame);
+}
+
+void KisAsyncAnimationFramesPipeRenderer::frameCancelledCallback(int frame)
+{
+    /**
+     * Cancelling of any frame fails the whole rendering. Release the
+     * other renderers that might be waiting for the writer, otherwise
+     * the dialog would wait for them forever.
+     */
+    m_d->writer->cancel();
+
+    notifyFrameCancelled(frame);
+}
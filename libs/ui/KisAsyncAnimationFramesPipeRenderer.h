@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISASYNCANIMATIONFRAMESPIPERENDERER_H
+#define KISASYNCANIMATIONFRAMESPIPERENDERER_H
+
+#include <KisAsyncAnimationRendererBase.h>
+
+class KoColorSpace;
+class KisTimeRange;
+class KisOrderedFramesWriter;
+
+/**
+ * Fetches the raw pixels of the rendered frames and passes them
+ * to a KisOrderedFramesWriter, without saving them into files.
+ */
+class KisAsyncAnimationFramesPipeRenderer : public KisAsyncAnimationRendererBase
+{
+    Q_OBJECT
+public:
+    /**
+     * @param writer the writer shared by all the renderers of the dialog
+     * @param range the frames of the held keyframes are written repeatedly
+     *              until the end of this range
+     * @param dstColorSpace the color space the pixels are converted into
+     */
+    KisAsyncAnimationFramesPipeRenderer(KisOrderedFramesWriter *writer,
+                                        const KisTimeRange &range,
+                                        const KoColorSpace *dstColorSpace);
+    ~KisAsyncAnimationFramesPipeRenderer();
+
+protected:
+    void frameCompletedCallback(int frame, const KisRegion &requestedRegion) override;
+    void frameCancelledCallback(int frame) override;
+
+Q_SIGNALS:
+    void sigCompleteRegenerationInternal(int frame);
+    void sigCancelRegenerationInternal(int frame);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISASYNCANIMATIONFRAMESPIPERENDERER_H
@@ -253,6 +253,7 @@ public:
         , globalAssistantsColor(KisConfig(true).defaultAssistantsColor())
         , savingLock(&savingMutex)
         , batchMode(false)
+        , savedPaintDevicesCache(new KisSavedPaintDevicesCache())
     {
         if (QLocale().measurementSystem() == QLocale::ImperialSystem) {
             unit = KoUnit::Inch;
@@ -272,6 +273,7 @@ public:
         , preActivatedNode(0) // the node is from another hierarchy!
         , imageIdleWatcher(2000 /*ms*/)
         , savingLock(&savingMutex)
+        , savedPaintDevicesCache(rhs.savedPaintDevicesCache) // the clones save the same files
     {
         copyFromImpl(rhs, _q, CONSTRUCT);
         connect(&imageIdleWatcher, SIGNAL(startedIdleMode()), q, SLOT(slotPerformIdleRoutines()));
@@ -351,6 +353,8 @@ public:
     QString documentStorageID {QUuid::createUuid().toString()};
     KisResourceStorageSP documentResourceStorage;
 
+    KisSavedPaintDevicesCacheSP savedPaintDevicesCache;
+
     void syncDecorationsWrapperLayerState();
 
     void setImageAndInitIdleWatcher(KisImageSP _image) {
@@ -1182,6 +1186,9 @@ void KisDocument::slotPerformIdleRoutines()
 {
     d->image->explicitRegenerateLevelOfDetail();
 
+    // the snapshots of the changed devices only keep their old tiles in memory
+    d->savedPaintDevicesCache->releaseStaleEntries();
+
 
     /// TODO: automatical purging is disabled for now: it modifies
     ///       data managers without creating a transaction, which breaks
@@ -1820,6 +1827,11 @@ KisImportExportManager *KisDocument::importExportManager() const
     return d->importExportManager;
 }
 
+KisSavedPaintDevicesCacheSP KisDocument::savedPaintDevicesCache() const
+{
+    return d->savedPaintDevicesCache;
+}
+
 void KisDocument::addCommand(KUndo2Command *command)
 {
     if (command)
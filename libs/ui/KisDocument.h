@@ -40,6 +40,7 @@
 #include <KisReferenceImage.h>
 #include <kis_debug.h>
 #include <KisImportExportUtils.h>
+#include <KisSavedPaintDevicesCache.h>
 #include <kis_config.h>
 
 #include "kritaui_export.h"
@@ -405,6 +406,13 @@ public:
      */
     KisImportExportManager *importExportManager() const;
 
+    /**
+     * @brief savedPaintDevicesCache keeps track of the paint devices that
+     * have not been changed since the document was saved last time
+     * @return the cache shared by the document and its clones
+     */
+    KisSavedPaintDevicesCacheSP savedPaintDevicesCache() const;
+
     /**
      * @brief serializeToNativeByteArray daves the document into a .kra file wtitten
      * to a memory-based byte-array
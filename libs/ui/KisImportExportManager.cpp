@@ -679,6 +679,9 @@ KisImportExportErrorCode KisImportExportManager::doExport(const QString &locatio
 
 KisImportExportErrorCode KisImportExportManager::doExportImpl(const QString &location, QSharedPointer<KisImportExportFilter> filter, KisPropertiesConfigurationSP exportConfiguration)
 {
+    // the entries left by a failed save are not valid anymore
+    m_document->savedPaintDevicesCache()->discardPendingEntries();
+
 #ifdef USE_QSAVEFILE
     QSaveFile file(location);
     file.setDirectWriteFallback(true);
@@ -731,6 +734,16 @@ KisImportExportErrorCode KisImportExportManager::doExportImpl(const QString &loc
         m_document->setErrorMessage(verificationResult);
     }
 
+    /**
+     * The file at the location has been replaced, so the cache should
+     * forget about its old entries. The new ones are valid only if the
+     * file has been written successfully.
+     */
+    if (status.isOk()) {
+        m_document->savedPaintDevicesCache()->commitPendingEntries(location);
+    } else {
+        m_document->savedPaintDevicesCache()->discardPendingEntries();
+    }
 
     return status;
 
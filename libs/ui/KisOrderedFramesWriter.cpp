@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisOrderedFramesWriter.h"
+
+#include <QIODevice>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+#include "kis_debug.h"
+
+namespace {
+struct PendingFrame {
+    int numRepeats = 1;
+    QByteArray data;
+};
+}
+
+struct KisOrderedFramesWriter::Private
+{
+    QIODevice *device = 0;
+    qint64 maxPendingBytes = 0;
+
+    mutable QMutex mutex;
+    QWaitCondition frameWritten;
+
+    QMap<int, PendingFrame> pendingFrames;
+    qint64 pendingBytes = 0;
+    int nextFrame = 0;
+    bool failed = false;
+    bool cancelled = false;
+
+    void writeReadyFrames(bool waitForDevice);
+    void dropPendingFrames();
+};
+
+void KisOrderedFramesWriter::Private::writeReadyFrames(bool waitForDevice)
+{
+    while (true) {
+        QByteArray data;
+
+        {
+            QMutexLocker l(&mutex);
+
+            if (failed || cancelled) return;
+
+            auto it = pendingFrames.constFind(nextFrame);
+            if (it == pendingFrames.constEnd()) return;
+
+            data = it->data;
+        }
+
+        /**
+         * Don't let the data pile up in the buffer of the device. The
+         * next frame is passed to the device only when it has (almost)
+         * sent the previous one, we will be called again on bytesWritten()
+         */
+        if (waitForDevice && device->bytesToWrite() >= data.size()) return;
+
+        const bool success = device->write(data) == data.size();
+
+        if (!success) {
+            warnKrita << "KisOrderedFramesWriter: failed to write frame data:" << device->errorString();
+        }
+
+        QMutexLocker l(&mutex);
+
+        if (!success) {
+            failed = true;
+            dropPendingFrames();
+            return;
+        }
+
+        /**
+         * The held frames are written one copy at a time, the rest of the
+         * copies are moved to the next frame, which has never been rendered
+         */
+        PendingFrame frame = pendingFrames.take(nextFrame);
+        nextFrame++;
+
+        if (frame.numRepeats > 1) {
+            frame.numRepeats--;
+            pendingFrames.insert(nextFrame, frame);
+        } else {
+            pendingBytes -= frame.data.size();
+        }
+
+        frameWritten.wakeAll();
+    }
+}
+
+void KisOrderedFramesWriter::Private::dropPendingFrames()
+{
+    pendingFrames.clear();
+    pendingBytes = 0;
+    frameWritten.wakeAll();
+}
+
+KisOrderedFramesWriter::KisOrderedFramesWriter(QIODevice *device, int firstFrame, qint64 maxPendingBytes, QObject *parent)
+    : QObject(parent),
+      m_d(new Private)
+{
+    m_d->device = device;
+    m_d->nextFrame = firstFrame;
+    m_d->maxPendingBytes = maxPendingBytes;
+
+    connect(device, SIGNAL(bytesWritten(qint64)), SLOT(writePendingFrames()));
+}
+
+KisOrderedFramesWriter::~KisOrderedFramesWriter()
+{
+}
+
+void KisOrderedFramesWriter::addFrame(int frame, int numRepeats, const QByteArray &data)
+{
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        /**
+         * If the encoder is slower than the renderers, the rendering
+         * threads wait for it instead of letting the frames pile up in
+         * memory. The frame the writer is waiting for is always accepted,
+         * otherwise nothing would be written anymore. The thread of the
+         * writer never waits, since it is the one who writes the frames.
+         */
+        if (QThread::currentThread() != this->thread()) {
+            while (frame != m_d->nextFrame &&
+                   m_d->pendingBytes + data.size() > m_d->maxPendingBytes &&
+                   !m_d->failed && !m_d->cancelled) {
+
+                m_d->frameWritten.wait(&m_d->mutex);
+            }
+        }
+
+        if (m_d->failed || m_d->cancelled) return;
+
+        PendingFrame pending;
+        pending.numRepeats = numRepeats;
+        pending.data = data;
+
+        KIS_SAFE_ASSERT_RECOVER_RETURN(!m_d->pendingFrames.contains(frame));
+        m_d->pendingFrames.insert(frame, pending);
+        m_d->pendingBytes += data.size();
+    }
+
+    QMetaObject::invokeMethod(this, "writePendingFrames", Qt::QueuedConnection);
+}
+
+void KisOrderedFramesWriter::cancel()
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->cancelled = true;
+    m_d->dropPendingFrames();
+}
+
+void KisOrderedFramesWriter::flush()
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(QThread::currentThread() == this->thread());
+    m_d->writeReadyFrames(false);
+}
+
+int KisOrderedFramesWriter::nextFrame() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->nextFrame;
+}
+
+bool KisOrderedFramesWriter::hasFailed() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->failed;
+}
+
+void KisOrderedFramesWriter::writePendingFrames()
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(QThread::currentThread() == this->thread());
+    m_d->writeReadyFrames(true);
+}
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISORDEREDFRAMESWRITER_H
+#define KISORDEREDFRAMESWRITER_H
+
+#include <QObject>
+#include <QScopedPointer>
+
+#include "kritaui_export.h"
+
+class QIODevice;
+
+/**
+ * KisOrderedFramesWriter writes the raw data of the rendered frames
+ * into a device (usually the stdin of an encoder process) strictly
+ * in the order of the frames.
+ *
+ * The frames may be added from any thread and in any order, e.g. by
+ * several image clones rendering in parallel. The frames that arrive
+ * too early are kept in memory until all the preceding frames are
+ * written. The device itself is accessed from the thread of the
+ * writer only, so it can be a QProcess.
+ *
+ * The writer never waits for the device. A frame is passed to the
+ * device only when the device has sent (almost) all the previous
+ * data, the rest of the frames are written when the device emits
+ * bytesWritten(). If the encoder is slower than the renderers, the
+ * queued frames are limited by \p maxPendingBytes: the threads adding
+ * the frames wait until some memory is freed.
+ */
+class KRITAUI_EXPORT KisOrderedFramesWriter : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @param device the device the frames are written into
+     * @param firstFrame the frame that should be written first
+     * @param maxPendingBytes the amount of frame data that may be queued
+     *        before addFrame() starts to block the calling threads
+     */
+    KisOrderedFramesWriter(QIODevice *device, int firstFrame,
+                           qint64 maxPendingBytes = 256 * 1024 * 1024,
+                           QObject *parent = 0);
+    ~KisOrderedFramesWriter() override;
+
+    /**
+     * Adds the data of \p frame that will be written \p numRepeats
+     * times, i.e. for all the following identical frames as well.
+     *
+     * Thread-safe, the data is written asynchronously in the thread
+     * of the writer. When called from any other thread, the call blocks
+     * while too much data is queued, unless \p frame is the one the
+     * writer is waiting for.
+     */
+    void addFrame(int frame, int numRepeats, const QByteArray &data);
+
+    /**
+     * Drops all the queued frames and wakes up the threads waiting in
+     * addFrame(). The frames added afterwards are ignored.
+     */
+    void cancel();
+
+    /**
+     * Passes all the frames that are ready to the device, without
+     * waiting for the device to send the previous data. The data is
+     * then sent by the device itself, e.g. QProcess sends its buffer
+     * before closing the write channel. Must be called from the thread
+     * of the writer.
+     */
+    void flush();
+
+    /**
+     * @return the frame that is expected to be written next
+     */
+    int nextFrame() const;
+
+    /**
+     * @return true if the device failed to accept the data
+     */
+    bool hasFailed() const;
+
+public Q_SLOTS:
+    /**
+     * Writes the frames that are ready to be written while the device
+     * has room for them. Must be called from the thread of the writer.
+     */
+    void writePendingFrames();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISORDEREDFRAMESWRITER_H
@@ -69,6 +69,7 @@
 #include "kis_image_animation_interface.h"
 #include "kis_time_range.h"
 #include "kis_idle_watcher.h"
+#include "tiles3/kis_tile_data_store.h"
 #include "kis_image.h"
 #include "KisOpenPane.h"
 
@@ -155,6 +156,14 @@ KisPart::KisPart()
     connect(&d->idleWatcher, SIGNAL(startedIdleMode()),
             &d->animationCachePopulator, SLOT(slotRequestRegeneration()));
 
+    // the swap file is compacted in the swapper thread and identical
+    // tiles are merged in the pooler thread
+    connect(&d->idleWatcher, &KisIdleWatcher::startedIdleMode,
+            [] () {
+                KisTileDataStore::instance()->requestSwapCompaction();
+                KisTileDataStore::instance()->requestDeduplication();
+            });
+
 
     d->animationCachePopulator.slotRequestRegeneration();
     KisBusyWaitBroker::instance()->setFeedbackCallback(&busyWaitWithFeedback);
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisSavedPaintDevicesCache.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMultiHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <kis_datamanager.h>
+
+
+struct KisSavedPaintDevicesCache::Private
+{
+    struct Entry {
+        KisDataManagerSP snapshot;
+        quint64 fingerprint = 0;
+        QString entryName;
+    };
+
+    struct FileStamp {
+        QDateTime lastModified;
+        qint64 size = -1;
+    };
+
+    QMutex mutex;
+
+    QString filePath;
+    FileStamp fileStamp;
+    QMultiHash<quint64, Entry> entries;
+
+    QVector<Entry> pendingEntries;
+
+    static FileStamp currentStamp(const QString &filePath) {
+        FileStamp stamp;
+        QFileInfo info(filePath);
+        if (info.exists()) {
+            stamp.lastModified = info.lastModified();
+            stamp.size = info.size();
+        }
+        return stamp;
+    }
+
+    bool fileIsUnchanged() const {
+        const FileStamp stamp = currentStamp(filePath);
+        return stamp.size >= 0 &&
+            stamp.size == fileStamp.size &&
+            stamp.lastModified == fileStamp.lastModified;
+    }
+
+    void forgetFile() {
+        filePath.clear();
+        fileStamp = FileStamp();
+        entries.clear();
+    }
+};
+
+KisSavedPaintDevicesCache::KisSavedPaintDevicesCache()
+    : m_d(new Private)
+{
+}
+
+KisSavedPaintDevicesCache::~KisSavedPaintDevicesCache()
+{
+}
+
+bool KisSavedPaintDevicesCache::findEntry(KisDataManagerSP dataManager, QString *filePath, QString *entryName)
+{
+    const quint64 fingerprint = dataManager->tilesFingerprint();
+
+    QMutexLocker l(&m_d->mutex);
+
+    for (auto it = m_d->entries.constFind(fingerprint);
+         it != m_d->entries.constEnd() && it.key() == fingerprint; ++it) {
+
+        if (!it->snapshot->hasSameTiles(dataManager.data())) continue;
+
+        if (!m_d->fileIsUnchanged()) {
+            // the file has been changed by someone else, the entries are useless
+            m_d->forgetFile();
+            return false;
+        }
+
+        *filePath = m_d->filePath;
+        *entryName = it->entryName;
+        return true;
+    }
+
+    return false;
+}
+
+void KisSavedPaintDevicesCache::addPendingEntry(KisDataManagerSP dataManager, const QString &entryName)
+{
+    Private::Entry entry;
+    entry.snapshot = new KisDataManager(*dataManager);
+    entry.fingerprint = entry.snapshot->tilesFingerprint();
+    entry.entryName = entryName;
+
+    QMutexLocker l(&m_d->mutex);
+    m_d->pendingEntries.append(entry);
+}
+
+void KisSavedPaintDevicesCache::commitPendingEntries(const QString &filePath)
+{
+    QMutexLocker l(&m_d->mutex);
+
+    m_d->forgetFile();
+
+    const Private::FileStamp stamp = Private::currentStamp(filePath);
+
+    if (stamp.size >= 0 && !m_d->pendingEntries.isEmpty()) {
+        m_d->filePath = filePath;
+        m_d->fileStamp = stamp;
+
+        for (auto it = m_d->pendingEntries.constBegin(); it != m_d->pendingEntries.constEnd(); ++it) {
+            m_d->entries.insert(it->fingerprint, *it);
+        }
+    }
+
+    m_d->pendingEntries.clear();
+}
+
+void KisSavedPaintDevicesCache::discardPendingEntries()
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->pendingEntries.clear();
+}
+
+void KisSavedPaintDevicesCache::releaseStaleEntries()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    for (auto it = m_d->entries.begin(); it != m_d->entries.end();) {
+        if (it->snapshot->hasUnsharedTiles()) {
+            it = m_d->entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
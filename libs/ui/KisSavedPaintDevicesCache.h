@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSAVEDPAINTDEVICESCACHE_H
+#define KISSAVEDPAINTDEVICESCACHE_H
+
+#include "kritaui_export.h"
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+
+#include <kis_shared_ptr.h>
+
+class KisDataManager;
+typedef KisSharedPtr<KisDataManager> KisDataManagerSP;
+
+/**
+ * Remembers which entries of the last .kra file saved by the document
+ * contain the pixel data of which data managers. It lets the saver
+ * copy the entries of the devices that have not been changed since
+ * the last save from the previous file as they are, instead of
+ * serializing and compressing them again.
+ *
+ * The cache keeps a shallow copy of every saved data manager. The
+ * copy shares all the tiles with the original, so any change of the
+ * original will copy the changed tiles, which can be detected with
+ * KisTiledDataManager::hasSameTiles(). The devices are matched by
+ * their content only, so the cache is still valid when the image
+ * is cloned for saving in background. The entries are indexed by
+ * KisTiledDataManager::tilesFingerprint(), so a lookup doesn't
+ * depend on the number of the saved devices.
+ *
+ * Memory trade-off: while a copy is alive, the first write into
+ * any of its tiles has to copy the tile, and the old tile stays in
+ * memory. Usually that costs nothing, since the undo history keeps
+ * the old tiles and forces the same copying anyway. To keep the cost
+ * bounded in the other cases, only the entries of the last saved
+ * file are kept, and releaseStaleEntries() drops the copies that
+ * have become the only owners of some of their tiles.
+ *
+ * The entries added while saving are pending until the file is
+ * actually written to the disk, see commitPendingEntries().
+ */
+class KRITAUI_EXPORT KisSavedPaintDevicesCache
+{
+public:
+    KisSavedPaintDevicesCache();
+    ~KisSavedPaintDevicesCache();
+
+    /**
+     * Looks for a file entry that contains exactly the same tiles as
+     * \p dataManager. The file is checked to not have been changed
+     * since it was saved.
+     *
+     * \return true if such entry has been found
+     */
+    bool findEntry(KisDataManagerSP dataManager, QString *filePath, QString *entryName);
+
+    /**
+     * Remembers that \p dataManager has been written into \p entryName
+     * of the file which is being saved now
+     */
+    void addPendingEntry(KisDataManagerSP dataManager, const QString &entryName);
+
+    /**
+     * Should be called when the file has been successfully written to
+     * \p filePath. All the entries of the previously saved files are
+     * replaced with the pending ones.
+     */
+    void commitPendingEntries(const QString &filePath);
+
+    /**
+     * Should be called when saving of the file has failed
+     */
+    void discardPendingEntries();
+
+    /**
+     * Drops the entries whose copy of the data manager is the only
+     * owner of some of its tiles. The original device has been
+     * changed or removed since the save, so the entry will never be
+     * used again, and the copy just keeps the old tiles in memory.
+     * Should be called when the document has been changed.
+     */
+    void releaseStaleEntries();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+typedef QSharedPointer<KisSavedPaintDevicesCache> KisSavedPaintDevicesCacheSP;
+
+#endif // KISSAVEDPAINTDEVICESCACHE_H
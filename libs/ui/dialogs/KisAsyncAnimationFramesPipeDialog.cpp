@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAsyncAnimationFramesPipeDialog.h"
+
+#include <klocalizedstring.h>
+
+#include <kis_image.h>
+#include <kis_time_range.h>
+
+#include <KisAsyncAnimationFramesPipeRenderer.h>
+#include <KisOrderedFramesWriter.h>
+
+struct KisAsyncAnimationFramesPipeDialog::Private {
+    Private(KisImageSP _image,
+            const KisTimeRange &_range,
+            QIODevice *device,
+            const KoColorSpace *_dstColorSpace)
+        : originalImage(_image),
+          range(_range),
+          dstColorSpace(_dstColorSpace),
+          writer(device, _range.start())
+    {
+    }
+
+    KisImageSP originalImage;
+    KisTimeRange range;
+    const KoColorSpace *dstColorSpace;
+    KisOrderedFramesWriter writer;
+};
+
+KisAsyncAnimationFramesPipeDialog::KisAsyncAnimationFramesPipeDialog(KisImageSP originalImage,
+                                                                     const KisTimeRange &range,
+                                                                     QIODevice *device,
+                                                                     const KoColorSpace *dstColorSpace)
+    : KisAsyncAnimationRenderDialogBase(i18n("Rendering frames..."), originalImage, 0),
+      m_d(new Private(originalImage, range, device, dstColorSpace))
+{
+}
+
+KisAsyncAnimationFramesPipeDialog::~KisAsyncAnimationFramesPipeDialog()
+{
+}
+
+KisAsyncAnimationRenderDialogBase::Result KisAsyncAnimationFramesPipeDialog::regenerateRange(KisViewManager *viewManager)
+{
+    Result result = KisAsyncAnimationRenderDialogBase::regenerateRange(viewManager);
+
+    if (result == RenderComplete) {
+        /**
+         * The last frames might still be waiting in the event queue or
+         * for the room in the device's buffer. Pass them to the device
+         * right now, it will send them itself before closing the channel.
+         */
+        m_d->writer.flush();
+
+        if (m_d->writer.hasFailed() || m_d->writer.nextFrame() != m_d->range.end() + 1) {
+            result = RenderFailed;
+        }
+    }
+
+    return result;
+}
+
+QList<int> KisAsyncAnimationFramesPipeDialog::calcDirtyFrames() const
+{
+    QList<int> result;
+    for (int frame = m_d->range.start(); frame <= m_d->range.end(); frame++) {
+        KisTimeRange heldFrameTimeRange = KisTimeRange::calculateIdenticalFramesRecursive(m_d->originalImage->root(), frame);
+
+        // Clamp holds that begin before the rendered range onto it
+        heldFrameTimeRange &= m_d->range;
+
+        KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(heldFrameTimeRange.isValid(), result);
+
+        result.append(heldFrameTimeRange.start());
+
+        if (heldFrameTimeRange.isInfinite()) {
+            break;
+        } else {
+            frame = heldFrameTimeRange.end();
+        }
+    }
+    return result;
+}
+
+KisAsyncAnimationRendererBase *KisAsyncAnimationFramesPipeDialog::createRenderer(KisImageSP image)
+{
+    Q_UNUSED(image);
+    return new KisAsyncAnimationFramesPipeRenderer(&m_d->writer, m_d->range, m_d->dstColorSpace);
+}
+
+void KisAsyncAnimationFramesPipeDialog::initializeRendererForFrame(KisAsyncAnimationRendererBase *renderer, KisImageSP image, int frame)
+{
+    Q_UNUSED(renderer);
+    Q_UNUSED(image);
+    Q_UNUSED(frame);
+}
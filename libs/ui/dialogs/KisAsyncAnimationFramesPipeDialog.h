@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISASYNCANIMATIONFRAMESPIPEDIALOG_H
+#define KISASYNCANIMATIONFRAMESPIPEDIALOG_H
+
+#include "KisAsyncAnimationRenderDialogBase.h"
+#include "kis_types.h"
+
+class QIODevice;
+class KoColorSpace;
+
+/**
+ * Renders the frames of the range and writes their raw pixels into
+ * \p device one after another, in the order of the frames. Every frame
+ * of the range is written, the held frames are rendered only once.
+ *
+ * The device is usually the stdin of an encoder reading a raw video
+ * stream, so no intermediate image files are created.
+ */
+class KRITAUI_EXPORT KisAsyncAnimationFramesPipeDialog : public KisAsyncAnimationRenderDialogBase
+{
+public:
+    KisAsyncAnimationFramesPipeDialog(KisImageSP image,
+                                      const KisTimeRange &range,
+                                      QIODevice *device,
+                                      const KoColorSpace *dstColorSpace);
+
+    ~KisAsyncAnimationFramesPipeDialog();
+
+    Result regenerateRange(KisViewManager *viewManager) override;
+
+protected:
+    QList<int> calcDirtyFrames() const override;
+    KisAsyncAnimationRendererBase* createRenderer(KisImageSP image) override;
+    void initializeRendererForFrame(KisAsyncAnimationRendererBase *renderer,
+                                    KisImageSP image, int frame) override;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISASYNCANIMATIONFRAMESPIPEDIALOG_H
@@ -1847,6 +1847,16 @@ void KisConfig::setTrimKra(bool trim)
     m_cfg.writeEntry("TrimKra", trim);
 }
 
+bool KisConfig::lazyLoadKra(bool defaultValue) const
+{
+    return (defaultValue ? false : m_cfg.readEntry("LazyLoadKra", false));
+}
+
+void KisConfig::setLazyLoadKra(bool lazy)
+{
+    m_cfg.writeEntry("LazyLoadKra", lazy);
+}
+
 bool KisConfig::toolOptionsInDocker(bool defaultValue) const
 {
     return (defaultValue ? true : m_cfg.readEntry("ToolOptionsInDocker", true));
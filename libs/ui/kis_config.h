@@ -530,6 +530,14 @@ public:
     bool trimKra(bool defaultValue = false) const;
     void setTrimKra(bool trim);
 
+    /**
+     * When enabled, the layers of .kra files are kept compressed in
+     * memory after loading and every tile is decompressed on the
+     * first access only
+     */
+    bool lazyLoadKra(bool defaultValue = false) const;
+    void setLazyLoadKra(bool lazy);
+
     bool toolOptionsInDocker(bool defaultValue = false) const;
     void setToolOptionsInDocker(bool inDocker);
 
@@ -306,8 +306,9 @@ void KisStatusBar::updateMemoryStatus()
                   "  image data:\t %3 / %4\n"
                   "  pool:\t\t %5 / %6\n"
                   "  undo data:\t %7\n"
+                  "  unused tiles:\t %8\n"
                   "\n"
-                  "Swap used:\t %8",
+                  "Swap used:\t %9",
                   format.formatByteSize(stats.totalMemorySize),
                   format.formatByteSize(stats.totalMemoryLimit),
 
@@ -318,9 +319,31 @@ void KisStatusBar::updateMemoryStatus()
                   format.formatByteSize(stats.tilesPoolLimit),
 
                   format.formatByteSize(stats.historicalMemorySize),
+                  format.formatByteSize(stats.allocatorPoolSize),
                   format.formatByteSize(stats.swapSize));
 
-    QString longStats = imageStatsMsg + "\n" + memoryStatsMsg;
+    QString swapStatsMsg =
+            i18nc("tooltip on statusbar memory reporting button (swap stats)",
+                  "\n"
+                  "  swap file:\t %1\n"
+                  "  compacted:\t %2",
+                  format.formatByteSize(stats.swapFileSize),
+                  format.formatByteSize(stats.swapCompactionSavedSize));
+
+    if (stats.swapCompactionProgress < 100) {
+        swapStatsMsg +=
+            i18nc("tooltip on statusbar memory reporting button (swap stats)",
+                  " (compacting: %1%)", stats.swapCompactionProgress);
+    }
+
+    QString longStats = imageStatsMsg + "\n" + memoryStatsMsg + swapStatsMsg;
+
+    if (stats.deduplicatedSize > 0) {
+        longStats +=
+            i18nc("tooltip on statusbar memory reporting button (deduplication stats)",
+                  "\n\nShared tiles:\t %1",
+                  format.formatByteSize(stats.deduplicatedSize));
+    }
 
     QString shortStats = format.formatByteSize(stats.imageSize);
     QIcon icon;
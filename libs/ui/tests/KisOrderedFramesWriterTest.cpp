@@ -0,0 +1,159 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "KisOrderedFramesWriterTest.h"
+
+#include <QTest>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+
+#include <thread>
+
+#include "KisOrderedFramesWriter.h"
+
+namespace {
+QByteArray frameData(int frame)
+{
+    return QByteArray(16, char('a' + frame));
+}
+}
+
+void KisOrderedFramesWriterTest::testOutOfOrderFrames()
+{
+    const int firstFrame = 3;
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    KisOrderedFramesWriter writer(&buffer, firstFrame);
+
+    // frame 5 is held for two frames, so frame 6 is never rendered
+    writer.addFrame(7, 1, frameData(7));
+    writer.addFrame(5, 2, frameData(5));
+    QCoreApplication::processEvents();
+
+    // the first frame hasn't arrived yet, so nothing can be written
+    QCOMPARE(buffer.data().size(), 0);
+    QCOMPARE(writer.nextFrame(), firstFrame);
+
+    writer.addFrame(3, 1, frameData(3));
+    QCoreApplication::processEvents();
+
+    // frame 4 is still missing, the later frames should wait for it
+    QCOMPARE(buffer.data(), frameData(3));
+    QCOMPARE(writer.nextFrame(), 4);
+
+    writer.addFrame(8, 1, frameData(8));
+    writer.addFrame(4, 1, frameData(4));
+
+    /**
+     * When the rendering is finished, the last frames may still be
+     * waiting in the event queue, so the dialog flushes them explicitly
+     * without returning to the event loop
+     */
+    writer.flush();
+
+    QByteArray expected;
+    expected += frameData(3);
+    expected += frameData(4);
+    expected += frameData(5);
+    expected += frameData(5);
+    expected += frameData(7);
+    expected += frameData(8);
+
+    QCOMPARE(buffer.data(), expected);
+    QCOMPARE(writer.nextFrame(), 9);
+    QVERIFY(!writer.hasFailed());
+
+    // the queued write requests should not duplicate the frames
+    QCoreApplication::processEvents();
+    QCOMPARE(buffer.data(), expected);
+}
+
+void KisOrderedFramesWriterTest::testBackPressure()
+{
+    const int firstFrame = 0;
+    const int frameSize = frameData(0).size();
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    // only two frames may be queued
+    KisOrderedFramesWriter writer(&buffer, firstFrame, 2 * frameSize);
+
+    QAtomicInt numAddedFrames;
+
+    // the first frame is delayed, the later ones fill the queue
+    std::thread renderer([&writer, &numAddedFrames] () {
+        for (int frame = 1; frame < 5; frame++) {
+            writer.addFrame(frame, 1, frameData(frame));
+            numAddedFrames.ref();
+        }
+    });
+
+    QTest::qWait(100);
+    QCOMPARE(numAddedFrames.loadAcquire(), 2);
+
+    // the first frame is always accepted and unblocks the renderer
+    writer.addFrame(0, 1, frameData(0));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (numAddedFrames.loadAcquire() < 4 && timer.elapsed() < 5000) {
+        QCoreApplication::processEvents();
+    }
+
+    renderer.join();
+    writer.flush();
+
+    QByteArray expected;
+    for (int frame = 0; frame < 5; frame++) {
+        expected += frameData(frame);
+    }
+
+    QCOMPARE(buffer.data(), expected);
+    QCOMPARE(writer.nextFrame(), 5);
+}
+
+void KisOrderedFramesWriterTest::testCancelReleasesRenderers()
+{
+    const int frameSize = frameData(0).size();
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    KisOrderedFramesWriter writer(&buffer, 0, frameSize);
+
+    std::thread renderer([&writer] () {
+        writer.addFrame(1, 1, frameData(1));
+        writer.addFrame(2, 1, frameData(2));
+    });
+
+    // the renderer waits for frame 0, which never comes
+    QTest::qWait(100);
+
+    writer.cancel();
+    renderer.join();
+
+    writer.flush();
+    QCOMPARE(buffer.data().size(), 0);
+    QCOMPARE(writer.nextFrame(), 0);
+}
+
+QTEST_MAIN(KisOrderedFramesWriterTest)
@@ -19,6 +19,7 @@
 #include "kis_animation_exporter_test.h"
 
 #include "dialogs/KisAsyncAnimationFramesSaveDialog.h"
+#include "dialogs/KisAsyncAnimationFramesPipeDialog.h"
 
 #include <QTest>
 #include <testutil.h>
@@ -32,6 +33,8 @@
 #include "kis_keyframe_channel.h"
 #include <kistest.h>
 
+#include <QBuffer>
+
 void KisAnimationExporterTest::testAnimationExport()
 {
     KisDocument *document = KisPart::instance()->createDocument();
@@ -99,4 +102,61 @@ void KisAnimationExporterTest::testAnimationExport()
     }
 }
 
+void KisAnimationExporterTest::testAnimationPipeExport()
+{
+    KisDocument *document = KisPart::instance()->createDocument();
+    QRect rect(0,0,512,512);
+    QRect fillRect(10,0,502,512);
+    TestUtil::MaskParent p(rect);
+    document->setCurrentImage(p.image);
+    const KoColorSpace *cs = p.image->colorSpace();
+
+    KUndo2Command parentCommand;
+
+    p.layer->enableAnimation();
+    KisKeyframeChannel *rasterChannel = p.layer->getKeyframeChannel(KisKeyframeChannel::Content.id(), true);
+
+    rasterChannel->addKeyframe(1, &parentCommand);
+    rasterChannel->addKeyframe(2, &parentCommand);
+    p.image->animationInterface()->setFullClipRange(KisTimeRange::fromTime(0, 3));
+
+    KisPaintDeviceSP dev = p.layer->paintDevice();
+    const int frameSize = rect.width() * rect.height() * cs->pixelSize();
+
+    QVector<QByteArray> frames;
+    QList<QColor> colors({Qt::red, Qt::green, Qt::blue});
+
+    for (int i = 0; i < colors.size(); i++) {
+        p.image->animationInterface()->switchCurrentTimeAsync(i);
+        p.image->waitForDone();
+        dev->fill(fillRect, KoColor(colors[i], cs));
+
+        QByteArray frame(frameSize, 0);
+        dev->readBytes(reinterpret_cast<quint8*>(frame.data()), rect);
+        frames.append(frame);
+    }
+
+    // frame 3 is a hold of frame 2
+    frames.append(frames.last());
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    KisAsyncAnimationFramesPipeDialog exporter(document->image(),
+                                               KisTimeRange::fromTime(0,3),
+                                               &buffer,
+                                               cs);
+
+    exporter.setBatchMode(true);
+    QCOMPARE(exporter.regenerateRange(0), KisAsyncAnimationRenderDialogBase::RenderComplete);
+
+    const QByteArray exported = buffer.data();
+    QCOMPARE(exported.size(), frames.size() * frameSize);
+
+    for (int i = 0; i < frames.size(); i++) {
+        QVERIFY2(exported.mid(i * frameSize, frameSize) == frames[i],
+                 QString("Frame %1 is written incorrectly").arg(i).toLatin1());
+    }
+}
+
 KISTEST_MAIN(KisAnimationExporterTest)
@@ -25,6 +25,7 @@
 #include <klocalizedstring.h>
 
 #include "LcmsColorSpace.h"
+#include "LcmsMatrixShaperTransformation.h"
 
 // -- KoLcmsColorConversionTransformation --
 
@@ -230,10 +231,22 @@ KoColorConversionTransformation *IccColorSpaceEngine::createColorTransformation(
     Q_ASSERT(srcColorSpace);
     Q_ASSERT(dstColorSpace);
 
+    LcmsColorProfileContainer *srcProfile = dynamic_cast<const IccColorProfile *>(srcColorSpace->profile())->asLcms();
+    LcmsColorProfileContainer *dstProfile = dynamic_cast<const IccColorProfile *>(dstColorSpace->profile())->asLcms();
+
+    // conversions between RGB matrix-shaper profiles don't need LCMS at all
+    KoColorConversionTransformation *transformation =
+        LcmsMatrixShaper::tryCreateTransformation(srcColorSpace, srcProfile,
+                                                  dstColorSpace, dstProfile,
+                                                  renderingIntent, conversionFlags);
+    if (transformation) {
+        return transformation;
+    }
+
     return new KoLcmsColorConversionTransformation(
-                srcColorSpace, computeColorSpaceType(srcColorSpace),
-                dynamic_cast<const IccColorProfile *>(srcColorSpace->profile())->asLcms(), dstColorSpace, computeColorSpaceType(dstColorSpace),
-                dynamic_cast<const IccColorProfile *>(dstColorSpace->profile())->asLcms(), renderingIntent, conversionFlags);
+                srcColorSpace, computeColorSpaceType(srcColorSpace), srcProfile,
+                dstColorSpace, computeColorSpaceType(dstColorSpace), dstProfile,
+                renderingIntent, conversionFlags);
 
 }
 KoColorProofingConversionTransformation *IccColorSpaceEngine::createColorProofingTransformation(const KoColorSpace *srcColorSpace,
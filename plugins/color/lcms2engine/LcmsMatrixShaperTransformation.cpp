@@ -0,0 +1,430 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "LcmsMatrixShaperTransformation.h"
+
+#include <type_traits>
+
+#include <QScopedPointer>
+#include <QVector>
+
+#include <lcms2.h>
+
+#include <KoConfig.h>
+#include "KoColorModelStandardIds.h"
+#include "KoColorSpace.h"
+#include "KoColorSpaceMaths.h"
+#include "KoBgrColorSpaceTraits.h"
+#include "KoRgbColorSpaceTraits.h"
+#include "KoMatrixTrcKernelFactory.h"
+#include "kis_assert.h"
+
+#include "LcmsColorProfileContainer.h"
+
+namespace {
+
+/**
+ * The number of samples in the encoding curves of integer color spaces.
+ * LCMS uses tables of the same precision (1.14 fixed point) in its own
+ * optimized matrix-shaper transforms.
+ */
+const int encodingCurveSize = 16385;
+
+/**
+ * Pixels are converted in chunks, so that the planar buffers fit on stack
+ */
+const int pixelsPerChunk = 256;
+
+struct MatrixShaper {
+    /// row-major matrix with the colorants as columns: linear RGB -> XYZ (D50)
+    double matrix[9];
+    cmsToneCurve *curves[3];
+};
+
+bool fetchMatrixShaper(LcmsColorProfileContainer *profile,
+                       KoColorConversionTransformation::Intent renderingIntent,
+                       cmsUInt32Number direction,
+                       MatrixShaper *result)
+{
+    cmsHPROFILE hProfile = profile->lcmsProfile();
+
+    if (!hProfile ||
+        cmsGetColorSpace(hProfile) != cmsSigRgbData ||
+        cmsGetPCS(hProfile) != cmsSigXYZData ||
+        !cmsIsMatrixShaper(hProfile) ||
+        cmsIsCLUT(hProfile, renderingIntent, direction)) {
+
+        return false;
+    }
+
+    const cmsTagSignature colorantTags[] = {cmsSigRedColorantTag, cmsSigGreenColorantTag, cmsSigBlueColorantTag};
+    const cmsTagSignature curveTags[] = {cmsSigRedTRCTag, cmsSigGreenTRCTag, cmsSigBlueTRCTag};
+
+    for (int i = 0; i < 3; i++) {
+        const cmsCIEXYZ *colorant = static_cast<const cmsCIEXYZ*>(cmsReadTag(hProfile, colorantTags[i]));
+        cmsToneCurve *curve = static_cast<cmsToneCurve*>(cmsReadTag(hProfile, curveTags[i]));
+
+        if (!colorant || !curve) return false;
+
+        result->matrix[0 * 3 + i] = colorant->X;
+        result->matrix[1 * 3 + i] = colorant->Y;
+        result->matrix[2 * 3 + i] = colorant->Z;
+        result->curves[i] = curve;
+    }
+
+    return true;
+}
+
+bool curvesAreLinear(const MatrixShaper &shaper)
+{
+    for (int i = 0; i < 3; i++) {
+        if (!cmsIsToneCurveLinear(shaper.curves[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * Blackpoint compensation is a noop when the black of both profiles
+ * is zero, otherwise we leave the conversion to LCMS
+ */
+bool blackIsZero(const MatrixShaper &shaper)
+{
+    for (int i = 0; i < 3; i++) {
+        if (qAbs(cmsEvalToneCurveFloat(shaper.curves[i], 0.0f)) > 1e-6f) return false;
+    }
+    return true;
+}
+
+bool invertMatrix(const double m[9], double result[9])
+{
+    const double det =
+        m[0] * (m[4] * m[8] - m[5] * m[7]) -
+        m[1] * (m[3] * m[8] - m[5] * m[6]) +
+        m[2] * (m[3] * m[7] - m[4] * m[6]);
+
+    if (qAbs(det) < 1e-12) return false;
+
+    result[0] =  (m[4] * m[8] - m[5] * m[7]) / det;
+    result[1] = -(m[1] * m[8] - m[2] * m[7]) / det;
+    result[2] =  (m[1] * m[5] - m[2] * m[4]) / det;
+    result[3] = -(m[3] * m[8] - m[5] * m[6]) / det;
+    result[4] =  (m[0] * m[8] - m[2] * m[6]) / det;
+    result[5] = -(m[0] * m[5] - m[2] * m[3]) / det;
+    result[6] =  (m[3] * m[7] - m[4] * m[6]) / det;
+    result[7] = -(m[0] * m[7] - m[1] * m[6]) / det;
+    result[8] =  (m[0] * m[4] - m[1] * m[3]) / det;
+
+    return true;
+}
+
+QVector<float> sampleCurve(cmsToneCurve *curve, int size)
+{
+    QVector<float> samples(size);
+
+    for (int i = 0; i < size; i++) {
+        samples[i] = cmsEvalToneCurveFloat(curve, float(i) / (size - 1));
+    }
+
+    return samples;
+}
+
+template <typename channel_type,
+          bool isInteger = std::is_integral<channel_type>::value>
+struct ChannelDecoder
+{
+    // floating point values are never decoded with the tables
+    static inline float decode(channel_type value, const float *curve) {
+        Q_UNUSED(curve);
+        return KoColorSpaceMaths<channel_type, float>::scaleToA(value);
+    }
+
+    static QVector<float> sampleDecodingCurve(cmsToneCurve *curve) {
+        Q_UNUSED(curve);
+        return QVector<float>();
+    }
+};
+
+template <typename channel_type>
+struct ChannelDecoder<channel_type, true>
+{
+    static inline float decode(channel_type value, const float *curve) {
+        return curve ? curve[value] : KoColorSpaceMaths<channel_type, float>::scaleToA(value);
+    }
+
+    static QVector<float> sampleDecodingCurve(cmsToneCurve *curve) {
+        return sampleCurve(curve, int(KoColorSpaceMathsTraits<channel_type>::unitValue) + 1);
+    }
+};
+
+template <class SrcCSTraits, class DstCSTraits>
+class KoLcmsMatrixShaperTransformation : public KoColorConversionTransformation
+{
+    typedef typename SrcCSTraits::channels_type src_channel_type;
+    typedef typename DstCSTraits::channels_type dst_channel_type;
+    typedef ChannelDecoder<src_channel_type> Decoder;
+
+public:
+    /**
+     * \p decodingCurves are the transfer curves of the source profile
+     * (null for a pure depth conversion) and \p kernel converts linear
+     * values into the destination profile (null for a pure depth
+     * conversion). The transformation takes ownership of the kernel.
+     */
+    KoLcmsMatrixShaperTransformation(const KoColorSpace *srcCs,
+                                     const KoColorSpace *dstCs,
+                                     Intent renderingIntent,
+                                     ConversionFlags conversionFlags,
+                                     cmsToneCurve *const *decodingCurves,
+                                     KoMatrixTrcKernelBase *kernel)
+        : KoColorConversionTransformation(srcCs, dstCs, renderingIntent, conversionFlags),
+          m_kernel(kernel)
+    {
+        for (int i = 0; i < 3; i++) {
+            if (decodingCurves) {
+                // profiles often link all the three TRC tags to the same curve
+                for (int j = 0; j < i; j++) {
+                    if (decodingCurves[j] == decodingCurves[i]) {
+                        m_decodingTables[i] = m_decodingTables[j];
+                        break;
+                    }
+                }
+
+                if (m_decodingTables[i].isEmpty()) {
+                    m_decodingTables[i] = Decoder::sampleDecodingCurve(decodingCurves[i]);
+                }
+            }
+
+            m_decodingCurves[i] =
+                !m_decodingTables[i].isEmpty() ? m_decodingTables[i].constData() : 0;
+        }
+    }
+
+    void transform(const quint8 *src8, quint8 *dst8, qint32 nPixels) const override
+    {
+        const typename SrcCSTraits::Pixel *src = reinterpret_cast<const typename SrcCSTraits::Pixel*>(src8);
+        typename DstCSTraits::Pixel *dst = reinterpret_cast<typename DstCSTraits::Pixel*>(dst8);
+
+        float red[pixelsPerChunk];
+        float green[pixelsPerChunk];
+        float blue[pixelsPerChunk];
+        dst_channel_type alpha[pixelsPerChunk];
+
+        while (nPixels > 0) {
+            const int numPixels = qMin(nPixels, pixelsPerChunk);
+
+            for (int i = 0; i < numPixels; i++) {
+                red[i] = Decoder::decode(src[i].red, m_decodingCurves[0]);
+                green[i] = Decoder::decode(src[i].green, m_decodingCurves[1]);
+                blue[i] = Decoder::decode(src[i].blue, m_decodingCurves[2]);
+                alpha[i] = KoColorSpaceMaths<src_channel_type, dst_channel_type>::scaleToA(src[i].alpha);
+            }
+
+            if (m_kernel) {
+                m_kernel->process(red, green, blue, numPixels);
+            }
+
+            for (int i = 0; i < numPixels; i++) {
+                dst[i].red = KoColorSpaceMaths<float, dst_channel_type>::scaleToA(red[i]);
+                dst[i].green = KoColorSpaceMaths<float, dst_channel_type>::scaleToA(green[i]);
+                dst[i].blue = KoColorSpaceMaths<float, dst_channel_type>::scaleToA(blue[i]);
+                dst[i].alpha = alpha[i];
+            }
+
+            src += numPixels;
+            dst += numPixels;
+            nPixels -= numPixels;
+        }
+    }
+
+private:
+    QVector<float> m_decodingTables[3];
+    const float *m_decodingCurves[3];
+    QScopedPointer<KoMatrixTrcKernelBase> m_kernel;
+};
+
+bool isFloatDepth(const KoID &depthId)
+{
+    return depthId == Float16BitsColorDepthID || depthId == Float32BitsColorDepthID;
+}
+
+bool isSupportedDepth(const KoID &depthId)
+{
+    return depthId == Integer8BitsColorDepthID ||
+        depthId == Integer16BitsColorDepthID ||
+#ifdef HAVE_OPENEXR
+        depthId == Float16BitsColorDepthID ||
+#endif
+        depthId == Float32BitsColorDepthID;
+}
+
+template <class SrcCSTraits>
+KoColorConversionTransformation *createForSrcTraits(const KoColorSpace *srcCs,
+                                                    const KoColorSpace *dstCs,
+                                                    KoColorConversionTransformation::Intent renderingIntent,
+                                                    KoColorConversionTransformation::ConversionFlags conversionFlags,
+                                                    cmsToneCurve *const *decodingCurves,
+                                                    KoMatrixTrcKernelBase *kernel)
+{
+    const KoID dstDepth = dstCs->colorDepthId();
+
+    if (dstDepth == Integer8BitsColorDepthID) {
+        return new KoLcmsMatrixShaperTransformation<SrcCSTraits, KoBgrU8Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+    } else if (dstDepth == Integer16BitsColorDepthID) {
+        return new KoLcmsMatrixShaperTransformation<SrcCSTraits, KoBgrU16Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+#ifdef HAVE_OPENEXR
+    } else if (dstDepth == Float16BitsColorDepthID) {
+        return new KoLcmsMatrixShaperTransformation<SrcCSTraits, KoRgbF16Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+#endif
+    } else if (dstDepth == Float32BitsColorDepthID) {
+        return new KoLcmsMatrixShaperTransformation<SrcCSTraits, KoRgbF32Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+    }
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(0 && "unsupported destination depth");
+    delete kernel;
+    return 0;
+}
+
+KoColorConversionTransformation *createTransformation(const KoColorSpace *srcCs,
+                                                      const KoColorSpace *dstCs,
+                                                      KoColorConversionTransformation::Intent renderingIntent,
+                                                      KoColorConversionTransformation::ConversionFlags conversionFlags,
+                                                      cmsToneCurve *const *decodingCurves,
+                                                      KoMatrixTrcKernelBase *kernel)
+{
+    const KoID srcDepth = srcCs->colorDepthId();
+
+    if (srcDepth == Integer8BitsColorDepthID) {
+        return createForSrcTraits<KoBgrU8Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+    } else if (srcDepth == Integer16BitsColorDepthID) {
+        return createForSrcTraits<KoBgrU16Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+#ifdef HAVE_OPENEXR
+    } else if (srcDepth == Float16BitsColorDepthID) {
+        return createForSrcTraits<KoRgbF16Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+#endif
+    } else if (srcDepth == Float32BitsColorDepthID) {
+        return createForSrcTraits<KoRgbF32Traits>(srcCs, dstCs, renderingIntent, conversionFlags, decodingCurves, kernel);
+    }
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(0 && "unsupported source depth");
+    delete kernel;
+    return 0;
+}
+
+}
+
+namespace LcmsMatrixShaper
+{
+
+KoColorConversionTransformation *tryCreateTransformation(const KoColorSpace *srcCs,
+                                                         LcmsColorProfileContainer *srcProfile,
+                                                         const KoColorSpace *dstCs,
+                                                         LcmsColorProfileContainer *dstProfile,
+                                                         KoColorConversionTransformation::Intent renderingIntent,
+                                                         KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    if (!srcProfile || !dstProfile) return 0;
+
+    if (srcCs->colorModelId() != RGBAColorModelID ||
+        dstCs->colorModelId() != RGBAColorModelID ||
+        !isSupportedDepth(srcCs->colorDepthId()) ||
+        !isSupportedDepth(dstCs->colorDepthId())) {
+
+        return 0;
+    }
+
+    if (renderingIntent == KoColorConversionTransformation::IntentAbsoluteColorimetric ||
+        conversionFlags.testFlag(KoColorConversionTransformation::NoOptimization) ||
+        conversionFlags.testFlag(KoColorConversionTransformation::GamutCheck) ||
+        conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing)) {
+
+        return 0;
+    }
+
+    MatrixShaper srcShaper;
+    MatrixShaper dstShaper;
+
+    if (!fetchMatrixShaper(srcProfile, renderingIntent, LCMS_USED_AS_INPUT, &srcShaper) ||
+        !fetchMatrixShaper(dstProfile, renderingIntent, LCMS_USED_AS_OUTPUT, &dstShaper)) {
+
+        return 0;
+    }
+
+    const QByteArray srcProfileId = srcProfile->getProfileUniqueId();
+    const bool sameProfile =
+        srcProfile == dstProfile ||
+        (!srcProfileId.isEmpty() && srcProfileId == dstProfile->getProfileUniqueId());
+
+    if (sameProfile) {
+        return createTransformation(srcCs, dstCs, renderingIntent, conversionFlags, 0, 0);
+    }
+
+    /**
+     * LCMS evaluates the curves of floating point color spaces in
+     * unbounded mode, which our tables cannot represent. Linear curves
+     * are fine though, and they are what floating point color spaces
+     * are normally used with.
+     */
+    const bool srcIsFloat = isFloatDepth(srcCs->colorDepthId());
+    const bool dstIsFloat = isFloatDepth(dstCs->colorDepthId());
+
+    if ((srcIsFloat && !curvesAreLinear(srcShaper)) ||
+        (dstIsFloat && !curvesAreLinear(dstShaper))) {
+
+        return 0;
+    }
+
+    if (conversionFlags.testFlag(KoColorConversionTransformation::BlackpointCompensation) &&
+        (!blackIsZero(srcShaper) || !blackIsZero(dstShaper))) {
+
+        return 0;
+    }
+
+    double dstInverse[9];
+    if (!invertMatrix(dstShaper.matrix, dstInverse)) return 0;
+
+    KoMatrixTrcKernelBase::Params params;
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            double value = 0.0;
+
+            for (int i = 0; i < 3; i++) {
+                value += dstInverse[row * 3 + i] * srcShaper.matrix[i * 3 + col];
+            }
+
+            params.matrix[row * 3 + col] = value;
+        }
+    }
+
+    if (!dstIsFloat) {
+        for (int i = 0; i < 3; i++) {
+            cmsToneCurve *reversedCurve = cmsReverseToneCurve(dstShaper.curves[i]);
+            if (!reversedCurve) return 0;
+
+            params.encodingCurves[i] = sampleCurve(reversedCurve, encodingCurveSize);
+            cmsFreeToneCurve(reversedCurve);
+        }
+    }
+
+    return createTransformation(srcCs, dstCs, renderingIntent, conversionFlags,
+                                !srcIsFloat ? srcShaper.curves : 0,
+                                KoMatrixTrcKernelFactory::create(params));
+}
+
+}
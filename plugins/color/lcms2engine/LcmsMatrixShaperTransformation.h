@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LCMSMATRIXSHAPERTRANSFORMATION_H
+#define LCMSMATRIXSHAPERTRANSFORMATION_H
+
+#include "KoColorConversionTransformation.h"
+
+class LcmsColorProfileContainer;
+
+namespace LcmsMatrixShaper
+{
+
+/**
+ * Creates a transformation between two RGB color spaces with matrix-shaper
+ * (matrix/TRC) profiles that doesn't go through cmsDoTransform(). The
+ * pixels are linearized with lookup tables, converted with a single 3x3
+ * matrix by a vectorized KoMatrixTrcKernelBase and encoded with the sampled
+ * transfer curves of the destination profile. If both color spaces share
+ * the profile, only the channel depth is converted.
+ *
+ * Returns null if the conversion cannot be expressed this way (LUT-based
+ * profiles, absolute colorimetric intent, gamut check, non-linear floating
+ * point color spaces in different profiles, etc.). The caller should fall
+ * back to a generic LCMS transformation in this case.
+ */
+KoColorConversionTransformation *tryCreateTransformation(const KoColorSpace *srcCs,
+                                                         LcmsColorProfileContainer *srcProfile,
+                                                         const KoColorSpace *dstCs,
+                                                         LcmsColorProfileContainer *dstProfile,
+                                                         KoColorConversionTransformation::Intent renderingIntent,
+                                                         KoColorConversionTransformation::ConversionFlags conversionFlags);
+
+}
+
+#endif // LCMSMATRIXSHAPERTRANSFORMATION_H
@@ -0,0 +1,229 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestLcmsMatrixShaperTransformation.h"
+
+#include <QTest>
+#include <QScopedPointer>
+#include "sdk/tests/kistest.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceMaths.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorProfile.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorConversionTransformation.h>
+
+#include <typeinfo>
+#include <lcms2.h>
+
+namespace {
+
+const int numTestPixels = 4096;
+
+template <typename T>
+void fillRandom(QVector<T> &pixels, int numPixels, T unitValue)
+{
+    pixels.resize(numPixels * 4);
+
+    qsrand(10);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = T(qreal(qrand()) / RAND_MAX * unitValue);
+    }
+}
+
+/**
+ * The matrix-shaper transformation lives inside the engine plugin,
+ * which the test doesn't link to, so its class can only be recognized
+ * by the type name. If the engine falls back to a generic LCMS
+ * transformation, the conversion results would still match, so the
+ * tests check the selected class explicitly.
+ */
+bool usesMatrixShaperTransformation(const KoColorSpace *srcCs, const KoColorSpace *dstCs,
+                                    KoColorConversionTransformation::Intent renderingIntent,
+                                    KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    QScopedPointer<KoColorConversionTransformation> transformation(
+        srcCs->createColorConverter(dstCs, renderingIntent, conversionFlags));
+
+    return transformation &&
+        QByteArray(typeid(*transformation).name()).contains("KoLcmsMatrixShaperTransformation");
+}
+
+/**
+ * Converts \p src with Krita's own machinery and with a plain
+ * unoptimized LCMS transform, and checks that the color channels
+ * differ by no more than \p tolerance
+ */
+template <typename SrcChannel, typename DstChannel>
+void checkConversion(const KoColorSpace *srcCs, cmsUInt32Number srcType,
+                     const KoColorSpace *dstCs, cmsUInt32Number dstType,
+                     SrcChannel srcUnit, qreal tolerance)
+{
+    QVERIFY(srcCs);
+    QVERIFY(dstCs);
+
+    QVERIFY(usesMatrixShaperTransformation(srcCs, dstCs,
+                                           KoColorConversionTransformation::IntentRelativeColorimetric,
+                                           KoColorConversionTransformation::BlackpointCompensation));
+
+    QVector<SrcChannel> src;
+    fillRandom(src, numTestPixels, srcUnit);
+
+    QVector<DstChannel> dst(numTestPixels * 4);
+    QVector<DstChannel> ref(numTestPixels * 4);
+
+    srcCs->convertPixelsTo(reinterpret_cast<const quint8*>(src.constData()),
+                           reinterpret_cast<quint8*>(dst.data()),
+                           dstCs, numTestPixels,
+                           KoColorConversionTransformation::IntentRelativeColorimetric,
+                           KoColorConversionTransformation::BlackpointCompensation);
+
+    const QByteArray srcRawData = srcCs->profile()->rawData();
+    const QByteArray dstRawData = dstCs->profile()->rawData();
+
+    cmsHPROFILE srcProfile = cmsOpenProfileFromMem(srcRawData.constData(), srcRawData.size());
+    cmsHPROFILE dstProfile = cmsOpenProfileFromMem(dstRawData.constData(), dstRawData.size());
+    QVERIFY(srcProfile);
+    QVERIFY(dstProfile);
+
+    cmsHTRANSFORM tf = cmsCreateTransform(srcProfile, srcType,
+                                          dstProfile, dstType,
+                                          INTENT_RELATIVE_COLORIMETRIC,
+                                          cmsFLAGS_NOOPTIMIZE | cmsFLAGS_BLACKPOINTCOMPENSATION);
+    QVERIFY(tf);
+
+    cmsDoTransform(tf, src.constData(), ref.data(), numTestPixels);
+
+    cmsDeleteTransform(tf);
+    cmsCloseProfile(srcProfile);
+    cmsCloseProfile(dstProfile);
+
+    for (int i = 0; i < numTestPixels; i++) {
+        for (int ch = 0; ch < 3; ch++) {
+            const int idx = i * 4 + ch;
+            if (qAbs(qreal(dst[idx]) - qreal(ref[idx])) > tolerance) {
+                QFAIL(QString("Pixel %1, channel %2: got %3, LCMS gives %4")
+                      .arg(i).arg(ch)
+                      .arg(qreal(dst[idx])).arg(qreal(ref[idx]))
+                      .toLatin1());
+            }
+        }
+
+        // alpha is never touched by the color transform
+        const qreal srcAlpha = qreal(src[i * 4 + 3]) / qreal(srcUnit);
+        const qreal dstAlpha = qreal(dst[i * 4 + 3]) / qreal(KoColorSpaceMathsTraits<DstChannel>::unitValue);
+        QVERIFY(qAbs(srcAlpha - dstAlpha) < 1.0 / 255);
+    }
+}
+
+}
+
+void TestLcmsMatrixShaperTransformation::testU8ToU16()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    checkConversion<quint8, quint16>(registry->rgb8(), TYPE_BGRA_8,
+                                     registry->rgb16(registry->p709G10Profile()), TYPE_BGRA_16,
+                                     255, 3.0);
+}
+
+void TestLcmsMatrixShaperTransformation::testU16ToU8()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    checkConversion<quint16, quint8>(registry->rgb16(registry->p709G10Profile()), TYPE_BGRA_16,
+                                     registry->rgb8(), TYPE_BGRA_8,
+                                     65535, 1.0);
+}
+
+void TestLcmsMatrixShaperTransformation::testU8ToF32()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *dstCs =
+        registry->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(),
+                             registry->p2020G10Profile());
+
+    checkConversion<quint8, float>(registry->rgb8(), TYPE_BGRA_8,
+                                   dstCs, TYPE_RGBA_FLT,
+                                   255, 1e-4);
+}
+
+void TestLcmsMatrixShaperTransformation::testF32ToF32()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCs =
+        registry->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(),
+                             registry->p2020G10Profile());
+
+    const KoColorSpace *dstCs =
+        registry->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(),
+                             registry->p709G10Profile());
+
+    checkConversion<float, float>(srcCs, TYPE_RGBA_FLT,
+                                  dstCs, TYPE_RGBA_FLT,
+                                  1.0f, 1e-5);
+}
+
+void TestLcmsMatrixShaperTransformation::testSameProfile()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCs = registry->rgb8();
+    const KoColorSpace *dstCs = registry->rgb16(srcCs->profile());
+
+    QVERIFY(usesMatrixShaperTransformation(srcCs, dstCs,
+                                           KoColorConversionTransformation::IntentPerceptual,
+                                           KoColorConversionTransformation::Empty));
+
+    QVector<quint8> src;
+    fillRandom(src, numTestPixels, quint8(255));
+
+    QVector<quint16> dst(numTestPixels * 4);
+    srcCs->convertPixelsTo(src.constData(), reinterpret_cast<quint8*>(dst.data()),
+                           dstCs, numTestPixels,
+                           KoColorConversionTransformation::IntentPerceptual,
+                           KoColorConversionTransformation::Empty);
+
+    // a pure depth conversion must be exact
+    for (int i = 0; i < src.size(); i++) {
+        QCOMPARE(dst[i], quint16(src[i] * 257));
+    }
+}
+
+void TestLcmsMatrixShaperTransformation::testGenericFallback()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *srcCs = registry->rgb8();
+    const KoColorSpace *dstCs = registry->rgb16(registry->p709G10Profile());
+
+    // the same pair of color spaces must go through LCMS when the
+    // fast path is explicitly disabled or cannot represent the intent
+    QVERIFY(!usesMatrixShaperTransformation(srcCs, dstCs,
+                                            KoColorConversionTransformation::IntentRelativeColorimetric,
+                                            KoColorConversionTransformation::NoOptimization));
+
+    QVERIFY(!usesMatrixShaperTransformation(srcCs, dstCs,
+                                            KoColorConversionTransformation::IntentAbsoluteColorimetric,
+                                            KoColorConversionTransformation::Empty));
+}
+
+KISTEST_MAIN(TestLcmsMatrixShaperTransformation)
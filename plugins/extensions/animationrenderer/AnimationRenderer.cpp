@@ -130,6 +130,33 @@ void AnimaterionRenderer::renderAnimationImpl(KisDocument *doc, KisAnimationRend
     }
 
     const bool batchMode = false; // TODO: fetch correctly!
+
+    if (VideoSaver::canEncodeStreamed(encoderOptions)) {
+        // the frames would be deleted right after encoding, so
+        // they are piped into ffmpeg instead of being saved
+        const QString resultFile = encoderOptions.resolveAbsoluteVideoFilePath();
+        KIS_SAFE_ASSERT_RECOVER_NOOP(QFileInfo(resultFile).isAbsolute());
+
+        {
+            const QFileInfo info(resultFile);
+            QDir dir(info.absolutePath());
+
+            if (!dir.exists()) {
+                dir.mkpath(info.absolutePath());
+            }
+            KIS_SAFE_ASSERT_RECOVER_NOOP(dir.exists());
+        }
+
+        QScopedPointer<VideoSaver> encoder(new VideoSaver(doc, batchMode));
+        KisImportExportErrorCode res = encoder->encodeStreamed(encoderOptions, viewManager()->mainWindow()->viewManager());
+
+        if (!res.isOk() && !res.isCancelled()) {
+            QMessageBox::critical(0, i18nc("@title:window", "Krita"), i18n("Could not render animation:\n%1", res.errorMessage()));
+        }
+
+        return;
+    }
+
     KisAsyncAnimationFramesSaveDialog exporter(doc->image(),
                                                KisTimeRange::fromTime(encoderOptions.firstFrame,
                                                                       encoderOptions.lastFrame),
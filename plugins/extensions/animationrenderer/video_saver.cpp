@@ -46,6 +46,7 @@
 #include <QTime>
 
 #include "KisPart.h"
+#include <dialogs/KisAsyncAnimationFramesPipeDialog.h>
 
 class KisFFMpegProgressWatcher : public QObject {
     Q_OBJECT
@@ -108,27 +109,46 @@ public:
                                      const QString &logPath,
                                      int totalFrames)
     {
-        dbgFile << "runFFMpeg: specialArgs" << specialArgs
-                << "actionName" << actionName
+        startFFMpeg(specialArgs, logPath, false);
+        return waitForFFMpegProcess(actionName, totalFrames);
+    }
+
+    /**
+     * Starts ffmpeg without waiting for it to finish. If \p readsStdin
+     * is true, the caller is expected to write the input into process()
+     * and close its write channel.
+     */
+    void startFFMpeg(const QStringList &specialArgs,
+                     const QString &logPath,
+                     bool readsStdin)
+    {
+        dbgFile << "startFFMpeg: specialArgs" << specialArgs
                 << "logPath" << logPath
-                << "totalFrames" << totalFrames;
+                << "readsStdin" << readsStdin;
 
-        QTemporaryFile progressFile(QDir::tempPath() + '/' + "KritaFFmpegProgress.XXXXXX");
-        progressFile.open();
+        m_progressFile.reset(new QTemporaryFile(QDir::tempPath() + '/' + "KritaFFmpegProgress.XXXXXX"));
+        m_progressFile->open();
 
         m_process.setStandardOutputFile(logPath);
         m_process.setProcessChannelMode(QProcess::MergedChannels);
         QStringList args;
-        args << "-v" << "debug"
-             << "-nostdin"
-             << "-progress" << progressFile.fileName()
+        args << "-v" << "debug";
+
+        if (!readsStdin) {
+            args << "-nostdin";
+        }
+
+        args << "-progress" << m_progressFile->fileName()
              << specialArgs;
 
         qDebug() << "\t" << m_ffmpegPath << args.join(" ");
 
         m_cancelled = false;
         m_process.start(m_ffmpegPath, args);
-        return waitForFFMpegProcess(actionName, progressFile, m_process, totalFrames);
+    }
+
+    QProcess* process() {
+        return &m_process;
     }
 
     void cancel() {
@@ -136,14 +156,12 @@ public:
         m_process.kill();
     }
 
-private:
     KisImportExportErrorCode waitForFFMpegProcess(const QString &message,
-                                                QFile &progressFile,
-                                                QProcess &ffmpegProcess,
                                                 int totalFrames)
     {
+        QProcess &ffmpegProcess = m_process;
 
-        KisFFMpegProgressWatcher watcher(progressFile, totalFrames);
+        KisFFMpegProgressWatcher watcher(*m_progressFile, totalFrames);
 
         QProgressDialog progress(message, "", 0, 0, KisPart::instance()->currentMainwindow());
         progress.setWindowModality(Qt::ApplicationModal);
@@ -182,10 +200,24 @@ private:
 
 private:
     QProcess m_process;
+    QScopedPointer<QTemporaryFile> m_progressFile;
     bool m_cancelled;
     QString m_ffmpegPath;
 };
 
+namespace {
+
+QString scaleFilter(const KisAnimationRenderingOptions &options)
+{
+    // export dimensions could be off a little bit, so the last force option tweaks the pixels for the export to work
+    return QString("scale=w=")
+            .append(QString::number(options.width))
+            .append(":h=")
+            .append(QString::number(options.height));
+            //.append(":force_original_aspect_ratio=decrease"); HOTFIX for even:odd dimension images.
+}
+
+}
 
 VideoSaver::VideoSaver(KisDocument *doc, bool batchMode)
     : m_image(doc->image())
@@ -212,19 +244,11 @@ KisImportExportErrorCode VideoSaver::encode(const QString &savedFilesMask, const
 
     KisImportExportErrorCode resultOuter = ImportExportCodes::OK;
 
-    KisImageAnimationInterface *animation = m_image->animationInterface();
-
     const int sequenceNumberingOffset = options.sequenceStart;
     const KisTimeRange clipRange(sequenceNumberingOffset + options.firstFrame,
                                  sequenceNumberingOffset + options.lastFrame);
 
-     // export dimensions could be off a little bit, so the last force option tweaks the pixels for the export to work
-    const QString exportDimensions =
-        QString("scale=w=")
-            .append(QString::number(options.width))
-            .append(":h=")
-            .append(QString::number(options.height));
-            //.append(":force_original_aspect_ratio=decrease"); HOTFIX for even:odd dimension images.
+    const QString exportDimensions = scaleFilter(options);
 
     const QString resultFile = options.resolveAbsoluteVideoFilePath();
     const QDir videoDir(QFileInfo(resultFile).absolutePath());
@@ -232,7 +256,6 @@ KisImportExportErrorCode VideoSaver::encode(const QString &savedFilesMask, const
     const QFileInfo info(resultFile);
     const QString suffix = info.suffix().toLower();
     const QString palettePath = videoDir.filePath("palette.png");
-    const QStringList additionalOptionsList = options.customFFMpegOptions.split(' ', QString::SkipEmptyParts);
     QScopedPointer<KisFFMpegRunner> runner(new KisFFMpegRunner(options.ffmpegPath));
 
     if (suffix == "gif") {
@@ -288,39 +311,134 @@ KisImportExportErrorCode VideoSaver::encode(const QString &savedFilesMask, const
         QStringList args;
         args << "-r" << QString::number(options.frameRate)
              << "-start_number" << QString::number(clipRange.start())
-             << "-i" << savedFilesMask;
+             << "-i" << savedFilesMask
+             << videoEncodingArgs(options, clipRange);
 
-        QFileInfo audioFileInfo = animation->audioChannelFileName();
-        if (options.includeAudio && audioFileInfo.exists()) {
-            const int msecStart = clipRange.start() * 1000 / animation->framerate();
-            const int msecDuration = clipRange.duration() * 1000 / animation->framerate();
+        resultOuter = runner->runFFMpeg(args, i18n("Encoding frames..."),
+                                     videoDir.filePath("log_encode.log"),
+                                     clipRange.duration());
+    }
 
-            const QTime startTime = QTime::fromMSecsSinceStartOfDay(msecStart);
-            const QTime durationTime = QTime::fromMSecsSinceStartOfDay(msecDuration);
-            const QString ffmpegTimeFormat("H:m:s.zzz");
+    return resultOuter;
+}
 
-            args << "-ss" << startTime.toString(ffmpegTimeFormat);
-            args << "-t" << durationTime.toString(ffmpegTimeFormat);
+QStringList VideoSaver::videoEncodingArgs(const KisAnimationRenderingOptions &options, const KisTimeRange &clipRange)
+{
+    KisImageAnimationInterface *animation = m_image->animationInterface();
 
-            args << "-i" << audioFileInfo.absoluteFilePath();
-        }
+    QStringList args;
 
-        // if we are exporting out at a different image size, we apply scaling filter
-        // export options HAVE to go after input options, so make sure this is after the audio import
-        if (m_image->width() != options.width || m_image->height() != options.height) {
-            args << "-vf" << exportDimensions;
-        }
+    QFileInfo audioFileInfo = animation->audioChannelFileName();
+    if (options.includeAudio && audioFileInfo.exists()) {
+        const int msecStart = clipRange.start() * 1000 / animation->framerate();
+        const int msecDuration = clipRange.duration() * 1000 / animation->framerate();
 
-        args << additionalOptionsList
-             << "-y" << resultFile;
+        const QTime startTime = QTime::fromMSecsSinceStartOfDay(msecStart);
+        const QTime durationTime = QTime::fromMSecsSinceStartOfDay(msecDuration);
+        const QString ffmpegTimeFormat("H:m:s.zzz");
 
+        args << "-ss" << startTime.toString(ffmpegTimeFormat);
+        args << "-t" << durationTime.toString(ffmpegTimeFormat);
 
-        resultOuter = runner->runFFMpeg(args, i18n("Encoding frames..."),
-                                     videoDir.filePath("log_encode.log"),
-                                     clipRange.duration());
+        args << "-i" << audioFileInfo.absoluteFilePath();
     }
 
-    return resultOuter;
+    // if we are exporting out at a different image size, we apply scaling filter
+    // export options HAVE to go after input options, so make sure this is after the audio import
+    if (m_image->width() != options.width || m_image->height() != options.height) {
+        args << "-vf" << scaleFilter(options);
+    }
+
+    args << options.customFFMpegOptions.split(' ', QString::SkipEmptyParts)
+         << "-y" << options.resolveAbsoluteVideoFilePath();
+
+    return args;
+}
+
+bool VideoSaver::canEncodeStreamed(const KisAnimationRenderingOptions &options)
+{
+    const QString suffix = QFileInfo(options.resolveAbsoluteVideoFilePath()).suffix().toLower();
+    const bool saveAsHDR = options.frameExportConfig && options.frameExportConfig->getPropertyLazy("saveAsHDR", false);
+
+    // gif needs a separate pass over the frames to generate the palette,
+    // HDR frames need the color space of the frames exporter, and the
+    // streamed frames reproduce the pixels of the PNG frames only
+    return options.renderMode() == KisAnimationRenderingOptions::RENDER_VIDEO_ONLY &&
+        options.frameMimeType == "image/png" &&
+        suffix != "gif" && !saveAsHDR;
+}
+
+KisImportExportErrorCode VideoSaver::encodeStreamed(const KisAnimationRenderingOptions &options, KisViewManager *viewManager)
+{
+    if (!QFileInfo(options.ffmpegPath).exists()) {
+        m_doc->setErrorMessage(i18n("ffmpeg could not be found at %1", options.ffmpegPath));
+        return ImportExportCodes::Failure;
+    }
+
+    const KisTimeRange range = KisTimeRange::fromTime(options.firstFrame, options.lastFrame);
+    const KisTimeRange clipRange(options.sequenceStart + options.firstFrame,
+                                 options.sequenceStart + options.lastFrame);
+
+    const QDir videoDir(QFileInfo(options.resolveAbsoluteVideoFilePath()).absolutePath());
+
+    /**
+     * The frames are passed to ffmpeg with the same pixels the PNG frames
+     * would have. Like KisPNGConverter, keep the profile of RGB and
+     * grayscale images (ffmpeg doesn't use it anyway), convert the other
+     * color models to sRGB, or all of them, if "Force sRGB" is set. Float
+     * images are converted to 16-bit integers.
+     */
+    const KoColorSpace *srcColorSpace = m_image->colorSpace();
+    const bool forceSRGB = options.frameExportConfig && options.frameExportConfig->getPropertyLazy("forceSRGB", false);
+    const bool is8Bit = srcColorSpace->colorDepthId() == Integer8BitsColorDepthID;
+    const QString dstDepth = is8Bit ? Integer8BitsColorDepthID.id() : Integer16BitsColorDepthID.id();
+
+    const KoColorSpace *dstColorSpace = 0;
+    QString pixelFormat;
+
+    if (!forceSRGB && srcColorSpace->colorModelId() == GrayAColorModelID) {
+        dstColorSpace = KoColorSpaceRegistry::instance()->colorSpace(GrayAColorModelID.id(), dstDepth, srcColorSpace->profile());
+        pixelFormat = is8Bit ? "ya8" : "ya16le";
+    } else if (!forceSRGB && srcColorSpace->colorModelId() == RGBAColorModelID) {
+        dstColorSpace = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), dstDepth, srcColorSpace->profile());
+        pixelFormat = is8Bit ? "bgra" : "bgra64le";
+    } else {
+        dstColorSpace = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), dstDepth, "sRGB built-in - (lcms internal)");
+        pixelFormat = is8Bit ? "bgra" : "bgra64le";
+    }
+
+    QStringList args;
+    args << "-f" << "rawvideo"
+         << "-pix_fmt" << pixelFormat
+         << "-s" << QString("%1x%2").arg(m_image->width()).arg(m_image->height())
+         << "-r" << QString::number(options.frameRate)
+         << "-i" << "pipe:0"
+         << videoEncodingArgs(options, clipRange);
+
+    QScopedPointer<KisFFMpegRunner> runner(new KisFFMpegRunner(options.ffmpegPath));
+    runner->startFFMpeg(args, videoDir.filePath("log_encode.log"), true);
+
+    if (!runner->process()->waitForStarted()) {
+        m_doc->setErrorMessage(i18n("Failed to start ffmpeg: %1", runner->process()->errorString()));
+        return ImportExportCodes::Failure;
+    }
+
+    KisAsyncAnimationFramesPipeDialog exporter(m_image, range, runner->process(), dstColorSpace);
+    exporter.setBatchMode(m_batchMode);
+
+    const KisAsyncAnimationRenderDialogBase::Result result = exporter.regenerateRange(viewManager);
+
+    if (result != KisAsyncAnimationRenderDialogBase::RenderComplete) {
+        runner->cancel();
+        runner->waitForFFMpegProcess(i18n("Encoding frames..."), range.duration());
+
+        return result == KisAsyncAnimationRenderDialogBase::RenderCancelled ?
+            ImportExportCodes::Cancelled : ImportExportCodes::Failure;
+    }
+
+    runner->process()->closeWriteChannel();
+
+    return runner->waitForFFMpegProcess(i18n("Encoding frames..."), range.duration());
 }
 
 KisImportExportErrorCode VideoSaver::convert(KisDocument *document, const QString &savedFilesMask, const KisAnimationRenderingOptions &options, bool batchMode)
@@ -21,6 +21,7 @@
 #define VIDEO_SAVER_H_
 
 #include <QObject>
+#include <QStringList>
 
 #include "kis_types.h"
 
@@ -29,6 +30,8 @@
 class KisFFMpegRunner;
 
 class KisDocument;
+class KisViewManager;
+class KisTimeRange;
 class KisAnimationRenderingOptions;
 
 class VideoSaver : public QObject {
@@ -61,6 +64,25 @@ public:
 
     static KisImportExportErrorCode convert(KisDocument *document, const QString &savedFilesMask, const KisAnimationRenderingOptions &options, bool batchMode);
 
+    /**
+     * @brief encodeStreamed renders the frames and writes them into ffmpeg's
+     * stdin as a raw video stream, without saving them into image files.
+     * The frames rendered by several image clones are written in order.
+     * @param options the configuration
+     * @param viewManager the view manager used to lock the image while rendering, may be null
+     * @return whether it is successful or had another failure.
+     */
+    KisImportExportErrorCode encodeStreamed(const KisAnimationRenderingOptions &options, KisViewManager *viewManager);
+
+    /**
+     * @return true if the video can be encoded with encodeStreamed(), i.e. the
+     * image sequence is not requested and the format needs a single pass
+     */
+    static bool canEncodeStreamed(const KisAnimationRenderingOptions &options);
+
+private:
+    QStringList videoEncodingArgs(const KisAnimationRenderingOptions &options, const KisTimeRange &clipRange);
+
 private:
     KisImageSP m_image;
     KisDocument* m_doc;
@@ -28,6 +28,8 @@
 #include <QBuffer>
 #include <QByteArray>
 #include <QMessageBox>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <KoMD5Generator.h>
 #include <KoColorSpaceRegistry.h>
@@ -69,6 +71,7 @@
 #include "kis_paint_device_frames_interface.h"
 #include "kis_filter_registry.h"
 #include "kis_generator_registry.h"
+#include "kis_config.h"
 
 
 using namespace KRA;
@@ -110,6 +113,8 @@ KisKraLoadVisitor::KisKraLoadVisitor(KisImageSP image,
     , m_keyframeFilenames(keyframeFilenames)
     , m_name(name)
     , m_shapeController(shapeController)
+    , m_lazyDecoding(KisConfig(true).lazyLoadKra())
+    , m_maxPendingDeviceData(qMax(2, QThread::idealThreadCount()))
 {
     m_store->pushDirectory();
 
@@ -131,6 +136,15 @@ KisKraLoadVisitor::KisKraLoadVisitor(KisImageSP image,
     m_syntaxVersion = syntaxVersion;
 }
 
+KisKraLoadVisitor::~KisKraLoadVisitor()
+{
+    // the devices are still referenced by the decoding jobs
+    Q_FOREACH (const PendingDeviceData &pending, m_pendingDeviceData) {
+        QFuture<bool> future = pending.result;
+        future.waitForFinished();
+    }
+}
+
 void KisKraLoadVisitor::setExternalUri(const QString &uri)
 {
     m_external = true;
@@ -195,10 +209,15 @@ bool KisKraLoadVisitor::visit(KisPaintLayer *layer)
 {
     loadNodeKeyframes(layer);
 
-    if (!loadPaintDevice(layer->paintDevice(), getLocation(layer))) {
+    /**
+     * The profile is assigned before the pixel data is queued for
+     * decoding, because the device cannot be touched while the
+     * decoding job is writing into it.
+     */
+    if (!loadProfile(layer->paintDevice(), getLocation(layer, DOT_ICC))) {
         return false;
     }
-    if (!loadProfile(layer->paintDevice(), getLocation(layer, DOT_ICC))) {
+    if (!loadPaintDevice(layer->paintDevice(), getLocation(layer))) {
         return false;
     }
     if (!loadMetaData(layer)) {
@@ -254,6 +273,9 @@ bool KisKraLoadVisitor::visit(KisAdjustmentLayer* layer)
         KisSelectionSP selection = new KisSelection();
         KisPixelSelectionSP pixelSelection = selection->pixelSelection();
         result = loadPaintDevice(pixelSelection, getLocation(layer, ".selection"));
+
+        // the layer copies the selection, so it should be decoded first
+        waitForPendingDeviceData(pixelSelection);
         layer->setInternalSelection(selection);
     } else if (m_syntaxVersion == 2) {
         result = loadSelection(getLocation(layer), layer->internalSelection());
@@ -457,9 +479,11 @@ bool KisKraLoadVisitor::visit(KisColorizeMask *mask)
         loadPaintDevice(stroke.dev, fileName);
     }
 
+    waitForPendingDeviceData();
     mask->setKeyStrokesDirect(QList<KisLazyFillTools::KeyStroke>::fromVector(strokes));
 
     loadPaintDevice(mask->coloringProjection(), COLORIZE_COLORING_DEVICE);
+    waitForPendingDeviceData();
     mask->resetCache();
 
     m_store->popDirectory();
@@ -476,10 +500,38 @@ QStringList KisKraLoadVisitor::warningMessages() const
     return m_warningMessages;
 }
 
+void KisKraLoadVisitor::waitForPendingDeviceData()
+{
+    while (!m_pendingDeviceData.isEmpty()) {
+        finishPendingDeviceData();
+    }
+}
+
+void KisKraLoadVisitor::waitForPendingDeviceData(KisPaintDeviceSP device)
+{
+    for (int i = 0; i < m_pendingDeviceData.size();) {
+        if (m_pendingDeviceData[i].device == device) {
+            finishPendingDeviceData(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void KisKraLoadVisitor::finishPendingDeviceData(int index)
+{
+    PendingDeviceData pending = m_pendingDeviceData.takeAt(index);
+
+    if (!pending.result.result()) {
+        m_warningMessages << i18n("Could not read pixel data: %1.", pending.location);
+        pending.device->disconnect();
+    }
+}
+
 struct SimpleDevicePolicy
 {
-    bool read(KisPaintDeviceSP dev, QIODevice *stream) {
-        return dev->read(stream);
+    bool read(KisPaintDeviceSP dev, QIODevice *stream, bool lazyDecoding) {
+        return dev->read(stream, lazyDecoding);
     }
 
     void setDefaultPixel(KisPaintDeviceSP dev, const KoColor &defaultPixel) const {
@@ -492,8 +544,8 @@ struct FramedDevicePolicy
     FramedDevicePolicy(int frameId)
         :  m_frameId(frameId) {}
 
-    bool read(KisPaintDeviceSP dev, QIODevice *stream) {
-        return dev->framesInterface()->readFrame(stream, m_frameId);
+    bool read(KisPaintDeviceSP dev, QIODevice *stream, bool lazyDecoding) {
+        return dev->framesInterface()->readFrame(stream, m_frameId, lazyDecoding);
     }
 
     void setDefaultPixel(KisPaintDeviceSP dev, const KoColor &defaultPixel) const {
@@ -557,13 +609,34 @@ bool KisKraLoadVisitor::loadPaintDeviceFrame(KisPaintDeviceSP device, const QStr
     }
 
     if (m_store->open(location)) {
-        if (!policy.read(device, m_store->device())) {
-            m_warningMessages << i18n("Could not read pixel data: %1.", location);
-            device->disconnect();
-            m_store->close();
-            return true;
-        }
+        /**
+         * The store can be read sequentially only, so the data is
+         * fetched in the visitor's thread, but the tiles are decoded
+         * in the background. The data managers of different devices
+         * (and frames) are independent, so they may be decoded at once.
+         */
+        const QByteArray data = m_store->read(m_store->size());
         m_store->close();
+
+        const bool lazyDecoding = m_lazyDecoding;
+
+        PendingDeviceData pending;
+        pending.device = device;
+        pending.location = location;
+        pending.result = QtConcurrent::run(
+            [device, policy, data, lazyDecoding] () mutable {
+                QBuffer buffer;
+                buffer.setData(data);
+                buffer.open(QIODevice::ReadOnly);
+                return policy.read(device, &buffer, lazyDecoding);
+            });
+
+        m_pendingDeviceData.append(pending);
+
+        // limit the amount of memory occupied by the undecoded data
+        while (m_pendingDeviceData.size() > m_maxPendingDeviceData) {
+            finishPendingDeviceData();
+        }
     } else {
         m_warningMessages << i18n("Could not load pixel data: %1.", location);
         return true;
@@ -686,11 +759,14 @@ bool KisKraLoadVisitor::loadSelection(const QString& location, KisSelectionSP ds
     QString pixelSelectionLocation = location + DOT_PIXEL_SELECTION;
     if (m_store->hasFile(pixelSelectionLocation)) {
         KisPixelSelectionSP pixelSelection = dstSelection->pixelSelection();
+
+        // the device cannot be touched after its decoding has been queued
+        pixelSelection->invalidateOutlineCache();
+
         result = loadPaintDevice(pixelSelection, pixelSelectionLocation);
         if (!result) {
             m_warningMessages << i18n("Could not load raster selection %1.", location);
         }
-        pixelSelection->invalidateOutlineCache();
     }
 
     // Shape selection
@@ -698,6 +774,9 @@ bool KisKraLoadVisitor::loadSelection(const QString& location, KisSelectionSP ds
     if (m_store->hasFile(shapeSelectionLocation + "/content.svg") ||
         m_store->hasFile(shapeSelectionLocation + "/content.xml")) {
 
+        // the shape selection renders itself into the pixel selection
+        waitForPendingDeviceData(dstSelection->pixelSelection());
+
         m_store->pushDirectory();
         m_store->enterDirectory(shapeSelectionLocation) ;
 
@@ -22,6 +22,7 @@
 
 #include <QRect>
 #include <QStringList>
+#include <QFuture>
 
 // kritaimage
 #include "kis_types.h"
@@ -48,6 +49,8 @@ public:
                       const QString & name,
                       int syntaxVersion);
 
+    ~KisKraLoadVisitor() override;
+
 public:
     void setExternalUri(const QString &uri);
 
@@ -69,6 +72,13 @@ public:
     QStringList errorMessages() const;
     QStringList warningMessages() const;
 
+    /**
+     * The pixel data of the paint devices is decoded in background
+     * threads. This function waits until all the devices are decoded.
+     * It should be called after the visitor has visited all the nodes.
+     */
+    void waitForPendingDeviceData();
+
 private:
 
     bool loadPaintDevice(KisPaintDeviceSP device, const QString& location);
@@ -94,7 +104,22 @@ private:
      */
     void loadDeprecatedFilter(KisFilterConfigurationSP cfg);
 
+    /**
+     * Waits until all the pending data of \p device is decoded. Should
+     * be called before the device is accessed in any way.
+     */
+    void waitForPendingDeviceData(KisPaintDeviceSP device);
+
+    void finishPendingDeviceData(int index = 0);
+
 private:
+
+    struct PendingDeviceData {
+        KisPaintDeviceSP device;
+        QString location;
+        QFuture<bool> result;
+    };
+
     KisImageSP m_image;
     KoStore *m_store;
     bool m_external;
@@ -107,6 +132,9 @@ private:
     QStringList m_warningMessages;
     KoShapeControllerBase *m_shapeController;
     QMap<QByteArray, const KoColorProfile *> m_profileCache;
+    bool m_lazyDecoding;
+    QList<PendingDeviceData> m_pendingDeviceData;
+    int m_maxPendingDeviceData;
 };
 
 #endif // KIS_KRA_LOAD_VISITOR_H_
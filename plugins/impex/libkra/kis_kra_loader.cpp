@@ -444,6 +444,8 @@ void KisKraLoader::loadBinaryData(KoStore * store, KisImageSP image, const QStri
     }
 
     image->rootLayer()->accept(visitor);
+    visitor.waitForPendingDeviceData();
+
     if (!visitor.errorMessages().isEmpty()) {
         m_d->errorMessages.append(visitor.errorMessages());
     }
@@ -23,6 +23,8 @@
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <KoColorProfile.h>
 #include <KoStore.h>
@@ -55,7 +57,7 @@
 #include <kis_meta_data_io_backend.h>
 
 #include "kis_config.h"
-#include "kis_store_paintdevice_writer.h"
+#include "kis_paint_device_writer.h"
 #include "flake/kis_shape_selection.h"
 
 #include "kis_raster_keyframe_channel.h"
@@ -75,13 +77,20 @@ KisKraSaveVisitor::KisKraSaveVisitor(KoStore *store, const QString & name, QMap<
     , m_external(false)
     , m_name(name)
     , m_nodeFileNames(nodeFileNames)
-    , m_writer(new KisStorePaintDeviceWriter(store))
+    , m_compressPaintDevices(KisConfig(true).compressKra())
+    , m_maxPendingDeviceData(qMax(2, QThread::idealThreadCount()))
 {
 }
 
 KisKraSaveVisitor::~KisKraSaveVisitor()
 {
-    delete m_writer;
+    // the devices are still referenced by the serialization jobs
+    Q_FOREACH (const PendingDeviceData &pending, m_pendingDeviceData) {
+        QFuture<QByteArray> future = pending.data;
+        future.waitForFinished();
+    }
+
+    qDeleteAll(m_sourceStores);
 }
 
 void KisKraSaveVisitor::setExternalUri(const QString &uri)
@@ -90,6 +99,11 @@ void KisKraSaveVisitor::setExternalUri(const QString &uri)
     m_uri = uri;
 }
 
+void KisKraSaveVisitor::setSavedPaintDevicesCache(KisSavedPaintDevicesCacheSP cache)
+{
+    m_savedDevicesCache = cache;
+}
+
 bool KisKraSaveVisitor::visit(KisExternalLayer * layer)
 {
     bool result = false;
@@ -315,6 +329,120 @@ QStringList KisKraSaveVisitor::errorMessages() const
     return m_errorMessages;
 }
 
+bool KisKraSaveVisitor::flushPendingDeviceData()
+{
+    bool result = true;
+
+    while (!m_pendingDeviceData.isEmpty()) {
+        result &= writePendingDeviceData();
+    }
+
+    return result;
+}
+
+bool KisKraSaveVisitor::writePendingDeviceData()
+{
+    PendingDeviceData pending = m_pendingDeviceData.takeFirst();
+    const QByteArray data = pending.data.result();
+
+    if (data.isNull()) {
+        pending.device->disconnect();
+        m_errorMessages << i18n("Failed to save the pixel data to %1.", pending.location);
+        return false;
+    }
+
+    // the location has been resolved when the device was scheduled
+    const QString storeLocation = "tar:/" + pending.location;
+
+    m_store->setCompressionEnabled(m_compressPaintDevices);
+
+    if (m_store->open(storeLocation)) {
+        m_store->write(data);
+        m_store->close();
+
+        if (m_savedDevicesCache && pending.dataManager) {
+            m_savedDevicesCache->addPendingEntry(pending.dataManager, pending.location);
+        }
+    }
+    if (m_store->open(storeLocation + ".defaultpixel")) {
+        m_store->write(pending.defaultPixel);
+        m_store->close();
+    }
+
+    m_store->setCompressionEnabled(true);
+
+    return true;
+}
+
+bool KisKraSaveVisitor::copyUnchangedDeviceData(KisDataManagerSP dataManager, const QString &location, const QByteArray &defaultPixel)
+{
+    QString filePath;
+    QString entryName;
+
+    if (!m_savedDevicesCache->findEntry(dataManager, &filePath, &entryName)) {
+        return false;
+    }
+
+    KoStore *source = sourceStore(filePath);
+    if (!source) return false;
+
+    const QString storeLocation = "tar:/" + location;
+
+    if (!m_store->copyFileFrom(source, "tar:/" + entryName, storeLocation)) {
+        return false;
+    }
+
+    m_savedDevicesCache->addPendingEntry(dataManager, location);
+
+    m_store->setCompressionEnabled(m_compressPaintDevices);
+
+    if (m_store->open(storeLocation + ".defaultpixel")) {
+        m_store->write(defaultPixel);
+        m_store->close();
+    }
+
+    m_store->setCompressionEnabled(true);
+
+    return true;
+}
+
+KoStore* KisKraSaveVisitor::sourceStore(const QString &filePath)
+{
+    auto it = m_sourceStores.find(filePath);
+
+    if (it == m_sourceStores.end()) {
+        KoStore *store = KoStore::createStore(filePath, KoStore::Read, "", KoStore::Zip);
+
+        if (store->bad()) {
+            delete store;
+            store = 0;
+        }
+
+        it = m_sourceStores.insert(filePath, store);
+    }
+
+    return it.value();
+}
+
+namespace {
+
+struct ByteArrayPaintDeviceWriter : public KisPaintDeviceWriter
+{
+    bool write(const QByteArray &data) override {
+        m_data.append(data);
+        return true;
+    }
+
+    bool write(const char* data, qint64 length) override {
+        m_data.append(data, length);
+        return true;
+    }
+
+    QByteArray m_data;
+};
+
+}
+
 struct SimpleDevicePolicy
 {
     bool write(KisPaintDeviceSP dev, KisPaintDeviceWriter &store) {
@@ -324,6 +452,10 @@ struct SimpleDevicePolicy
     KoColor defaultPixel(KisPaintDeviceSP dev) const {
         return dev->defaultPixel();
     }
+
+    KisDataManagerSP dataManager(KisPaintDeviceSP dev) const {
+        return dev->dataManager();
+    }
 };
 
 struct FramedDevicePolicy
@@ -339,16 +471,16 @@ struct FramedDevicePolicy
         return dev->framesInterface()->frameDefaultPixel(m_frameId);
     }
 
+    KisDataManagerSP dataManager(KisPaintDeviceSP dev) const {
+        return dev->framesInterface()->frameDataManager(m_frameId);
+    }
+
     int m_frameId;
 };
 
 bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
                                         QString location)
 {
-    // Layer data
-    KisConfig cfg(true);
-    m_store->setCompressionEnabled(cfg.compressKra());
-
     KisPaintDeviceFramesInterface *frameInterface = device->framesInterface();
     QList<int> frames;
 
@@ -373,7 +505,6 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
         }
     }
 
-    m_store->setCompressionEnabled(true);
     return true;
 }
 
@@ -381,18 +512,49 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
 template<class DevicePolicy>
 bool KisKraSaveVisitor::savePaintDeviceFrame(KisPaintDeviceSP device, QString location, DevicePolicy policy)
 {
-    if (m_store->open(location)) {
-        if (!policy.write(device, *m_writer)) {
-            device->disconnect();
-            m_store->close();
-            return false;
+    /**
+     * Serialization of the device is the most expensive part of
+     * saving, so it is done in a background thread. The data is
+     * written into the store later, in the same order, by
+     * writePendingDeviceData(). The store will compress it in
+     * parallel as well.
+     */
+    PendingDeviceData pending;
+    pending.device = device;
+
+    // the current directory of the store may change until the data is written
+    pending.location = location.startsWith("tar:/") ?
+        location.mid(5) : m_store->currentPath() + location;
+
+    pending.defaultPixel =
+        QByteArray((char*)policy.defaultPixel(device).data(), device->colorSpace()->pixelSize());
+
+    /**
+     * The devices that have not been changed since the previous save
+     * are copied from the previous file without serializing and
+     * compressing them again
+     */
+    if (m_savedDevicesCache) {
+        pending.dataManager = policy.dataManager(device);
+
+        if (copyUnchangedDeviceData(pending.dataManager, pending.location, pending.defaultPixel)) {
+            return true;
         }
-
-        m_store->close();
     }
-    if (m_store->open(location + ".defaultpixel")) {
-        m_store->write((char*)policy.defaultPixel(device).data(), device->colorSpace()->pixelSize());
-        m_store->close();
+
+    pending.data = QtConcurrent::run(
+        [device, policy] () mutable {
+            ByteArrayPaintDeviceWriter writer;
+            return policy.write(device, writer) ? writer.m_data : QByteArray();
+        });
+
+    m_pendingDeviceData.append(pending);
+
+    // limit the amount of memory occupied by the serialized data
+    while (m_pendingDeviceData.size() > m_maxPendingDeviceData) {
+        if (!writePendingDeviceData()) {
+            return false;
+        }
     }
 
     return true;
@@ -22,13 +22,15 @@
 
 #include <QRect>
 #include <QStringList>
+#include <QFuture>
+#include <QHash>
 
 #include "kis_types.h"
 #include "kis_node_visitor.h"
 #include "kis_image.h"
 #include "kritalibkra_export.h"
+#include "KisSavedPaintDevicesCache.h"
 
-class KisPaintDeviceWriter;
 class KoStore;
 
 class KRITALIBKRA_EXPORT KisKraSaveVisitor : public KisNodeVisitor
@@ -41,6 +43,13 @@ public:
 public:
     void setExternalUri(const QString &uri);
 
+    /**
+     * If the cache is set, the data of the devices that have not been
+     * changed since the previous save is copied from the previously
+     * saved file as it is
+     */
+    void setSavedPaintDevicesCache(KisSavedPaintDevicesCacheSP cache);
+
     bool visit(KisNode*) override {
         return true;
     }
@@ -70,6 +79,16 @@ public:
     /// @return a list with everything that went wrong while saving
     QStringList errorMessages() const;
 
+    /**
+     * The pixel data of the paint devices is serialized in background
+     * threads. This function waits until all the devices are serialized
+     * and writes them into the store. It should be called after the
+     * visitor has visited all the nodes.
+     *
+     * @return false if any of the devices failed to save
+     */
+    bool flushPendingDeviceData();
+
 private:
 
     bool savePaintDevice(KisPaintDeviceSP device, QString location);
@@ -84,15 +103,31 @@ private:
     QString getLocation(KisNode* node, const QString& suffix = QString());
     QString getLocation(const QString &filename, const QString &suffix = QString());
 
+    bool writePendingDeviceData();
+    bool copyUnchangedDeviceData(KisDataManagerSP dataManager, const QString &location, const QByteArray &defaultPixel);
+    KoStore* sourceStore(const QString &filePath);
+
 private:
 
+    struct PendingDeviceData {
+        KisPaintDeviceSP device;
+        QString location;
+        QFuture<QByteArray> data;
+        QByteArray defaultPixel;
+        KisDataManagerSP dataManager;
+    };
+
     KoStore *m_store;
     bool m_external;
     QString m_uri;
     QString m_name;
     QMap<const KisNode*, QString> m_nodeFileNames;
-    KisPaintDeviceWriter *m_writer;
     QStringList m_errorMessages;
+    bool m_compressPaintDevices;
+    QList<PendingDeviceData> m_pendingDeviceData;
+    int m_maxPendingDeviceData;
+    KisSavedPaintDevicesCacheSP m_savedDevicesCache;
+    QHash<QString, KoStore*> m_sourceStores;
 };
 
 #endif // KIS_KRA_SAVE_VISITOR_H_
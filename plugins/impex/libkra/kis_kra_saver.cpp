@@ -245,7 +245,12 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageSP image, const QString
     if (external)
         visitor.setExternalUri(uri);
 
+    if (m_d->doc) {
+        visitor.setSavedPaintDevicesCache(m_d->doc->savedPaintDevicesCache());
+    }
+
     image->rootLayer()->accept(visitor);
+    visitor.flushPendingDeviceData();
 
     m_d->errorMessages.append(visitor.errorMessages());
     if (!m_d->errorMessages.isEmpty()) {
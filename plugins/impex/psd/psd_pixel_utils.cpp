@@ -38,6 +38,9 @@
 #include "psd_layer_record.h"
 #include <asl/kis_offset_keeper.h>
 #include "kis_iterator_ng.h"
+#include "kis_algebra_2d.h"
+
+#include <QtConcurrent>
 
 #include "config_psd.h"
 #ifdef HAVE_ZLIB
@@ -391,42 +394,92 @@ psd_status psd_unzip_with_prediction(psd_uchar *src_buf, psd_int src_len,
 /* End of third party block                                           */
 /**********************************************************************/
 
-QMap<quint16, QByteArray> fetchChannelsBytes(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
-                                            int row, int width, int channelSize, bool processMasks)
+/**
+ * Compressed data of a single channel of a layer. The whole block is
+ * read from the device at once, the rows are decoded later in parallel.
+ */
+struct ChannelRows {
+    quint16 channelId;
+    Compression::CompressionType compressionType;
+    QByteArray data;
+    QVector<int> rowOffsets; // height + 1 elements
+};
+
+ChannelRows fetchChannelRows(QIODevice *io, ChannelInfo *channelInfo, int height, int uncompressedLength)
 {
-    const int uncompressedLength = width * channelSize;
-
-    QMap<quint16, QByteArray> channelBytes;
-
-    Q_FOREACH (ChannelInfo *channelInfo, channelInfoRecords) {
-        // user supplied masks are ignored here
-        if (!processMasks && channelInfo->channelId < -1) continue;
-
-        io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
-
-        if (channelInfo->compressionType == Compression::Uncompressed) {
-            channelBytes[channelInfo->channelId] = io->read(uncompressedLength);
-            channelInfo->channelOffset += uncompressedLength;
-        }
-        else if (channelInfo->compressionType == Compression::RLE) {
-            int rleLength = channelInfo->rleRowLengths[row];
-            QByteArray compressedBytes = io->read(rleLength);
-            QByteArray uncompressedBytes = Compression::uncompress(uncompressedLength, compressedBytes, channelInfo->compressionType);
-            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
-            channelInfo->channelOffset += rleLength;
+    ChannelRows channel;
+    channel.channelId = channelInfo->channelId;
+    channel.compressionType = Compression::CompressionType(channelInfo->compressionType);
+    channel.rowOffsets.reserve(height + 1);
+
+    int totalLength = 0;
+    channel.rowOffsets.append(totalLength);
+
+    if (channelInfo->compressionType == Compression::Uncompressed) {
+        for (int row = 0; row < height; row++) {
+            totalLength += uncompressedLength;
+            channel.rowOffsets.append(totalLength);
         }
-        else {
-            QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
-            dbgFile << "ERROR: fetchChannelsBytes:" << error;
+    }
+    else if (channelInfo->compressionType == Compression::RLE) {
+        if (channelInfo->rleRowLengths.size() < height) {
+            QString error = QString("Not enough RLE row lengths: channel id = %1, rows = %2, expected = %3")
+                .arg(channelInfo->channelId).arg(channelInfo->rleRowLengths.size()).arg(height);
+            dbgFile << "ERROR: fetchChannelRows:" << error;
             throw KisAslReaderUtils::ASLParseException(error);
         }
+
+        for (int row = 0; row < height; row++) {
+            totalLength += channelInfo->rleRowLengths[row];
+            channel.rowOffsets.append(totalLength);
+        }
+    }
+    else {
+        QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
+        dbgFile << "ERROR: fetchChannelRows:" << error;
+        throw KisAslReaderUtils::ASLParseException(error);
     }
 
-    return channelBytes;
+    io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+    channel.data = io->read(totalLength);
+    channelInfo->channelOffset += totalLength;
+
+    // a truncated file is decoded as far as possible
+    const int bytesRead = channel.data.size();
+    if (bytesRead < totalLength) {
+        dbgFile << "Truncated channel data: id" << channelInfo->channelId << "read" << bytesRead << "of" << totalLength;
+        channel.data.resize(totalLength);
+        memset(channel.data.data() + bytesRead, 0, totalLength - bytesRead);
+    }
+
+    return channel;
 }
 
 typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
 
+/**
+ * Split the layer into horizontal stripes that are decoded in parallel.
+ * The stripes are aligned to the height of the tiles, so that
+ * the threads don't write into the same tiles of the device.
+ */
+QVector<QRect> splitIntoStripes(KisPaintDeviceSP dev, const QRect &layerRect)
+{
+    const int stripeHeight = 64;
+
+    QVector<QRect> stripes;
+
+    int top = layerRect.top();
+    while (top <= layerRect.bottom()) {
+        const int alignedTop = dev->y() + KisAlgebra2D::divideFloor(top - dev->y(), stripeHeight) * stripeHeight;
+        const int bottom = qMin(alignedTop + stripeHeight - 1, layerRect.bottom());
+
+        stripes.append(QRect(layerRect.left(), top, layerRect.width(), bottom - top + 1));
+        top = bottom + 1;
+    }
+
+    return stripes;
+}
+
 void readCommon(KisPaintDeviceSP dev,
                 QIODevice *io,
                 const QRect &layerRect,
@@ -442,29 +495,56 @@ void readCommon(KisPaintDeviceSP dev,
         return;
     }
 
+    const QVector<QRect> stripes = splitIntoStripes(dev, layerRect);
+
     if (infoRecords.first()->compressionType == Compression::ZIP ||
         infoRecords.first()->compressionType == Compression::ZIPWithPrediction) {
 
         const int numPixels = channelSize * layerRect.width() * layerRect.height();
 
-        QMap<quint16, QByteArray> channelBytes;
+        struct ZipChannel {
+            ChannelInfo *info;
+            QByteArray compressedBytes;
+            QByteArray uncompressedBytes;
+            bool status;
+        };
+
+        QVector<ZipChannel> channels;
 
         Q_FOREACH (ChannelInfo *info, infoRecords) {
             io->seek(info->channelDataStart);
-            QByteArray compressedBytes = io->read(info->channelDataLength);
-            QByteArray uncompressedBytes(numPixels, 0);
 
-            bool status = false;
-            if (infoRecords.first()->compressionType == Compression::ZIP) {
-                status = psd_unzip_without_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                      (quint8*)uncompressedBytes.data(), uncompressedBytes.size());
-            } else {
-                status = psd_unzip_with_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                   (quint8*)uncompressedBytes.data(), uncompressedBytes.size(),
-                                                   layerRect.width(), channelSize * 8);
-            }
+            ZipChannel channel;
+            channel.info = info;
+            channel.compressedBytes = io->read(info->channelDataLength);
+            channel.status = false;
+            channels.append(channel);
+        }
+
+        const bool withPrediction = infoRecords.first()->compressionType == Compression::ZIPWithPrediction;
 
-            if (!status) {
+        QtConcurrent::blockingMap(channels,
+            [numPixels, withPrediction, layerRect, channelSize] (ZipChannel &channel) {
+                channel.uncompressedBytes = QByteArray(numPixels, 0);
+
+                if (!withPrediction) {
+                    channel.status = psd_unzip_without_prediction((quint8*)channel.compressedBytes.data(), channel.compressedBytes.size(),
+                                                                  (quint8*)channel.uncompressedBytes.data(), channel.uncompressedBytes.size());
+                } else {
+                    channel.status = psd_unzip_with_prediction((quint8*)channel.compressedBytes.data(), channel.compressedBytes.size(),
+                                                               (quint8*)channel.uncompressedBytes.data(), channel.uncompressedBytes.size(),
+                                                               layerRect.width(), channelSize * 8);
+                }
+
+                channel.compressedBytes = QByteArray();
+            });
+
+        QMap<quint16, QByteArray> channelBytes;
+
+        Q_FOREACH (const ZipChannel &channel, channels) {
+            ChannelInfo *info = channel.info;
+
+            if (!channel.status) {
                 QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
                 dbgFile << "ERROR:" << error;
                 dbgFile << "      " << ppVar(info->channelId);
@@ -474,31 +554,73 @@ void readCommon(KisPaintDeviceSP dev,
                 throw KisAslReaderUtils::ASLParseException(error);
             }
 
-            channelBytes.insert(info->channelId, uncompressedBytes);
+            channelBytes.insert(info->channelId, channel.uncompressedBytes);
         }
 
-        KisSequentialIterator it(dev, layerRect);
-        int col = 0;
-        while (it.nextPixel()) {
-            pixelFunc(channelSize, channelBytes, col, it.rawData());
-            col++;
-        }
+        channels.clear();
+
+        QtConcurrent::blockingMap(stripes,
+            [dev, layerRect, channelSize, pixelFunc, &channelBytes] (const QRect &stripe) {
+                KisHLineIteratorSP it = dev->createHLineIteratorNG(stripe.left(), stripe.top(), stripe.width());
+
+                int col = (stripe.top() - layerRect.top()) * layerRect.width();
+                for (int i = 0 ; i < stripe.height(); i++) {
+                    for (qint64 x = 0; x < stripe.width(); x++) {
+                        pixelFunc(channelSize, channelBytes, col, it->rawData());
+                        it->nextPixel();
+                        col++;
+                    }
+                    it->nextRow();
+                }
+            });
 
     } else {
-        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top(), layerRect.width());
-        for (int i = 0 ; i < layerRect.height(); i++) {
-            QMap<quint16, QByteArray> channelBytes;
+        const int uncompressedLength = layerRect.width() * channelSize;
 
-            channelBytes = fetchChannelsBytes(io, infoRecords,
-                                              i, layerRect.width(),
-                                              channelSize, processMasks);
+        QVector<ChannelRows> channels;
 
-            for (qint64 col = 0; col < layerRect.width(); col++){
-                pixelFunc(channelSize, channelBytes, col, it->rawData());
-                it->nextPixel();
-            }
-            it->nextRow();
+        Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+            // user supplied masks are ignored here
+            if (!processMasks && channelInfo->channelId < -1) continue;
+
+            channels.append(fetchChannelRows(io, channelInfo, layerRect.height(), uncompressedLength));
         }
+
+        QtConcurrent::blockingMap(stripes,
+            [dev, layerRect, channelSize, pixelFunc, uncompressedLength, &channels] (const QRect &stripe) {
+                // every row of a channel is decoded into the same buffer,
+                // the map only references them and stays the same for the
+                // whole stripe
+                QVector<QByteArray> rowBuffers;
+                QMap<quint16, QByteArray> channelBytes;
+
+                Q_FOREACH (const ChannelRows &channel, channels) {
+                    QByteArray buffer(uncompressedLength, Qt::Uninitialized);
+                    channelBytes.insert(channel.channelId, QByteArray::fromRawData(buffer.constData(), buffer.size()));
+                    rowBuffers.append(buffer);
+                }
+
+                KisHLineIteratorSP it = dev->createHLineIteratorNG(stripe.left(), stripe.top(), stripe.width());
+
+                const int firstRow = stripe.top() - layerRect.top();
+                for (int row = firstRow; row < firstRow + stripe.height(); row++) {
+                    for (int i = 0; i < channels.size(); i++) {
+                        const ChannelRows &channel = channels.at(i);
+                        const int offset = channel.rowOffsets[row];
+
+                        Compression::uncompress(channel.data.constData() + offset,
+                                                channel.rowOffsets[row + 1] - offset,
+                                                rowBuffers[i].data(), uncompressedLength,
+                                                channel.compressionType);
+                    }
+
+                    for (qint64 col = 0; col < stripe.width(); col++){
+                        pixelFunc(channelSize, channelBytes, col, it->rawData());
+                        it->nextPixel();
+                    }
+                    it->nextRow();
+                }
+            });
     }
 }
 
@@ -543,53 +665,6 @@ void readAlphaMaskChannels(QIODevice *io,
     readCommon(device, io, layerRect, infoRecords, channelSize, &readAlphaMaskPixelCommon, true);
 }
 
-void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
-{
-    typedef KisAslWriterUtils::OffsetStreamPusher<quint32> Pusher;
-    QScopedPointer<Pusher> channelBlockSizeExternalTag;
-    if (sizeFieldOffset >= 0) {
-        channelBlockSizeExternalTag.reset(new Pusher(io, 0, sizeFieldOffset));
-    }
-
-    if (writeCompressionType) {
-        SAFE_WRITE_EX(io, (quint16)Compression::RLE);
-    }
-
-    const bool externalRleBlock = rleBlockOffset >= 0;
-
-    // the start of RLE sizes block
-    const qint64 channelRLESizePos = externalRleBlock ? rleBlockOffset : io->pos();
-
-    {
-        QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
-
-        if (externalRleBlock) {
-            rleOffsetKeeper.reset(new KisOffsetKeeper(io));
-            io->seek(rleBlockOffset);
-        }
-
-        // write zero's for the channel lengths block
-        for(int i = 0; i < rc.height(); ++i) {
-            // XXX: choose size for PSB!
-            const quint16 fakeRLEBLockSize = 0;
-            SAFE_WRITE_EX(io, fakeRLEBLockSize);
-        }
-    }
-
-    quint32 stride = channelSize * rc.width();
-    for (qint32 row = 0; row < rc.height(); ++row) {
-
-        QByteArray uncompressed = QByteArray::fromRawData((const char*)plane + row * stride, stride);
-        QByteArray compressed = Compression::compress(uncompressed, Compression::RLE);
-
-        KisAslWriterUtils::OffsetStreamPusher<quint16> rleExternalTag(io, 0, channelRLESizePos + row * sizeof(quint16));
-
-        if (io->write(compressed) != compressed.size()) {
-            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
-        }
-    }
-}
-
 inline void preparePixelForWrite(quint8 *dataPlane,
                                  int numPixels,
                                  int channelSize,
@@ -633,6 +708,113 @@ inline void preparePixelForWrite(quint8 *dataPlane,
     }
 }
 
+/**
+ * A stripe of rows of a channel plane compressed by a separate thread.
+ * The compressed rows are stored one after another in a single buffer.
+ */
+struct CompressedStripe {
+    int channel;
+    int firstRow;
+    int numRows;
+    QByteArray data;
+    QVector<quint16> rowSizes;
+};
+
+void splitPlaneIntoStripes(int channel, const QRect &rc, QVector<CompressedStripe> &stripes)
+{
+    const int stripeHeight = 64;
+
+    for (int row = 0; row < rc.height(); row += stripeHeight) {
+        CompressedStripe stripe;
+        stripe.channel = channel;
+        stripe.firstRow = row;
+        stripe.numRows = qMin(stripeHeight, rc.height() - row);
+        stripes.append(stripe);
+    }
+}
+
+void compressStripe(CompressedStripe &stripe, const quint8 *plane, int stride)
+{
+    QByteArray compressed;
+
+    stripe.data.reserve(stripe.numRows * Compression::maxRLECompressedSize(stride));
+    stripe.rowSizes.reserve(stripe.numRows);
+
+    for (int row = stripe.firstRow; row < stripe.firstRow + stripe.numRows; ++row) {
+        Compression::compress((const char*)plane + row * stride, stride, compressed, Compression::RLE);
+        stripe.data.append(compressed);
+        stripe.rowSizes.append(compressed.size());
+    }
+}
+
+void writeCompressedChannel(QIODevice *io,
+                            QVector<CompressedStripe>::const_iterator begin,
+                            QVector<CompressedStripe>::const_iterator end,
+                            const QRect &rc,
+                            const qint64 sizeFieldOffset,
+                            const qint64 rleBlockOffset,
+                            const bool writeCompressionType)
+{
+    typedef KisAslWriterUtils::OffsetStreamPusher<quint32> Pusher;
+    QScopedPointer<Pusher> channelBlockSizeExternalTag;
+    if (sizeFieldOffset >= 0) {
+        channelBlockSizeExternalTag.reset(new Pusher(io, 0, sizeFieldOffset));
+    }
+
+    if (writeCompressionType) {
+        SAFE_WRITE_EX(io, (quint16)Compression::RLE);
+    }
+
+    // all the rows are already compressed, so the RLE sizes block
+    // is written at once instead of being patched after every row
+    QByteArray rleSizes;
+    rleSizes.reserve(rc.height() * sizeof(quint16));
+
+    for (auto it = begin; it != end; ++it) {
+        Q_FOREACH (quint16 size, it->rowSizes) {
+            // XXX: choose size for PSB!
+            const quint16 value = qToBigEndian(size);
+            rleSizes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+    }
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(rleSizes.size() == rc.height() * int(sizeof(quint16)));
+
+    {
+        QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
+
+        if (rleBlockOffset >= 0) {
+            rleOffsetKeeper.reset(new KisOffsetKeeper(io));
+            io->seek(rleBlockOffset);
+        }
+
+        if (io->write(rleSizes) != rleSizes.size()) {
+            throw KisAslWriterUtils::ASLWriteException("Failed to write RLE sizes block");
+        }
+    }
+
+    for (auto it = begin; it != end; ++it) {
+        if (io->write(it->data) != it->data.size()) {
+            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
+        }
+    }
+}
+
+void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
+{
+    const int stride = channelSize * rc.width();
+
+    QVector<CompressedStripe> stripes;
+    splitPlaneIntoStripes(0, rc, stripes);
+
+    QtConcurrent::blockingMap(stripes,
+        [plane, stride] (CompressedStripe &stripe) {
+            compressStripe(stripe, plane, stride);
+        });
+
+    writeCompressedChannel(io, stripes.constBegin(), stripes.constEnd(), rc, sizeFieldOffset, rleBlockOffset, writeCompressionType);
+}
+
 void writePixelDataCommon(QIODevice *io,
                           KisPaintDeviceSP dev,
                           const QRect &rc,
@@ -686,21 +868,44 @@ void writePixelDataCommon(QIODevice *io,
 
     KIS_ASSERT_RECOVER_RETURN(planes.size() >= writingInfoList.size());
 
-    const int numPixels = rc.width() * rc.height();
+    const int stride = channelSize * rc.width();
+
+    // prepare and compress the rows of all the channels in parallel
+
+    QVector<CompressedStripe> stripes;
+
+    for (int i = 0; i < writingInfoList.size(); i++) {
+        splitPlaneIntoStripes(i, rc, stripes);
+    }
+
+    QtConcurrent::blockingMap(stripes,
+        [&planes, &writingInfoList, stride, rc, channelSize, colorMode] (CompressedStripe &stripe) {
+            quint8 *plane = planes.at(stripe.channel);
+
+            preparePixelForWrite(plane + stripe.firstRow * stride, stripe.numRows * rc.width(),
+                                 channelSize, writingInfoList.at(stripe.channel).channelId, colorMode);
+
+            compressStripe(stripe, plane, stride);
+        });
 
     // write down the planes
 
     try {
+        auto channelBegin = stripes.constBegin();
+
         for (int i = 0; i < writingInfoList.size(); i++) {
             const ChannelWritingInfo &info = writingInfoList[i];
 
             dbgFile << "\tWriting channel" << i << "psd channel id" << info.channelId;
-
-            preparePixelForWrite(planes[i], numPixels, channelSize, info.channelId, colorMode);
-
             dbgFile << "\t\tchannel start" << ppVar(io->pos());
 
-            writeChannelDataRLE(io, planes[i], channelSize, rc, info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
+            auto channelEnd = channelBegin;
+            while (channelEnd != stripes.constEnd() && channelEnd->channel == i) {
+                ++channelEnd;
+            }
+
+            writeCompressedChannel(io, channelBegin, channelEnd, rc, info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
+            channelBegin = channelEnd;
         }
 
     } catch (KisAslWriterUtils::ASLWriteException &e) {
@@ -97,5 +97,28 @@ void CompressionTest::testCompressionUncompressed()
 
 }
 
+void CompressionTest::testCompressionRLEReusedBuffers()
+{
+    const int rowSize = 40000; // longer than the limit of the old API
+    QByteArray compressed;
+    QByteArray uncompressed(rowSize, Qt::Uninitialized);
+
+    for (int row = 0; row < 4; ++row) {
+        QByteArray ba(rowSize, Qt::Uninitialized);
+        for (int i = 0; i < rowSize; ++i) {
+            ba[i] = (i / (row + 1)) % 3 ? char(rand()) : char(row);
+        }
+
+        Compression::compress(ba.constData(), ba.size(), compressed, Compression::RLE);
+        QVERIFY(quint32(compressed.size()) <= Compression::maxRLECompressedSize(ba.size()));
+        QCOMPARE(compressed, Compression::compress(ba, Compression::RLE));
+
+        QVERIFY(Compression::uncompress(compressed.constData(), compressed.size(),
+                                        uncompressed.data(), uncompressed.size(),
+                                        Compression::RLE));
+        QCOMPARE(uncompressed, ba);
+    }
+}
+
 QTEST_MAIN(CompressionTest)
 
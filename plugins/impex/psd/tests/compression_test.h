@@ -29,6 +29,7 @@ private Q_SLOTS:
     void testCompressionRLE();
     void testCompressionZIP();
     void testCompressionUncompressed();
+    void testCompressionRLEReusedBuffers();
 
 };
 
@@ -39,8 +39,14 @@
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
 #include <KoColorModelStandardIds.h>
+#include <kis_image_config.h>
+#include <kis_pointer_utils.h>
+#include <kis_default_bounds_base.h>
+#include <KisRunnableStrokeJobData.h>
 #include "kis_paintop_plugin_utils.h"
 
+#include <QElapsedTimer>
+
 
 KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
@@ -48,13 +54,15 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     , m_image(image)
     , m_precisePainterWrapper(painter->device())
     , m_tempDev(m_precisePainterWrapper.createPreciseCompositionSourceDevice())
-    , m_backgroundPainter(new KisPainter(m_tempDev))
-    , m_smudgePainter(new KisPainter(m_tempDev))
     , m_colorRatePainter(new KisPainter(m_tempDev))
     , m_finalPainter(new KisPainter(m_precisePainterWrapper.preciseDevice()))
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
     , m_smudgeRadiusOption()
+    , m_avgUpdateTimePerDab(50)
+    , m_idealNumRects(KisImageConfig(true).maxNumberOfThreads())
+    , m_minUpdatePeriod(10)
+    , m_maxUpdatePeriod(100)
 {
     Q_UNUSED(node);
 
@@ -88,8 +96,6 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
 
     m_gradient = painter->gradient();
 
-    m_backgroundPainter->setCompositeOp(COMPOSITE_COPY);
-    // Smudge Painter works in default COMPOSITE_OVER mode
     m_colorRatePainter->setCompositeOp(painter->compositeOp()->id());
 
     m_finalPainter->setCompositeOp(m_smudgeRateOption.getSmearAlpha() ? COMPOSITE_COPY : COMPOSITE_OVER);
@@ -151,20 +157,32 @@ inline void KisColorSmudgeOp::getTopLeftAligned(const QPointF &pos, const QPoint
     splitCoordinate(topLeft.y(), y, &yFraction);
 }
 
+struct KisColorSmudgeOp::DabParameters
+{
+    KisFixedPaintDeviceSP mask;
+    QRect dstRect;
+    QRect srcRect;
+    QPoint samplePoint;
+    int smudgeRadius = 0;
+
+    quint8 colorRateOpacity = OPACITY_TRANSPARENT_U8;
+    quint8 smudgeRateOpacity = OPACITY_OPAQUE_U8;
+    KoColor color;
+
+    // calculated by prepareDabSource()
+    KoColor dullingFillColor;
+    KisPaintDeviceSP projectionSnapshot;
+};
+
+struct KisColorSmudgeOp::UpdateSharedState
+{
+    int numDabs = 0;
+    QElapsedTimer dabRenderingTimer;
+};
+
 KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 {
     KisBrushSP brush = m_brush;
-    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
-
-    /* This is a fix for dulling + overlay + paint,
-     * this should allow the image to composite paint addition effects correctly
-     * while also respecting overlay mode. */
-    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
-                                        useDullingMode &&
-                                        m_preciseImageDeviceWrapper!= nullptr);
-
-    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
-                                                                                 m_precisePainterWrapper;
 
     // Simple error catching
     if (!painter()->device() || !brush || !brush->canPaintFor(info)) {
@@ -247,42 +265,27 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
 
-    if (m_image && m_overlayModeOption.isChecked()) {
-        m_image->blockUpdates();
-        m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), srcDabRect);
-        m_image->unblockUpdates();
-    }
-    else {
-        // IMPORTANT: Clear the temporary painting device to transparent black.
-        //            It will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
-    }
-
-    // stored in the color space of the paintColor
-    KoColor dullingFillColor = m_paintColor;
-
-    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
-
-    if (!useDullingMode) {
-        activeWrapper.readRect(srcDabRect);
-        m_smudgePainter->bitBlt(QPoint(), activeWrapper.preciseDevice(), srcDabRect);
-    } else {
-        if (m_smudgeRadiusOption.isChecked()) {
-            const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
-
-            const QRect sampleRect = m_smudgeRadiusOption.sampleRect(info, effectiveSize, canvasLocalSamplePoint);
-            activeWrapper.readRect(sampleRect);
-
-            m_smudgeRadiusOption.apply(&dullingFillColor, info, effectiveSize, canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), activeWrapper.preciseDevice());
-            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        } else {
-            // get the pixel on the canvas that lies beneath the hot spot
-            // of the dab and fill  the temporary paint device with that color
-            activeWrapper.readRect(QRect(canvasLocalSamplePoint, QSize(1,1)));
-            KisCrossDeviceColorPickerInt colorPicker(activeWrapper.preciseDevice(), dullingFillColor);
-            colorPicker.pickColor(canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), dullingFillColor.data());
-            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        }
+    /**
+     * All the sensor-based options are evaluated here, on the stroke
+     * thread. The actual smudging depends on the pixels written by the
+     * previous dab, so it is postponed until doAsyncronousUpdate(), which
+     * executes the dabs in order. The mask is copied, because the dab
+     * cache reuses its device for the next dab.
+     */
+    DabParametersSP dab(new DabParameters());
+    dab->mask = new KisFixedPaintDevice(m_maskDab->colorSpace());
+    dab->mask->setRect(m_maskDab->bounds());
+    dab->mask->lazyGrowBufferWithoutInitialization();
+    memcpy(dab->mask->data(), m_maskDab->constData(),
+           m_maskDab->bounds().width() * m_maskDab->bounds().height() * m_maskDab->pixelSize());
+    dab->dstRect = m_dstDabRect;
+    dab->srcRect = srcDabRect;
+    dab->samplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
+
+    if (m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE &&
+        m_smudgeRadiusOption.isChecked()) {
+        const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
+        dab->smudgeRadius = m_smudgeRadiusOption.smudgeRadius(info, effectiveSize);
     }
 
     // if the user selected the color smudge option,
@@ -292,6 +295,7 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
         qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
         m_colorRateOption.apply(*m_colorRatePainter, info, 0.0, maxColorRate, fpOpacity);
+        dab->colorRateOpacity = m_colorRatePainter->opacity();
 
         // paint a rectangle with the current color (foreground color)
         // or a gradient color (if enabled)
@@ -306,59 +310,335 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
             m_hsvTransform->transform(color.data(), color.data(), 1);
         }
 
-        if (!useDullingMode) {
-            KIS_SAFE_ASSERT_RECOVER(*m_colorRatePainter->device()->colorSpace() == *color.colorSpace()) {
-                color.convertTo(m_colorRatePainter->device()->colorSpace());
-            }
+        KIS_SAFE_ASSERT_RECOVER(*m_tempDev->colorSpace() == *color.colorSpace()) {
+            color.convertTo(m_tempDev->colorSpace());
+        }
+
+        dab->color = color;
+    }
+
+    // set opacity calculated by the rate option
+    m_smudgeRateOption.apply(*m_finalPainter, info, 0.0, 1.0, fpOpacity);
+    dab->smudgeRateOpacity = m_finalPainter->opacity();
+
+    m_dabsQueue.append(dab);
+
+    return spacingInfo;
+}
 
-            m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+QPoint KisColorSmudgeOp::tempDeviceOrigin(const QRect &dstRect) const
+{
+    /**
+     * The dab is placed into m_tempDev with the same alignment as
+     * it has on the canvas, so that the tiles of both devices have
+     * the same borders. It lets us split the dab into tile-aligned
+     * strips that never share a tile when rendered concurrently.
+     */
+    const int tileMask = ~(64 - 1);
+    return QPoint(dstRect.x() & tileMask, dstRect.y() & tileMask);
+}
+
+void KisColorSmudgeOp::prepareDabSource(DabParameters *dab)
+{
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+
+    /* This is a fix for dulling + overlay + paint,
+     * this should allow the image to composite paint addition effects correctly
+     * while also respecting overlay mode. */
+    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
+                                        useDullingMode &&
+                                        m_preciseImageDeviceWrapper!= nullptr);
+
+    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
+                                                                                 m_precisePainterWrapper;
+
+    if (!useDullingMode) {
+        activeWrapper.readRect(dab->srcRect);
+    } else {
+        // stored in the color space of the paintColor
+        KoColor dullingFillColor = m_paintColor;
+        const QPoint &canvasLocalSamplePoint = dab->samplePoint;
+
+        if (m_smudgeRadiusOption.isChecked()) {
+            const QRect sampleRect = KisSmudgeRadiusOption::sampleRect(dab->smudgeRadius, canvasLocalSamplePoint);
+            activeWrapper.readRect(sampleRect);
+
+            m_smudgeRadiusOption.apply(&dullingFillColor, dab->smudgeRadius, canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), activeWrapper.preciseDevice());
+            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
         } else {
-            KIS_SAFE_ASSERT_RECOVER(*dullingFillColor.colorSpace() == *color.colorSpace()) {
-                color.convertTo(dullingFillColor.colorSpace());
-            }
+            // get the pixel on the canvas that lies beneath the hot spot
+            // of the dab and fill  the temporary paint device with that color
+            activeWrapper.readRect(QRect(canvasLocalSamplePoint, QSize(1,1)));
+            KisCrossDeviceColorPickerInt colorPicker(activeWrapper.preciseDevice(), dullingFillColor);
+            colorPicker.pickColor(canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), dullingFillColor.data());
             KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
+        }
+
+        if (m_colorRateOption.isChecked()) {
+            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *dab->color.colorSpace());
             m_preciseColorRateCompositeOp->composite(dullingFillColor.data(), 0,
-                                                     color.data(), 0,
+                                                     dab->color.data(), 0,
                                                      0, 0,
                                                      1, 1,
-                                                     m_colorRatePainter->opacity());
+                                                     dab->colorRateOpacity);
         }
+
+        dab->dullingFillColor = dullingFillColor;
     }
 
-    if (useDullingMode) {
-        KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        m_tempDev->fill(QRect(0, 0, m_dstDabRect.width(), m_dstDabRect.height()), dullingFillColor);
+    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(dab->dstRect));
+
+    if (m_image && m_overlayModeOption.isChecked()) {
+        /**
+         * The updates of the image are blocked only while this job
+         * copies the projection. The following jobs of the dab are
+         * dropped if the stroke is cancelled, so they cannot be the
+         * ones to unblock them.
+         */
+        const QRect projectionRect = dab->srcRect | dab->dstRect;
+        KisPaintDeviceSP projection = m_image->projection();
+        dab->projectionSnapshot = new KisPaintDevice(projection->colorSpace());
+
+        m_image->blockUpdates();
+        KisPainter::copyAreaOptimized(projectionRect.topLeft(), projection, dab->projectionSnapshot, projectionRect);
+        m_image->unblockUpdates();
     }
+}
+
+void KisColorSmudgeOp::fillTempDeviceRect(const DabParameters *dab, const QRect &rc)
+{
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+
+    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
+                                        useDullingMode &&
+                                        m_preciseImageDeviceWrapper!= nullptr);
 
-    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(m_dstDabRect));
+    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
+                                                                                 m_precisePainterWrapper;
+
+    const QPoint tempOrigin = tempDeviceOrigin(dab->dstRect);
+    const QRect tempRect = rc.translated(-tempOrigin);
+    const QRect srcRect = rc.translated(dab->srcRect.topLeft() - dab->dstRect.topLeft());
+
+    /**
+     * The painters are created locally, because the parts of the dab
+     * are rendered concurrently
+     */
+
+    if (m_image && m_overlayModeOption.isChecked()) {
+        KisPainter backgroundPainter(m_tempDev);
+        backgroundPainter.setCompositeOp(COMPOSITE_COPY);
+        backgroundPainter.bitBlt(tempRect.topLeft(), dab->projectionSnapshot, srcRect);
+    }
+    else {
+        // IMPORTANT: Clear the temporary painting device to transparent black.
+        //            It will only clear the extents of the brush.
+        m_tempDev->clear(tempRect);
+    }
+
+    if (!useDullingMode) {
+        // Smudge Painter works in default COMPOSITE_OVER mode
+        KisPainter smudgePainter(m_tempDev);
+        smudgePainter.bitBlt(tempRect.topLeft(), activeWrapper.preciseDevice(), srcRect);
+
+        if (m_colorRateOption.isChecked()) {
+            KisPainter colorRatePainter(m_tempDev);
+            colorRatePainter.setCompositeOp(m_preciseColorRateCompositeOp);
+            colorRatePainter.setOpacity(dab->colorRateOpacity);
+            colorRatePainter.fill(tempRect.x(), tempRect.y(), tempRect.width(), tempRect.height(), dab->color);
+        }
+    } else {
+        KIS_SAFE_ASSERT_RECOVER_NOOP(*dab->dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
+        m_tempDev->fill(tempRect, dab->dullingFillColor);
+    }
+}
+
+void KisColorSmudgeOp::blendDabRect(const DabParameters *dab, const QRect &rc)
+{
+    const QRect tempRect = rc.translated(-tempDeviceOrigin(dab->dstRect));
+    const QPoint maskOffset = rc.topLeft() - dab->dstRect.topLeft() + dab->mask->bounds().topLeft();
+
+    KisPainter finalPainter(m_precisePainterWrapper.preciseDevice());
+    finalPainter.setCompositeOp(m_finalPainter->compositeOp());
+    finalPainter.setSelection(m_finalPainter->selection());
+    finalPainter.setChannelFlags(m_finalPainter->channelFlags());
 
     // if color is disabled (only smudge) and "overlay mode" is enabled
     // then first blit the region under the brush from the image projection
     // to the painting device to prevent a rapid build up of alpha value
     // if the color to be smudged is semi transparent.
     if (m_image && m_overlayModeOption.isChecked() && !m_colorRateOption.isChecked()) {
-        m_finalPainter->setOpacity(OPACITY_OPAQUE_U8);
-        m_image->blockUpdates();
+        finalPainter.setOpacity(OPACITY_OPAQUE_U8);
         // TODO: check if this code is correct in mirrored mode! Technically, the
         //       painter renders the mirrored dab only, so we should also prepare
         //       the overlay for it in all the places.
-        m_finalPainter->bitBlt(m_dstDabRect.topLeft(), m_image->projection(), m_dstDabRect);
-        m_image->unblockUpdates();
+        finalPainter.bitBlt(rc.topLeft(), dab->projectionSnapshot, rc);
     }
 
-    // set opacity calculated by the rate option
-    m_smudgeRateOption.apply(*m_finalPainter, info, 0.0, 1.0, fpOpacity);
+    finalPainter.setOpacity(dab->smudgeRateOpacity);
 
     // then blit the temporary painting device on the canvas at the current brush position
     // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
-    m_finalPainter->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    m_finalPainter->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    finalPainter.bitBltWithFixedSelection(rc.x(), rc.y(),
+                                          m_tempDev, dab->mask,
+                                          maskOffset.x(), maskOffset.y(),
+                                          tempRect.x(), tempRect.y(),
+                                          rc.width(), rc.height());
+}
 
-    const QVector<QRect> dirtyRects = m_finalPainter->takeDirtyRegion();
+void KisColorSmudgeOp::finishDab(const DabParameters *dab)
+{
+    if (m_finalPainter->hasMirroring()) {
+        const QPoint tempOrigin = tempDeviceOrigin(dab->dstRect);
+
+        m_finalPainter->setOpacity(dab->smudgeRateOpacity);
+        m_finalPainter->renderMirrorMaskSafe(dab->dstRect, m_tempDev,
+                                             dab->dstRect.x() - tempOrigin.x(),
+                                             dab->dstRect.y() - tempOrigin.y(),
+                                             dab->mask, false);
+        m_finalPainter->takeDirtyRegion();
+    }
+
+    const QVector<QRect> dirtyRects = m_finalPainter->calculateAllMirroredRects(dab->dstRect);
     m_precisePainterWrapper.writeRects(dirtyRects);
     painter()->addDirtyRects(dirtyRects);
+}
 
-    return spacingInfo;
+void KisColorSmudgeOp::addDabJobs(DabParametersSP dab, QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    const QRect &rc = dab->dstRect;
+
+    /**
+     * Mirrored dabs are rendered from the whole m_tempDev, and in
+     * wrap-around mode the strips of a big dab may wrap onto each
+     * other, so in these cases the dab is rendered in one piece.
+     */
+    const bool canSplitDab =
+        !m_finalPainter->hasMirroring() &&
+        !painter()->device()->defaultBounds()->wrapAroundMode() &&
+        rc.width() * rc.height() >= 128 * 128;
+
+    QVector<QRect> strips;
+
+    if (canSplitDab && m_idealNumRects > 1) {
+        // strips are aligned to the tile rows of the canvas
+        const int tileSize = 64;
+        const int stripHeight =
+            qMax(tileSize, (rc.height() / m_idealNumRects + tileSize - 1) & ~(tileSize - 1));
+
+        int top = rc.top();
+        int boundary = (rc.top() & ~(tileSize - 1)) + stripHeight;
+
+        while (top <= rc.bottom()) {
+            const int bottom = qMin(boundary - 1, rc.bottom());
+            strips.append(QRect(rc.left(), top, rc.width(), bottom - top + 1));
+
+            top = bottom + 1;
+            boundary += stripHeight;
+        }
+    } else {
+        strips.append(rc);
+    }
+
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [this, dab] () {
+                prepareDabSource(dab.data());
+            },
+            KisStrokeJobData::SEQUENTIAL));
+
+    if (strips.size() > 1) {
+        /**
+         * In smearing mode the source rect of the dab overlaps its
+         * destination rect, so all the strips should have read the
+         * canvas before any of them starts writing into it.
+         */
+        Q_FOREACH (const QRect &strip, strips) {
+            jobs.append(
+                new KisRunnableStrokeJobData(
+                    [this, dab, strip] () {
+                        fillTempDeviceRect(dab.data(), strip);
+                    },
+                    KisStrokeJobData::CONCURRENT));
+        }
+
+        jobs.append(new KisRunnableStrokeJobData(0, KisStrokeJobData::SEQUENTIAL));
+
+        Q_FOREACH (const QRect &strip, strips) {
+            jobs.append(
+                new KisRunnableStrokeJobData(
+                    [this, dab, strip] () {
+                        blendDabRect(dab.data(), strip);
+                    },
+                    KisStrokeJobData::CONCURRENT));
+        }
+    } else {
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [this, dab] () {
+                    fillTempDeviceRect(dab.data(), dab->dstRect);
+                    blendDabRect(dab.data(), dab->dstRect);
+                },
+                KisStrokeJobData::SEQUENTIAL));
+    }
+
+    jobs.append(
+        new KisRunnableStrokeJobData(
+            [this, dab] () {
+                finishDab(dab.data());
+            },
+            KisStrokeJobData::SEQUENTIAL));
+}
+
+std::pair<int, bool> KisColorSmudgeOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs)
+{
+    bool someDabsAreStillInQueue = false;
+
+    if (!m_updateSharedState && !m_dabsQueue.isEmpty()) {
+        m_updateSharedState = toQShared(new UpdateSharedState());
+        UpdateSharedStateSP state = m_updateSharedState;
+
+        /**
+         * Every dab reads the pixels written by the previous one, so the
+         * dabs are executed strictly one after another, only the parts of
+         * a single dab are rendered in parallel. We limit the number of
+         * dabs in a batch to fit the maximum update period.
+         */
+        const qreal updateTimePerDab = m_avgUpdateTimePerDab.rollingMeanSafe();
+        const int dabsLimit =
+            updateTimePerDab > 0 ?
+                qMax(1, int(m_maxUpdatePeriod / updateTimePerDab)) :
+                m_dabsQueue.size();
+
+        while (!m_dabsQueue.isEmpty() && state->numDabs < dabsLimit) {
+            addDabJobs(m_dabsQueue.takeFirst(), jobs);
+            state->numDabs++;
+        }
+
+        someDabsAreStillInQueue = !m_dabsQueue.isEmpty();
+
+        state->dabRenderingTimer.start();
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, this, someDabsAreStillInQueue] () {
+                    const int updateRenderingTime = state->dabRenderingTimer.elapsed();
+
+                    m_avgUpdateTimePerDab(qreal(updateRenderingTime) / state->numDabs);
+
+                    m_currentUpdatePeriod =
+                        someDabsAreStillInQueue ? m_minUpdatePeriod :
+                        qBound(m_minUpdatePeriod, int(1.5 * updateRenderingTime), m_maxUpdatePeriod);
+
+                    m_updateSharedState.clear();
+                },
+                KisStrokeJobData::SEQUENTIAL));
+
+    } else if (m_updateSharedState && !m_dabsQueue.isEmpty()) {
+        someDabsAreStillInQueue = true;
+    }
+
+    return std::make_pair(m_currentUpdatePeriod, someDabsAreStillInQueue);
 }
 
 KisSpacingInformation KisColorSmudgeOp::updateSpacingImpl(const KisPaintInformation &info) const
@@ -20,6 +20,7 @@
 #define _KIS_COLORSMUDGEOP_H_
 
 #include <QRect>
+#include <QSharedPointer>
 
 #include "KoColorTransformation.h"
 #include <KoAbstractGradient.h>
@@ -43,11 +44,14 @@
 #include "kis_smudge_radius_option.h"
 #include "KisPrecisePaintDeviceWrapper.h"
 
+#include <KisRollingMeanAccumulatorWrapper.h>
+
 class QPointF;
 
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
 class KoColorSpace;
+class KisRunnableStrokeJobData;
 
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
@@ -55,6 +59,8 @@ public:
     KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image);
     ~KisColorSmudgeOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
@@ -67,6 +73,44 @@ private:
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
+    struct DabParameters;
+    typedef QSharedPointer<DabParameters> DabParametersSP;
+
+    struct UpdateSharedState;
+    typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
+    /**
+     * Reads the source data of the dab from the canvas and calculates
+     * the dulling color. Must be called sequentially, after all the
+     * previous dabs have been written into the precise device.
+     */
+    void prepareDabSource(DabParameters *dab);
+
+    /**
+     * Fills \p rc area of m_tempDev with the smudged data and the
+     * paint color. \p rc is a part of dab's destination rect. Parts
+     * of the same dab can be filled concurrently.
+     */
+    void fillTempDeviceRect(const DabParameters *dab, const QRect &rc);
+
+    /**
+     * Blends \p rc area of m_tempDev into the canvas. Must be called
+     * after all the parts of the dab have been filled by
+     * fillTempDeviceRect(). Parts of the same dab can be blended
+     * concurrently.
+     */
+    void blendDabRect(const DabParameters *dab, const QRect &rc);
+
+    /**
+     * Renders the mirrored copies of the dab and writes the dab back
+     * into the canvas device.
+     */
+    void finishDab(const DabParameters *dab);
+
+    QPoint tempDeviceOrigin(const QRect &dstRect) const;
+
+    void addDabJobs(DabParametersSP dab, QVector<KisRunnableStrokeJobData*> &jobs);
+
 private:
     bool                      m_firstRun;
     KisImageWSP               m_image;
@@ -74,8 +118,6 @@ private:
     KoColor                   m_paintColor;
     KisPaintDeviceSP          m_tempDev;
     QScopedPointer<KisPrecisePaintDeviceWrapper> m_preciseImageDeviceWrapper;
-    QScopedPointer<KisPainter> m_backgroundPainter;
-    QScopedPointer<KisPainter> m_smudgePainter;
     QScopedPointer<KisPainter> m_colorRatePainter;
     QScopedPointer<KisPainter> m_finalPainter;
     KoAbstractGradientSP      m_gradient;
@@ -99,6 +141,17 @@ private:
 
     KoColorTransformation *m_hsvTransform {0};
     const KoCompositeOp *m_preciseColorRateCompositeOp {0};
+
+    QList<DabParametersSP> m_dabsQueue;
+    UpdateSharedStateSP m_updateSharedState;
+
+    int m_currentUpdatePeriod = 20;
+    KisRollingMeanAccumulatorWrapper m_avgUpdateTimePerDab;
+
+    const int m_idealNumRects;
+
+    const int m_minUpdatePeriod;
+    const int m_maxUpdatePeriod;
 };
 
 #endif // _KIS_COLORSMUDGEOP_H_
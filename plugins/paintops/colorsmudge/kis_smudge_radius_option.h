@@ -29,15 +29,22 @@ class KisSmudgeRadiusOption: public KisRateOption
 public:
     KisSmudgeRadiusOption();
 
-    QRect sampleRect(const KisPaintInformation &info, qreal diameter, const QPoint &pos) const;
+    /**
+     * Calculates the radius of the area the dulling color is
+     * sampled from. The radius is calculated separately from the
+     * sampling itself, because the sampling happens asynchronously,
+     * when the paint information is no longer valid.
+     */
+    int smudgeRadius(const KisPaintInformation &info, qreal diameter) const;
+
+    static QRect sampleRect(int smudgeRadius, const QPoint &pos);
 
     /**
      * Set the opacity of the painter based on the rate
      * and the curve (if checked)
      */
     void apply(KoColor *resultColor,
-               const KisPaintInformation& info,
-               qreal diameter,
+               int smudgeRadius,
                qreal posx,
                qreal posy,
                KisPaintDeviceSP dev) const;
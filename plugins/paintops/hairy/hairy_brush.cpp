@@ -28,7 +28,7 @@
 #include <QVector>
 
 #include <kis_types.h>
-#include <kis_random_accessor_ng.h>
+#include <KisParticleRasterizer.h>
 #include <kis_cross_device_color_picker.h>
 #include <kis_fixed_paint_device.h>
 
@@ -45,11 +45,13 @@ HairyBrush::HairyBrush()
 
     m_saturationId = -1;
     m_transfo = 0;
+    m_particleRasterizer = 0;
 }
 
 HairyBrush::~HairyBrush()
 {
     delete m_transfo;
+    delete m_particleRasterizer;
     qDeleteAll(m_bristles.begin(), m_bristles.end());
     m_bristles.clear();
 }
@@ -60,6 +62,14 @@ void HairyBrush::initAndCache()
     m_compositeOp = m_dab->colorSpace()->compositeOp(COMPOSITE_OVER);
     m_pixelSize = m_dab->colorSpace()->pixelSize();
 
+    const KisParticleRasterizer::Mode mode =
+        m_properties->useCompositing ? KisParticleRasterizer::Composite :
+        m_properties->antialias ? KisParticleRasterizer::AccumulateOpacity :
+        KisParticleRasterizer::Darken;
+
+    delete m_particleRasterizer;
+    m_particleRasterizer = new KisParticleRasterizer(m_dab->colorSpace(), mode, m_compositeOp);
+
     if (m_properties->useSaturation) {
         m_transfo = m_dab->colorSpace()->createColorTransformation("hsv_adjustment", m_params);
         if (m_transfo) {
@@ -136,8 +146,6 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     Bristle *bristle = 0;
     KoColor bristleColor(dab->colorSpace());
 
-    m_dabAccessor = dab->createRandomAccessorNG();
-
     m_dab = dab;
 
     // initialization block
@@ -244,8 +252,9 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
         }
 
     }
+
+    m_particleRasterizer->rasterize(dab);
     m_dab = 0;
-    m_dabAccessor = 0;
 }
 
 
@@ -330,85 +339,26 @@ inline void HairyBrush::addBristleInk(Bristle *bristle,const QPointF &pos, const
 
 void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
 {
-    // opacity top left, right, bottom left, right
     quint8 opacity = color.opacityU8();
     opacity *= weight;
 
-    int ipx = int (pos.x());
-    int ipy = int (pos.y());
-    qreal fx = qAbs(pos.x() - ipx);
-    qreal fy = qAbs(pos.y() - ipy);
-
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
-
-    const KoColorSpace * cs = m_dab->colorSpace();
-
-    m_dabAccessor->moveTo(ipx  , ipy);
-    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy);
-    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btr, 1);
-
-    m_dabAccessor->moveTo(ipx, ipy + 1);
-    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy + 1);
-    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbr, 1);
+    m_particleRasterizer->addParticle(pos, color, opacity);
 }
 
 void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
 {
-    // opacity top left, right, bottom left, right
-    memcpy(m_color.data(), color.data(), m_pixelSize);
-    quint8 opacity = color.opacityU8();
-
-    int ipx = int (pos.x());
-    int ipy = int (pos.y());
-    qreal fx = qAbs(pos.x() - ipx);
-    qreal fy = qAbs(pos.y() - ipy);
-
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
-
-    m_color.setOpacity(btl);
-    plotPixel(ipx  , ipy, m_color);
-
-    m_color.setOpacity(btr);
-    plotPixel(ipx + 1  , ipy, m_color);
-
-    m_color.setOpacity(bbl);
-    plotPixel(ipx  , ipy + 1, m_color);
-
-    m_color.setOpacity(bbr);
-    plotPixel(ipx + 1 , ipy + 1, m_color);
+    m_particleRasterizer->addParticle(pos, color, OPACITY_OPAQUE_U8);
 }
 
 
 inline void HairyBrush::plotPixel(int wx, int wy, const KoColor &color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    m_compositeOp->composite(m_dabAccessor->rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+    m_particleRasterizer->addPixel(QPoint(wx, wy), color, OPACITY_OPAQUE_U8);
 }
 
 inline void HairyBrush::darkenPixel(int wx, int wy, const KoColor &color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    if (m_dab->colorSpace()->opacityU8(m_dabAccessor->rawData()) < color.opacityU8()) {
-        memcpy(m_dabAccessor->rawData(), color.data(), m_pixelSize);
-    }
+    m_particleRasterizer->addPixel(QPoint(wx, wy), color, color.opacityU8());
 }
 
 double HairyBrush::computeMousePressure(double distance)
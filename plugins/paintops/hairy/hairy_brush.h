@@ -30,9 +30,9 @@
 
 #include <kis_paint_device.h>
 #include <brushengine/kis_paint_information.h>
-#include <kis_random_accessor_ng.h>
 
 class KoCompositeOp;
+class KisParticleRasterizer;
 
 
 class KisHairyProperties
@@ -123,7 +123,7 @@ private:
     QHash<QString, QVariant> m_params;
     // temporary device
     KisPaintDeviceSP m_dab;
-    KisRandomAccessorSP m_dabAccessor;
+    KisParticleRasterizer *m_particleRasterizer;
     const KoCompositeOp * m_compositeOp;
     quint32 m_pixelSize;
 
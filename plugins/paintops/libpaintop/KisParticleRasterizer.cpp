@@ -0,0 +1,416 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisParticleRasterizer.h"
+
+#include <QVector>
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoCompositeOp.h>
+
+#include "kis_paint_device.h"
+#include "kis_global.h"
+#include "kis_assert.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+/**
+ * The splats are grouped by the tiles of the paint device, so that
+ * every group is read and written with a single tile lookup.
+ */
+const int tileShift = 6;
+
+struct PixelOp {
+    qint32 x;
+    qint32 y;
+    qint32 colorIndex;
+    quint8 opacity;
+};
+
+inline bool sameTile(const PixelOp &a, const PixelOp &b)
+{
+    return (a.x >> tileShift) == (b.x >> tileShift) &&
+           (a.y >> tileShift) == (b.y >> tileShift);
+}
+
+inline bool tileLessThan(const PixelOp &a, const PixelOp &b)
+{
+    const int ay = a.y >> tileShift;
+    const int by = b.y >> tileShift;
+
+    return ay < by || (ay == by && (a.x >> tileShift) < (b.x >> tileShift));
+}
+
+}
+
+struct KisParticleRasterizer::Private
+{
+    Private(const KoColorSpace *_colorSpace, Mode _mode, const KoCompositeOp *_compositeOp)
+        : colorSpace(_colorSpace),
+          pixelSize(_colorSpace->pixelSize()),
+          mode(_mode),
+          compositeOp(_compositeOp)
+    {
+        resetBounds();
+    }
+
+    const KoColorSpace *colorSpace;
+    const int pixelSize;
+    Mode mode;
+    const KoCompositeOp *compositeOp;
+
+    QVector<PixelOp> ops;
+
+    // packed pixels of the colors used by the splats
+    QVector<quint8> colors;
+    int lastColorIndex = -1;
+    int prevColorIndex = -1;
+
+    int minX, minY, maxX, maxY;
+
+    // dense per-pixel state of the currently processed tile region
+    QVector<quint8> buffer;
+    QVector<qint32> pixelColorIndex;
+    QVector<quint32> pixelOpacity;
+
+    void resetBounds() {
+        minX = minY = std::numeric_limits<int>::max();
+        maxX = maxY = std::numeric_limits<int>::min();
+    }
+
+    int colorIndex(const KoColor &color);
+
+    inline void addOp(int x, int y, int colorIndex, quint8 opacity) {
+        PixelOp op;
+        op.x = x;
+        op.y = y;
+        op.colorIndex = colorIndex;
+        op.opacity = opacity;
+        ops.append(op);
+
+        minX = qMin(minX, x);
+        minY = qMin(minY, y);
+        maxX = qMax(maxX, x);
+        maxY = qMax(maxY, y);
+    }
+
+    void processRegion(QVector<PixelOp>::const_iterator begin,
+                       QVector<PixelOp>::const_iterator end,
+                       const QRect &rc);
+};
+
+int KisParticleRasterizer::Private::colorIndex(const KoColor &color)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(color.colorSpace()->pixelSize() == quint32(pixelSize));
+
+    /**
+     * The engines usually paint the whole dab with the same color
+     * (or alternate between two of them, like the lines do with their
+     * edges), so checking the last two used colors is enough to keep
+     * the table tiny
+     */
+    if (lastColorIndex >= 0 &&
+        !memcmp(colors.constData() + lastColorIndex * pixelSize, color.data(), pixelSize)) {
+
+        return lastColorIndex;
+    }
+
+    if (prevColorIndex >= 0 &&
+        !memcmp(colors.constData() + prevColorIndex * pixelSize, color.data(), pixelSize)) {
+
+        std::swap(lastColorIndex, prevColorIndex);
+        return lastColorIndex;
+    }
+
+    prevColorIndex = lastColorIndex;
+    lastColorIndex = colors.size() / pixelSize;
+    colors.resize(colors.size() + pixelSize);
+    memcpy(colors.data() + lastColorIndex * pixelSize, color.data(), pixelSize);
+
+    return lastColorIndex;
+}
+
+void KisParticleRasterizer::Private::processRegion(QVector<PixelOp>::const_iterator begin,
+                                                   QVector<PixelOp>::const_iterator end,
+                                                   const QRect &rc)
+{
+    const int numPixels = rc.width() * rc.height();
+    const int left = rc.x();
+    const int top = rc.y();
+    const int width = rc.width();
+
+    quint8 *bufferPtr = buffer.data();
+    const quint8 *colorsPtr = colors.constData();
+
+    switch (mode) {
+    case Overwrite:
+    case AccumulateOpacity: {
+        /**
+         * Only the last color and the total opacity of every pixel
+         * matter, so first resolve all the splats into the dense state
+         * and only then touch the pixels, once per pixel.
+         */
+        qint32 *colorIndexPtr = pixelColorIndex.data();
+        quint32 *opacityPtr = pixelOpacity.data();
+
+        std::fill(colorIndexPtr, colorIndexPtr + numPixels, -1);
+        std::fill(opacityPtr, opacityPtr + numPixels, 0);
+
+        if (mode == Overwrite) {
+            for (auto it = begin; it != end; ++it) {
+                const int idx = (it->y - top) * width + it->x - left;
+                colorIndexPtr[idx] = it->colorIndex;
+                opacityPtr[idx] = it->opacity;
+            }
+        } else {
+            for (auto it = begin; it != end; ++it) {
+                const int idx = (it->y - top) * width + it->x - left;
+                colorIndexPtr[idx] = it->colorIndex;
+                opacityPtr[idx] += it->opacity;
+            }
+        }
+
+        const bool accumulate = mode == AccumulateOpacity;
+
+        for (int i = 0; i < numPixels; i++) {
+            if (colorIndexPtr[i] < 0) continue;
+
+            quint8 *pixel = bufferPtr + i * pixelSize;
+            quint32 opacity = opacityPtr[i];
+
+            if (accumulate) {
+                opacity += colorSpace->opacityU8(pixel);
+            }
+
+            memcpy(pixel, colorsPtr + colorIndexPtr[i] * pixelSize, pixelSize);
+            colorSpace->setOpacity(pixel, quint8(qMin(opacity, quint32(OPACITY_OPAQUE_U8))), 1);
+        }
+        break;
+    }
+    case Darken:
+        for (auto it = begin; it != end; ++it) {
+            quint8 *pixel = bufferPtr + ((it->y - top) * width + it->x - left) * pixelSize;
+
+            if (colorSpace->opacityU8(pixel) < it->opacity) {
+                memcpy(pixel, colorsPtr + it->colorIndex * pixelSize, pixelSize);
+                colorSpace->setOpacity(pixel, it->opacity, 1);
+            }
+        }
+        break;
+    case Composite:
+        KIS_SAFE_ASSERT_RECOVER_RETURN(compositeOp);
+
+        for (auto it = begin; it != end; ++it) {
+            if (!it->opacity) continue;
+
+            quint8 *pixel = bufferPtr + ((it->y - top) * width + it->x - left) * pixelSize;
+            compositeOp->composite(pixel, pixelSize,
+                                   colorsPtr + it->colorIndex * pixelSize, pixelSize,
+                                   0, 0, 1, 1, it->opacity);
+        }
+        break;
+    }
+}
+
+KisParticleRasterizer::KisParticleRasterizer(const KoColorSpace *colorSpace, Mode mode, const KoCompositeOp *compositeOp)
+    : m_d(new Private(colorSpace, mode, compositeOp))
+{
+}
+
+KisParticleRasterizer::~KisParticleRasterizer()
+{
+}
+
+KisParticleRasterizer::Mode KisParticleRasterizer::mode() const
+{
+    return m_d->mode;
+}
+
+void KisParticleRasterizer::setMode(KisParticleRasterizer::Mode mode)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP(m_d->ops.isEmpty());
+    m_d->mode = mode;
+}
+
+void KisParticleRasterizer::addParticle(const QPointF &pos, const KoColor &color, qreal opacity)
+{
+    const int ipx = qFloor(pos.x());
+    const int ipy = qFloor(pos.y());
+    const qreal fx = pos.x() - ipx;
+    const qreal fy = pos.y() - ipy;
+
+    const int index = m_d->colorIndex(color);
+
+    m_d->addOp(ipx,     ipy,     index, qRound((1.0 - fx) * (1.0 - fy) * opacity));
+    m_d->addOp(ipx + 1, ipy,     index, qRound(fx * (1.0 - fy) * opacity));
+    m_d->addOp(ipx,     ipy + 1, index, qRound((1.0 - fx) * fy * opacity));
+    m_d->addOp(ipx + 1, ipy + 1, index, qRound(fx * fy * opacity));
+}
+
+void KisParticleRasterizer::addPixel(const QPoint &pos, const KoColor &color, quint8 opacity)
+{
+    m_d->addOp(pos.x(), pos.y(), m_d->colorIndex(color), opacity);
+}
+
+void KisParticleRasterizer::addLine(const QPointF &start, const QPointF &end, qreal width, bool antialias, const KoColor &color, quint8 opacity)
+{
+    int x1 = qFloor(start.x());
+    int y1 = qFloor(start.y());
+    int x2 = qFloor(end.x());
+    int y2 = qFloor(end.y());
+
+    if ((x2 == x1) && (y2 == y1)) return;
+
+    const int dstX = x2 - x1;
+    const int dstY = y2 - y1;
+
+    const qreal uniC = dstX * y1 - dstY * x1;
+    const qreal projectionDenominator = 1.0 / (pow2(qreal(dstX)) + pow2(qreal(dstY)));
+
+    const qreal subPixel = qAbs(dstX) > qAbs(dstY) ? start.x() - x1 : start.y() - y1;
+
+    const qreal halfWidth = width * 0.5 + subPixel;
+    const int W_ = qRound(halfWidth) + 1;
+
+    // save the state
+    const int X1_ = x1;
+    const int Y1_ = y1;
+    const int X2_ = x2;
+    const int Y2_ = y2;
+
+    if (x2 < x1) std::swap(x1, x2);
+    if (y2 < y1) std::swap(y1, y2);
+
+    const qreal denominator = 1.0 / std::sqrt(pow2(qreal(dstY)) + pow2(qreal(dstX)));
+
+    const int index = m_d->colorIndex(color);
+
+    /**
+     * KisPainter::drawLine() tries to fade the edge pixels by passing a factor
+     * below 1.0 to multiplyAlpha(), which takes a quint8, so the factor
+     * is truncated to zero and the edge pixels are composited with a
+     * fully transparent color. Do exactly the same, so that the lines
+     * look the same whichever way they are drawn.
+     */
+    int edgeIndex = -1;
+    if (antialias) {
+        KoColor edgeColor(color);
+        edgeColor.colorSpace()->multiplyAlpha(edgeColor.data(), OPACITY_TRANSPARENT_U8, 1);
+        edgeIndex = m_d->colorIndex(edgeColor);
+    }
+
+    for (int y = y1 - W_; y < y2 + W_; y++) {
+        for (int x = x1 - W_; x < x2 + W_; x++) {
+
+            const qreal projection = ((x - X1_) * dstX + (y - Y1_) * dstY) * projectionDenominator;
+            const qreal scanX = X1_ + projection * dstX;
+            const qreal scanY = Y1_ + projection * dstY;
+
+            qreal AA_;
+
+            if (((scanX < x1) || (scanX > x2)) || ((scanY < y1) || (scanY > y2))) {
+                AA_ = qMin(std::sqrt(pow2(qreal(x - X1_)) + pow2(qreal(y - Y1_))),
+                           std::sqrt(pow2(qreal(x - X2_)) + pow2(qreal(y - Y2_))));
+            } else {
+                AA_ = qAbs(dstY * x - dstX * y + uniC) * denominator;
+            }
+
+            if (AA_ > halfWidth) {
+                continue;
+            }
+
+            const bool isEdge = antialias && AA_ > halfWidth - 1.0;
+            m_d->addOp(x, y, isEdge ? edgeIndex : index, opacity);
+        }
+    }
+}
+
+bool KisParticleRasterizer::isEmpty() const
+{
+    return m_d->ops.isEmpty();
+}
+
+QRect KisParticleRasterizer::bounds() const
+{
+    return !m_d->ops.isEmpty() ?
+        QRect(QPoint(m_d->minX, m_d->minY), QPoint(m_d->maxX, m_d->maxY)) : QRect();
+}
+
+void KisParticleRasterizer::rasterize(KisPaintDeviceSP dev)
+{
+    if (m_d->ops.isEmpty()) return;
+
+    KIS_SAFE_ASSERT_RECOVER(dev->pixelSize() == quint32(m_d->pixelSize)) {
+        clear();
+        return;
+    }
+
+    /**
+     * Stable sorting keeps the order of the splats falling onto the
+     * same pixel, which is all the modes depend on.
+     */
+    std::stable_sort(m_d->ops.begin(), m_d->ops.end(), tileLessThan);
+
+    const int maxTilePixels = 1 << (2 * tileShift);
+    m_d->buffer.resize(maxTilePixels * m_d->pixelSize);
+    m_d->pixelColorIndex.resize(maxTilePixels);
+    m_d->pixelOpacity.resize(maxTilePixels);
+
+    auto it = m_d->ops.constBegin();
+    const auto end = m_d->ops.constEnd();
+
+    while (it != end) {
+        int left = it->x;
+        int top = it->y;
+        int right = it->x;
+        int bottom = it->y;
+
+        auto groupEnd = it + 1;
+        while (groupEnd != end && sameTile(*it, *groupEnd)) {
+            left = qMin(left, groupEnd->x);
+            top = qMin(top, groupEnd->y);
+            right = qMax(right, groupEnd->x);
+            bottom = qMax(bottom, groupEnd->y);
+            ++groupEnd;
+        }
+
+        const QRect rc(QPoint(left, top), QPoint(right, bottom));
+
+        dev->readBytes(m_d->buffer.data(), rc);
+        m_d->processRegion(it, groupEnd, rc);
+        dev->writeBytes(m_d->buffer.constData(), rc);
+
+        it = groupEnd;
+    }
+
+    clear();
+}
+
+void KisParticleRasterizer::clear()
+{
+    m_d->ops.clear();
+    m_d->colors.clear();
+    m_d->lastColorIndex = -1;
+    m_d->prevColorIndex = -1;
+    m_d->resetBounds();
+}
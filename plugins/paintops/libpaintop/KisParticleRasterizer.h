@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISPARTICLERASTERIZER_H
+#define KISPARTICLERASTERIZER_H
+
+#include <QScopedPointer>
+#include <QPointF>
+#include <QRect>
+
+#include "kis_types.h"
+#include "kritapaintop_export.h"
+
+class KoColor;
+class KoColorSpace;
+class KoCompositeOp;
+
+/**
+ * Collects single-pixel splats (Wu particles, plain pixels, thin
+ * antialiased lines) generated by the particle-based engines and
+ * writes them into a paint device in one go.
+ *
+ * Writing every splat through KisRandomAccessor means a tile lookup
+ * for every pixel. The rasterizer instead groups the splats of a dab
+ * by tile, reads every touched tile region into a dense buffer once,
+ * resolves all the splats with plain index arithmetic and writes the
+ * buffer back.
+ *
+ * The splats landing on the same pixel are applied in the order they
+ * were added, so the result is the same as if they were written
+ * directly into the device.
+ */
+class PAINTOP_EXPORT KisParticleRasterizer
+{
+public:
+    enum Mode {
+        /// the pixel gets the color of the splat and its opacity
+        Overwrite,
+        /// the pixel gets the color of the splat, the opacity of the splat is added to the pixel's one
+        AccumulateOpacity,
+        /// the pixel is replaced with the splat only if the splat is more opaque than the pixel
+        Darken,
+        /// the splat is composited onto the pixel with the composite op passed to the constructor
+        Composite
+    };
+
+public:
+    KisParticleRasterizer(const KoColorSpace *colorSpace, Mode mode, const KoCompositeOp *compositeOp = 0);
+    ~KisParticleRasterizer();
+
+    Mode mode() const;
+    void setMode(Mode mode);
+
+    /**
+     * Adds a Wu particle: \p opacity (in 0...255 range) is split among
+     * the four pixels around \p pos proportionally to their coverage
+     */
+    void addParticle(const QPointF &pos, const KoColor &color, qreal opacity);
+
+    /**
+     * Adds a single pixel splat
+     */
+    void addPixel(const QPoint &pos, const KoColor &color, quint8 opacity);
+
+    /**
+     * Adds a line of width \p width. The result is the same as the one of
+     * KisPainter::drawLine(start, end, width, antialias) with the same color,
+     * opacity and composite op. That includes the antialiased edge pixels,
+     * which drawLine() composites with a fully transparent color.
+     */
+    void addLine(const QPointF &start, const QPointF &end, qreal width, bool antialias, const KoColor &color, quint8 opacity);
+
+    bool isEmpty() const;
+
+    /**
+     * \return the rect covered by the splats added since the last call
+     * to rasterize()
+     */
+    QRect bounds() const;
+
+    /**
+     * Writes all the collected splats into \p dev and resets the
+     * rasterizer. The device must be in the color space passed to the
+     * constructor.
+     */
+    void rasterize(KisPaintDeviceSP dev);
+
+    /**
+     * Drops all the collected splats without rendering them
+     */
+    void clear();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISPARTICLERASTERIZER_H
@@ -0,0 +1,212 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_particle_rasterizer_test.h"
+
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <kis_random_accessor_ng.h>
+#include <KisParticleRasterizer.h>
+
+#include <random>
+
+Q_DECLARE_METATYPE(KisParticleRasterizer::Mode)
+
+namespace {
+
+struct Splat {
+    QPoint pos;
+    KoColor color;
+    quint8 opacity;
+};
+
+/**
+ * The per-pixel reference implementation, the way the engines
+ * wrote their particles before the rasterizer was introduced
+ */
+void referenceSplat(KisRandomAccessorSP it, KisParticleRasterizer::Mode mode, const Splat &splat)
+{
+    const KoColorSpace *cs = splat.color.colorSpace();
+    it->moveTo(splat.pos.x(), splat.pos.y());
+
+    switch (mode) {
+    case KisParticleRasterizer::Overwrite:
+        memcpy(it->rawData(), splat.color.data(), cs->pixelSize());
+        cs->setOpacity(it->rawData(), splat.opacity, 1);
+        break;
+    case KisParticleRasterizer::AccumulateOpacity: {
+        const quint8 opacity = quint8(qMin(splat.opacity + cs->opacityU8(it->rawData()), int(OPACITY_OPAQUE_U8)));
+        memcpy(it->rawData(), splat.color.data(), cs->pixelSize());
+        cs->setOpacity(it->rawData(), opacity, 1);
+        break;
+    }
+    case KisParticleRasterizer::Darken:
+        if (cs->opacityU8(it->rawData()) < splat.opacity) {
+            memcpy(it->rawData(), splat.color.data(), cs->pixelSize());
+            cs->setOpacity(it->rawData(), splat.opacity, 1);
+        }
+        break;
+    case KisParticleRasterizer::Composite:
+        cs->compositeOp(COMPOSITE_OVER)->composite(it->rawData(), cs->pixelSize(),
+                                                   splat.color.data(), cs->pixelSize(),
+                                                   0, 0, 1, 1, splat.opacity);
+        break;
+    }
+}
+
+bool compareDevices(KisPaintDeviceSP dev1, KisPaintDeviceSP dev2)
+{
+    const QRect rc = dev1->exactBounds() | dev2->exactBounds();
+    if (rc.isEmpty()) return true;
+
+    QByteArray data1(rc.width() * rc.height() * dev1->pixelSize(), 0);
+    QByteArray data2(rc.width() * rc.height() * dev2->pixelSize(), 0);
+
+    dev1->readBytes(reinterpret_cast<quint8*>(data1.data()), rc);
+    dev2->readBytes(reinterpret_cast<quint8*>(data2.data()), rc);
+
+    return data1 == data2;
+}
+
+}
+
+void KisParticleRasterizerTest::testParticles_data()
+{
+    QTest::addColumn<KisParticleRasterizer::Mode>("mode");
+
+    QTest::newRow("overwrite") << KisParticleRasterizer::Overwrite;
+    QTest::newRow("accumulate") << KisParticleRasterizer::AccumulateOpacity;
+    QTest::newRow("darken") << KisParticleRasterizer::Darken;
+    QTest::newRow("composite") << KisParticleRasterizer::Composite;
+}
+
+void KisParticleRasterizerTest::testParticles()
+{
+    QFETCH(KisParticleRasterizer::Mode, mode);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    // the particles cross the tile borders and the origin
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<qreal> posDistribution(-100.0, 100.0);
+    std::uniform_int_distribution<int> opacityDistribution(0, 255);
+
+    const KoColor colors[] = {
+        KoColor(Qt::red, cs),
+        KoColor(Qt::blue, cs)
+    };
+
+    KisParticleRasterizer rasterizer(cs, mode, cs->compositeOp(COMPOSITE_OVER));
+    KisRandomAccessorSP it = refDev->createRandomAccessorNG();
+
+    for (int i = 0; i < 5000; i++) {
+        const QPointF pos(posDistribution(generator), posDistribution(generator));
+        const KoColor &color = colors[(i / 7) % 2];
+        const quint8 opacity = opacityDistribution(generator);
+
+        if (i % 3) {
+            rasterizer.addParticle(pos, color, opacity);
+
+            const int ipx = qFloor(pos.x());
+            const int ipy = qFloor(pos.y());
+            const qreal fx = pos.x() - ipx;
+            const qreal fy = pos.y() - ipy;
+
+            referenceSplat(it, mode, {QPoint(ipx, ipy), color, quint8(qRound((1.0 - fx) * (1.0 - fy) * opacity))});
+            referenceSplat(it, mode, {QPoint(ipx + 1, ipy), color, quint8(qRound(fx * (1.0 - fy) * opacity))});
+            referenceSplat(it, mode, {QPoint(ipx, ipy + 1), color, quint8(qRound((1.0 - fx) * fy * opacity))});
+            referenceSplat(it, mode, {QPoint(ipx + 1, ipy + 1), color, quint8(qRound(fx * fy * opacity))});
+        } else {
+            const QPoint pt = pos.toPoint();
+            rasterizer.addPixel(pt, color, opacity);
+            referenceSplat(it, mode, {pt, color, opacity});
+        }
+    }
+
+    QVERIFY(rasterizer.bounds().contains(refDev->exactBounds()));
+
+    rasterizer.rasterize(dev);
+    QVERIFY(rasterizer.isEmpty());
+
+    QVERIFY(compareDevices(dev, refDev));
+}
+
+void KisParticleRasterizerTest::testLine_data()
+{
+    QTest::addColumn<QString>("compositeOpId");
+    QTest::addColumn<int>("opacity");
+    QTest::addColumn<bool>("antialias");
+
+    QTest::newRow("over") << COMPOSITE_OVER << int(OPACITY_OPAQUE_U8) << true;
+    QTest::newRow("over-translucent") << COMPOSITE_OVER << 128 << true;
+    QTest::newRow("over-aliased") << COMPOSITE_OVER << 128 << false;
+    QTest::newRow("copy") << COMPOSITE_COPY << 200 << true;
+}
+
+void KisParticleRasterizerTest::testLine()
+{
+    QFETCH(QString, compositeOpId);
+    QFETCH(int, opacity);
+    QFETCH(bool, antialias);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColor color(Qt::red, cs);
+    const KoColor background(Qt::blue, cs);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+
+    const QRect fillRect(0, 0, 150, 60);
+    dev->fill(fillRect, background);
+    refDev->fill(fillRect, background);
+
+    KisPainter gc(refDev);
+    gc.setPaintColor(color);
+    gc.setOpacity(opacity);
+    gc.setCompositeOp(compositeOpId);
+
+    KisParticleRasterizer rasterizer(cs, KisParticleRasterizer::Composite, cs->compositeOp(compositeOpId));
+
+    // the lines cross two tiles and overlap each other
+    const QVector<QPair<QPointF, QPointF>> lines = {
+        {QPointF(10.5, 10.5), QPointF(110.5, 30.5)},
+        {QPointF(100.3, 5.7), QPointF(20.9, 50.2)},
+        {QPointF(70.1, 45.4), QPointF(71.6, 2.8)}
+    };
+
+    for (const auto &line : lines) {
+        gc.drawLine(line.first, line.second, 4.0, antialias);
+        rasterizer.addLine(line.first, line.second, 4.0, antialias, color, quint8(opacity));
+    }
+
+    rasterizer.rasterize(dev);
+
+    QVERIFY(compareDevices(dev, refDev));
+}
+
+QTEST_MAIN(KisParticleRasterizerTest)
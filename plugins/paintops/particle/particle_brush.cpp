@@ -19,7 +19,7 @@
 #include "particle_brush.h"
 
 #include "kis_paint_device.h"
-#include "kis_random_accessor_ng.h"
+#include <KisParticleRasterizer.h>
 
 #include <KoColorSpace.h>
 #include <KoColor.h>
@@ -31,10 +31,12 @@ const qreal TIME = 0.000030;
 ParticleBrush::ParticleBrush()
 {
     m_properties = 0;
+    m_particleRasterizer = 0;
 }
 
 ParticleBrush::~ParticleBrush()
 {
+    delete m_particleRasterizer;
 }
 
 
@@ -55,37 +57,10 @@ void ParticleBrush::setInitialPosition(const QPointF &pos)
 }
 
 
-void ParticleBrush::paintParticle(KisRandomAccessorSP accWrite, const KoColorSpace * cs, const QPointF &pos, const KoColor& color, qreal weight, bool respectOpacity)
+void ParticleBrush::paintParticle(const QPointF &pos, const KoColor& color, qreal weight, bool respectOpacity)
 {
-    // opacity top left, right, bottom left, right
-    KoColor myColor(color);
-    quint8 opacity = respectOpacity ? myColor.opacityU8() : OPACITY_OPAQUE_U8;
-
-    int ipx = floor(pos.x());
-    int ipy = floor(pos.y());
-    qreal fx = pos.x() - ipx;
-    qreal fy = pos.y() - ipy;
-
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity * weight);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity * weight);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity * weight);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity * weight);
-
-    accWrite->moveTo(ipx  , ipy);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
-
-    accWrite->moveTo(ipx + 1, ipy);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
-
-    accWrite->moveTo(ipx, ipy + 1);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
-
-    accWrite->moveTo(ipx + 1, ipy + 1);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
+    quint8 opacity = respectOpacity ? color.opacityU8() : OPACITY_OPAQUE_U8;
+    m_particleRasterizer->addParticle(pos, color, opacity * weight);
 }
 
 
@@ -93,8 +68,9 @@ void ParticleBrush::paintParticle(KisRandomAccessorSP accWrite, const KoColorSpa
 
 void ParticleBrush::draw(KisPaintDeviceSP dab, const KoColor& color, const QPointF &pos)
 {
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG();
-    const KoColorSpace * cs = dab->colorSpace();
+    if (!m_particleRasterizer) {
+        m_particleRasterizer = new KisParticleRasterizer(dab->colorSpace(), KisParticleRasterizer::AccumulateOpacity);
+    }
 
     QRect boundingRect;
 
@@ -152,11 +128,13 @@ void ParticleBrush::draw(KisPaintDeviceSP dab, const KoColor& color, const QPoin
             bool inside = boundingRect.contains(m_particlePos[j].toPoint());
 
             if (boundingRect.isEmpty() || (inside && !nearInfinity)) {
-                paintParticle(accessor, cs, m_particlePos[j], color, m_properties->weight, true);
+                paintParticle(m_particlePos[j], color, m_properties->weight, true);
             }
 
         }//for j
     }//for i
+
+    m_particleRasterizer->rasterize(dab);
 }
 
 
@@ -25,6 +25,7 @@
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
+#include <KoCompositeOpRegistry.h>
 
 #include <kis_image.h>
 #include <kis_debug.h>
@@ -40,6 +41,7 @@
 
 #include <kis_pressure_opacity_option.h>
 #include <kis_dab_cache.h>
+#include <KisParticleRasterizer.h>
 #include "kis_lod_transform.h"
 
 
@@ -89,12 +91,14 @@ KisSketchPaintOp::KisSketchPaintOp(const KisPaintOpSettingsSP settings, KisPaint
     m_rateOption.resetAllSensors();
 
     m_painter = 0;
+    m_particleRasterizer = 0;
     m_count = 0;
 }
 
 KisSketchPaintOp::~KisSketchPaintOp()
 {
     delete m_painter;
+    delete m_particleRasterizer;
     delete m_dabCache;
 }
 
@@ -106,11 +110,17 @@ QList<KoResourceSP> KisSketchPaintOp::prepareLinkedResources(const KisPaintOpSet
 
 void KisSketchPaintOp::drawConnection(const QPointF& start, const QPointF& end, double lineWidth)
 {
+    /**
+     * The line width is the same for all the connections of one
+     * doPaintLine() call, so the lines drawn by the painter and the
+     * ones collected by the rasterizer never overlap in order
+     */
     if (lineWidth == 1.0) {
         m_painter->drawThickLine(start, end, lineWidth, lineWidth);
     }
     else {
-        m_painter->drawLine(start, end, lineWidth, true);
+        m_particleRasterizer->addLine(start, end, lineWidth, true,
+                                      m_painter->paintColor(), m_painter->opacity());
     }
 }
 
@@ -149,6 +159,9 @@ void KisSketchPaintOp::doPaintLine(const KisPaintInformation &pi1, const KisPain
         m_dab = source()->createCompositionSourceDevice();
         m_painter = new KisPainter(m_dab);
         m_painter->setPaintColor(painter()->paintColor());
+        m_particleRasterizer = new KisParticleRasterizer(m_dab->colorSpace(),
+                                                         KisParticleRasterizer::Composite,
+                                                         m_dab->colorSpace()->compositeOp(COMPOSITE_OVER));
     }
     else {
         m_dab->clear();
@@ -302,6 +315,8 @@ void KisSketchPaintOp::doPaintLine(const KisPaintInformation &pi1, const KisPain
 
     m_count++;
 
+    m_particleRasterizer->rasterize(m_dab);
+
     QRect rc = m_dab->extent();
     quint8 origOpacity = m_opacityOption.apply(painter(), pi2);
 
@@ -36,6 +36,7 @@
 #include "kis_offset_scale_option.h"
 
 class KisDabCache;
+class KisParticleRasterizer;
 
 
 class KisSketchPaintOp : public KisPaintOp
@@ -84,6 +85,7 @@ private:
     QVector<QPointF> m_points;
     int m_count;
     KisPainter * m_painter;
+    KisParticleRasterizer *m_particleRasterizer;
     KisBrushSP m_brush;
     KisDabCache *m_dabCache;
 
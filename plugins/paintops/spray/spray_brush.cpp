@@ -40,6 +40,7 @@
 #include <brushengine/kis_paint_information.h>
 #include <kis_fixed_paint_device.h>
 #include <kis_cross_device_color_picker.h>
+#include <KisParticleRasterizer.h>
 
 #include "kis_spray_paintop_settings.h"
 
@@ -52,12 +53,14 @@ SprayBrush::SprayBrush()
 {
     m_painter = 0;
     m_transfo = 0;
+    m_particleRasterizer = 0;
 }
 
 SprayBrush::~SprayBrush()
 {
     delete m_painter;
     delete m_transfo;
+    delete m_particleRasterizer;
 }
 
 void SprayBrush::setProperties(KisSprayOptionProperties * properties,
@@ -128,13 +131,12 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             m_brushQImage = m_brushQImage.scaled(m_shapeProperties->width, m_shapeProperties->height);
         }
         m_imageDevice = new KisPaintDevice(dab->colorSpace());
+        m_particleRasterizer = new KisParticleRasterizer(dab->colorSpace(), KisParticleRasterizer::Overwrite);
     }
 
 
     qreal x = info.pos().x();
     qreal y = info.pos().y();
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG();
-
     Q_ASSERT(color.colorSpace()->pixelSize() == dab->pixelSize());
     m_inkColor = color;
     KisCrossDeviceColorPicker colorPicker(source, m_inkColor);
@@ -291,15 +293,14 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             }
             // wu-particle
             case 2: {
-                paintParticle(accessor, m_inkColor, nx + x, ny + y);
+                paintParticle(m_inkColor, nx + x, ny + y);
                 break;
             }
             // pixel
             case 3: {
                 ix = qRound(nx + x);
                 iy = qRound(ny + y);
-                accessor->moveTo(ix, iy);
-                memcpy(accessor->rawData(), m_inkColor.data(), m_dabPixelSize);
+                m_particleRasterizer->addPixel(QPoint(ix, iy), m_inkColor, m_inkColor.opacityU8());
                 break;
             }
             case 4: {
@@ -374,47 +375,23 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             m_inkColor=color;//reset color//
         }
     }
+
+    // particles and pixels are only collected in the loop above,
+    // write them into the dab in one go
+    m_particleRasterizer->rasterize(dab);
+
     // recover from jittering of color,
     // m_inkColor.opacity is recovered with every paint
 }
 
 
 
-void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry)
+void SprayBrush::paintParticle(const KoColor &color, qreal rx, qreal ry)
 {
-    // opacity top left, right, bottom left, right
-    KoColor pcolor(color);
-    //int opacity = pcolor.opacityU8();
-
-    int ipx = int (rx);
-    int ipy = int (ry);
-    qreal fx = rx - ipx;
-    qreal fy = ry - ipy;
-
-    qreal btl = (1 - fx) * (1 - fy);
-    qreal btr = (fx)  * (1 - fy);
-    qreal bbl = (1 - fx) * (fy);
-    qreal bbr = (fx)  * (fy);
-
     // this version overwrite pixels, e.g. when it sprays two particle next
     // to each other, the pixel with lower opacity can override other pixel.
     // Maybe some kind of compositing using here would be cool
-
-    pcolor.setOpacity(btl);
-    writeAccessor->moveTo(ipx  , ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(btr);
-    writeAccessor->moveTo(ipx + 1, ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(bbl);
-    writeAccessor->moveTo(ipx, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
-
-    pcolor.setOpacity(bbr);
-    writeAccessor->moveTo(ipx + 1, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    m_particleRasterizer->addParticle(QPointF(rx, ry), color, OPACITY_OPAQUE_U8);
 }
 
 void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius)
@@ -42,6 +42,9 @@
 //#include "kis_random_accessor_ng.h"
 
 #include <QList>
+#include <QVector>
+#include <QtConcurrent>
+#include <KoUpdater.h>
 #include <kis_transform_worker.h>
 #include <kis_filter_strategy.h>
 #include "KoColor.h"
@@ -56,8 +59,45 @@ const int MAX_DIST = 65535;
 const quint8 MASK_SET = 255;
 const quint8 MASK_CLEAR = 0;
 
+/**
+ * Reports the progress of the current pyramid level, from 0.0 to 1.0.
+ * Returns false if the operation has been cancelled.
+ */
+typedef std::function<bool (qreal)> LevelProgressCallback;
+
 class MaskedImage; //forward decl for the forward decl below
-template <typename T> float distance_impl(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo);
+template <typename T, int channels> float distance_impl(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo, int count, float maskedDistance);
+
+/**
+ * Splits the rows of an image into chunks and calls
+ * func(firstRow, lastRow, random) for every chunk concurrently.
+ *
+ * Every chunk gets its own random generator seeded from \p seed and
+ * the index of the chunk, so the result doesn't depend on the number
+ * of threads.
+ */
+template <typename Func>
+void processRowsConcurrently(int height, quint32 seed, Func func)
+{
+    struct Chunk {
+        int firstRow;
+        int lastRow;
+        quint32 seed;
+    };
+
+    const int rowsPerChunk = 16;
+
+    QVector<Chunk> chunks;
+    for (int y = 0; y < height; y += rowsPerChunk) {
+        chunks.append({y, std::min(y + rowsPerChunk, height) - 1, seed + quint32(chunks.size())});
+    }
+
+    QtConcurrent::blockingMap(chunks,
+        [&func] (const Chunk &chunk) {
+            std::mt19937 random(chunk.seed);
+            func(chunk.firstRow, chunk.lastRow, random);
+        });
+}
 
 
 class ImageView
@@ -211,7 +251,7 @@ class MaskedImage : public KisShared
 {
 private:
 
-    template <typename T> friend float distance_impl(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo);
+    template <typename T, int channels> friend float distance_impl(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo, int count, float maskedDistance);
 
     QRect imageSize;
     int nChannels;
@@ -222,6 +262,34 @@ private:
     ImageData maskData;
     ImageData imageData;
 
+    /**
+     * Summed area table of the masked pixels. It makes containsMasked()
+     * constant time, which is important, because every pyramid level is
+     * queried for every pixel in every EM iteration.
+     */
+    QVector<int> maskIntegral;
+
+    void updateMaskIntegral()
+    {
+        const int W = imageSize.width();
+        const int H = imageSize.height();
+
+        maskIntegral.resize((W + 1) * (H + 1));
+        std::fill(maskIntegral.begin(), maskIntegral.begin() + W + 1, 0);
+
+        for (int y = 0; y < H; ++y) {
+            int rowSum = 0;
+            int *row = maskIntegral.data() + (y + 1) * (W + 1);
+            const int *prevRow = row - (W + 1);
+
+            row[0] = 0;
+            for (int x = 0; x < W; ++x) {
+                rowSum += isMasked(x, y);
+                row[x + 1] = prevRow[x + 1] + rowSum;
+            }
+        }
+    }
+
 
     void cacheImage(KisPaintDeviceSP imageDev, QRect rect)
     {
@@ -243,12 +311,20 @@ private:
         std::for_each(maskData.data(), maskData.data() + maskData.num_bytes(), [](quint8 & v) {
             v = (v > MASK_CLEAR) ? MASK_SET : MASK_CLEAR;
         });
+
+        updateMaskIntegral();
     }
 
     MaskedImage() {}
 
 public:
-    std::function< float(const MaskedImage&, int, int, const MaskedImage& , int , int ) > distance;
+    /**
+     * Distance between \p count consecutive pixels of a row of this image
+     * starting at (x, y) and the pixels of a row of \p other starting at
+     * (xo, yo). Every pair having a masked pixel costs \p maskedDistance.
+     */
+    typedef float (*DistanceFunc)(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo, int count, float maskedDistance);
+    DistanceFunc distance;
 
     void toPaintDevice(KisPaintDeviceSP imageDev, QRect rect)
     {
@@ -264,6 +340,7 @@ public:
     void clearMask(void)
     {
         std::fill(maskData.data(), maskData.data() + maskData.num_bytes(), MASK_CLEAR);
+        updateMaskIntegral();
     }
 
     void initialize(KisPaintDeviceSP _imageDev, KisPaintDeviceSP _maskDev, QRect _maskRect)
@@ -276,19 +353,23 @@ public:
         KoID colorDepthId =  _imageDev->colorSpace()->colorDepthId();
 
         //Use RGB traits to assign actual pixel data types.
-        distance = &distance_impl<KoRgbU8Traits::channels_type>;
+        //The channel count is fixed for the RGBA case, so that the
+        //compiler can vectorize the inner loop
+        const bool isRgba = nChannels == 4;
+
+        distance = isRgba ? &distance_impl<KoRgbU8Traits::channels_type, 4> : &distance_impl<KoRgbU8Traits::channels_type, 0>;
 
         if( colorDepthId == Integer16BitsColorDepthID )
-            distance = &distance_impl<KoRgbU16Traits::channels_type>;
+            distance = isRgba ? &distance_impl<KoRgbU16Traits::channels_type, 4> : &distance_impl<KoRgbU16Traits::channels_type, 0>;
 #ifdef HAVE_OPENEXR
         if( colorDepthId == Float16BitsColorDepthID )
-            distance = &distance_impl<KoRgbF16Traits::channels_type>;
+            distance = isRgba ? &distance_impl<KoRgbF16Traits::channels_type, 4> : &distance_impl<KoRgbF16Traits::channels_type, 0>;
 #endif
         if( colorDepthId == Float32BitsColorDepthID )
-            distance = &distance_impl<KoRgbF32Traits::channels_type>;
+            distance = isRgba ? &distance_impl<KoRgbF32Traits::channels_type, 4> : &distance_impl<KoRgbF32Traits::channels_type, 0>;
 
         if( colorDepthId == Float64BitsColorDepthID )
-            distance = &distance_impl<KoRgbF64Traits::channels_type>;
+            distance = isRgba ? &distance_impl<KoRgbF64Traits::channels_type, 4> : &distance_impl<KoRgbF64Traits::channels_type, 0>;
     }
 
     MaskedImage(KisPaintDeviceSP _imageDev, KisPaintDeviceSP _maskDev, QRect _maskRect)
@@ -296,7 +377,8 @@ public:
         initialize(_imageDev, _maskDev, _maskRect);
     }
 
-    void downsample2x(void)
+    //the pyramid levels are built from each other without copying the full-size images
+    KisSharedPtr<MaskedImage> downsampled2x(void) const
     {
         int H = imageSize.height();
         int W = imageSize.width();
@@ -321,19 +403,28 @@ public:
 
         imageDev->readBytes(newImage.data(), 0, 0, newW, newH);
         maskDev->readBytes(newMask.data(), 0, 0, newW, newH);
-        imageData = std::move(newImage);
-        maskData = std::move(newMask);
 
-        for (int i = 0; i < imageData.num_elements(); ++i) {
-            quint8* maskPix = maskData.data() + i * maskData.pixel_size();
+        KisSharedPtr<MaskedImage> result = new MaskedImage();
+        result->nChannels = nChannels;
+        result->cs = cs;
+        result->csMask = csMask;
+        result->distance = distance;
+        result->imageData = std::move(newImage);
+        result->maskData = std::move(newMask);
+
+        for (int i = 0; i < result->imageData.num_elements(); ++i) {
+            quint8* maskPix = result->maskData.data() + i * result->maskData.pixel_size();
             if (*maskPix == MASK_SET) {
-                for (int k = 0; k < imageData.pixel_size(); k++)
-                    *(imageData.data() + i * imageData.pixel_size() + k) = 0;
+                for (int k = 0; k < result->imageData.pixel_size(); k++)
+                    *(result->imageData.data() + i * result->imageData.pixel_size() + k) = 0;
             } else {
                 *maskPix = MASK_CLEAR;
             }
         }
-        imageSize = QRect(0, 0, newW, newH);
+        result->imageSize = QRect(0, 0, newW, newH);
+        result->updateMaskIntegral();
+
+        return result;
     }
 
     void upscale(int newW, int newH)
@@ -368,9 +459,10 @@ public:
         imageData = std::move(newImage);
         maskData = std::move(newMask);
         imageSize = QRect(0, 0, newW, newH);
+        updateMaskIntegral();
     }
 
-    QRect size()
+    QRect size() const
     {
         return imageSize;
     }
@@ -385,6 +477,7 @@ public:
         clone->cs = this->cs;
         clone->csMask = this->csMask;
         clone->distance = this->distance;
+        clone->maskIntegral = this->maskIntegral;
         return clone;
     }
 
@@ -396,28 +489,27 @@ public:
         return count;
     }
 
-    inline bool isMasked(int x, int y)
+    inline bool isMasked(int x, int y) const
     {
         return (*maskData(x, y) > MASK_CLEAR);
     }
 
     //returns true if the patch contains a masked pixel
-    bool containsMasked(int x, int y, int S)
+    bool containsMasked(int x, int y, int S) const
     {
-        for (int dy = -S; dy <= S; ++dy) {
-            int ys = y + dy;
-            if (ys < 0 || ys >= imageSize.height())
-                continue;
+        const int W = imageSize.width();
 
-            for (int dx = -S; dx <= S; ++dx) {
-                int xs = x + dx;
-                if (xs < 0 || xs >= imageSize.width())
-                    continue;
-                if (isMasked(xs, ys))
-                    return true;
-            }
-        }
-        return false;
+        const int left = std::max(0, x - S);
+        const int top = std::max(0, y - S);
+        const int right = std::min(W, x + S + 1);
+        const int bottom = std::min(imageSize.height(), y + S + 1);
+
+        if (left >= right || top >= bottom) return false;
+
+        const int *integral = maskIntegral.constData();
+
+        return integral[bottom * (W + 1) + right] - integral[top * (W + 1) + right] -
+               integral[bottom * (W + 1) + left] + integral[top * (W + 1) + left] > 0;
     }
 
     inline quint8 getImagePixelU8(int x, int y, int chan) const
@@ -432,7 +524,7 @@ public:
         return v;
     }
 
-    inline quint8* getImagePixel(int x, int y)
+    inline quint8* getImagePixel(int x, int y) const
     {
         return imageData(x, y);
     }
@@ -442,7 +534,7 @@ public:
         cs->fromNormalisedChannelsValue(imageData(x, y), value);
     }
 
-    inline void mixColors(std::vector< quint8* > pixels, std::vector< float > w, float wsum,  quint8* dst)
+    inline void mixColors(const std::vector< quint8* > &pixels, const std::vector< float > &w, float wsum,  quint8* dst) const
     {
         const KoMixColorsOp* mixOp = cs->mixColorsOp();
 
@@ -466,10 +558,6 @@ public:
         mixOp->mixColors(pixels.data(), weights.data(), n, dst);
     }
 
-    inline void setMask(int x, int y, quint8 v)
-    {
-        *(maskData(x, y)) = v;
-    }
 
     inline int channelCount(void) const
     {
@@ -480,19 +568,38 @@ public:
 
 //Generic version of the distance function. produces distance between colors in the range [0, MAX_DIST]. This
 //is a fast distance computation. More accurate, but very slow implementation is to use color space operations.
-template <typename T> float distance_impl(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo)
+//
+//The function processes a whole row of the patch at once: the pixels are plain arrays, the mask is checked
+//without branches and with \p channels known at compile time the inner loop is vectorized by the compiler.
+template <typename T, int channels> float distance_impl(const MaskedImage& my, int x, int y, const MaskedImage& other, int xo, int yo, int count, float maskedDistance)
 {
-    float dsq = 0;
-    quint32 nchannels = my.channelCount();
-    quint8* v1 = my.imageData(x, y);
-    quint8* v2 = other.imageData(xo, yo);
+    const int nchannels = channels > 0 ? channels : my.channelCount();
+    const T* v1 = reinterpret_cast<const T*>(my.imageData(x, y));
+    const T* v2 = reinterpret_cast<const T*>(other.imageData(xo, yo));
+    const quint8* m1 = my.maskData(x, y);
+    const quint8* m2 = other.maskData(xo, yo);
+
+    const float scale = MAX_DIST / ((float)KoColorSpaceMathsTraits<T>::unitValue * (float)KoColorSpaceMathsTraits<T>::unitValue);
 
-    for (quint32 chan = 0; chan < nchannels; chan++) {
-        //It's very important not to lose precision in the next line
-        float v = ((float)(*((T*)v1 + chan)) - (float)(*((T*)v2 + chan)));
-        dsq += v * v;
+    float result = 0;
+
+    for (int i = 0; i < count; i++) {
+        float dsq = 0;
+
+        for (int chan = 0; chan < nchannels; chan++) {
+            //It's very important not to lose precision in the next line
+            float v = (float)v1[chan] - (float)v2[chan];
+            dsq += v * v;
+        }
+
+        //cannot use masked pixels as a valid source of information
+        result += (m1[i] | m2[i]) ? maskedDistance : dsq * scale;
+
+        v1 += nchannels;
+        v2 += nchannels;
     }
-    return dsq / ( (float)KoColorSpaceMathsTraits<T>::unitValue * (float)KoColorSpaceMathsTraits<T>::unitValue / MAX_DIST );
+
+    return result;
 }
 
 
@@ -517,29 +624,32 @@ class NearestNeighborField : public KisShared
 {
 
 private:
-    template< typename T> T randomInt(T range)
+    template< typename T> T randomInt(std::mt19937 &random, T range)
     {
-        return rand() % range;
+        return random() % range;
     }
 
     //compute initial value of the distance term
-    void initialize(void)
+    void initialize(quint32 seed)
     {
-        for (int y = 0; y < imSize.height(); y++) {
-            for (int x = 0; x < imSize.width(); x++) {
-                field[x][y].distance = distance(x, y, field[x][y].x, field[x][y].y);
-
-                //if the distance is "infinity", try to find a better link
-                int iter = 0;
-                const int maxretry = 20;
-                while (field[x][y].distance == MAX_DIST && iter < maxretry) {
-                    field[x][y].x = randomInt(imSize.width() + 1);
-                    field[x][y].y = randomInt(imSize.height() + 1);
-                    field[x][y].distance = distance(x, y, field[x][y].x, field[x][y].y);
-                    iter++;
+        processRowsConcurrently(imSize.height(), seed,
+            [this] (int firstRow, int lastRow, std::mt19937 &random) {
+                for (int y = firstRow; y <= lastRow; y++) {
+                    for (int x = 0; x < imSize.width(); x++) {
+                        field[x][y].distance = distance(x, y, field[x][y].x, field[x][y].y);
+
+                        //if the distance is "infinity", try to find a better link
+                        int iter = 0;
+                        const int maxretry = 20;
+                        while (field[x][y].distance == MAX_DIST && iter < maxretry) {
+                            field[x][y].x = randomInt(random, imSize.width() + 1);
+                            field[x][y].y = randomInt(random, imSize.height() + 1);
+                            field[x][y].distance = distance(x, y, field[x][y].x, field[x][y].y);
+                            iter++;
+                        }
+                    }
                 }
-            }
-        }
+            });
     }
 
     void init_similarity_curve(void)
@@ -580,20 +690,23 @@ public:
         nColors = input->channelCount(); //only color count, doesn't include alpha channels
     }
 
-    void randomize(void)
+    void randomize(quint32 seed)
     {
-        for (int y = 0; y < imSize.height(); y++) {
-            for (int x = 0; x < imSize.width(); x++) {
-                field[x][y].x = randomInt(imSize.width() + 1);
-                field[x][y].y = randomInt(imSize.height() + 1);
-                field[x][y].distance = MAX_DIST;
-            }
-        }
-        initialize();
+        processRowsConcurrently(imSize.height(), seed,
+            [this] (int firstRow, int lastRow, std::mt19937 &random) {
+                for (int y = firstRow; y <= lastRow; y++) {
+                    for (int x = 0; x < imSize.width(); x++) {
+                        field[x][y].x = randomInt(random, imSize.width() + 1);
+                        field[x][y].y = randomInt(random, imSize.height() + 1);
+                        field[x][y].distance = MAX_DIST;
+                    }
+                }
+            });
+        initialize(seed + 1);
     }
 
     //initialize field from an existing (possibly smaller) nearest neighbor field
-    void initialize(const NearestNeighborField& nnf)
+    void initialize(const NearestNeighborField& nnf, quint32 seed)
     {
         float xscale = qreal(imSize.width()) / nnf.imSize.width();
         float yscale = qreal(imSize.height()) / nnf.imSize.height();
@@ -608,58 +721,65 @@ public:
                 field[x][y].distance = MAX_DIST;
             }
         }
-        initialize();
+        initialize(seed);
     }
 
-    //multi-pass NN-field minimization (see "PatchMatch" paper referenced above - page 4)
-    void minimize(int pass)
+    /**
+     * Multi-pass NN-field minimization (see "PatchMatch" paper referenced above - page 4)
+     *
+     * The original algorithm propagates the links in scanline and reverse
+     * scanline order, which cannot be parallelized. Here every pass updates
+     * the pixels in a checkerboard order instead: first all the "white"
+     * pixels, then all the "black" ones. All four neighbours of a pixel have
+     * the other color, so the pixels of one color can be processed
+     * concurrently, each of them propagating the links from all four
+     * neighbours.
+     */
+    void minimize(int pass, quint32 seed)
     {
-        int min_x = 0;
-        int min_y = 0;
-        int max_x = imSize.width() - 1;
-        int max_y = imSize.height() - 1;
-
         for (int i = 0; i < pass; i++) {
-            //scanline order
-            for (int y = min_y; y < max_y; y++)
-                for (int x = min_x; x <= max_x; x++)
-                    if (field[x][y].distance > 0)
-                        minimizeLink(x, y, 1);
-
-            //reverse scanline order
-            for (int y = max_y; y >= min_y; y--)
-                for (int x = max_x; x >= min_x; x--)
-                    if (field[x][y].distance > 0)
-                        minimizeLink(x, y, -1);
+            for (int parity = 0; parity < 2; parity++) {
+                processRowsConcurrently(imSize.height(), seed,
+                    [this, parity] (int firstRow, int lastRow, std::mt19937 &random) {
+                        for (int y = firstRow; y <= lastRow; y++) {
+                            for (int x = (y + parity) & 1; x < imSize.width(); x += 2) {
+                                if (field[x][y].distance > 0)
+                                    minimizeLink(x, y, random);
+                            }
+                        }
+                    });
+
+                seed += 0x10000;
+            }
         }
     }
 
-    void minimizeLink(int x, int y, int dir)
+    inline void tryLink(int x, int y, int xp, int yp)
     {
-        int xp, yp, dp;
+        int dp = distance(x, y, xp, yp);
+        if (dp < field[x][y].distance) {
+            field[x][y].x = xp;
+            field[x][y].y = yp;
+            field[x][y].distance = dp;
+        }
+    }
 
+    void minimizeLink(int x, int y, std::mt19937 &random)
+    {
         //Propagation Left/Right
-        if (x - dir > 0 && x - dir < imSize.width()) {
-            xp = field[x - dir][y].x + dir;
-            yp = field[x - dir][y].y;
-            dp = distance(x, y, xp, yp);
-            if (dp < field[x][y].distance) {
-                field[x][y].x = xp;
-                field[x][y].y = yp;
-                field[x][y].distance = dp;
-            }
+        if (x > 0) {
+            tryLink(x, y, field[x - 1][y].x + 1, field[x - 1][y].y);
+        }
+        if (x < imSize.width() - 1) {
+            tryLink(x, y, field[x + 1][y].x - 1, field[x + 1][y].y);
         }
 
         //Propagation Up/Down
-        if (y - dir > 0 && y - dir < imSize.height()) {
-            xp = field[x][y - dir].x;
-            yp = field[x][y - dir].y + dir;
-            dp = distance(x, y, xp, yp);
-            if (dp < field[x][y].distance) {
-                field[x][y].x = xp;
-                field[x][y].y = yp;
-                field[x][y].distance = dp;
-            }
+        if (y > 0) {
+            tryLink(x, y, field[x][y - 1].x, field[x][y - 1].y + 1);
+        }
+        if (y < imSize.height() - 1) {
+            tryLink(x, y, field[x][y + 1].x, field[x][y + 1].y - 1);
         }
 
         //Random search
@@ -667,79 +787,56 @@ public:
         int xpi = field[x][y].x;
         int ypi = field[x][y].y;
         while (wi > 0) {
-            xp = xpi + randomInt(2 * wi) - wi;
-            yp = ypi + randomInt(2 * wi) - wi;
+            int xp = xpi + randomInt(random, 2 * wi) - wi;
+            int yp = ypi + randomInt(random, 2 * wi) - wi;
             xp = std::max(0, std::min(output->size().width() - 1, xp));
             yp = std::max(0, std::min(output->size().height() - 1, yp));
 
-            dp = distance(x, y, xp, yp);
-            if (dp < field[x][y].distance) {
-                field[x][y].x = xp;
-                field[x][y].y = yp;
-                field[x][y].distance = dp;
-            }
+            tryLink(x, y, xp, yp);
             wi /= 2;
         }
     }
 
     //compute distance between two patches
-    int distance(int x, int y, int xp, int yp)
+    int distance(int x, int y, int xp, int yp) const
     {
-        float distance = 0;
-        float wsum = 0;
-        float ssdmax = nColors * 255 * 255;
+        const int patchWidth = 2 * patchSize + 1;
+        const float ssdmax = nColors * 255 * 255;
+        const float wsum = ssdmax * patchWidth * patchWidth;
 
-        //for each pixel in the source patch
-        for (int dy = -patchSize; dy <= patchSize; dy++) {
-            for (int dx = -patchSize; dx <= patchSize; dx++) {
-                wsum += ssdmax;
-                int xks = x + dx;
-                int yks = y + dy;
-
-                if (xks < 0 || xks >= input->size().width()) {
-                    distance += ssdmax;
-                    continue;
-                }
+        const QRect inputSize = input->size();
+        const QRect outputSize = output->size();
 
-                if (yks < 0 || yks >= input->size().height()) {
-                    distance += ssdmax;
-                    continue;
-                }
-
-                //cannot use masked pixels as a valid source of information
-                if (input->isMasked(xks, yks)) {
-                    distance += ssdmax;
-                    continue;
-                }
+        // the part of the patch row lying inside both images,
+        // the pixels outside any of them cost ssdmax
+        const int dxMin = std::max(-patchSize, std::max(-x, -xp));
+        const int dxMax = std::min(patchSize, std::min(inputSize.width() - 1 - x, outputSize.width() - 1 - xp));
+        const int rowCount = std::max(0, dxMax - dxMin + 1);
 
-                //corresponding pixel in target patch
-                int xkt = xp + dx;
-                int ykt = yp + dy;
-                if (xkt < 0 || xkt >= output->size().width()) {
-                    distance += ssdmax;
-                    continue;
-                }
-                if (ykt < 0 || ykt >= output->size().height()) {
-                    distance += ssdmax;
-                    continue;
-                }
+        float distance = 0;
 
-                //cannot use masked pixels as a valid source of information
-                if (output->isMasked(xkt, ykt)) {
-                    distance += ssdmax;
-                    continue;
-                }
+        //for each row in the source patch
+        for (int dy = -patchSize; dy <= patchSize; dy++) {
+            int yks = y + dy;
+            int ykt = yp + dy;
 
-                //SSD distance between pixels
-                float ssd = input->distance(*input, xks, yks, *output, xkt, ykt);
-                distance += ssd;
+            if (!rowCount ||
+                yks < 0 || yks >= inputSize.height() ||
+                ykt < 0 || ykt >= outputSize.height()) {
 
+                distance += ssdmax * patchWidth;
+                continue;
             }
+
+            distance += ssdmax * (patchWidth - rowCount);
+
+            //SSD distance between pixels
+            distance += input->distance(*input, x + dxMin, yks, *output, xp + dxMin, ykt, rowCount, ssdmax);
         }
         return (int)(MAX_DIST * (distance / wsum));
     }
 
-    static MaskedImageSP ExpectationMaximization(KisSharedPtr<NearestNeighborField> TargetToSource, int level, int radius, QList<MaskedImageSP>& pyramid);
+    static MaskedImageSP ExpectationMaximization(KisSharedPtr<NearestNeighborField> TargetToSource, int level, int radius, QList<MaskedImageSP>& pyramid, quint32 seed, const LevelProgressCallback &reportProgress);
 
     static void ExpectationStep(KisSharedPtr<NearestNeighborField> nnf, MaskedImageSP source, MaskedImageSP target, bool upscale);
 
@@ -757,13 +854,18 @@ private:
     NearestNeighborFieldSP nnf_SourceToTarget;
     int radius;
     QList<MaskedImageSP> pyramid;
+    KoUpdater *progressUpdater;
+    std::function<bool ()> cancelRequested;
 
 
 public:
-    Inpaint(KisPaintDeviceSP dev, KisPaintDeviceSP devMask, int _radius, QRect maskRect)
+    Inpaint(KisPaintDeviceSP dev, KisPaintDeviceSP devMask, int _radius, QRect maskRect,
+            KoUpdater *_progressUpdater = 0, std::function<bool ()> _cancelRequested = std::function<bool ()>())
     : devCache(dev)
     , initial(new MaskedImage(dev, devMask, maskRect))
     , radius(_radius)
+    , progressUpdater(_progressUpdater)
+    , cancelRequested(_cancelRequested)
     {
     }
     MaskedImageSP patch(void);
@@ -772,9 +874,10 @@ public:
 
 
 
+//Returns null if the operation has been cancelled
 MaskedImageSP Inpaint::patch()
 {
-    MaskedImageSP source = initial->copy();
+    MaskedImageSP source = initial;
 
     pyramid.append(initial);
 
@@ -782,13 +885,20 @@ MaskedImageSP Inpaint::patch()
 
     //qDebug() << "countMasked: " <<  source->countMasked() << "\n";
     while ((size.width() > radius) && (size.height() > radius) && source->countMasked() > 0) {
-        source->downsample2x();
+        source = source->downsampled2x();
         //source->DebugDump("Pyramid");
         //qDebug() << "countMasked1: " <<  source->countMasked() << "\n";
-        pyramid.append(source->copy());
+        pyramid.append(source);
         size = source->size();
     }
     int maxlevel = pyramid.size();
+
+    // the work done on a level is proportional to its area
+    qint64 totalWork = 0;
+    for (int level = maxlevel - 1; level > 0; level--) {
+        totalWork += qint64(pyramid.at(level - 1)->size().width()) * pyramid.at(level - 1)->size().height();
+    }
+    qint64 doneWork = 0;
     //qDebug() << "MaxLevel: " <<  maxlevel << "\n";
 
     // The initial target is the same as the smallest source.
@@ -800,34 +910,59 @@ MaskedImageSP Inpaint::patch()
     for (int level = maxlevel - 1; level > 0; level--) {
         source = pyramid.at(level);
 
+        //fixed seeds make the result reproducible
+        const quint32 seed = quint32(level) << 24;
+
         if (level == maxlevel - 1) {
             //random initial guess
             nnf_TargetToSource = new NearestNeighborField(target, source, radius);
-            nnf_TargetToSource->randomize();
+            nnf_TargetToSource->randomize(seed);
         } else {
             // then, we use the rebuilt (upscaled) target
             // and reuse the previous NNF as initial guess
 
             NearestNeighborFieldSP new_nnf_rev = new NearestNeighborField(target, source, radius);
-            new_nnf_rev->initialize(*nnf_TargetToSource);
+            new_nnf_rev->initialize(*nnf_TargetToSource, seed);
             nnf_TargetToSource = new_nnf_rev;
         }
 
+        const qint64 levelWork = qint64(pyramid.at(level - 1)->size().width()) * pyramid.at(level - 1)->size().height();
+
+        auto reportProgress = [this, doneWork, levelWork, totalWork] (qreal levelProgress) {
+            if (progressUpdater) {
+                progressUpdater->setProgress(int(100 * (doneWork + levelProgress * levelWork) / totalWork));
+            }
+            return !cancelRequested || !cancelRequested();
+        };
+
         //Build an upscaled target by EM-like algorithm (see "PatchMatch" paper referenced above - page 6)
-        target = NearestNeighborField::ExpectationMaximization(nnf_TargetToSource, level, radius, pyramid);
+        target = NearestNeighborField::ExpectationMaximization(nnf_TargetToSource, level, radius, pyramid, seed, reportProgress);
         //target->DebugDump( "target" );
+
+        if (!target) return nullptr;
+
+        doneWork += levelWork;
     }
     return target;
 }
 
 
 //EM-Like algorithm (see "PatchMatch" - page 6)
-//Returns a float sized target image
-MaskedImageSP NearestNeighborField::ExpectationMaximization(NearestNeighborFieldSP nnf_TargetToSource, int level, int radius, QList<MaskedImageSP>& pyramid)
+//Returns a float sized target image or null if the operation has been cancelled
+MaskedImageSP NearestNeighborField::ExpectationMaximization(NearestNeighborFieldSP nnf_TargetToSource, int level, int radius, QList<MaskedImageSP>& pyramid, quint32 seed, const LevelProgressCallback &reportProgress)
 {
     int iterEM = std::min(2 * level, 4);
     int iterNNF = std::min(5, 1 + level);
 
+    // every EM iteration consists of iterNNF minimization passes and an expectation step
+    const int totalSteps = iterEM * (iterNNF + 1);
+    int doneSteps = 0;
+
+    auto completeStep = [&reportProgress, &doneSteps, totalSteps] () {
+        doneSteps++;
+        return !reportProgress || reportProgress(qreal(doneSteps) / totalSteps);
+    };
+
     MaskedImageSP source = nnf_TargetToSource->output;
     MaskedImageSP target = nnf_TargetToSource->input;
     MaskedImageSP newtarget = nullptr;
@@ -851,8 +986,13 @@ MaskedImageSP NearestNeighborField::ExpectationMaximization(NearestNeighborField
             }
         }
 
-        //minimize the NNF
-        nnf_TargetToSource->minimize(iterNNF);
+        //minimize the NNF, pass by pass, so that we could stop early
+        //(every pass uses two seeds, one per checkerboard color)
+        for (int pass = 0; pass < iterNNF; pass++) {
+            nnf_TargetToSource->minimize(1, seed + (quint32(emloop) << 20) + quint32(pass) * 0x20000);
+
+            if (!completeStep()) return nullptr;
+        }
 
         //Now we rebuild the target using best patches from source
         MaskedImageSP newsource = nullptr;
@@ -875,6 +1015,8 @@ MaskedImageSP NearestNeighborField::ExpectationMaximization(NearestNeighborField
 
         //EM_Step(newsource, newtarget, radius, upscaled);
         ExpectationStep(nnf_TargetToSource, newsource, newtarget, upscaled);
+
+        if (!completeStep()) return nullptr;
     }
 
     return newtarget;
@@ -895,74 +1037,78 @@ void NearestNeighborField::ExpectationStep(NearestNeighborFieldSP nnf, MaskedIma
     int H_source = source->size().height();
     int W_source = source->size().width();
 
-    std::vector< quint8* > pixels;
-    std::vector< float > weights;
-    pixels.reserve(R * R);
-    weights.reserve(R * R);
-    for (int x = 0 ; x < W_target ; ++x) {
-        for (int y = 0 ; y < H_target; ++y) {
-            float wsum = 0;
-            pixels.clear();
-            weights.clear();
-
-
-            if (!source->containsMasked(x, y, R + 4) /*&& upscale*/) {
-                //speedup computation by copying parts that are not masked.
-                pixels.push_back(source->getImagePixel(x, y));
-                weights.push_back(1.f);
-                target->mixColors(pixels, weights, 1.f, target->getImagePixel(x, y));
-            } else {
-                for (int dx = -R ; dx <= R; ++dx) {
-                    for (int dy = -R ; dy <= R ; ++dy) {
-                        // xpt,ypt = center pixel of the target patch
-                        int xpt = x + dx;
-                        int ypt = y + dy;
-
-                        int xst, yst;
-                        float w;
-
-                        if (!upscale) {
-                            if (xpt < 0 || xpt >= W_nnf || ypt < 0 || ypt >= H_nnf)
-                                continue;
-
-                            xst = nnf->field[xpt][ypt].x;
-                            yst = nnf->field[xpt][ypt].y;
-                            float dp = nnf->field[xpt][ypt].distance;
-                            // similarity measure between the two patches
-                            w = nnf->similarity[dp];
-
-                        } else {
-                            if (xpt < 0 || (xpt / 2) >= W_nnf || ypt < 0 || (ypt / 2) >= H_nnf)
-                                continue;
-                            xst = 2 * nnf->field[xpt / 2][ypt / 2].x + (xpt % 2);
-                            yst = 2 * nnf->field[xpt / 2][ypt / 2].y + (ypt % 2);
-                            float dp = nnf->field[xpt / 2][ypt / 2].distance;
-                            // similarity measure between the two patches
-                            w = nnf->similarity[dp];
+    //every target pixel is computed independently, so the rows are processed concurrently
+    processRowsConcurrently(H_target, 0,
+        [=] (int firstRow, int lastRow, std::mt19937 &) {
+            std::vector< quint8* > pixels;
+            std::vector< float > weights;
+            pixels.reserve(R * R);
+            weights.reserve(R * R);
+            for (int y = firstRow ; y <= lastRow; ++y) {
+                for (int x = 0 ; x < W_target ; ++x) {
+                    float wsum = 0;
+                    pixels.clear();
+                    weights.clear();
+
+
+                    if (!source->containsMasked(x, y, R + 4) /*&& upscale*/) {
+                        //speedup computation by copying parts that are not masked.
+                        pixels.push_back(source->getImagePixel(x, y));
+                        weights.push_back(1.f);
+                        target->mixColors(pixels, weights, 1.f, target->getImagePixel(x, y));
+                    } else {
+                        for (int dx = -R ; dx <= R; ++dx) {
+                            for (int dy = -R ; dy <= R ; ++dy) {
+                                // xpt,ypt = center pixel of the target patch
+                                int xpt = x + dx;
+                                int ypt = y + dy;
+
+                                int xst, yst;
+                                float w;
+
+                                if (!upscale) {
+                                    if (xpt < 0 || xpt >= W_nnf || ypt < 0 || ypt >= H_nnf)
+                                        continue;
+
+                                    xst = nnf->field[xpt][ypt].x;
+                                    yst = nnf->field[xpt][ypt].y;
+                                    float dp = nnf->field[xpt][ypt].distance;
+                                    // similarity measure between the two patches
+                                    w = nnf->similarity[dp];
+
+                                } else {
+                                    if (xpt < 0 || (xpt / 2) >= W_nnf || ypt < 0 || (ypt / 2) >= H_nnf)
+                                        continue;
+                                    xst = 2 * nnf->field[xpt / 2][ypt / 2].x + (xpt % 2);
+                                    yst = 2 * nnf->field[xpt / 2][ypt / 2].y + (ypt % 2);
+                                    float dp = nnf->field[xpt / 2][ypt / 2].distance;
+                                    // similarity measure between the two patches
+                                    w = nnf->similarity[dp];
+                                }
+
+                                int xs = xst - dx;
+                                int ys = yst - dy;
+
+                                if (xs < 0 || xs >= W_source || ys < 0 || ys >= H_source)
+                                    continue;
+
+                                if (source->isMasked(xs, ys))
+                                    continue;
+
+                                pixels.push_back(source->getImagePixel(xs, ys));
+                                weights.push_back(w);
+                                wsum += w;
+                            }
                         }
 
-                        int xs = xst - dx;
-                        int ys = yst - dy;
-
-                        if (xs < 0 || xs >= W_source || ys < 0 || ys >= H_source)
+                        if (wsum < 1)
                             continue;
 
-                        if (source->isMasked(xs, ys))
-                            continue;
-
-                        pixels.push_back(source->getImagePixel(xs, ys));
-                        weights.push_back(w);
-                        wsum += w;
+                        target->mixColors(pixels, weights, wsum, target->getImagePixel(x, y));
                     }
                 }
-
-                if (wsum < 1)
-                    continue;
-
-                target->mixColors(pixels, weights, wsum, target->getImagePixel(x, y));
             }
-        }
-    }
+        });
 }
 
 QRect getMaskBoundingBox(KisPaintDeviceSP maskDev)
@@ -972,7 +1118,8 @@ QRect getMaskBoundingBox(KisPaintDeviceSP maskDev)
 }
 
 
-QRect patchImage(const KisPaintDeviceSP imageDev, const KisPaintDeviceSP maskDev, int patchRadius, int accuracy)
+QRect patchImage(const KisPaintDeviceSP imageDev, const KisPaintDeviceSP maskDev, int patchRadius, int accuracy,
+                 KoUpdater *progressUpdater, std::function<bool ()> cancelRequested)
 {
     QRect maskRect = getMaskBoundingBox(maskDev);
     QRect imageRect = imageDev->exactBounds();
@@ -984,8 +1131,13 @@ QRect patchImage(const KisPaintDeviceSP imageDev, const KisPaintDeviceSP maskDev
     maskRect = maskRect.intersected(imageRect);
 
     if (!maskRect.isEmpty()) {
-        Inpaint inpaint(imageDev, maskDev, patchRadius, maskRect);
+        Inpaint inpaint(imageDev, maskDev, patchRadius, maskRect, progressUpdater, cancelRequested);
         MaskedImageSP output = inpaint.patch();
+
+        if (!output) {
+            return QRect();
+        }
+
         output->toPaintDevice(imageDev, maskRect);
     }
 
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_smart_patch_stroke_strategy.h"
+
+#include <QAtomicInt>
+
+#include <klocalizedstring.h>
+
+#include "kis_node.h"
+#include "kis_paint_device.h"
+#include "kis_transaction.h"
+#include "kis_processing_visitor.h"
+
+QRect patchImage(KisPaintDeviceSP imageDev, KisPaintDeviceSP maskDev, int radius, int accuracy,
+                 KoUpdater *progressUpdater, std::function<bool ()> cancelRequested);
+
+struct KisSmartPatchStrokeStrategy::Private
+{
+    KisNodeSP node;
+    KisPaintDeviceSP maskDev;
+    int accuracy = 50;
+    int patchRadius = 4;
+
+    QAtomicInt cancelRequested;
+};
+
+KisSmartPatchStrokeStrategy::KisSmartPatchStrokeStrategy(KisNodeSP node,
+                                                         KisPaintDeviceSP maskDev,
+                                                         int accuracy,
+                                                         int patchRadius,
+                                                         KisStrokeUndoFacade *undoFacade)
+    : KisStrokeStrategyUndoCommandBased(kundo2_i18n("Smart Patch"), false, undoFacade),
+      m_d(new Private)
+{
+    m_d->node = node;
+    m_d->maskDev = maskDev;
+    m_d->accuracy = accuracy;
+    m_d->patchRadius = patchRadius;
+
+    enableJob(KisSimpleStrokeStrategy::JOB_INIT, true,
+              KisStrokeJobData::BARRIER, KisStrokeJobData::EXCLUSIVE);
+    enableJob(KisSimpleStrokeStrategy::JOB_FINISH);
+    enableJob(KisSimpleStrokeStrategy::JOB_CANCEL);
+
+    /**
+     * The user may cancel the stroke while the init job is still
+     * running, we should revert its results in that case
+     */
+    setNeedsExplicitCancel(true);
+}
+
+KisSmartPatchStrokeStrategy::~KisSmartPatchStrokeStrategy()
+{
+}
+
+void KisSmartPatchStrokeStrategy::initStrokeCallback()
+{
+    KisStrokeStrategyUndoCommandBased::initStrokeCallback();
+
+    KisPaintDeviceSP imageDev = m_d->node->paintDevice();
+    KisTransaction transaction(name(), imageDev);
+
+    // the progress is shown by the progress bar of the node
+    KisProcessingVisitor::ProgressHelper helper(m_d->node);
+
+    const QRect patchedRect =
+        patchImage(imageDev, m_d->maskDev, m_d->patchRadius, m_d->accuracy, helper.updater(),
+                   [this] () { return bool(m_d->cancelRequested.loadAcquire()); });
+
+    if (patchedRect.isEmpty()) {
+        // cancelled or nothing to patch, the device hasn't been touched
+        transaction.revert();
+        return;
+    }
+
+    runAndSaveCommand(KUndo2CommandSP(transaction.endAndTake()),
+                      KisStrokeJobData::SEQUENTIAL,
+                      KisStrokeJobData::NORMAL);
+
+    m_d->node->setDirty(patchedRect);
+}
+
+void KisSmartPatchStrokeStrategy::tryCancelCurrentStrokeJobAsync()
+{
+    m_d->cancelRequested.storeRelease(1);
+}
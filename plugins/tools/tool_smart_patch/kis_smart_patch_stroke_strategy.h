@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2020 The Krita developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_SMART_PATCH_STROKE_STRATEGY_H
+#define __KIS_SMART_PATCH_STROKE_STRATEGY_H
+
+#include <QScopedPointer>
+
+#include "kis_stroke_strategy_undo_command_based.h"
+#include "kis_types.h"
+
+/**
+ * Inpaints the area of the node marked by the mask. The whole work is
+ * done by the init job, which checks whether the stroke has been
+ * cancelled between the steps of the algorithm. A cancelled stroke
+ * leaves the node untouched.
+ */
+class KisSmartPatchStrokeStrategy : public KisStrokeStrategyUndoCommandBased
+{
+public:
+    KisSmartPatchStrokeStrategy(KisNodeSP node,
+                                KisPaintDeviceSP maskDev,
+                                int accuracy,
+                                int patchRadius,
+                                KisStrokeUndoFacade *undoFacade);
+    ~KisSmartPatchStrokeStrategy() override;
+
+    void initStrokeCallback() override;
+    void tryCancelCurrentStrokeJobAsync() override;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_SMART_PATCH_STROKE_STRATEGY_H */
@@ -18,7 +18,6 @@
 
 #include "kis_tool_smart_patch.h"
 
-#include "QApplication"
 #include "QPainterPath"
 
 #include <klocalizedstring.h>
@@ -29,13 +28,8 @@
 #include "kis_painter.h"
 #include "kis_paintop_preset.h"
 
-#include "kundo2magicstring.h"
-#include "kundo2stack.h"
-#include "commands_new/kis_transaction_based_command.h"
-#include "kis_transaction.h"
-
-#include "kis_processing_applicator.h"
-#include "kis_datamanager.h"
+#include "kis_image.h"
+#include "kis_smart_patch_stroke_strategy.h"
 
 #include "KoColorSpaceRegistry.h"
 
@@ -45,24 +39,6 @@
 #include "kis_paint_layer.h"
 #include "kis_algebra_2d.h"
 
-QRect patchImage(KisPaintDeviceSP imageDev, KisPaintDeviceSP maskDev, int radius, int accuracy);
-
-class KisToolSmartPatch::InpaintCommand : public KisTransactionBasedCommand {
-public:
-    InpaintCommand( KisPaintDeviceSP maskDev, KisPaintDeviceSP imageDev, int accuracy, int patchRadius ) :
-        m_maskDev(maskDev), m_imageDev(imageDev), m_accuracy(accuracy), m_patchRadius(patchRadius) {}
-
-    KUndo2Command* paint() override {
-        KisTransaction transaction(m_imageDev);
-        patchImage(m_imageDev, m_maskDev, m_patchRadius, m_accuracy);
-        return transaction.endAndTake();
-    }
-
-private:
-    KisPaintDeviceSP m_maskDev, m_imageDev;
-    int m_accuracy, m_patchRadius;
-};
-
 struct KisToolSmartPatch::Private {
     KisPaintDeviceSP maskDev = nullptr;
     KisPainter maskDevPainter;
@@ -165,8 +141,6 @@ void KisToolSmartPatch::endPrimaryAction(KoPointerEvent *event)
     KisToolPaint::endPrimaryAction(event);
     setMode(KisTool::HOVER_MODE);
 
-    QApplication::setOverrideCursor(KisCursor::waitCursor());
-
     int accuracy = 50; //default accuracy - middle value
     int patchRadius = 4; //default radius, which works well for most cases tested
 
@@ -175,17 +149,15 @@ void KisToolSmartPatch::endPrimaryAction(KoPointerEvent *event)
         patchRadius = m_d->optionsWidget->getPatchRadius();
     }
 
-    KisProcessingApplicator applicator( image(), currentNode(), KisProcessingApplicator::NONE, KisImageSignalVector() << ModifiedSignal,
-                                        kundo2_i18n("Smart Patch"));
-
     //actual inpaint operation. filling in areas masked by user
-    applicator.applyCommand( new InpaintCommand( KisPainter::convertToAlphaAsAlpha(m_d->maskDev), currentNode()->paintDevice(), accuracy, patchRadius ),
-                             KisStrokeJobData::BARRIER, KisStrokeJobData::EXCLUSIVE );
+    //the stroke works on its own copy of the mask, so it runs asynchronously
+    KisStrokeStrategy *strategy =
+        new KisSmartPatchStrokeStrategy(currentNode(), KisPainter::convertToAlphaAsAlpha(m_d->maskDev),
+                                        accuracy, patchRadius, image().data());
 
-    applicator.end();
-    image()->waitForDone();
+    KisStrokeId strokeId = image()->startStroke(strategy);
+    image()->endStroke(strokeId);
 
-    QApplication::restoreOverrideCursor();
     m_d->maskDev->clear();
 }
 
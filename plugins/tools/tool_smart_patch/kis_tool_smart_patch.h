@@ -73,7 +73,6 @@ private:
 
 private:
     struct Private;
-    class InpaintCommand;
     const QScopedPointer<Private> m_d;
 
     void addMaskPath(KoPointerEvent *event);